@@ -0,0 +1,109 @@
+// ThresholdBlobDetector against cv::SimpleBlobDetector on testdata images,
+// optionally upscaled: detection time, blobs found and how many of the
+// SimpleBlobDetector blobs are found as well.
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "keypoints/threshold_blob_detector.h"
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/imgproc.hpp"
+
+ABSL_FLAG(std::vector<std::string>, images,
+          std::vector<std::string>({"testdata/blox.jpg",
+                                    "testdata/smarties.png"}),
+          "Images to detect blobs in");
+ABSL_FLAG(std::vector<std::string>, scales,
+          std::vector<std::string>({"1", "2", "4"}),
+          "Images are resized by these factors");
+ABSL_FLAG(int32_t, repeats, 10, "Runs per detector, times are averaged");
+
+namespace {
+
+double Milliseconds(int64 start) {
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+double TimeDetect(cv::Feature2D& detector, const cv::Mat& img,
+                  std::vector<cv::KeyPoint>& keypoints, int32_t repeats) {
+  const int64 start = cv::getTickCount();
+  for (int32_t r = 0; r < repeats; ++r) detector.detect(img, keypoints);
+  return Milliseconds(start) / repeats;
+}
+
+// Blobs of `want` with one of `got` within half their size.
+int Found(const std::vector<cv::KeyPoint>& want,
+          const std::vector<cv::KeyPoint>& got) {
+  int found = 0;
+  for (const cv::KeyPoint& w : want) {
+    found += std::any_of(got.begin(), got.end(), [&](const cv::KeyPoint& g) {
+      return cv::norm(g.pt - w.pt) <= std::max(w.size / 2, 2.f);
+    });
+  }
+  return found;
+}
+
+}  // namespace
+
+absl::Status Run() {
+  const int32_t repeats = std::max(absl::GetFlag(FLAGS_repeats), 1);
+  const cv::Ptr<cv::SimpleBlobDetector> simple =
+      cv::SimpleBlobDetector::create();
+  LOG(INFO) << absl::StreamFormat("%-24s %5s %11s %10s %9s %8s %6s %8s",
+                                  "image", "scale", "size", "simple_ms",
+                                  "ours_ms", "speedup", "blobs", "found");
+  for (const std::string& path : absl::GetFlag(FLAGS_images)) {
+    const cv::Mat original = cv::imread(path, cv::IMREAD_GRAYSCALE);
+    if (original.empty()) {
+      return absl::InvalidArgumentError(absl::StrCat("No image - ", path));
+    }
+    for (const std::string& scale_flag : absl::GetFlag(FLAGS_scales)) {
+      double scale = 0;
+      if (!absl::SimpleAtod(scale_flag, &scale) || scale <= 0) {
+        return absl::InvalidArgumentError(
+            absl::StrCat("Bad scale ", scale_flag));
+      }
+      cv::Mat img;
+      cv::resize(original, img, cv::Size(), scale, scale, cv::INTER_LINEAR);
+      // Blob areas grow with the image.
+      cv::SimpleBlobDetector::Params params;
+      params.maxArea *= scale * scale;
+      params.minArea *= scale * scale;
+      simple->setParams(params);
+      hello::keypoints::ThresholdBlobDetector::Options options;
+      options.max_area *= scale * scale;
+      options.min_area *= scale * scale;
+      const cv::Ptr<hello::keypoints::ThresholdBlobDetector> ours =
+          hello::keypoints::ThresholdBlobDetector::create(options, nullptr);
+
+      std::vector<cv::KeyPoint> want;
+      std::vector<cv::KeyPoint> got;
+      const double simple_ms = TimeDetect(*simple, img, want, repeats);
+      const double ours_ms = TimeDetect(*ours, img, got, repeats);
+      LOG(INFO) << absl::StreamFormat(
+          "%-24s %5s %11s %10.2f %9.2f %7.1fx %6d %4d/%-3d", path, scale_flag,
+          absl::StrFormat("%dx%d", img.cols, img.rows), simple_ms, ours_ms,
+          simple_ms / ours_ms, got.size(), Found(want, got), want.size());
+    }
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
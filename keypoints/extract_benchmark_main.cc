@@ -0,0 +1,104 @@
+// Images per second of feature extraction for every DescriptorType:
+// a detector created per call (the old detect_and_compute), a persistent
+// extractor on one thread and the parallel batch API.
+#include <string>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "keypoints/feature_extractor.h"
+#include "opencv2/imgcodecs.hpp"
+
+ABSL_FLAG(std::vector<std::string>, image_paths,
+          std::vector<std::string>({"testdata/box_in_scene.png",
+                                    "testdata/graf1.png",
+                                    "testdata/leuvenA.jpg",
+                                    "testdata/left01.jpg"}),
+          "Images, repeated to fill the batch");
+ABSL_FLAG(int32_t, batch_size, 32, "Images per batch");
+
+namespace {
+
+using ::hello::keypoints::DescriptorType;
+
+struct NamedType {
+  const char* name;
+  DescriptorType type;
+};
+
+constexpr NamedType kTypes[] = {
+    {"fast", DescriptorType::kFast},   {"blob", DescriptorType::kBlob},
+    {"sift", DescriptorType::kSift},   {"orb", DescriptorType::kOrb},
+    {"brisk", DescriptorType::kBrisk}, {"kaze", DescriptorType::kKaze},
+    {"akaze", DescriptorType::kAkaze},
+};
+
+double Seconds(int64 start) {
+  return (cv::getTickCount() - start) / cv::getTickFrequency();
+}
+
+}  // namespace
+
+absl::Status Run() {
+  std::vector<cv::Mat> images;
+  const std::vector<std::string> paths = absl::GetFlag(FLAGS_image_paths);
+  for (int32_t i = 0; i < absl::GetFlag(FLAGS_batch_size); ++i) {
+    const std::string& image_path = paths[i % paths.size()];
+    cv::Mat img = cv::imread(image_path, cv::IMREAD_GRAYSCALE);
+    if (img.empty()) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("No image - ", image_path));
+    }
+    images.push_back(img);
+  }
+  const int n = static_cast<int>(images.size());
+
+  LOG(INFO) << absl::StreamFormat("%-6s %14s %14s %14s %12s", "type",
+                                  "per_call_ips", "persistent_ips",
+                                  "batch_ips", "keypoints");
+  for (const NamedType& named : kTypes) {
+    const hello::keypoints::FeatureExtractor extractor(named.type);
+    std::vector<cv::KeyPoint> keypoints;
+    cv::Mat descriptors;
+
+    int64 start = cv::getTickCount();
+    for (const cv::Mat& image : images) {
+      cv::Ptr<cv::Feature2D> detector =
+          hello::keypoints::CreateFeature2D(named.type);
+      detector->detectAndCompute(image, cv::noArray(), keypoints,
+                                 descriptors);
+    }
+    const double per_call = n / Seconds(start);
+
+    start = cv::getTickCount();
+    for (const cv::Mat& image : images) {
+      extractor.DetectAndCompute(image, keypoints, descriptors);
+    }
+    const double persistent = n / Seconds(start);
+
+    start = cv::getTickCount();
+    const hello::keypoints::FeatureBatch batch = extractor.ExtractBatch(images);
+    const double batched = n / Seconds(start);
+
+    LOG(INFO) << absl::StreamFormat("%-6s %14.1f %14.1f %14.1f %12d",
+                                    named.name, per_call, persistent, batched,
+                                    batch.keypoints.size());
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
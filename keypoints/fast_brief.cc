@@ -0,0 +1,137 @@
+#include "keypoints/fast_brief.h"
+#include <algorithm>
+#include <cmath>
+#include "opencv2/imgproc.hpp"
+#include "util/trace.h"
+
+namespace hello::keypoints {
+namespace {
+
+constexpr int32_t kTests = FastBrief::kDescriptorBytes * 8;
+// Keypoints closer to the border can't be oriented or described.
+constexpr int32_t kBorder = FastBrief::kPatchRadius + 1;
+
+// Orientation of the patch around `center` from its intensity centroid,
+// in degrees.
+float IntensityCentroidAngle(const uint8_t* center, int step,
+                             const std::vector<int32_t>& umax) {
+  const int32_t radius = FastBrief::kPatchRadius;
+  int32_t m10 = 0;
+  int32_t m01 = 0;
+  for (int32_t u = -radius; u <= radius; ++u) m10 += u * center[u];
+  for (int32_t v = 1; v <= radius; ++v) {
+    int32_t v_sum = 0;
+    const int32_t d = umax[v];
+    for (int32_t u = -d; u <= d; ++u) {
+      const int32_t plus = center[u + v * step];
+      const int32_t minus = center[u - v * step];
+      v_sum += plus - minus;
+      m10 += u * (plus + minus);
+    }
+    m01 += v * v_sum;
+  }
+  return cv::fastAtan2(static_cast<float>(m01), static_cast<float>(m10));
+}
+
+}  // namespace
+
+FastBrief::FastBrief(const Options& options)
+    : options_(options), umax_(kPatchRadius + 1) {
+  for (int32_t v = 0; v <= kPatchRadius; ++v) {
+    umax_[v] = cvFloor(std::sqrt(static_cast<double>(kPatchRadius) *
+                                     kPatchRadius - v * v) + 0.5);
+  }
+  // Test points are isotropic Gaussian around the keypoint as in BRIEF,
+  // kept far enough inside the patch to stay there when rotated.
+  cv::RNG rng(0x5eed);
+  std::vector<cv::Point2f> base(2 * kTests);
+  for (cv::Point2f& p : base) {
+    do {
+      p = cv::Point2f(static_cast<float>(rng.gaussian(kPatchRadius * 0.4)),
+                      static_cast<float>(rng.gaussian(kPatchRadius * 0.4)));
+    } while (p.dot(p) > (kPatchRadius - 1) * (kPatchRadius - 1));
+  }
+  pattern_.resize(kAngleBins * base.size());
+  for (int32_t bin = 0; bin < kAngleBins; ++bin) {
+    const double angle = bin * 2 * CV_PI / kAngleBins;
+    const float c = static_cast<float>(std::cos(angle));
+    const float s = static_cast<float>(std::sin(angle));
+    for (size_t i = 0; i < base.size(); ++i) {
+      pattern_[bin * base.size() + i] =
+          cv::Point(cvRound(c * base[i].x - s * base[i].y),
+                    cvRound(s * base[i].x + c * base[i].y));
+    }
+  }
+}
+
+cv::Ptr<FastBrief> FastBrief::create(const Options& options) {
+  return cv::Ptr<FastBrief>(new FastBrief(options));
+}
+
+void FastBrief::detectAndCompute(cv::InputArray image_array,
+                                 cv::InputArray mask,
+                                 std::vector<cv::KeyPoint>& keypoints,
+                                 cv::OutputArray descriptors,
+                                 bool useProvidedKeypoints) {
+  TRACE_SCOPE("keypoints/fast_brief");
+  cv::Mat image = image_array.getMat();
+  if (image.channels() > 1) {
+    cv::cvtColor(image, image, cv::COLOR_BGR2GRAY);
+  }
+  if (!useProvidedKeypoints) {
+    cv::FAST(image, keypoints, options_.fast_threshold,
+             options_.nonmax_suppression);
+    if (!mask.empty()) {
+      cv::KeyPointsFilter::runByPixelsMask(keypoints, mask.getMat());
+    }
+  }
+  cv::KeyPointsFilter::runByImageBorder(keypoints, image.size(), kBorder);
+  if (!useProvidedKeypoints && options_.max_keypoints > 0) {
+    cv::KeyPointsFilter::retainBest(keypoints, options_.max_keypoints);
+  }
+  for (cv::KeyPoint& kp : keypoints) {
+    if (!useProvidedKeypoints || kp.angle < 0) {
+      kp.angle = IntensityCentroidAngle(
+          image.ptr<uint8_t>(cvRound(kp.pt.y)) + cvRound(kp.pt.x),
+          static_cast<int>(image.step), umax_);
+    }
+    if (kp.size <= 0) kp.size = 2 * kPatchRadius + 1;
+  }
+  if (!descriptors.needed()) return;
+
+  const int32_t n = static_cast<int32_t>(keypoints.size());
+  descriptors.create(n, kDescriptorBytes, CV_8U);
+  if (n == 0) return;
+  cv::Mat out = descriptors.getMat();
+  cv::Mat smoothed;
+  cv::GaussianBlur(image, smoothed, cv::Size(7, 7), 2, 2,
+                   cv::BORDER_REFLECT_101);
+  // The pattern as offsets into the smoothed image.
+  std::vector<int32_t> offsets(pattern_.size());
+  const int32_t step = static_cast<int32_t>(smoothed.step);
+  for (size_t i = 0; i < pattern_.size(); ++i) {
+    offsets[i] = pattern_[i].y * step + pattern_[i].x;
+  }
+  cv::parallel_for_(cv::Range(0, n), [&](const cv::Range& range) {
+    for (int32_t k = range.start; k < range.end; ++k) {
+      const cv::KeyPoint& kp = keypoints[k];
+      const uint8_t* center =
+          smoothed.ptr<uint8_t>(cvRound(kp.pt.y)) + cvRound(kp.pt.x);
+      const int32_t bin =
+          cvRound(kp.angle * kAngleBins / 360.f) % kAngleBins;
+      const int32_t* pair = &offsets[bin * 2 * kTests];
+      uint8_t* desc = out.ptr<uint8_t>(k);
+      for (int32_t b = 0; b < kDescriptorBytes; ++b, pair += 16) {
+        uint8_t value = 0;
+        for (int32_t bit = 0; bit < 8; ++bit) {
+          value |= static_cast<uint8_t>(
+                       center[pair[2 * bit]] < center[pair[2 * bit + 1]])
+                   << bit;
+        }
+        desc[b] = value;
+      }
+    }
+  });
+}
+
+}  // namespace hello::keypoints
@@ -0,0 +1,60 @@
+#ifndef KEYPOINTS_FAST_BRIEF_H_
+#define KEYPOINTS_FAST_BRIEF_H_
+
+#include <cstdint>
+#include <vector>
+#include "opencv2/features2d.hpp"
+
+namespace hello::keypoints {
+
+// FAST corners with steered BRIEF descriptors for real-time tracking, a
+// single-scale, stripped down ORB. Keypoints are oriented by the intensity
+// centroid of their patch. The 256 binary tests of the descriptor are
+// rotated in advance for every one of kAngleBins orientations and turned
+// into pixel offsets once per image, so describing a keypoint is a table
+// driven pass of byte compares over the smoothed image.
+class FastBrief : public cv::Feature2D {
+ public:
+  struct Options {
+    int32_t fast_threshold = 20;
+    bool nonmax_suppression = true;
+    // Strongest keypoints kept by FAST response, <= 0 keeps all.
+    int32_t max_keypoints = 1000;
+  };
+
+  static constexpr int32_t kDescriptorBytes = 32;
+  static constexpr int32_t kAngleBins = 32;
+  // Radius of the patch the orientation and the tests are taken from.
+  static constexpr int32_t kPatchRadius = 15;
+
+  static cv::Ptr<FastBrief> create(const Options& options);
+  static cv::Ptr<FastBrief> create() { return create(Options()); }
+
+  // With useProvidedKeypoints, keypoints without an angle (< 0) are
+  // oriented first. Keypoints too close to the border to describe are
+  // dropped either way.
+  void detectAndCompute(cv::InputArray image, cv::InputArray mask,
+                        std::vector<cv::KeyPoint>& keypoints,
+                        cv::OutputArray descriptors,
+                        bool useProvidedKeypoints = false) override;
+
+  int descriptorSize() const override { return kDescriptorBytes; }
+  int descriptorType() const override { return CV_8U; }
+  int defaultNorm() const override { return cv::NORM_HAMMING; }
+  cv::String getDefaultName() const override {
+    return "Feature2D.FastBrief";
+  }
+
+ private:
+  explicit FastBrief(const Options& options);
+
+  const Options options_;
+  // Test point pairs of every angle bin, kDescriptorBytes * 8 pairs each.
+  std::vector<cv::Point> pattern_;
+  // Half width of the circular patch at every row offset.
+  std::vector<int32_t> umax_;
+};
+
+}  // namespace hello::keypoints
+
+#endif  // KEYPOINTS_FAST_BRIEF_H_
@@ -0,0 +1,111 @@
+// Per-frame latency of FastBrief against ORB on video frames scaled to
+// 720p, with the number of cross-checked matches between consecutive
+// frames as a sanity check that both are usable for tracking.
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "keypoints/fast_brief.h"
+#include "keypoints/hamming_matcher.h"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/videoio.hpp"
+#include "util/status_macros.h"
+
+ABSL_FLAG(std::string, video_path, "testdata/Megamind.avi", "Video file path");
+ABSL_FLAG(int32_t, frames, 200, "Frames to process at most");
+ABSL_FLAG(int32_t, max_keypoints, 1000, "Keypoints per frame");
+
+namespace {
+
+double Milliseconds(int64 start) {
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+struct Latency {
+  std::vector<double> ms;
+  int64_t keypoints = 0;
+  int64_t matches = 0;
+  cv::Mat previous;
+};
+
+absl::Status Process(cv::Feature2D& detector, const cv::Mat& frame,
+                     Latency& latency) {
+  std::vector<cv::KeyPoint> keypoints;
+  cv::Mat descriptors;
+  const int64 start = cv::getTickCount();
+  detector.detectAndCompute(frame, cv::noArray(), keypoints, descriptors);
+  latency.ms.push_back(Milliseconds(start));
+  latency.keypoints += keypoints.size();
+  if (!latency.previous.empty() && !descriptors.empty()) {
+    std::vector<cv::DMatch> matches;
+    RETURN_IF_ERROR(hello::keypoints::HammingMatcher().Match(
+        latency.previous, descriptors, matches));
+    latency.matches += matches.size();
+  }
+  latency.previous = descriptors;
+  return absl::OkStatus();
+}
+
+void Report(const char* name, Latency& latency) {
+  std::vector<double>& ms = latency.ms;
+  if (ms.empty()) return;
+  std::sort(ms.begin(), ms.end());
+  double total = 0;
+  for (double m : ms) total += m;
+  const double pairs = std::max<double>(ms.size() - 1, 1);
+  LOG(INFO) << absl::StreamFormat(
+      "%-10s %8.3f %8.3f %8.3f %10.0f %10.0f", name, total / ms.size(),
+      ms[ms.size() / 2], ms[ms.size() * 99 / 100],
+      static_cast<double>(latency.keypoints) / ms.size(),
+      latency.matches / pairs);
+}
+
+}  // namespace
+
+absl::Status Run() {
+  const std::string video_path = absl::GetFlag(FLAGS_video_path);
+  cv::VideoCapture capture(video_path);
+  if (!capture.isOpened()) {
+    return absl::InvalidArgumentError(absl::StrCat("No video - ", video_path));
+  }
+  const int32_t max_keypoints = absl::GetFlag(FLAGS_max_keypoints);
+  hello::keypoints::FastBrief::Options options;
+  options.max_keypoints = max_keypoints;
+  const cv::Ptr<cv::Feature2D> fast_brief =
+      hello::keypoints::FastBrief::create(options);
+  const cv::Ptr<cv::Feature2D> orb = cv::ORB::create(max_keypoints);
+  Latency fast_brief_latency;
+  Latency orb_latency;
+  cv::Mat frame;
+  for (int32_t i = 0; i < absl::GetFlag(FLAGS_frames) && capture.read(frame);
+       ++i) {
+    cv::cvtColor(frame, frame, cv::COLOR_BGR2GRAY);
+    cv::resize(frame, frame, cv::Size(1280, 720));
+    RETURN_IF_ERROR(Process(*fast_brief, frame, fast_brief_latency));
+    RETURN_IF_ERROR(Process(*orb, frame, orb_latency));
+  }
+  LOG(INFO) << absl::StreamFormat("%-10s %8s %8s %8s %10s %10s", "detector",
+                                  "mean_ms", "p50_ms", "p99_ms", "keypoints",
+                                  "matches");
+  Report("fast_brief", fast_brief_latency);
+  Report("orb", orb_latency);
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
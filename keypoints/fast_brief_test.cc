@@ -0,0 +1,93 @@
+#include "keypoints/fast_brief.h"
+#include <vector>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+#include "keypoints/feature_extractor.h"
+#include "keypoints/hamming_matcher.h"
+#include "opencv2/imgproc.hpp"
+
+namespace hello::keypoints {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Gt;
+using ::testing::Le;
+using ::testing::SizeIs;
+
+cv::Mat MakeScene() {
+  cv::Mat img(480, 640, CV_8UC1, cv::Scalar(90));
+  cv::RNG rng(11);
+  for (int i = 0; i < 150; ++i) {
+    const cv::Point a(rng.uniform(0, 640), rng.uniform(0, 480));
+    const cv::Point b = a + cv::Point(rng.uniform(10, 60), rng.uniform(10, 60));
+    cv::rectangle(img, a, b, cv::Scalar(rng.uniform(0, 256)), -1);
+  }
+  cv::GaussianBlur(img, img, cv::Size(3, 3), 0);
+  return img;
+}
+
+TEST(FastBriefTest, DescribesEveryKeypoint) {
+  const cv::Mat img = MakeScene();
+  FastBrief::Options options;
+  options.max_keypoints = 300;
+  std::vector<cv::KeyPoint> keypoints;
+  cv::Mat descriptors;
+  FastBrief::create(options)->detectAndCompute(img, cv::noArray(), keypoints,
+                                               descriptors);
+  ASSERT_THAT(keypoints, SizeIs(Gt(50)));
+  EXPECT_THAT(keypoints, SizeIs(Le(300)));
+  EXPECT_THAT(descriptors.rows, Eq(static_cast<int>(keypoints.size())));
+  EXPECT_THAT(descriptors.cols, Eq(FastBrief::kDescriptorBytes));
+  EXPECT_THAT(descriptors.type(), Eq(CV_8U));
+  for (const cv::KeyPoint& kp : keypoints) {
+    EXPECT_THAT(kp.angle, Ge(0.f));
+    EXPECT_THAT(kp.angle, Le(360.f));
+  }
+}
+
+TEST(FastBriefTest, ProvidedKeypointsKeepTheirAngle) {
+  const cv::Mat img = MakeScene();
+  std::vector<cv::KeyPoint> keypoints = {cv::KeyPoint(100, 100, 31, 45),
+                                         cv::KeyPoint(2, 2, 31, 45)};
+  cv::Mat descriptors;
+  FastBrief::create()->detectAndCompute(img, cv::noArray(), keypoints,
+                                        descriptors, true);
+  // The second one is too close to the border.
+  ASSERT_THAT(keypoints, SizeIs(1));
+  EXPECT_THAT(keypoints[0].angle, Eq(45.f));
+  EXPECT_THAT(descriptors.rows, Eq(1));
+}
+
+TEST(FastBriefTest, MatchesUnderRotation) {
+  const cv::Mat img = MakeScene();
+  const cv::Mat rotation =
+      cv::getRotationMatrix2D(cv::Point2f(320, 240), 30, 1.0);
+  cv::Mat rotated;
+  cv::warpAffine(img, rotated, rotation, img.size());
+
+  const cv::Ptr<cv::Feature2D> detector =
+      CreateFeature2D(DescriptorType::kFast);
+  std::vector<cv::KeyPoint> kpts1;
+  std::vector<cv::KeyPoint> kpts2;
+  cv::Mat desc1;
+  cv::Mat desc2;
+  detector->detectAndCompute(img, cv::noArray(), kpts1, desc1);
+  detector->detectAndCompute(rotated, cv::noArray(), kpts2, desc2);
+  std::vector<cv::DMatch> matches;
+  ASSERT_TRUE(HammingMatcher().Match(desc1, desc2, matches).ok());
+  ASSERT_THAT(matches, SizeIs(Gt(30)));
+
+  const cv::Matx23d m(rotation);
+  int correct = 0;
+  for (const cv::DMatch& match : matches) {
+    const cv::Point2f p = kpts1[match.queryIdx].pt;
+    const cv::Point2f want(m(0, 0) * p.x + m(0, 1) * p.y + m(0, 2),
+                           m(1, 0) * p.x + m(1, 1) * p.y + m(1, 2));
+    correct += cv::norm(kpts2[match.trainIdx].pt - want) < 3;
+  }
+  EXPECT_THAT(correct, Ge(static_cast<int>(matches.size() * 0.7)));
+}
+
+}  // namespace
+}  // namespace hello::keypoints
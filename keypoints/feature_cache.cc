@@ -0,0 +1,385 @@
+#include "keypoints/feature_cache.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "glog/logging.h"
+#include "util/trace.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace hello::keypoints {
+namespace {
+
+constexpr char kMagic[4] = {'K', 'P', 'C', 'F'};
+constexpr uint32_t kVersion = 1;
+// Descriptor rows start at a multiple of this, for aligned SIMD loads.
+constexpr uint64_t kDescriptorAlignment = 16;
+// x, y, size, angle, response, octave, class_id.
+constexpr int32_t kKeypointArrays = 7;
+
+constexpr uint64_t kHashSeed = 0x6a09e667f3bcc908ull;
+// The splitmix64 increment, keeps runs of zero words from mapping to zero.
+constexpr uint64_t kHashIncrement = 0x9e3779b97f4a7c15ull;
+
+struct FileHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  int32_t num_keypoints;
+  int32_t descriptor_rows;
+  int32_t descriptor_cols;
+  int32_t descriptor_type;
+  uint64_t descriptor_offset;
+};
+
+uint64_t DescriptorOffset(int32_t num_keypoints) {
+  const uint64_t end =
+      sizeof(FileHeader) +
+      static_cast<uint64_t>(num_keypoints) * kKeypointArrays * 4;
+  return (end + kDescriptorAlignment - 1) / kDescriptorAlignment *
+         kDescriptorAlignment;
+}
+
+// splitmix64 finalizer, every input bit reaches every output bit.
+uint64_t Mix64(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+// 64-bit words, then the remaining bytes, each mixed into the hash with
+// Mix64. A multiply alone would only carry differences upwards, leaving
+// the high byte of every word to the top bits of the hash.
+void HashBytes(const void* data, size_t size, uint64_t& hash) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes + i, sizeof(word));
+    hash = Mix64(hash ^ word) + kHashIncrement;
+  }
+  uint64_t tail = size - i;
+  for (int32_t shift = 8; i < size; ++i, shift += 8) {
+    tail |= static_cast<uint64_t>(bytes[i]) << shift;
+  }
+  hash = Mix64(hash ^ tail) + kHashIncrement;
+}
+
+void HashMat(const cv::Mat& mat, uint64_t& hash) {
+  const int32_t shape[3] = {mat.rows, mat.cols, mat.type()};
+  HashBytes(shape, sizeof(shape), hash);
+  for (int r = 0; r < mat.rows; ++r) {
+    HashBytes(mat.ptr(r), mat.cols * mat.elemSize(), hash);
+  }
+}
+
+std::string DefaultDetectorId(const cv::Feature2D& detector) {
+  cv::FileStorage fs(".yml", cv::FileStorage::WRITE | cv::FileStorage::MEMORY);
+  detector.write(fs);
+  return absl::StrCat(detector.getDefaultName(), "\n",
+                      fs.releaseAndGetString());
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<MappedFeatures>> MappedFeatures::Open(
+    absl::string_view file_path) {
+  auto features = absl::WrapUnique(new MappedFeatures());
+  const std::string path(file_path);
+#ifndef _WIN32
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return absl::NotFoundError(absl::StrCat("No file ", path));
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    return absl::DataLossError(absl::StrCat("Empty file ", path));
+  }
+  void* data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    return absl::InternalError(absl::StrCat("Can't map ", path));
+  }
+  features->data_ = static_cast<const char*>(data);
+  features->size_ = st.st_size;
+  features->mapped_ = true;
+#else
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  if (!in) return absl::NotFoundError(absl::StrCat("No file ", path));
+  features->buffer_.resize(static_cast<size_t>(in.tellg()));
+  in.seekg(0);
+  if (!in.read(features->buffer_.data(), features->buffer_.size())) {
+    return absl::DataLossError(absl::StrCat("Can't read ", path));
+  }
+  features->data_ = features->buffer_.data();
+  features->size_ = features->buffer_.size();
+#endif
+  if (absl::Status status = features->Parse(); !status.ok()) {
+    return absl::DataLossError(absl::StrCat(status.message(), " in ", path));
+  }
+  return features;
+}
+
+MappedFeatures::~MappedFeatures() {
+#ifndef _WIN32
+  if (mapped_) ::munmap(const_cast<char*>(data_), size_);
+#endif
+}
+
+absl::Status MappedFeatures::Parse() {
+  if (size_ < sizeof(FileHeader)) return absl::DataLossError("Short file");
+  FileHeader header;
+  std::memcpy(&header, data_, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion) {
+    return absl::DataLossError("Not a feature cache file");
+  }
+  if (header.num_keypoints < 0 || header.descriptor_rows < 0 ||
+      header.descriptor_cols < 0 ||
+      CV_MAT_CN(header.descriptor_type) != 1 ||
+      header.descriptor_offset != DescriptorOffset(header.num_keypoints)) {
+    return absl::DataLossError("Bad header");
+  }
+  if (header.descriptor_rows != 0 &&
+      header.descriptor_rows != header.num_keypoints) {
+    return absl::DataLossError(
+        absl::StrFormat("%d descriptor rows for %d keypoints",
+                        header.descriptor_rows, header.num_keypoints));
+  }
+  const uint64_t descriptor_bytes =
+      static_cast<uint64_t>(header.descriptor_rows) * header.descriptor_cols *
+      CV_ELEM_SIZE(header.descriptor_type);
+  if (header.descriptor_offset + descriptor_bytes != size_) {
+    return absl::DataLossError("Truncated file");
+  }
+  key_ = header.key;
+  num_keypoints_ = header.num_keypoints;
+  if (header.descriptor_rows > 0) {
+    descriptors_ = cv::Mat(header.descriptor_rows, header.descriptor_cols,
+                           header.descriptor_type,
+                           const_cast<char*>(data_ + header.descriptor_offset));
+  }
+  return absl::OkStatus();
+}
+
+std::vector<cv::KeyPoint> MappedFeatures::keypoints() const {
+  const size_t n = num_keypoints_;
+  const char* arrays = data_ + sizeof(FileHeader);
+  auto floats = [&](int32_t array) {
+    return reinterpret_cast<const float*>(arrays + array * n * 4);
+  };
+  auto ints = [&](int32_t array) {
+    return reinterpret_cast<const int32_t*>(arrays + array * n * 4);
+  };
+  const float* x = floats(0);
+  const float* y = floats(1);
+  const float* size = floats(2);
+  const float* angle = floats(3);
+  const float* response = floats(4);
+  const int32_t* octave = ints(5);
+  const int32_t* class_id = ints(6);
+  std::vector<cv::KeyPoint> keypoints(n);
+  for (size_t i = 0; i < n; ++i) {
+    keypoints[i] = cv::KeyPoint(x[i], y[i], size[i], angle[i], response[i],
+                                octave[i], class_id[i]);
+  }
+  return keypoints;
+}
+
+FeatureCache::FeatureCache(std::string directory)
+    : directory_(std::move(directory)) {}
+
+uint64_t FeatureCache::Key(const cv::Mat& image, const cv::Mat& mask,
+                           absl::string_view detector_id) {
+  uint64_t hash = kHashSeed;
+  HashMat(image, hash);
+  if (!mask.empty()) HashMat(mask, hash);
+  HashBytes(detector_id.data(), detector_id.size(), hash);
+  return hash;
+}
+
+uint64_t FeatureCache::Key(uint64_t image_key,
+                           const std::vector<cv::KeyPoint>& keypoints) {
+  uint64_t hash = image_key;
+  for (const cv::KeyPoint& kp : keypoints) {
+    const float floats[5] = {kp.pt.x, kp.pt.y, kp.size, kp.angle,
+                             kp.response};
+    const int32_t ints[2] = {kp.octave, kp.class_id};
+    HashBytes(floats, sizeof(floats), hash);
+    HashBytes(ints, sizeof(ints), hash);
+  }
+  const uint64_t count = keypoints.size();
+  HashBytes(&count, sizeof(count), hash);
+  return hash;
+}
+
+std::string FeatureCache::PathOf(uint64_t key) const {
+  const std::string file_name = absl::StrFormat("%016x.kpc", key);
+  return (std::filesystem::path(directory_) / file_name).string();
+}
+
+absl::StatusOr<std::unique_ptr<MappedFeatures>> FeatureCache::Load(
+    uint64_t key) const {
+  TRACE_SCOPE("keypoints/feature_cache_load");
+  auto features = MappedFeatures::Open(PathOf(key));
+  if (features.ok() && (*features)->key() != key) {
+    return absl::DataLossError(absl::StrCat("Key mismatch in ", PathOf(key)));
+  }
+  return features;
+}
+
+absl::Status FeatureCache::Store(uint64_t key,
+                                 const std::vector<cv::KeyPoint>& keypoints,
+                                 const cv::Mat& descriptors) const {
+  TRACE_SCOPE("keypoints/feature_cache_store");
+  if (!descriptors.empty() &&
+      (descriptors.channels() != 1 ||
+       descriptors.rows != static_cast<int>(keypoints.size()))) {
+    return absl::InvalidArgumentError(
+        "Expected one single channel descriptor row per keypoint");
+  }
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+  if (error) {
+    return absl::InternalError(
+        absl::StrCat("Can't create ", directory_, ": ", error.message()));
+  }
+
+  const int32_t n = static_cast<int32_t>(keypoints.size());
+  FileHeader header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.key = key;
+  header.num_keypoints = n;
+  header.descriptor_rows = descriptors.rows;
+  header.descriptor_cols = descriptors.cols;
+  header.descriptor_type = descriptors.empty() ? CV_8U : descriptors.type();
+  header.descriptor_offset = DescriptorOffset(n);
+
+  std::vector<float> floats(static_cast<size_t>(n) * 5);
+  std::vector<int32_t> ints(static_cast<size_t>(n) * 2);
+  for (int32_t i = 0; i < n; ++i) {
+    const cv::KeyPoint& kp = keypoints[i];
+    floats[i] = kp.pt.x;
+    floats[n + i] = kp.pt.y;
+    floats[2 * n + i] = kp.size;
+    floats[3 * n + i] = kp.angle;
+    floats[4 * n + i] = kp.response;
+    ints[i] = kp.octave;
+    ints[n + i] = kp.class_id;
+  }
+
+  // A name of its own for every writer, renamed over the final file once
+  // complete.
+  static std::atomic<uint64_t> counter{0};
+  const std::string path = PathOf(key);
+  const std::string temp_path = absl::StrFormat(
+      "%s.%x.%x.%d.tmp", path,
+      std::hash<std::thread::id>()(std::this_thread::get_id()),
+      std::chrono::steady_clock::now().time_since_epoch().count(),
+      counter.fetch_add(1));
+  {
+    std::ofstream out(temp_path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(floats.data()),
+              floats.size() * sizeof(float));
+    out.write(reinterpret_cast<const char*>(ints.data()),
+              ints.size() * sizeof(int32_t));
+    const std::string padding(
+        header.descriptor_offset -
+            (sizeof(header) + static_cast<uint64_t>(n) * kKeypointArrays * 4),
+        '\0');
+    out.write(padding.data(), padding.size());
+    for (int r = 0; r < descriptors.rows; ++r) {
+      out.write(reinterpret_cast<const char*>(descriptors.ptr(r)),
+                descriptors.cols * descriptors.elemSize());
+    }
+    out.close();
+    if (!out) {
+      std::filesystem::remove(temp_path, error);
+      return absl::InternalError(absl::StrCat("Failed writing ", temp_path));
+    }
+  }
+  std::filesystem::rename(temp_path, path, error);
+  if (error) {
+    std::filesystem::remove(temp_path, error);
+    return absl::InternalError(absl::StrCat("Can't rename to ", path));
+  }
+  return absl::OkStatus();
+}
+
+cv::Ptr<CachedFeature2D> CachedFeature2D::create(
+    const cv::Ptr<cv::Feature2D>& detector, const std::string& directory,
+    const std::string& detector_id) {
+  return cv::Ptr<CachedFeature2D>(new CachedFeature2D(
+      detector, directory,
+      detector_id.empty() ? DefaultDetectorId(*detector) : detector_id));
+}
+
+CachedFeature2D::CachedFeature2D(const cv::Ptr<cv::Feature2D>& detector,
+                                 const std::string& directory,
+                                 std::string detector_id)
+    : detector_(detector),
+      cache_(directory),
+      detector_id_(std::move(detector_id)) {}
+
+cv::String CachedFeature2D::getDefaultName() const {
+  return detector_->getDefaultName() + ".Cached";
+}
+
+void CachedFeature2D::detectAndCompute(cv::InputArray image,
+                                       cv::InputArray mask,
+                                       std::vector<cv::KeyPoint>& keypoints,
+                                       cv::OutputArray descriptors,
+                                       bool useProvidedKeypoints) {
+  const uint64_t image_key =
+      FeatureCache::Key(image.getMat(), mask.getMat(), detector_id_);
+  // compute() lands here with the keypoints of a previous detect(), its
+  // entries are keyed by these keypoints as well.
+  const uint64_t key = useProvidedKeypoints
+                           ? FeatureCache::Key(image_key, keypoints)
+                           : image_key;
+  if (auto cached = cache_.Load(key); cached.ok()) {
+    // An entry written by detect() alone can't serve detectAndCompute().
+    const bool complete = (*cached)->num_keypoints() == 0 ||
+                          !(*cached)->descriptors().empty();
+    if (!descriptors.needed() || complete) {
+      keypoints = (*cached)->keypoints();
+      if (descriptors.needed()) {
+        (*cached)->descriptors().copyTo(descriptors);
+        ++descriptor_hits_;
+      }
+      if (!useProvidedKeypoints) ++hits_;
+      return;
+    }
+  } else if (!absl::IsNotFound(cached.status())) {
+    LOG(WARNING) << "Ignoring feature cache entry: " << cached.status();
+  }
+  if (!useProvidedKeypoints) ++misses_;
+  if (descriptors.needed()) ++descriptor_misses_;
+  // Feature2D::detect() lands here without descriptors, detect-only
+  // detectors such as FAST implement nothing but detect().
+  if (descriptors.needed()) {
+    detector_->detectAndCompute(image, mask, keypoints, descriptors,
+                                useProvidedKeypoints);
+  } else if (!useProvidedKeypoints) {
+    detector_->detect(image, keypoints, mask);
+  } else {
+    return;
+  }
+  const absl::Status status = cache_.Store(
+      key, keypoints, descriptors.needed() ? descriptors.getMat() : cv::Mat());
+  if (!status.ok()) LOG(WARNING) << "Feature cache: " << status;
+}
+
+}  // namespace hello::keypoints
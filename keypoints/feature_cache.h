@@ -0,0 +1,121 @@
+#ifndef KEYPOINTS_FEATURE_CACHE_H_
+#define KEYPOINTS_FEATURE_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "opencv2/features2d.hpp"
+
+namespace hello::keypoints {
+
+// Keypoints and descriptors of one image read from a cache file. The file
+// is memory-mapped read-only, where mmap isn't available it is read into
+// memory instead.
+class MappedFeatures {
+ public:
+  static absl::StatusOr<std::unique_ptr<MappedFeatures>> Open(
+      absl::string_view file_path);
+  ~MappedFeatures();
+
+  MappedFeatures(const MappedFeatures&) = delete;
+  MappedFeatures& operator=(const MappedFeatures&) = delete;
+
+  uint64_t key() const { return key_; }
+  int32_t num_keypoints() const { return num_keypoints_; }
+  // Unpacked from the structure of arrays in the file.
+  std::vector<cv::KeyPoint> keypoints() const;
+  // Points into the mapping, read-only and valid while this object lives.
+  const cv::Mat& descriptors() const { return descriptors_; }
+
+ private:
+  MappedFeatures() = default;
+  absl::Status Parse();
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  bool mapped_ = false;
+  std::vector<char> buffer_;
+  uint64_t key_ = 0;
+  int32_t num_keypoints_ = 0;
+  cv::Mat descriptors_;
+};
+
+// Directory of feature files, one per key. A key covers the image content
+// and the detector parameters, see Key(). Files are written under a
+// temporary name and renamed into place, so any number of readers can use
+// the directory while features are being stored.
+class FeatureCache {
+ public:
+  explicit FeatureCache(std::string directory);
+
+  // 64-bit hash of the pixels, of the mask if any and of `detector_id`.
+  static uint64_t Key(const cv::Mat& image, const cv::Mat& mask,
+                      absl::string_view detector_id);
+  // Key of the descriptors of `keypoints` in the image of `image_key`.
+  static uint64_t Key(uint64_t image_key,
+                      const std::vector<cv::KeyPoint>& keypoints);
+
+  std::string PathOf(uint64_t key) const;
+
+  // NotFound if the key isn't cached, DataLoss if its file is corrupt.
+  absl::StatusOr<std::unique_ptr<MappedFeatures>> Load(uint64_t key) const;
+
+  absl::Status Store(uint64_t key, const std::vector<cv::KeyPoint>& keypoints,
+                     const cv::Mat& descriptors) const;
+
+ private:
+  const std::string directory_;
+};
+
+// Feature2D that answers detect / compute / detectAndCompute from a
+// FeatureCache and runs the wrapped detector only on a miss, storing its
+// result. compute() entries are keyed by the image and the given keypoints,
+// so detect() followed by compute(), as cv::Stitcher does, is served from
+// the cache too. It can be passed wherever OpenCV takes a Feature2D, e.g.
+// Stitcher::setFeaturesFinder.
+class CachedFeature2D : public cv::Feature2D {
+ public:
+  // `detector_id` tells detector configurations apart, by default the name
+  // and the saved parameters of the detector.
+  static cv::Ptr<CachedFeature2D> create(const cv::Ptr<cv::Feature2D>& detector,
+                                         const std::string& directory,
+                                         const std::string& detector_id = "");
+
+  void detectAndCompute(cv::InputArray image, cv::InputArray mask,
+                        std::vector<cv::KeyPoint>& keypoints,
+                        cv::OutputArray descriptors,
+                        bool useProvidedKeypoints = false) override;
+
+  int descriptorSize() const override { return detector_->descriptorSize(); }
+  int descriptorType() const override { return detector_->descriptorType(); }
+  int defaultNorm() const override { return detector_->defaultNorm(); }
+  cv::String getDefaultName() const override;
+
+  // Lookups of keypoints, by detect() and detectAndCompute().
+  int64_t hits() const { return hits_; }
+  int64_t misses() const { return misses_; }
+  // Lookups of descriptors, by compute() and detectAndCompute().
+  int64_t descriptor_hits() const { return descriptor_hits_; }
+  int64_t descriptor_misses() const { return descriptor_misses_; }
+
+ private:
+  CachedFeature2D(const cv::Ptr<cv::Feature2D>& detector,
+                  const std::string& directory, std::string detector_id);
+
+  const cv::Ptr<cv::Feature2D> detector_;
+  const FeatureCache cache_;
+  const std::string detector_id_;
+  std::atomic<int64_t> hits_{0};
+  std::atomic<int64_t> misses_{0};
+  std::atomic<int64_t> descriptor_hits_{0};
+  std::atomic<int64_t> descriptor_misses_{0};
+};
+
+}  // namespace hello::keypoints
+
+#endif  // KEYPOINTS_FEATURE_CACHE_H_
@@ -0,0 +1,178 @@
+#include "keypoints/feature_cache.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+#include "opencv2/imgproc.hpp"
+
+namespace hello::keypoints {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Ne;
+using ::testing::SizeIs;
+
+std::string TestDirectory(const std::string& name) {
+  const std::string directory = testing::TempDir() + "/" + name;
+  std::filesystem::remove_all(directory);
+  return directory;
+}
+
+cv::Mat MakeScene() {
+  cv::Mat img(240, 320, CV_8UC1, cv::Scalar(30));
+  cv::RNG rng(7);
+  for (int i = 0; i < 40; ++i) {
+    cv::rectangle(img,
+                  cv::Rect(rng.uniform(0, 300), rng.uniform(0, 220),
+                           rng.uniform(5, 40), rng.uniform(5, 40)),
+                  cv::Scalar(rng.uniform(60, 255)), -1);
+  }
+  return img;
+}
+
+TEST(FeatureCacheTest, StoresAndLoads) {
+  const FeatureCache cache(TestDirectory("feature_cache_store"));
+  std::vector<cv::KeyPoint> keypoints = {
+      cv::KeyPoint(1.5f, 2.5f, 3.0f, 45.0f, 0.25f, 2, 7),
+      cv::KeyPoint(10.0f, 20.0f, 8.0f, -1.0f, 0.5f, 0, -1),
+      cv::KeyPoint(100.0f, 50.0f, 16.0f, 270.0f, 0.75f, 1, 3)};
+  cv::Mat descriptors(3, 61, CV_8U);
+  cv::randu(descriptors, 0, 256);
+  ASSERT_TRUE(cache.Store(42, keypoints, descriptors).ok());
+
+  auto features = cache.Load(42);
+  ASSERT_TRUE(features.ok()) << features.status();
+  const std::vector<cv::KeyPoint> loaded = (*features)->keypoints();
+  ASSERT_THAT(loaded, SizeIs(3));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_THAT(loaded[i].pt, Eq(keypoints[i].pt));
+    EXPECT_THAT(loaded[i].size, Eq(keypoints[i].size));
+    EXPECT_THAT(loaded[i].angle, Eq(keypoints[i].angle));
+    EXPECT_THAT(loaded[i].response, Eq(keypoints[i].response));
+    EXPECT_THAT(loaded[i].octave, Eq(keypoints[i].octave));
+    EXPECT_THAT(loaded[i].class_id, Eq(keypoints[i].class_id));
+  }
+  EXPECT_THAT(cv::norm((*features)->descriptors(), descriptors, cv::NORM_INF),
+              Eq(0));
+  EXPECT_TRUE(absl::IsNotFound(cache.Load(43).status()));
+}
+
+TEST(FeatureCacheTest, RejectsTruncatedFile) {
+  const FeatureCache cache(TestDirectory("feature_cache_truncated"));
+  cv::Mat descriptors(1, 128, CV_32F, cv::Scalar(1));
+  ASSERT_TRUE(cache.Store(1, {cv::KeyPoint(1, 1, 1)}, descriptors).ok());
+  std::filesystem::resize_file(cache.PathOf(1),
+                               std::filesystem::file_size(cache.PathOf(1)) - 4);
+  EXPECT_TRUE(absl::IsDataLoss(cache.Load(1).status()));
+}
+
+TEST(FeatureCacheTest, RejectsDescriptorRowMismatch) {
+  const FeatureCache cache(TestDirectory("feature_cache_rows"));
+  cv::Mat descriptors(2, 4, CV_32F, cv::Scalar(1));
+  ASSERT_TRUE(cache.Store(1, {cv::KeyPoint(1, 1, 1), cv::KeyPoint(2, 2, 1)},
+                          descriptors)
+                  .ok());
+  // descriptor_rows follows magic, version, key and num_keypoints.
+  {
+    std::fstream file(cache.PathOf(1),
+                      std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(20);
+    const int32_t rows = 1;
+    file.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+  }
+  // The file size still matches, the keypoint count doesn't.
+  std::filesystem::resize_file(cache.PathOf(1),
+                               std::filesystem::file_size(cache.PathOf(1)) -
+                                   4 * sizeof(float));
+  EXPECT_TRUE(absl::IsDataLoss(cache.Load(1).status()));
+}
+
+TEST(FeatureCacheTest, KeyCoversPixelsAndDetector) {
+  const cv::Mat image = MakeScene();
+  cv::Mat changed = image.clone();
+  changed.at<uint8_t>(100, 100) ^= 1;
+  const uint64_t key = FeatureCache::Key(image, cv::Mat(), "ORB");
+  EXPECT_THAT(FeatureCache::Key(image.clone(), cv::Mat(), "ORB"), Eq(key));
+  EXPECT_THAT(FeatureCache::Key(changed, cv::Mat(), "ORB"), Ne(key));
+  EXPECT_THAT(FeatureCache::Key(image, cv::Mat(), "SIFT"), Ne(key));
+}
+
+TEST(FeatureCacheTest, KeySpreadsHighByteChanges) {
+  const cv::Mat image = MakeScene();
+  const uint64_t key = FeatureCache::Key(image, cv::Mat(), "ORB");
+  // Bytes at offsets 7 mod 8 are the high bytes of the hashed words.
+  for (int x : {7, 15, 103}) {
+    cv::Mat changed = image.clone();
+    changed.at<uint8_t>(10, x) ^= 0x80;
+    const uint64_t changed_key = FeatureCache::Key(changed, cv::Mat(), "ORB");
+    EXPECT_THAT(changed_key & 0xffffffff, Ne(key & 0xffffffff)) << x;
+  }
+}
+
+TEST(CachedFeature2DTest, SecondRunHitsTheCache) {
+  const cv::Mat image = MakeScene();
+  cv::Ptr<CachedFeature2D> detector = CachedFeature2D::create(
+      cv::ORB::create(), TestDirectory("cached_feature2d"));
+  std::vector<cv::KeyPoint> cold_keypoints;
+  cv::Mat cold_descriptors;
+  detector->detectAndCompute(image, cv::noArray(), cold_keypoints,
+                             cold_descriptors);
+  std::vector<cv::KeyPoint> warm_keypoints;
+  cv::Mat warm_descriptors;
+  detector->detectAndCompute(image, cv::noArray(), warm_keypoints,
+                             warm_descriptors);
+
+  EXPECT_THAT(detector->misses(), Eq(1));
+  EXPECT_THAT(detector->hits(), Eq(1));
+  EXPECT_THAT(detector->descriptor_misses(), Eq(1));
+  EXPECT_THAT(detector->descriptor_hits(), Eq(1));
+  ASSERT_THAT(cold_keypoints, SizeIs(Ne(0)));
+  ASSERT_THAT(warm_keypoints, SizeIs(cold_keypoints.size()));
+  EXPECT_THAT(cv::norm(warm_descriptors, cold_descriptors, cv::NORM_INF),
+              Eq(0));
+}
+
+// The way cv::Stitcher finds features.
+TEST(CachedFeature2DTest, CachesDetectThenCompute) {
+  const cv::Mat image = MakeScene();
+  cv::Ptr<CachedFeature2D> detector = CachedFeature2D::create(
+      cv::ORB::create(), TestDirectory("cached_compute"));
+  std::vector<cv::KeyPoint> keypoints[2];
+  cv::Mat descriptors[2];
+  for (int run = 0; run < 2; ++run) {
+    detector->detect(image, keypoints[run]);
+    detector->compute(image, keypoints[run], descriptors[run]);
+  }
+
+  EXPECT_THAT(detector->misses(), Eq(1));
+  EXPECT_THAT(detector->hits(), Eq(1));
+  EXPECT_THAT(detector->descriptor_misses(), Eq(1));
+  EXPECT_THAT(detector->descriptor_hits(), Eq(1));
+  ASSERT_THAT(keypoints[0], SizeIs(Ne(0)));
+  ASSERT_THAT(keypoints[1], SizeIs(keypoints[0].size()));
+  ASSERT_THAT(descriptors[1].rows, Eq(descriptors[0].rows));
+  EXPECT_THAT(cv::norm(descriptors[1], descriptors[0], cv::NORM_INF), Eq(0));
+}
+
+TEST(CachedFeature2DTest, CachesDetectOnlyDetectors) {
+  const cv::Mat image = MakeScene();
+  cv::Ptr<CachedFeature2D> detector = CachedFeature2D::create(
+      cv::FastFeatureDetector::create(), TestDirectory("cached_fast"));
+  std::vector<cv::KeyPoint> cold_keypoints;
+  detector->detect(image, cold_keypoints);
+  std::vector<cv::KeyPoint> warm_keypoints;
+  detector->detect(image, warm_keypoints);
+
+  EXPECT_THAT(detector->misses(), Eq(1));
+  EXPECT_THAT(detector->hits(), Eq(1));
+  ASSERT_THAT(cold_keypoints, SizeIs(Ne(0)));
+  ASSERT_THAT(warm_keypoints, SizeIs(cold_keypoints.size()));
+  for (size_t i = 0; i < cold_keypoints.size(); ++i) {
+    EXPECT_THAT(warm_keypoints[i].pt, Eq(cold_keypoints[i].pt));
+    EXPECT_THAT(warm_keypoints[i].response, Eq(cold_keypoints[i].response));
+  }
+}
+
+}  // namespace
+}  // namespace hello::keypoints
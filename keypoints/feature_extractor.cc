@@ -0,0 +1,117 @@
+#include "keypoints/feature_extractor.h"
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include "absl/container/flat_hash_map.h"
+#include "glog/logging.h"
+#include "keypoints/fast_brief.h"
+#include "keypoints/feature_cache.h"
+#include "keypoints/threshold_blob_detector.h"
+#include "util/trace.h"
+
+namespace hello::keypoints {
+namespace {
+
+std::atomic<uint64_t> next_extractor_id{0};
+
+}  // namespace
+
+cv::Ptr<cv::Feature2D> CreateFeature2D(DescriptorType type) {
+  switch (type) {
+    case DescriptorType::kFast:
+      return FastBrief::create();
+    case DescriptorType::kBlob:
+      return ThresholdBlobDetector::create();
+    case DescriptorType::kSift:
+      return cv::SIFT::create();
+    case DescriptorType::kOrb:
+      return cv::ORB::create();
+    case DescriptorType::kBrisk:
+      return cv::BRISK::create();
+    case DescriptorType::kKaze:
+      return cv::KAZE::create();
+    case DescriptorType::kAkaze:
+      return cv::AKAZE::create();
+  }
+  LOG(FATAL) << "Unknown descriptor type " << static_cast<int>(type);
+  return nullptr;
+}
+
+cv::Mat FeatureBatch::descriptors_of(int32_t i) const {
+  if (descriptors.empty()) return cv::Mat();
+  return descriptors.rowRange(offsets[i], offsets[i + 1]);
+}
+
+std::vector<cv::KeyPoint> FeatureBatch::keypoints_of(int32_t i) const {
+  return std::vector<cv::KeyPoint>(keypoints.begin() + offsets[i],
+                                   keypoints.begin() + offsets[i + 1]);
+}
+
+FeatureExtractor::FeatureExtractor(DescriptorType type,
+                                   std::string cache_directory)
+    : type_(type),
+      cache_directory_(std::move(cache_directory)),
+      id_(next_extractor_id.fetch_add(1)) {}
+
+cv::Feature2D& FeatureExtractor::Local() const {
+  // Instances of extractors that are gone stay until the thread exits, there
+  // are only a handful of them.
+  thread_local absl::flat_hash_map<uint64_t, cv::Ptr<cv::Feature2D>> instances;
+  cv::Ptr<cv::Feature2D>& instance = instances[id_];
+  if (instance.empty()) {
+    instance = CreateFeature2D(type_);
+    if (!cache_directory_.empty()) {
+      instance = CachedFeature2D::create(instance, cache_directory_);
+    }
+  }
+  return *instance;
+}
+
+void FeatureExtractor::DetectAndCompute(const cv::Mat& image,
+                                        std::vector<cv::KeyPoint>& keypoints,
+                                        cv::Mat& descriptors) const {
+  TRACE_SCOPE("keypoints/detect_and_compute");
+  Local().detectAndCompute(image, cv::noArray(), keypoints, descriptors);
+}
+
+FeatureBatch FeatureExtractor::ExtractBatch(
+    const std::vector<cv::Mat>& images) const {
+  const int n = static_cast<int>(images.size());
+  std::vector<std::vector<cv::KeyPoint>> keypoints(n);
+  std::vector<cv::Mat> descriptors(n);
+  cv::parallel_for_(cv::Range(0, n), [&](const cv::Range& range) {
+    for (int i = range.start; i < range.end; ++i) {
+      DetectAndCompute(images[i], keypoints[i], descriptors[i]);
+    }
+  });
+
+  FeatureBatch batch;
+  batch.offsets.resize(n + 1);
+  int desc_cols = 0;
+  int desc_type = -1;
+  for (int i = 0; i < n; ++i) {
+    batch.offsets[i + 1] =
+        batch.offsets[i] + static_cast<int32_t>(keypoints[i].size());
+    if (!descriptors[i].empty()) {
+      desc_cols = descriptors[i].cols;
+      desc_type = descriptors[i].type();
+    }
+  }
+  const int total = batch.offsets[n];
+  batch.keypoints.resize(total);
+  if (desc_type >= 0) batch.descriptors.create(total, desc_cols, desc_type);
+  // Copy everything into the contiguous buffers.
+  cv::parallel_for_(cv::Range(0, n), [&](const cv::Range& range) {
+    for (int i = range.start; i < range.end; ++i) {
+      std::copy(keypoints[i].begin(), keypoints[i].end(),
+                batch.keypoints.begin() + batch.offsets[i]);
+      if (desc_type >= 0 && !descriptors[i].empty()) {
+        descriptors[i].copyTo(batch.descriptors.rowRange(
+            batch.offsets[i], batch.offsets[i + 1]));
+      }
+    }
+  });
+  return batch;
+}
+
+}  // namespace hello::keypoints
@@ -0,0 +1,62 @@
+#ifndef KEYPOINTS_FEATURE_EXTRACTOR_H_
+#define KEYPOINTS_FEATURE_EXTRACTOR_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "keypoints/types.h"
+#include "opencv2/features2d.hpp"
+
+namespace hello::keypoints {
+
+// Returns a new OpenCV detector / extractor for the type, kFast is FAST
+// with steered BRIEF descriptors, see FastBrief, and kBlob blobs described
+// with SIFT, see ThresholdBlobDetector.
+cv::Ptr<cv::Feature2D> CreateFeature2D(DescriptorType type);
+
+// Features of a batch of images stored back to back. Keypoints and
+// descriptor rows of image i are in [offsets[i], offsets[i + 1]).
+struct FeatureBatch {
+  std::vector<cv::KeyPoint> keypoints;
+  cv::Mat descriptors;
+  std::vector<int32_t> offsets = {0};
+
+  int32_t size() const { return static_cast<int32_t>(offsets.size()) - 1; }
+  int32_t count(int32_t i) const { return offsets[i + 1] - offsets[i]; }
+  // Shares the data, no copy. Empty for types without descriptors.
+  cv::Mat descriptors_of(int32_t i) const;
+  std::vector<cv::KeyPoint> keypoints_of(int32_t i) const;
+};
+
+// Detects and describes features with detectors that are built once per
+// worker thread and reused for every image afterwards. All methods are
+// thread-safe.
+class FeatureExtractor {
+ public:
+  // With a `cache_directory` features are kept in a FeatureCache there and
+  // detection only runs for images that aren't cached yet.
+  explicit FeatureExtractor(DescriptorType type,
+                            std::string cache_directory = "");
+
+  DescriptorType type() const { return type_; }
+
+  void DetectAndCompute(const cv::Mat& image,
+                        std::vector<cv::KeyPoint>& keypoints,
+                        cv::Mat& descriptors) const;
+
+  // Extracts features of all the images in parallel.
+  FeatureBatch ExtractBatch(const std::vector<cv::Mat>& images) const;
+
+  // The detector of the calling thread, created on first use.
+  cv::Feature2D& Local() const;
+
+ private:
+  const DescriptorType type_;
+  const std::string cache_directory_;
+  // Distinguishes the thread-local instances of different extractors.
+  const uint64_t id_;
+};
+
+}  // namespace hello::keypoints
+
+#endif  // KEYPOINTS_FEATURE_EXTRACTOR_H_
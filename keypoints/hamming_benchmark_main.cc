@@ -0,0 +1,94 @@
+// HammingMatcher on every backend against cv::BFMatcher(NORM_HAMMING) on
+// random descriptors, for 2-NN and for cross-checked best matches.
+#include <string>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "keypoints/hamming_matcher.h"
+#include "opencv2/features2d.hpp"
+#include "util/status_macros.h"
+
+ABSL_FLAG(std::vector<std::string>, sizes,
+          std::vector<std::string>({"1000", "5000", "20000"}),
+          "Number of query and of train descriptors");
+ABSL_FLAG(int32_t, bytes, 32, "Descriptor width, 32 ORB, 61 AKAZE, 64 BRISK");
+
+namespace {
+
+using ::hello::keypoints::HammingMatcher;
+
+struct NamedBackend {
+  const char* name;
+  HammingMatcher::Backend backend;
+};
+
+constexpr NamedBackend kBackends[] = {
+    {"scalar", HammingMatcher::Backend::kScalar},
+    {"popcnt", HammingMatcher::Backend::kPopcnt},
+    {"avx2", HammingMatcher::Backend::kAvx2},
+};
+
+double Milliseconds(int64 start) {
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+}  // namespace
+
+absl::Status Run() {
+  LOG(INFO) << absl::StreamFormat("%-8s %-8s %12s %12s", "size", "matcher",
+                                  "knn2_ms", "cross_ms");
+  for (const std::string& size_flag : absl::GetFlag(FLAGS_sizes)) {
+    int size = 0;
+    if (!absl::SimpleAtoi(size_flag, &size) || size <= 0) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Bad size %s", size_flag));
+    }
+    cv::Mat query(size, absl::GetFlag(FLAGS_bytes), CV_8U);
+    cv::Mat train(size, absl::GetFlag(FLAGS_bytes), CV_8U);
+    cv::randu(query, 0, 256);
+    cv::randu(train, 0, 256);
+
+    std::vector<std::vector<cv::DMatch>> knn;
+    std::vector<cv::DMatch> matches;
+    int64 start = cv::getTickCount();
+    cv::BFMatcher(cv::NORM_HAMMING).knnMatch(query, train, knn, 2);
+    const double bf_knn = Milliseconds(start);
+    start = cv::getTickCount();
+    cv::BFMatcher(cv::NORM_HAMMING, true).match(query, train, matches);
+    LOG(INFO) << absl::StreamFormat("%-8d %-8s %12.1f %12.1f", size,
+                                    "opencv", bf_knn, Milliseconds(start));
+
+    for (const NamedBackend& named : kBackends) {
+      if (!HammingMatcher::Supported(named.backend)) continue;
+      HammingMatcher::Options options;
+      options.backend = named.backend;
+      options.ratio = 0;
+      const HammingMatcher matcher(options);
+      start = cv::getTickCount();
+      RETURN_IF_ERROR(matcher.KnnMatch(query, train, 2, knn));
+      const double knn_ms = Milliseconds(start);
+      start = cv::getTickCount();
+      RETURN_IF_ERROR(matcher.Match(query, train, matches));
+      LOG(INFO) << absl::StreamFormat("%-8d %-8s %12.1f %12.1f", size,
+                                      named.name, knn_ms, Milliseconds(start));
+    }
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,249 @@
+#include "keypoints/hamming_matcher.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include "absl/strings/str_format.h"
+#include "util/status_macros.h"
+#include "util/trace.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define HAMMING_MATCHER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace hello::keypoints {
+namespace {
+
+// Hamming distances from one query row to `rows` consecutive train rows.
+using RowDistances = void (*)(const uint8_t* query, const uint8_t* train,
+                              size_t train_step, int32_t rows, int32_t bytes,
+                              int32_t* out);
+
+inline uint64_t Load64(const uint8_t* p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline int32_t PopCount64(uint64_t x) {
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  return static_cast<int32_t>((x * 0x0101010101010101ULL) >> 56);
+}
+
+void RowDistancesScalar(const uint8_t* query, const uint8_t* train,
+                        size_t train_step, int32_t rows, int32_t bytes,
+                        int32_t* out) {
+  for (int32_t r = 0; r < rows; ++r, train += train_step) {
+    int32_t d = 0;
+    int32_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+      d += PopCount64(Load64(query + i) ^ Load64(train + i));
+    }
+    for (; i < bytes; ++i) d += PopCount64(query[i] ^ train[i]);
+    out[r] = d;
+  }
+}
+
+#ifdef HAMMING_MATCHER_X86
+
+__attribute__((target("popcnt"))) void RowDistancesPopcnt(
+    const uint8_t* query, const uint8_t* train, size_t train_step,
+    int32_t rows, int32_t bytes, int32_t* out) {
+  for (int32_t r = 0; r < rows; ++r, train += train_step) {
+    int64_t d = 0;
+    int32_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+      d += __builtin_popcountll(Load64(query + i) ^ Load64(train + i));
+    }
+    for (; i < bytes; ++i) d += __builtin_popcount(query[i] ^ train[i]);
+    out[r] = static_cast<int32_t>(d);
+  }
+}
+
+// Counts bits of 32 bytes at a time with a nibble lookup table (Mula's
+// method) and sums the byte counts with SAD.
+__attribute__((target("avx2,popcnt"))) void RowDistancesAvx2(
+    const uint8_t* query, const uint8_t* train, size_t train_step,
+    int32_t rows, int32_t bytes, int32_t* out) {
+  const __m256i lookup =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1,
+                       2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  const __m256i zero = _mm256_setzero_si256();
+  const int32_t vector_bytes = bytes / 32 * 32;
+  for (int32_t r = 0; r < rows; ++r, train += train_step) {
+    __m256i sum = zero;
+    for (int32_t i = 0; i < vector_bytes; i += 32) {
+      const __m256i x = _mm256_xor_si256(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(query + i)),
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(train + i)));
+      const __m256i lo = _mm256_and_si256(x, low_mask);
+      const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), low_mask);
+      const __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                             _mm256_shuffle_epi8(lookup, hi));
+      sum = _mm256_add_epi64(sum, _mm256_sad_epu8(counts, zero));
+    }
+    const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum),
+                                       _mm256_extracti128_si256(sum, 1));
+    int64_t d = _mm_cvtsi128_si64(half) + _mm_extract_epi64(half, 1);
+    int32_t i = vector_bytes;
+    for (; i + 8 <= bytes; i += 8) {
+      d += __builtin_popcountll(Load64(query + i) ^ Load64(train + i));
+    }
+    for (; i < bytes; ++i) d += __builtin_popcount(query[i] ^ train[i]);
+    out[r] = static_cast<int32_t>(d);
+  }
+}
+
+#endif  // HAMMING_MATCHER_X86
+
+RowDistances Kernel(HammingMatcher::Backend backend) {
+  switch (backend) {
+#ifdef HAMMING_MATCHER_X86
+    case HammingMatcher::Backend::kPopcnt:
+      return RowDistancesPopcnt;
+    case HammingMatcher::Backend::kAvx2:
+      return RowDistancesAvx2;
+#endif
+    default:
+      return RowDistancesScalar;
+  }
+}
+
+}  // namespace
+
+HammingMatcher::HammingMatcher(const Options& options) : options_(options) {}
+
+bool HammingMatcher::Supported(Backend backend) {
+  switch (backend) {
+    case Backend::kAuto:
+    case Backend::kScalar:
+      return true;
+#ifdef HAMMING_MATCHER_X86
+    case Backend::kPopcnt:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("popcnt");
+    case Backend::kAvx2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#endif
+    default:
+      return false;
+  }
+}
+
+HammingMatcher::Backend HammingMatcher::Best() {
+  static const Backend best = [] {
+    if (Supported(Backend::kAvx2)) return Backend::kAvx2;
+    if (Supported(Backend::kPopcnt)) return Backend::kPopcnt;
+    return Backend::kScalar;
+  }();
+  return best;
+}
+
+absl::Status HammingMatcher::KnnMatch(
+    const cv::Mat& query, const cv::Mat& train, int32_t k,
+    std::vector<std::vector<cv::DMatch>>& matches) const {
+  TRACE_SCOPE("keypoints/hamming_knn");
+  matches.clear();
+  if (k < 1) return absl::InvalidArgumentError("k must be positive");
+  if (query.empty() || train.empty()) {
+    matches.resize(query.rows);
+    return absl::OkStatus();
+  }
+  if (query.depth() != CV_8U || train.depth() != CV_8U) {
+    return absl::InvalidArgumentError("Binary descriptors must be CV_8U");
+  }
+  const int32_t bytes = query.cols * static_cast<int32_t>(query.elemSize());
+  if (bytes != train.cols * static_cast<int32_t>(train.elemSize())) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Descriptor width mismatch %d vs %d", query.cols,
+                        train.cols));
+  }
+  if (!Supported(options_.backend)) {
+    return absl::FailedPreconditionError("Backend is not supported by CPU");
+  }
+  const RowDistances distances = Kernel(
+      options_.backend == Backend::kAuto ? Best() : options_.backend);
+
+  const int32_t query_block = std::max(options_.query_block, 1);
+  const int32_t train_block = std::max(options_.train_block, 1);
+  const int32_t num_blocks = (query.rows + query_block - 1) / query_block;
+  matches.resize(query.rows);
+  cv::parallel_for_(cv::Range(0, num_blocks), [&](const cv::Range& range) {
+    // Sorted k best of every query of the block, carried across train
+    // blocks.
+    std::vector<int32_t> best_distance(query_block * k);
+    std::vector<int32_t> best_index(query_block * k);
+    std::vector<int32_t> row(train_block);
+    for (int32_t block = range.start; block < range.end; ++block) {
+      const int32_t q0 = block * query_block;
+      const int32_t q1 = std::min(q0 + query_block, query.rows);
+      std::fill(best_distance.begin(), best_distance.end(),
+                std::numeric_limits<int32_t>::max());
+      std::fill(best_index.begin(), best_index.end(), -1);
+      for (int32_t t0 = 0; t0 < train.rows; t0 += train_block) {
+        const int32_t t1 = std::min(t0 + train_block, train.rows);
+        for (int32_t q = q0; q < q1; ++q) {
+          distances(query.ptr<uint8_t>(q), train.ptr<uint8_t>(t0), train.step,
+                    t1 - t0, bytes, row.data());
+          int32_t* dist = &best_distance[(q - q0) * k];
+          int32_t* index = &best_index[(q - q0) * k];
+          for (int32_t j = 0; j < t1 - t0; ++j) {
+            const int32_t d = row[j];
+            if (d >= dist[k - 1]) continue;
+            int32_t p = k - 1;
+            for (; p > 0 && dist[p - 1] > d; --p) {
+              dist[p] = dist[p - 1];
+              index[p] = index[p - 1];
+            }
+            dist[p] = d;
+            index[p] = t0 + j;
+          }
+        }
+      }
+      for (int32_t q = q0; q < q1; ++q) {
+        std::vector<cv::DMatch>& knn = matches[q];
+        knn.clear();
+        for (int32_t i = 0; i < k; ++i) {
+          const int32_t index = best_index[(q - q0) * k + i];
+          if (index < 0) break;
+          knn.emplace_back(q, index,
+                           static_cast<float>(best_distance[(q - q0) * k + i]));
+        }
+      }
+    }
+  });
+  return absl::OkStatus();
+}
+
+absl::Status HammingMatcher::Match(const cv::Mat& query, const cv::Mat& train,
+                                   std::vector<cv::DMatch>& matches) const {
+  matches.clear();
+  const bool ratio_test = options_.ratio > 0 && options_.ratio < 1;
+  std::vector<std::vector<cv::DMatch>> forward;
+  RETURN_IF_ERROR(KnnMatch(query, train, ratio_test ? 2 : 1, forward));
+  std::vector<std::vector<cv::DMatch>> backward;
+  if (options_.cross_check) {
+    RETURN_IF_ERROR(KnnMatch(train, query, 1, backward));
+  }
+  for (const std::vector<cv::DMatch>& knn : forward) {
+    if (knn.empty()) continue;
+    const cv::DMatch& best = knn[0];
+    if (ratio_test && knn.size() > 1 &&
+        !(best.distance < options_.ratio * knn[1].distance)) {
+      continue;
+    }
+    if (options_.cross_check &&
+        (backward[best.trainIdx].empty() ||
+         backward[best.trainIdx][0].trainIdx != best.queryIdx)) {
+      continue;
+    }
+    matches.push_back(best);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace hello::keypoints
@@ -0,0 +1,57 @@
+#ifndef KEYPOINTS_HAMMING_MATCHER_H_
+#define KEYPOINTS_HAMMING_MATCHER_H_
+
+#include <cstdint>
+#include <vector>
+#include "absl/status/status.h"
+#include "opencv2/core.hpp"
+
+namespace hello::keypoints {
+
+// Brute force matcher for binary descriptors (ORB, BRISK, AKAZE) under the
+// Hamming distance. Distances are computed with AVX2 or POPCNT when the CPU
+// has them, picked at runtime, with a portable fallback. Queries and train
+// rows are processed in blocks so that a block of train descriptors stays
+// in cache while a block of queries is scanned against it, query blocks run
+// in parallel.
+class HammingMatcher {
+ public:
+  enum class Backend { kAuto, kScalar, kPopcnt, kAvx2 };
+
+  struct Options {
+    // Lowe's ratio test, the best match is kept only if its distance is
+    // below ratio times the second best. Values <= 0 or >= 1 disable it.
+    float ratio = 0.8f;
+    // Keep only matches that are also the best match of the train row
+    // among all the queries.
+    bool cross_check = true;
+    int32_t query_block = 64;
+    int32_t train_block = 512;
+    Backend backend = Backend::kAuto;
+  };
+
+  explicit HammingMatcher(const Options& options);
+  HammingMatcher() : HammingMatcher(Options()) {}
+
+  // Whether the CPU runs the backend, kAuto and kScalar always do.
+  static bool Supported(Backend backend);
+  // The backend kAuto resolves to on this CPU.
+  static Backend Best();
+
+  // The k nearest train rows of every query row, nearest first. Ties go to
+  // the lower train index. Descriptors are CV_8U rows of the same width.
+  absl::Status KnnMatch(const cv::Mat& query, const cv::Mat& train, int32_t k,
+                        std::vector<std::vector<cv::DMatch>>& matches) const;
+
+  // At most one match per query, filtered by the ratio test and the cross
+  // check from the options.
+  absl::Status Match(const cv::Mat& query, const cv::Mat& train,
+                     std::vector<cv::DMatch>& matches) const;
+
+ private:
+  const Options options_;
+};
+
+}  // namespace hello::keypoints
+
+#endif  // KEYPOINTS_HAMMING_MATCHER_H_
@@ -0,0 +1,129 @@
+#include "keypoints/hamming_matcher.h"
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+#include "opencv2/core.hpp"
+#include "opencv2/features2d.hpp"
+
+namespace hello::keypoints {
+namespace {
+
+using ::testing::Eq;
+using ::testing::SizeIs;
+using ::testing::TestWithParam;
+using ::testing::ValuesIn;
+
+cv::Mat RandomDescriptors(int rows, int bytes, uint64_t seed) {
+  cv::Mat descriptors(rows, bytes, CV_8U);
+  cv::RNG rng(seed);
+  rng.fill(descriptors, cv::RNG::UNIFORM, 0, 256);
+  return descriptors;
+}
+
+struct TestCase {
+  std::string test_name;
+  HammingMatcher::Backend backend;
+  // 32 for ORB, 61 for AKAZE, 64 for BRISK.
+  int bytes;
+};
+
+using HammingMatcherTest = TestWithParam<TestCase>;
+
+TEST_P(HammingMatcherTest, KnnMatchesBruteForce) {
+  const TestCase& test_case = GetParam();
+  if (!HammingMatcher::Supported(test_case.backend)) {
+    GTEST_SKIP() << "Backend is not supported by CPU";
+  }
+  const cv::Mat query = RandomDescriptors(300, test_case.bytes, 1);
+  const cv::Mat train = RandomDescriptors(700, test_case.bytes, 2);
+  // Small blocks so that the carry over between blocks is exercised.
+  HammingMatcher::Options options;
+  options.backend = test_case.backend;
+  options.query_block = 7;
+  options.train_block = 50;
+  std::vector<std::vector<cv::DMatch>> got;
+  ASSERT_TRUE(HammingMatcher(options).KnnMatch(query, train, 3, got).ok());
+
+  std::vector<std::vector<cv::DMatch>> want;
+  cv::BFMatcher(cv::NORM_HAMMING).knnMatch(query, train, want, 3);
+  ASSERT_THAT(got, SizeIs(want.size()));
+  for (size_t q = 0; q < got.size(); ++q) {
+    ASSERT_THAT(got[q], SizeIs(3));
+    for (int i = 0; i < 3; ++i) {
+      // Indices can differ on ties, the distances can't.
+      EXPECT_THAT(got[q][i].distance, Eq(want[q][i].distance));
+      EXPECT_THAT(got[q][i].distance,
+                  Eq(cv::norm(query.row(q), train.row(got[q][i].trainIdx),
+                              cv::NORM_HAMMING)));
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    HammingMatcherTests, HammingMatcherTest,
+    ValuesIn<TestCase>({{"Scalar32", HammingMatcher::Backend::kScalar, 32},
+                        {"Scalar61", HammingMatcher::Backend::kScalar, 61},
+                        {"Popcnt32", HammingMatcher::Backend::kPopcnt, 32},
+                        {"Popcnt61", HammingMatcher::Backend::kPopcnt, 61},
+                        {"Avx2x32", HammingMatcher::Backend::kAvx2, 32},
+                        {"Avx2x61", HammingMatcher::Backend::kAvx2, 61},
+                        {"Avx2x64", HammingMatcher::Backend::kAvx2, 64}}),
+    [](const testing::TestParamInfo<HammingMatcherTest::ParamType>& info) {
+      return info.param.test_name;
+    });
+
+TEST(HammingMatcherTest, CrossCheckKeepsPlantedMatches) {
+  const cv::Mat train = RandomDescriptors(500, 32, 3);
+  // Every other train row with two bits flipped.
+  cv::Mat query;
+  for (int i = 0; i < train.rows; i += 2) {
+    cv::Mat row = train.row(i).clone();
+    row.at<uint8_t>(0) ^= 0x01;
+    row.at<uint8_t>(17) ^= 0x80;
+    query.push_back(row);
+  }
+  HammingMatcher::Options options;
+  options.ratio = 0;
+  std::vector<cv::DMatch> matches;
+  ASSERT_TRUE(HammingMatcher(options).Match(query, train, matches).ok());
+  ASSERT_THAT(matches, SizeIs(query.rows));
+  for (const cv::DMatch& match : matches) {
+    EXPECT_THAT(match.trainIdx, Eq(match.queryIdx * 2));
+    EXPECT_THAT(match.distance, Eq(2));
+  }
+}
+
+TEST(HammingMatcherTest, RatioTestDropsAmbiguousMatches) {
+  const cv::Mat query = RandomDescriptors(2, 32, 4);
+  // Query 0 is 10 and 11 bits away from train rows 0 and 1, which the 0.8
+  // ratio can't tell apart. Query 1 is 2 bits away from train row 2 and
+  // far from the others.
+  cv::Mat train(3, 32, CV_8U);
+  query.row(0).copyTo(train.row(0));
+  query.row(0).copyTo(train.row(1));
+  query.row(1).copyTo(train.row(2));
+  for (int byte = 0; byte < 10; ++byte) {
+    train.at<uint8_t>(0, byte) ^= 0x01;
+  }
+  for (int byte = 0; byte < 11; ++byte) {
+    train.at<uint8_t>(1, 16 + byte) ^= 0x02;
+  }
+  train.at<uint8_t>(2, 3) ^= 0x11;
+  ASSERT_THAT(cv::norm(query.row(0), train.row(0), cv::NORM_HAMMING), Eq(10));
+  ASSERT_THAT(cv::norm(query.row(0), train.row(1), cv::NORM_HAMMING), Eq(11));
+  std::vector<cv::DMatch> matches;
+  ASSERT_TRUE(HammingMatcher().Match(query, train, matches).ok());
+  ASSERT_THAT(matches, SizeIs(1));
+  EXPECT_THAT(matches[0].queryIdx, Eq(1));
+  EXPECT_THAT(matches[0].trainIdx, Eq(2));
+  EXPECT_THAT(matches[0].distance, Eq(2));
+}
+
+TEST(HammingMatcherTest, RejectsFloatDescriptors) {
+  const cv::Mat descriptors(10, 32, CV_32F, cv::Scalar(0));
+  std::vector<cv::DMatch> matches;
+  EXPECT_FALSE(
+      HammingMatcher().Match(descriptors, descriptors, matches).ok());
+}
+
+}  // namespace
+}  // namespace hello::keypoints
@@ -0,0 +1,146 @@
+// Builds an HnswIndex over SIFT descriptors and reports build time, memory,
+// recall@k against brute force and query latency for several ef_search.
+// Descriptors of the images are padded with jittered copies up to
+// --num_descriptors, queries are descriptors held out of the index.
+#include <string>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "keypoints/feature_extractor.h"
+#include "keypoints/hnsw_index.h"
+#include "opencv2/features2d.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "status_macros.h"
+
+ABSL_FLAG(std::vector<std::string>, image_paths,
+          std::vector<std::string>({"testdata/box_in_scene.png",
+                                    "testdata/graf1.png", "testdata/graf3.png",
+                                    "testdata/leuvenA.jpg",
+                                    "testdata/leuvenB.jpg"}),
+          "Images to take SIFT descriptors from");
+ABSL_FLAG(int32_t, num_descriptors, 200000, "Descriptors in the index");
+ABSL_FLAG(int32_t, num_queries, 1000, "Held out query descriptors");
+ABSL_FLAG(int32_t, k, 10, "Neighbours per query");
+ABSL_FLAG(std::vector<std::string>, ef_search,
+          std::vector<std::string>({"16", "32", "64", "128", "256"}),
+          "Search candidate list sizes");
+ABSL_FLAG(std::string, index_path, "",
+          "If set, the index is saved there and loaded back");
+
+namespace {
+
+using ::hello::keypoints::HnswIndex;
+
+double Seconds(int64 start) {
+  return (cv::getTickCount() - start) / cv::getTickFrequency();
+}
+
+}  // namespace
+
+absl::Status Run() {
+  std::vector<cv::Mat> images;
+  for (const std::string& image_path : absl::GetFlag(FLAGS_image_paths)) {
+    cv::Mat img = cv::imread(image_path, cv::IMREAD_GRAYSCALE);
+    if (img.empty()) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("No image - ", image_path));
+    }
+    images.push_back(img);
+  }
+  const hello::keypoints::FeatureBatch batch =
+      hello::keypoints::FeatureExtractor(
+          hello::keypoints::DescriptorType::kSift)
+          .ExtractBatch(images);
+  const int num_queries = absl::GetFlag(FLAGS_num_queries);
+  if (batch.descriptors.rows <= num_queries) {
+    return absl::InvalidArgumentError("Not enough descriptors for queries");
+  }
+  cv::Mat shuffled;
+  cv::Mat order(batch.descriptors.rows, 1, CV_32S);
+  for (int i = 0; i < order.rows; ++i) order.at<int>(i) = i;
+  cv::randShuffle(order);
+  for (int i = 0; i < order.rows; ++i) {
+    shuffled.push_back(batch.descriptors.row(order.at<int>(i)));
+  }
+  const cv::Mat queries = shuffled.rowRange(0, num_queries);
+  cv::Mat base = shuffled.rowRange(num_queries, shuffled.rows).clone();
+  const int real = base.rows;
+  while (base.rows < absl::GetFlag(FLAGS_num_descriptors)) {
+    cv::Mat noise(1, base.cols, CV_32F);
+    cv::randn(noise, 0, 8);
+    cv::Mat jittered = base.row(cv::theRNG().uniform(0, real)) + noise;
+    base.push_back(cv::Mat(cv::max(jittered, 0)));
+  }
+  LOG(INFO) << absl::StreamFormat("%d descriptors (%d from images), %d queries",
+                                  base.rows, real, queries.rows);
+
+  int64 start = cv::getTickCount();
+  std::unique_ptr<HnswIndex> index = std::make_unique<HnswIndex>(base.cols);
+  RETURN_IF_ERROR(index->Add(base));
+  LOG(INFO) << absl::StreamFormat("Build %.2f s, memory %.1f MB, raw %.1f MB",
+                                  Seconds(start), index->MemoryBytes() / 1e6,
+                                  base.total() * sizeof(float) / 1e6);
+
+  const std::string index_path = absl::GetFlag(FLAGS_index_path);
+  if (!index_path.empty()) {
+    start = cv::getTickCount();
+    RETURN_IF_ERROR(index->Save(index_path));
+    const double save = Seconds(start);
+    start = cv::getTickCount();
+    ASSIGN_OR_RETURN(index, HnswIndex::Load(index_path));
+    LOG(INFO) << absl::StreamFormat("Save %.2f s, load %.2f s", save,
+                                    Seconds(start));
+  }
+
+  const int k = absl::GetFlag(FLAGS_k);
+  std::vector<std::vector<cv::DMatch>> exact;
+  start = cv::getTickCount();
+  cv::BFMatcher(cv::NORM_L2).knnMatch(queries, base, exact, k);
+  LOG(INFO) << absl::StreamFormat("Brute force %.1f us/query",
+                                  Seconds(start) * 1e6 / queries.rows);
+
+  LOG(INFO) << absl::StreamFormat("%-10s %10s %12s", "ef_search",
+                                  absl::StrCat("recall@", k), "us/query");
+  for (const std::string& ef_flag : absl::GetFlag(FLAGS_ef_search)) {
+    int ef = 0;
+    if (!absl::SimpleAtoi(ef_flag, &ef) || ef <= 0) {
+      return absl::InvalidArgumentError(absl::StrCat("Bad ef ", ef_flag));
+    }
+    index->set_ef_search(ef);
+    std::vector<std::vector<cv::DMatch>> matches;
+    start = cv::getTickCount();
+    RETURN_IF_ERROR(index->SearchBatch(queries, k, matches));
+    const double micros = Seconds(start) * 1e6 / queries.rows;
+    int hits = 0;
+    for (int q = 0; q < queries.rows; ++q) {
+      for (const cv::DMatch& match : matches[q]) {
+        for (const cv::DMatch& want : exact[q]) {
+          if (want.trainIdx == match.trainIdx) ++hits;
+        }
+      }
+    }
+    LOG(INFO) << absl::StreamFormat("%-10d %10.3f %12.1f", ef,
+                                    static_cast<double>(hits) /
+                                        (queries.rows * k),
+                                    micros);
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
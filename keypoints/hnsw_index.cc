@@ -0,0 +1,438 @@
+#include "keypoints/hnsw_index.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <queue>
+#include <string>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "opencv2/core/hal/hal.hpp"
+#include "util/trace.h"
+
+namespace hello::keypoints {
+namespace {
+
+constexpr char kMagic[4] = {'H', 'N', 'S', 'W'};
+constexpr uint32_t kVersion = 1;
+constexpr int32_t kMaxLevel = 16;
+
+template <typename T>
+void WritePod(std::ofstream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+void WriteVector(std::ofstream& out, const std::vector<T>& values) {
+  WritePod(out, static_cast<uint64_t>(values.size()));
+  out.write(reinterpret_cast<const char*>(values.data()),
+            values.size() * sizeof(T));
+}
+
+template <typename T>
+bool ReadPod(std::ifstream& in, T& value) {
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+// Fails without allocating if the size is beyond the `file_size` bytes.
+template <typename T>
+bool ReadVector(std::ifstream& in, uint64_t file_size,
+                std::vector<T>& values) {
+  uint64_t size = 0;
+  if (!ReadPod(in, size)) return false;
+  const uint64_t offset = static_cast<uint64_t>(in.tellg());
+  if (offset > file_size || size > (file_size - offset) / sizeof(T)) {
+    return false;
+  }
+  values.resize(size);
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char*>(values.data()), size * sizeof(T)));
+}
+
+}  // namespace
+
+// Marks nodes seen by one search, cleared in O(1) by bumping the epoch.
+class HnswIndex::VisitedSet {
+ public:
+  void Reset(int32_t size) {
+    if (static_cast<int32_t>(marks_.size()) < size) marks_.resize(size, 0);
+    if (++epoch_ == 0) {
+      std::fill(marks_.begin(), marks_.end(), 0);
+      epoch_ = 1;
+    }
+  }
+
+  // Returns false if the node was already visited.
+  bool Visit(int32_t id) {
+    if (marks_[id] == epoch_) return false;
+    marks_[id] = epoch_;
+    return true;
+  }
+
+ private:
+  std::vector<uint32_t> marks_;
+  uint32_t epoch_ = 0;
+};
+
+HnswIndex::HnswIndex(int32_t dim, const Options& options)
+    : dim_(dim),
+      options_(options),
+      level_multiplier_(1.0 / std::log(std::max(options.m, 2))),
+      rng_(options.seed) {}
+
+int32_t* HnswIndex::Links(int32_t id, int32_t level) {
+  if (level == 0) {
+    return &links0_[static_cast<size_t>(id) * (1 + MaxLinks(0))];
+  }
+  return &upper_links_[id][(level - 1) * (1 + options_.m)];
+}
+
+const int32_t* HnswIndex::Links(int32_t id, int32_t level) const {
+  return const_cast<HnswIndex*>(this)->Links(id, level);
+}
+
+int32_t HnswIndex::RandomLevel() {
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  const double u = std::max(uniform(rng_), 1e-12);
+  return std::min(static_cast<int32_t>(-std::log(u) * level_multiplier_),
+                  kMaxLevel);
+}
+
+int32_t HnswIndex::GreedyClosest(const float* query, int32_t entry,
+                                 int32_t level) const {
+  float best = cv::hal::normL2Sqr_(query, Vector(entry), dim_);
+  for (bool improved = true; improved;) {
+    improved = false;
+    const int32_t* links = Links(entry, level);
+    for (int32_t i = 1; i <= links[0]; ++i) {
+      const float d = cv::hal::normL2Sqr_(query, Vector(links[i]), dim_);
+      if (d < best) {
+        best = d;
+        entry = links[i];
+        improved = true;
+      }
+    }
+  }
+  return entry;
+}
+
+std::vector<HnswIndex::Candidate> HnswIndex::SearchLayer(
+    const float* query, int32_t entry, int32_t ef, int32_t level,
+    VisitedSet& visited) const {
+  visited.Reset(static_cast<int32_t>(levels_.size()));
+  // Farthest result on top.
+  std::priority_queue<Candidate> results;
+  // Nearest candidate on top.
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>>
+      candidates;
+  const float d = cv::hal::normL2Sqr_(query, Vector(entry), dim_);
+  results.emplace(d, entry);
+  candidates.emplace(d, entry);
+  visited.Visit(entry);
+  while (!candidates.empty()) {
+    const Candidate current = candidates.top();
+    if (current.first > results.top().first &&
+        static_cast<int32_t>(results.size()) >= ef) {
+      break;
+    }
+    candidates.pop();
+    const int32_t* links = Links(current.second, level);
+    for (int32_t i = 1; i <= links[0]; ++i) {
+      const int32_t neighbor = links[i];
+      if (!visited.Visit(neighbor)) continue;
+      const float distance =
+          cv::hal::normL2Sqr_(query, Vector(neighbor), dim_);
+      if (static_cast<int32_t>(results.size()) < ef ||
+          distance < results.top().first) {
+        candidates.emplace(distance, neighbor);
+        results.emplace(distance, neighbor);
+        if (static_cast<int32_t>(results.size()) > ef) results.pop();
+      }
+    }
+  }
+  std::vector<Candidate> sorted(results.size());
+  for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
+    *it = results.top();
+    results.pop();
+  }
+  return sorted;
+}
+
+std::vector<int32_t> HnswIndex::SelectNeighbors(
+    const std::vector<Candidate>& sorted, int32_t max_count) const {
+  std::vector<int32_t> selected;
+  for (const Candidate& candidate : sorted) {
+    if (static_cast<int32_t>(selected.size()) >= max_count) break;
+    bool keep = true;
+    for (int32_t other : selected) {
+      if (cv::hal::normL2Sqr_(Vector(candidate.second), Vector(other), dim_) <
+          candidate.first) {
+        keep = false;
+        break;
+      }
+    }
+    if (keep) selected.push_back(candidate.second);
+  }
+  return selected;
+}
+
+void HnswIndex::AddLink(int32_t from, int32_t to, int32_t level) {
+  int32_t* links = Links(from, level);
+  const int32_t max_links = MaxLinks(level);
+  if (links[0] < max_links) {
+    links[++links[0]] = to;
+    return;
+  }
+  std::vector<Candidate> candidates;
+  candidates.reserve(max_links + 1);
+  for (int32_t i = 1; i <= links[0]; ++i) {
+    candidates.emplace_back(
+        cv::hal::normL2Sqr_(Vector(from), Vector(links[i]), dim_), links[i]);
+  }
+  candidates.emplace_back(
+      cv::hal::normL2Sqr_(Vector(from), Vector(to), dim_), to);
+  std::sort(candidates.begin(), candidates.end());
+  const std::vector<int32_t> kept = SelectNeighbors(candidates, max_links);
+  links[0] = static_cast<int32_t>(kept.size());
+  std::copy(kept.begin(), kept.end(), links + 1);
+}
+
+void HnswIndex::Insert(int32_t id, VisitedSet& visited) {
+  const int32_t level = levels_[id];
+  if (entry_point_ < 0) {
+    entry_point_ = id;
+    max_level_ = level;
+    return;
+  }
+  const float* query = Vector(id);
+  int32_t current = entry_point_;
+  for (int32_t l = max_level_; l > level; --l) {
+    current = GreedyClosest(query, current, l);
+  }
+  for (int32_t l = std::min(level, max_level_); l >= 0; --l) {
+    const std::vector<Candidate> candidates =
+        SearchLayer(query, current, options_.ef_construction, l, visited);
+    const std::vector<int32_t> neighbors =
+        SelectNeighbors(candidates, options_.m);
+    int32_t* links = Links(id, l);
+    links[0] = static_cast<int32_t>(neighbors.size());
+    std::copy(neighbors.begin(), neighbors.end(), links + 1);
+    for (int32_t neighbor : neighbors) AddLink(neighbor, id, l);
+    current = candidates.front().second;
+  }
+  if (level > max_level_) {
+    max_level_ = level;
+    entry_point_ = id;
+  }
+}
+
+absl::Status HnswIndex::Add(const cv::Mat& descriptors) {
+  TRACE_SCOPE("keypoints/hnsw_add");
+  if (descriptors.empty()) return absl::OkStatus();
+  if (descriptors.type() != CV_32F || descriptors.cols != dim_) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Expected CV_32F descriptors of ", dim_, " columns"));
+  }
+  absl::MutexLock lock(&mutex_);
+  const int32_t first = static_cast<int32_t>(levels_.size());
+  const int32_t count = descriptors.rows;
+  vectors_.reserve(vectors_.size() + static_cast<size_t>(count) * dim_);
+  levels_.reserve(first + count);
+  links0_.resize(static_cast<size_t>(first + count) * (1 + MaxLinks(0)), 0);
+  upper_links_.reserve(first + count);
+  VisitedSet visited;
+  for (int32_t row = 0; row < count; ++row) {
+    const float* values = descriptors.ptr<float>(row);
+    vectors_.insert(vectors_.end(), values, values + dim_);
+    const int32_t level = RandomLevel();
+    levels_.push_back(level);
+    upper_links_.emplace_back(level * (1 + options_.m), 0);
+    Insert(first + row, visited);
+  }
+  return absl::OkStatus();
+}
+
+void HnswIndex::Search(const float* query, int32_t k, VisitedSet& visited,
+                       std::vector<cv::DMatch>& matches) const {
+  matches.clear();
+  if (entry_point_ < 0) return;
+  int32_t current = entry_point_;
+  for (int32_t l = max_level_; l > 0; --l) {
+    current = GreedyClosest(query, current, l);
+  }
+  const std::vector<Candidate> candidates = SearchLayer(
+      query, current, std::max(options_.ef_search, k), 0, visited);
+  const int32_t n = std::min(k, static_cast<int32_t>(candidates.size()));
+  for (int32_t i = 0; i < n; ++i) {
+    matches.emplace_back(-1, candidates[i].second,
+                         std::sqrt(candidates[i].first));
+  }
+}
+
+absl::Status HnswIndex::SearchBatch(
+    const cv::Mat& queries, int32_t k,
+    std::vector<std::vector<cv::DMatch>>& matches) const {
+  TRACE_SCOPE("keypoints/hnsw_search");
+  matches.clear();
+  if (k < 1) return absl::InvalidArgumentError("k must be positive");
+  if (queries.empty()) return absl::OkStatus();
+  if (queries.type() != CV_32F || queries.cols != dim_) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Expected CV_32F queries of ", dim_, " columns"));
+  }
+  absl::ReaderMutexLock lock(&mutex_);
+  matches.resize(queries.rows);
+  cv::parallel_for_(cv::Range(0, queries.rows), [&](const cv::Range& range) {
+    VisitedSet visited;
+    for (int32_t row = range.start; row < range.end; ++row) {
+      Search(queries.ptr<float>(row), k, visited, matches[row]);
+      for (cv::DMatch& match : matches[row]) match.queryIdx = row;
+    }
+  });
+  return absl::OkStatus();
+}
+
+absl::Status HnswIndex::Save(absl::string_view file_path) const {
+  absl::ReaderMutexLock lock(&mutex_);
+  std::ofstream out(std::string(file_path), std::ios::binary);
+  if (!out) {
+    return absl::InternalError(absl::StrCat("Can't write ", file_path));
+  }
+  out.write(kMagic, sizeof(kMagic));
+  WritePod(out, kVersion);
+  WritePod(out, dim_);
+  WritePod(out, options_.m);
+  WritePod(out, options_.ef_construction);
+  WritePod(out, options_.ef_search);
+  WritePod(out, entry_point_);
+  WritePod(out, max_level_);
+  WriteVector(out, vectors_);
+  WriteVector(out, levels_);
+  WriteVector(out, links0_);
+  for (const std::vector<int32_t>& links : upper_links_) {
+    out.write(reinterpret_cast<const char*>(links.data()),
+              links.size() * sizeof(int32_t));
+  }
+  out.close();
+  if (!out) {
+    return absl::InternalError(absl::StrCat("Failed writing ", file_path));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::unique_ptr<HnswIndex>> HnswIndex::Load(
+    absl::string_view file_path) {
+  std::ifstream in(std::string(file_path), std::ios::binary | std::ios::ate);
+  if (!in) return absl::NotFoundError(absl::StrCat("Can't read ", file_path));
+  const uint64_t file_size = static_cast<uint64_t>(in.tellg());
+  in.seekg(0);
+  const absl::Status corrupt =
+      absl::DataLossError(absl::StrCat("Corrupt index ", file_path));
+  char magic[sizeof(kMagic)];
+  uint32_t version = 0;
+  int32_t dim = 0;
+  Options options;
+  if (!in.read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic + sizeof(magic), kMagic) ||
+      !ReadPod(in, version) || version != kVersion || !ReadPod(in, dim) ||
+      dim <= 0 || !ReadPod(in, options.m) || options.m <= 0 ||
+      !ReadPod(in, options.ef_construction) ||
+      !ReadPod(in, options.ef_search)) {
+    return corrupt;
+  }
+  auto index = std::make_unique<HnswIndex>(dim, options);
+  if (!ReadPod(in, index->entry_point_) || !ReadPod(in, index->max_level_) ||
+      !ReadVector(in, file_size, index->vectors_) ||
+      !ReadVector(in, file_size, index->levels_) ||
+      !ReadVector(in, file_size, index->links0_)) {
+    return corrupt;
+  }
+  const size_t n = index->levels_.size();
+  if (n > static_cast<size_t>(std::numeric_limits<int32_t>::max()) ||
+      index->vectors_.size() != n * dim ||
+      index->links0_.size() != n * (1 + index->MaxLinks(0))) {
+    return corrupt;
+  }
+  index->upper_links_.resize(n);
+  for (size_t id = 0; id < n; ++id) {
+    const int32_t level = index->levels_[id];
+    if (level < 0 || level > kMaxLevel) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "%s: node %d has level %d", file_path, id, level));
+    }
+    std::vector<int32_t>& links = index->upper_links_[id];
+    links.resize(level * (1 + options.m));
+    if (!in.read(reinterpret_cast<char*>(links.data()),
+                 links.size() * sizeof(int32_t))) {
+      return corrupt;
+    }
+  }
+  const absl::Status graph = index->CheckGraph();
+  if (!graph.ok()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat(file_path, ": ", graph.message()));
+  }
+  return index;
+}
+
+absl::Status HnswIndex::CheckGraph() const {
+  const int32_t n = static_cast<int32_t>(levels_.size());
+  if (n == 0) {
+    if (entry_point_ != -1 || max_level_ != -1) {
+      return absl::InvalidArgumentError("Entry point in an empty graph");
+    }
+    return absl::OkStatus();
+  }
+  if (entry_point_ < 0 || entry_point_ >= n ||
+      max_level_ != levels_[entry_point_]) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Entry point %d at level %d of %d nodes", entry_point_, max_level_,
+        n));
+  }
+  for (int32_t id = 0; id < n; ++id) {
+    if (levels_[id] > max_level_) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Node %d above the top level %d", id, max_level_));
+    }
+    for (int32_t level = 0; level <= levels_[id]; ++level) {
+      const int32_t* links = Links(id, level);
+      if (links[0] < 0 || links[0] > MaxLinks(level)) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Node %d has %d links on level %d", id, links[0], level));
+      }
+      // Searches read the links of the neighbours on the same level.
+      for (int32_t i = 1; i <= links[0]; ++i) {
+        if (links[i] < 0 || links[i] >= n || levels_[links[i]] < level) {
+          return absl::InvalidArgumentError(absl::StrFormat(
+              "Node %d links to %d on level %d", id, links[i], level));
+        }
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+void HnswIndex::set_ef_search(int32_t ef_search) {
+  absl::MutexLock lock(&mutex_);
+  options_.ef_search = ef_search;
+}
+
+int32_t HnswIndex::size() const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return static_cast<int32_t>(levels_.size());
+}
+
+size_t HnswIndex::MemoryBytes() const {
+  absl::ReaderMutexLock lock(&mutex_);
+  size_t bytes = vectors_.capacity() * sizeof(float) +
+                 levels_.capacity() * sizeof(int32_t) +
+                 links0_.capacity() * sizeof(int32_t) +
+                 upper_links_.capacity() * sizeof(std::vector<int32_t>);
+  for (const std::vector<int32_t>& links : upper_links_) {
+    bytes += links.capacity() * sizeof(int32_t);
+  }
+  return bytes;
+}
+
+}  // namespace hello::keypoints
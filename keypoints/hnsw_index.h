@@ -0,0 +1,109 @@
+#ifndef KEYPOINTS_HNSW_INDEX_H_
+#define KEYPOINTS_HNSW_INDEX_H_
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "opencv2/core.hpp"
+
+namespace hello::keypoints {
+
+// Approximate nearest neighbour index over float descriptors (SIFT, KAZE)
+// under the L2 distance, a Hierarchical Navigable Small World graph
+// (Malkov & Yashunin). Descriptors can be added at any time and searches
+// run in parallel, Add waits for the searches in flight and vice versa.
+class HnswIndex {
+ public:
+  struct Options {
+    // Links per node on the upper layers, twice that on the bottom layer.
+    int32_t m = 16;
+    // Candidate list size while inserting, higher builds a better graph.
+    int32_t ef_construction = 200;
+    // Candidate list size while searching, traded against recall.
+    int32_t ef_search = 64;
+    uint64_t seed = 42;
+  };
+
+  HnswIndex(int32_t dim, const Options& options);
+  explicit HnswIndex(int32_t dim) : HnswIndex(dim, Options()) {}
+
+  // Inserts the rows of CV_32F `descriptors`. The id of a descriptor, the
+  // trainIdx of its matches, is the number of descriptors added before it.
+  absl::Status Add(const cv::Mat& descriptors);
+
+  // The k nearest descriptors of every query row, nearest first, with L2
+  // distances. Query rows are searched in parallel.
+  absl::Status SearchBatch(const cv::Mat& queries, int32_t k,
+                           std::vector<std::vector<cv::DMatch>>& matches) const;
+
+  absl::Status Save(absl::string_view file_path) const;
+  // DataLoss for truncated files, InvalidArgument for graphs with levels or
+  // links out of range.
+  static absl::StatusOr<std::unique_ptr<HnswIndex>> Load(
+      absl::string_view file_path);
+
+  void set_ef_search(int32_t ef_search);
+  int32_t size() const;
+  int32_t dim() const { return dim_; }
+  // Bytes held by descriptors and links.
+  size_t MemoryBytes() const;
+
+ private:
+  class VisitedSet;
+  // Squared distance and id, ordered by distance.
+  using Candidate = std::pair<float, int32_t>;
+
+  const float* Vector(int32_t id) const {
+    return &vectors_[static_cast<size_t>(id) * dim_];
+  }
+  // Count followed by the neighbours of `id` on `level`.
+  int32_t* Links(int32_t id, int32_t level);
+  const int32_t* Links(int32_t id, int32_t level) const;
+  int32_t MaxLinks(int32_t level) const {
+    return level == 0 ? 2 * options_.m : options_.m;
+  }
+
+  int32_t RandomLevel();
+  void Insert(int32_t id, VisitedSet& visited);
+  int32_t GreedyClosest(const float* query, int32_t entry,
+                        int32_t level) const;
+  // The ef closest nodes reachable from `entry` on `level`, nearest first.
+  std::vector<Candidate> SearchLayer(const float* query, int32_t entry,
+                                     int32_t ef, int32_t level,
+                                     VisitedSet& visited) const;
+  // Keeps candidates that are closer to the base than to any neighbour
+  // already kept, so that links spread in all directions.
+  std::vector<int32_t> SelectNeighbors(const std::vector<Candidate>& sorted,
+                                       int32_t max_count) const;
+  void AddLink(int32_t from, int32_t to, int32_t level);
+  // InvalidArgument unless the entry point and every link are in range.
+  absl::Status CheckGraph() const;
+  void Search(const float* query, int32_t k, VisitedSet& visited,
+              std::vector<cv::DMatch>& matches) const;
+
+  const int32_t dim_;
+  Options options_;
+  const double level_multiplier_;
+  std::mt19937_64 rng_;
+
+  // Held shared by searches and exclusively by Add.
+  mutable absl::Mutex mutex_;
+  std::vector<float> vectors_;
+  std::vector<int32_t> levels_;
+  // Bottom layer links, 1 + 2m entries per node.
+  std::vector<int32_t> links0_;
+  // Links on layers 1..level, 1 + m entries per layer.
+  std::vector<std::vector<int32_t>> upper_links_;
+  int32_t entry_point_ = -1;
+  int32_t max_level_ = -1;
+};
+
+}  // namespace hello::keypoints
+
+#endif  // KEYPOINTS_HNSW_INDEX_H_
@@ -0,0 +1,134 @@
+#include "keypoints/hnsw_index.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+#include "opencv2/core.hpp"
+#include "opencv2/features2d.hpp"
+
+namespace hello::keypoints {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::SizeIs;
+
+cv::Mat ClusterCenters(int dim, uint64_t seed) {
+  cv::Mat centers(20, dim, CV_32F);
+  cv::RNG(seed).fill(centers, cv::RNG::UNIFORM, 0, 100);
+  return centers;
+}
+
+// Gaussian clusters, closer to real descriptors than uniform noise. The base
+// and its queries share the centers, as descriptors matched between two
+// views of a scene would.
+cv::Mat ClusteredDescriptors(const cv::Mat& centers, int rows,
+                             uint64_t seed) {
+  cv::RNG rng(seed);
+  cv::Mat descriptors(rows, centers.cols, CV_32F);
+  rng.fill(descriptors, cv::RNG::NORMAL, 0, 5);
+  for (int i = 0; i < rows; ++i) {
+    descriptors.row(i) += centers.row(rng.uniform(0, centers.rows));
+  }
+  return descriptors;
+}
+
+double RecallAtK(const cv::Mat& base, const cv::Mat& queries,
+                 const std::vector<std::vector<cv::DMatch>>& got, int k) {
+  std::vector<std::vector<cv::DMatch>> want;
+  cv::BFMatcher(cv::NORM_L2).knnMatch(queries, base, want, k);
+  int hits = 0;
+  for (int q = 0; q < queries.rows; ++q) {
+    for (const cv::DMatch& match : got[q]) {
+      for (const cv::DMatch& exact : want[q]) {
+        if (exact.trainIdx == match.trainIdx) ++hits;
+      }
+    }
+  }
+  return static_cast<double>(hits) / (queries.rows * k);
+}
+
+TEST(HnswIndexTest, FindsNearestNeighbours) {
+  const cv::Mat centers = ClusterCenters(64, 1);
+  const cv::Mat base = ClusteredDescriptors(centers, 4000, 2);
+  const cv::Mat queries = ClusteredDescriptors(centers, 200, 3);
+  HnswIndex index(64);
+  // Built in two steps to cover incremental insertion.
+  ASSERT_TRUE(index.Add(base.rowRange(0, 1500)).ok());
+  ASSERT_TRUE(index.Add(base.rowRange(1500, base.rows)).ok());
+  ASSERT_THAT(index.size(), Eq(base.rows));
+
+  std::vector<std::vector<cv::DMatch>> matches;
+  ASSERT_TRUE(index.SearchBatch(queries, 10, matches).ok());
+  ASSERT_THAT(matches, SizeIs(queries.rows));
+  EXPECT_THAT(RecallAtK(base, queries, matches, 10), Ge(0.95));
+  for (int q = 0; q < queries.rows; ++q) {
+    ASSERT_THAT(matches[q], SizeIs(10));
+    EXPECT_THAT(matches[q][0].queryIdx, Eq(q));
+    EXPECT_FLOAT_EQ(matches[q][0].distance,
+                    cv::norm(queries.row(q),
+                             base.row(matches[q][0].trainIdx)));
+  }
+}
+
+TEST(HnswIndexTest, SaveAndLoadGiveSameResults) {
+  const cv::Mat centers = ClusterCenters(32, 4);
+  const cv::Mat base = ClusteredDescriptors(centers, 1000, 5);
+  const cv::Mat queries = ClusteredDescriptors(centers, 50, 6);
+  HnswIndex index(32);
+  ASSERT_TRUE(index.Add(base).ok());
+  const std::string path = testing::TempDir() + "/hnsw_index_test.bin";
+  ASSERT_TRUE(index.Save(path).ok());
+  auto loaded = HnswIndex::Load(path);
+  ASSERT_TRUE(loaded.ok()) << loaded.status();
+  EXPECT_THAT((*loaded)->size(), Eq(index.size()));
+
+  std::vector<std::vector<cv::DMatch>> want;
+  std::vector<std::vector<cv::DMatch>> got;
+  ASSERT_TRUE(index.SearchBatch(queries, 5, want).ok());
+  ASSERT_TRUE((*loaded)->SearchBatch(queries, 5, got).ok());
+  for (int q = 0; q < queries.rows; ++q) {
+    for (int i = 0; i < 5; ++i) {
+      EXPECT_THAT(got[q][i].trainIdx, Eq(want[q][i].trainIdx));
+    }
+  }
+  std::remove(path.c_str());
+}
+
+TEST(HnswIndexTest, LoadRejectsCorruptFiles) {
+  const cv::Mat base = ClusteredDescriptors(ClusterCenters(8, 7), 100, 8);
+  HnswIndex index(8);
+  ASSERT_TRUE(index.Add(base).ok());
+  const std::string path = testing::TempDir() + "/hnsw_index_corrupt.bin";
+  ASSERT_TRUE(index.Save(path).ok());
+
+  // The first bottom layer link of node 0, after the header, the entry
+  // point, the top level and the size prefixed descriptors and levels.
+  const std::streamoff link_offset = 24 + 8 + (8 + base.total() * 4) +
+                                     (8 + base.rows * 4) + 8 + 4;
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(link_offset);
+    const int32_t out_of_range = base.rows + 5;
+    file.write(reinterpret_cast<const char*>(&out_of_range),
+               sizeof(out_of_range));
+  }
+  EXPECT_THAT(HnswIndex::Load(path).status().code(),
+              Eq(absl::StatusCode::kInvalidArgument));
+
+  std::filesystem::resize_file(path, link_offset);
+  EXPECT_THAT(HnswIndex::Load(path).status().code(),
+              Eq(absl::StatusCode::kDataLoss));
+  std::remove(path.c_str());
+}
+
+TEST(HnswIndexTest, RejectsWrongDimension) {
+  HnswIndex index(128);
+  EXPECT_FALSE(index.Add(cv::Mat(10, 64, CV_32F, cv::Scalar(0))).ok());
+  EXPECT_FALSE(HnswIndex::Load("/nonexistent/index.bin").ok());
+}
+
+}  // namespace
+}  // namespace hello::keypoints
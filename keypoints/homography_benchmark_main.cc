@@ -0,0 +1,158 @@
+// RobustHomography against findHomography with RANSAC and the USAC
+// variants on SIFT matches of the test image pairs: time, inliers and,
+// where available, the iterations and hypotheses spent.
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "keypoints/feature_extractor.h"
+#include "keypoints/l2_matcher.h"
+#include "keypoints/robust_homography.h"
+#include "opencv2/calib3d.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "status_macros.h"
+
+ABSL_FLAG(std::vector<std::string>, pairs,
+          std::vector<std::string>({"graf1.png:graf3.png",
+                                    "leuvenA.jpg:leuvenB.jpg",
+                                    "box.png:box_in_scene.png"}),
+          "Image pairs as first:second");
+ABSL_FLAG(std::string, testdata, "testdata", "Directory of the images");
+ABSL_FLAG(int32_t, repeats, 20, "Runs per method, times are averaged");
+ABSL_FLAG(double, threshold, 4.0, "Inlier reprojection threshold in pixels");
+
+namespace {
+
+using ::hello::keypoints::HomographyEstimate;
+using ::hello::keypoints::RobustHomography;
+
+struct Method {
+  const char* name;
+  int method;
+};
+
+constexpr Method kMethods[] = {
+    {"ransac", cv::RANSAC},
+    {"usac_default", cv::USAC_DEFAULT},
+    {"usac_fast", cv::USAC_FAST},
+    {"usac_accurate", cv::USAC_ACCURATE},
+    {"usac_prosac", cv::USAC_PROSAC},
+    {"usac_magsac", cv::USAC_MAGSAC},
+};
+
+double Milliseconds(int64 start) {
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+struct Correspondences {
+  std::vector<cv::Point2f> points1;
+  std::vector<cv::Point2f> points2;
+  std::vector<float> distances;
+};
+
+// Ratio-tested SIFT matches sorted by distance, the order USAC_PROSAC
+// expects.
+absl::StatusOr<Correspondences> Match(const std::string& first,
+                                      const std::string& second) {
+  const std::string dir = absl::GetFlag(FLAGS_testdata);
+  const cv::Mat img1 = cv::imread(absl::StrCat(dir, "/", first),
+                                  cv::IMREAD_GRAYSCALE);
+  const cv::Mat img2 = cv::imread(absl::StrCat(dir, "/", second),
+                                  cv::IMREAD_GRAYSCALE);
+  if (img1.empty() || img2.empty()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("No images - ", first, ", ", second));
+  }
+  const hello::keypoints::FeatureExtractor extractor(
+      hello::keypoints::DescriptorType::kSift);
+  std::vector<cv::KeyPoint> kpts1;
+  std::vector<cv::KeyPoint> kpts2;
+  cv::Mat desc1;
+  cv::Mat desc2;
+  extractor.DetectAndCompute(img1, kpts1, desc1);
+  extractor.DetectAndCompute(img2, kpts2, desc2);
+  hello::keypoints::L2Matcher::Options options;
+  options.cross_check = false;
+  std::vector<cv::DMatch> matches;
+  RETURN_IF_ERROR(
+      hello::keypoints::L2Matcher(options).Match(desc1, desc2, matches));
+  std::sort(matches.begin(), matches.end());
+  Correspondences c;
+  for (const cv::DMatch& m : matches) {
+    c.points1.push_back(kpts1[m.queryIdx].pt);
+    c.points2.push_back(kpts2[m.trainIdx].pt);
+    c.distances.push_back(m.distance);
+  }
+  return c;
+}
+
+}  // namespace
+
+absl::Status Run() {
+  const int32_t repeats = std::max(absl::GetFlag(FLAGS_repeats), 1);
+  const double threshold = absl::GetFlag(FLAGS_threshold);
+  LOG(INFO) << absl::StreamFormat("%-26s %-14s %9s %8s %8s %8s %10s %10s",
+                                  "pair", "method", "ms", "matches",
+                                  "inliers", "iters", "hypotheses",
+                                  "rejected");
+  for (const std::string& pair : absl::GetFlag(FLAGS_pairs)) {
+    const std::vector<std::string> names = absl::StrSplit(pair, ':');
+    if (names.size() != 2) {
+      return absl::InvalidArgumentError(absl::StrCat("Bad pair ", pair));
+    }
+    ASSIGN_OR_RETURN(const Correspondences c, Match(names[0], names[1]));
+    if (c.points1.size() < 4) {
+      LOG(WARNING) << pair << ": too few matches";
+      continue;
+    }
+    for (const Method& method : kMethods) {
+      cv::Mat mask;
+      const int64 start = cv::getTickCount();
+      for (int32_t r = 0; r < repeats; ++r) {
+        cv::findHomography(c.points1, c.points2, method.method, threshold,
+                           mask);
+      }
+      LOG(INFO) << absl::StreamFormat(
+          "%-26s %-14s %9.3f %8d %8d %8s %10s %10s", pair, method.name,
+          Milliseconds(start) / repeats, c.points1.size(),
+          mask.empty() ? 0 : cv::countNonZero(mask), "-", "-", "-");
+    }
+    RobustHomography::Options options;
+    options.threshold = threshold;
+    const RobustHomography estimator(options);
+    absl::StatusOr<HomographyEstimate> estimate;
+    const int64 start = cv::getTickCount();
+    for (int32_t r = 0; r < repeats; ++r) {
+      estimate = estimator.Estimate(c.points1, c.points2, c.distances);
+    }
+    const double ms = Milliseconds(start) / repeats;
+    if (!estimate.ok()) {
+      LOG(WARNING) << pair << ": " << estimate.status().message();
+      continue;
+    }
+    LOG(INFO) << absl::StreamFormat(
+        "%-26s %-14s %9.3f %8d %8d %8d %10d %10d", pair, "robust", ms,
+        c.points1.size(), estimate->num_inliers, estimate->stats.iterations,
+        estimate->stats.hypotheses, estimate->stats.rejected_early);
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -5,64 +5,36 @@
 #include <opencv2/imgproc.hpp>
 #include "absl/algorithm/container.h"
 #include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+#include "keypoints/feature_extractor.h"
+#include "keypoints/hamming_matcher.h"
+#include "keypoints/l2_matcher.h"
+#include "keypoints/robust_homography.h"
 #include "util/status_macros.h"
+#include "util/trace.h"
 
 namespace hello::keypoints {
 
 constexpr double kDistanceCoef = 4.0;
 constexpr int kMaxMatchingSize = 50;
 
-inline void detect_and_compute(DescriptorType type, cv::Mat& img,
-                               std::vector<cv::KeyPoint>& kpts, cv::Mat& desc) {
-  // kFast and kBlob don't work - no matches
-  if (type == DescriptorType::kFast) {
-    cv::Ptr<cv::FastFeatureDetector> detector =
-        cv::FastFeatureDetector::create(10, true);
-    detector->detect(img, kpts);
-  }
-  if (type == DescriptorType::kBlob) {
-    cv::Ptr<cv::SimpleBlobDetector> detector = cv::SimpleBlobDetector::create();
-    detector->detect(img, kpts);
-  }
-  if (type == DescriptorType::kSift) {
-    cv::Ptr<cv::Feature2D> sift = cv::SIFT::create();
-    sift->detectAndCompute(img, cv::Mat(), kpts, desc);
-  }
-  if (type == DescriptorType::kOrb) {
-    cv::Ptr<cv::ORB> orb = cv::ORB::create();
-    orb->detectAndCompute(img, cv::Mat(), kpts, desc);
-  }
-  if (type == DescriptorType::kBrisk) {
-    cv::Ptr<cv::BRISK> brisk = cv::BRISK::create();
-    brisk->detectAndCompute(img, cv::Mat(), kpts, desc);
-  }
-  if (type == DescriptorType::kKaze) {
-    cv::Ptr<cv::KAZE> kaze = cv::KAZE::create();
-    kaze->detectAndCompute(img, cv::Mat(), kpts, desc);
-  }
-  if (type == DescriptorType::kAkaze) {
-    cv::Ptr<cv::AKAZE> akaze = cv::AKAZE::create();
-    akaze->detectAndCompute(img, cv::Mat(), kpts, desc);
-  }
-}
-
 absl::Status match(MatchAlgorithm type, cv::Mat& desc1, cv::Mat& desc2,
                    std::vector<cv::DMatch>& matches) {
+  TRACE_SCOPE("keypoints/match");
   matches.clear();
-  if (type == MatchAlgorithm::kBf) {
-    cv::BFMatcher desc_matcher(cv::NORM_L2, true);
-    desc_matcher.match(desc1, desc2, matches, cv::Mat());
-  }
-  if (type == MatchAlgorithm::kKnn) {
-    cv::BFMatcher desc_matcher(cv::NORM_L2, true);
-    std::vector<std::vector<cv::DMatch>> vmatches;
-    desc_matcher.knnMatch(desc1, desc2, vmatches, 1);
-    for (int i = 0; i < static_cast<int>(vmatches.size()); ++i) {
-      if (!vmatches[i].size()) {
-        continue;
-      }
-      matches.push_back(vmatches[i][0]);
-    }
+  // kBf keeps mutual best matches, kKnn applies the ratio test instead.
+  const bool cross_check = type == MatchAlgorithm::kBf;
+  // ORB, BRISK and AKAZE descriptors are bit strings.
+  if (desc1.depth() == CV_8U) {
+    HammingMatcher::Options options;
+    options.cross_check = cross_check;
+    if (cross_check) options.ratio = 0;
+    RETURN_IF_ERROR(HammingMatcher(options).Match(desc1, desc2, matches));
+  } else {
+    L2Matcher::Options options;
+    options.cross_check = cross_check;
+    if (cross_check) options.ratio = 0;
+    RETURN_IF_ERROR(L2Matcher(options).Match(desc1, desc2, matches));
   }
   if (matches.empty()) return absl::InternalError("No matches");
   std::sort(matches.begin(), matches.end());
@@ -79,21 +51,37 @@ inline void findKeyPointsHomography(std::vector<cv::KeyPoint>& kpts1,
                                     std::vector<cv::KeyPoint>& kpts2,
                                     std::vector<cv::DMatch>& matches,
                                     std::vector<char>& match_mask) {
+  TRACE_SCOPE("keypoints/homography");
   if (static_cast<int>(match_mask.size()) < 3) {
     return;
   }
   std::vector<cv::Point2f> pts1;
   std::vector<cv::Point2f> pts2;
+  std::vector<float> distances;
   for (int i = 0; i < static_cast<int>(matches.size()); ++i) {
     pts1.push_back(kpts1[matches[i].queryIdx].pt);
     pts2.push_back(kpts2[matches[i].trainIdx].pt);
+    distances.push_back(matches[i].distance);
+  }
+  RobustHomography::Options options;
+  options.threshold = 4;
+  auto estimate = RobustHomography(options).Estimate(pts1, pts2, distances);
+  if (!estimate.ok()) {
+    LOG(WARNING) << "Homography: " << estimate.status().message();
+    return;
   }
-  findHomography(pts1, pts2, cv::RANSAC, 4, match_mask);
+  match_mask = estimate->inlier_mask;
+  const RobustHomographyStats& stats = estimate->stats;
+  LOG(INFO) << "Homography: " << estimate->num_inliers << "/" << pts1.size()
+            << " inliers, " << stats.iterations << " iterations, "
+            << stats.hypotheses << " hypotheses, " << stats.rejected_early
+            << " rejected early, " << stats.seconds * 1000 << " ms";
 }
 
 absl::Status Run(DescriptorType descriptor_type, MatchAlgorithm match_algorithm,
                  std::string_view image_file_name,
-                 std::string_view scene_file_name) {
+                 std::string_view scene_file_name,
+                 std::string_view feature_cache_directory) {
   cv::Mat img1 = cv::imread(image_file_name.data());
   if (img1.empty())
     return absl::InternalError(absl::StrCat("No image - ", image_file_name));
@@ -118,8 +106,10 @@ absl::Status Run(DescriptorType descriptor_type, MatchAlgorithm match_algorithm,
 
   std::vector<cv::DMatch> matches;
 
-  detect_and_compute(descriptor_type, img1, kpts1, desc1);
-  detect_and_compute(descriptor_type, img2, kpts2, desc2);
+  const FeatureExtractor extractor(descriptor_type,
+                                   std::string(feature_cache_directory));
+  extractor.DetectAndCompute(img1, kpts1, desc1);
+  extractor.DetectAndCompute(img2, kpts2, desc2);
 
   RETURN_IF_ERROR(match(match_algorithm, desc1, desc2, matches));
 
@@ -130,6 +120,7 @@ absl::Status Run(DescriptorType descriptor_type, MatchAlgorithm match_algorithm,
   cv::drawMatches(img1, kpts1, img2, kpts2, matches, res, cv::Scalar::all(-1),
                   cv::Scalar::all(-1), match_mask,
                   cv::DrawMatchesFlags::NOT_DRAW_SINGLE_POINTS);
+  LOG(INFO) << "Latency:\n" << hello::util::Tracer::Get().SummaryTable();
 
   cv::imshow("result", res);
   cv::waitKey(0);
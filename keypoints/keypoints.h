@@ -2,24 +2,23 @@
 #define KEYPOINTS_KEYPOINTS_H_
 
 #include "absl/status/status.h"
+#include "keypoints/types.h"
+#include <opencv2/core.hpp>
 #include <string_view>
+#include <vector>
 
 namespace hello::keypoints {
 
-enum class DescriptorType {
-  kFast,
-  kBlob,
-  kSift,
-  kOrb,
-  kBrisk,
-  kKaze,
-  kAkaze,
-};
-
-enum class MatchAlgorithm { kBf, kKnn };
+// The matching step of Run: mutual best matches for kBf, ratio-tested ones
+// for kKnn, then only the closest matches are kept.
+absl::Status match(MatchAlgorithm type, cv::Mat& desc1, cv::Mat& desc2,
+                   std::vector<cv::DMatch>& matches);
 
+// With a `feature_cache_directory` features of both images are cached
+// there, see FeatureCache.
 absl::Status Run(DescriptorType descriptor_type, MatchAlgorithm match_algorithm,
                  std::string_view image_file_name,
-                 std::string_view scene_file_name);
+                 std::string_view scene_file_name,
+                 std::string_view feature_cache_directory = "");
 }  // namespace hello::keypoints
 #endif  // KEYPOINTS_KEYPOINTS_H_
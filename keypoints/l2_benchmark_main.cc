@@ -0,0 +1,86 @@
+// L2Matcher against cv::BFMatcher(NORM_L2) on random 128 dimensional
+// descriptors, for 2-NN and for cross-checked best matches.
+#include <string>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "keypoints/l2_matcher.h"
+#include "opencv2/features2d.hpp"
+#include "util/status_macros.h"
+
+ABSL_FLAG(std::vector<std::string>, sizes,
+          std::vector<std::string>({"1000", "5000", "10000", "20000",
+                                    "50000"}),
+          "Number of query and of train descriptors");
+ABSL_FLAG(int32_t, dim, 128, "Descriptor width, 128 SIFT, 64 KAZE");
+
+namespace {
+
+double Milliseconds(int64 start) {
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+}  // namespace
+
+absl::Status Run() {
+  LOG(INFO) << absl::StreamFormat("%-8s %12s %12s %12s %12s %10s", "size",
+                                  "cv_knn2_ms", "knn2_ms", "cv_cross_ms",
+                                  "cross_ms", "agree");
+  for (const std::string& size_flag : absl::GetFlag(FLAGS_sizes)) {
+    int size = 0;
+    if (!absl::SimpleAtoi(size_flag, &size) || size <= 0) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Bad size %s", size_flag));
+    }
+    cv::Mat query(size, absl::GetFlag(FLAGS_dim), CV_32F);
+    cv::Mat train(size, absl::GetFlag(FLAGS_dim), CV_32F);
+    cv::randu(query, 0, 200);
+    cv::randu(train, 0, 200);
+
+    std::vector<std::vector<cv::DMatch>> want;
+    std::vector<std::vector<cv::DMatch>> got;
+    std::vector<cv::DMatch> matches;
+    int64 start = cv::getTickCount();
+    cv::BFMatcher(cv::NORM_L2).knnMatch(query, train, want, 2);
+    const double cv_knn = Milliseconds(start);
+    start = cv::getTickCount();
+    cv::BFMatcher(cv::NORM_L2, true).match(query, train, matches);
+    const double cv_cross = Milliseconds(start);
+
+    hello::keypoints::L2Matcher::Options options;
+    options.ratio = 0;
+    const hello::keypoints::L2Matcher matcher(options);
+    start = cv::getTickCount();
+    RETURN_IF_ERROR(matcher.KnnMatch(query, train, 2, got));
+    const double knn = Milliseconds(start);
+    start = cv::getTickCount();
+    RETURN_IF_ERROR(matcher.Match(query, train, matches));
+    const double cross = Milliseconds(start);
+
+    int agree = 0;
+    for (int q = 0; q < size; ++q) {
+      agree += got[q][0].trainIdx == want[q][0].trainIdx;
+    }
+    LOG(INFO) << absl::StreamFormat("%-8d %12.1f %12.1f %12.1f %12.1f %9.2f%%",
+                                    size, cv_knn, knn, cv_cross, cross,
+                                    100.0 * agree / size);
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
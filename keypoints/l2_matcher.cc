@@ -0,0 +1,163 @@
+#include "keypoints/l2_matcher.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include "absl/strings/str_format.h"
+#include "opencv2/core/hal/hal.hpp"
+#include "util/status_macros.h"
+#include "util/trace.h"
+
+namespace hello::keypoints {
+namespace {
+
+std::vector<float> SquaredNorms(const cv::Mat& descriptors) {
+  std::vector<float> norms(descriptors.rows);
+  for (int i = 0; i < descriptors.rows; ++i) {
+    norms[i] = static_cast<float>(descriptors.row(i).dot(descriptors.row(i)));
+  }
+  return norms;
+}
+
+}  // namespace
+
+L2Matcher::L2Matcher(const Options& options) : options_(options) {}
+
+absl::Status L2Matcher::KnnMatch(
+    const cv::Mat& query, const cv::Mat& train, int32_t k,
+    std::vector<std::vector<cv::DMatch>>& matches) const {
+  TRACE_SCOPE("keypoints/l2_knn");
+  matches.clear();
+  if (k < 1) return absl::InvalidArgumentError("k must be positive");
+  if (query.empty() || train.empty()) {
+    matches.resize(query.rows);
+    return absl::OkStatus();
+  }
+  if (query.type() != CV_32F || train.type() != CV_32F) {
+    return absl::InvalidArgumentError("Float descriptors must be CV_32F");
+  }
+  if (query.cols != train.cols) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Descriptor width mismatch %d vs %d", query.cols,
+                        train.cols));
+  }
+
+  const int32_t dim = query.cols;
+  const int32_t kept = std::min(k, train.rows);
+  const std::vector<float> query_norms = SquaredNorms(query);
+  const std::vector<float> train_norms = SquaredNorms(train);
+  // The float dot product of q and t is off by at most
+  // dim * eps * |q| |t| <= dim * eps * (|q|^2 + |t|^2) / 2 in any summation
+  // order, the norms and the two additions add a few eps of the same scale.
+  // A row whose expanded distance is within twice that bound of the k-th
+  // may be nearer than it, all of those are re-ranked.
+  const float max_train_norm =
+      *std::max_element(train_norms.begin(), train_norms.end());
+  const float error_scale =
+      2.0f * (dim + 5) * std::numeric_limits<float>::epsilon();
+  const int32_t query_block = std::max(options_.query_block, 1);
+  const int32_t train_block = std::max(options_.train_block, 1);
+  const int32_t num_blocks = (query.rows + query_block - 1) / query_block;
+  matches.resize(query.rows);
+  cv::parallel_for_(cv::Range(0, num_blocks), [&](const cv::Range& range) {
+    // Sorted candidates of every query of the block, carried across train
+    // blocks.
+    std::vector<float> best_distance(query_block * kept);
+    std::vector<int32_t> best_index(query_block * kept);
+    // Expanded distance and train row of everything within the margin of
+    // the running k-th, pruned as that tightens.
+    std::vector<std::vector<std::pair<float, int32_t>>> candidates(
+        query_block);
+    cv::Mat dots;
+    for (int32_t block = range.start; block < range.end; ++block) {
+      const int32_t q0 = block * query_block;
+      const int32_t q1 = std::min(q0 + query_block, query.rows);
+      std::fill(best_distance.begin(), best_distance.end(),
+                std::numeric_limits<float>::max());
+      std::fill(best_index.begin(), best_index.end(), -1);
+      for (auto& c : candidates) c.clear();
+      for (int32_t t0 = 0; t0 < train.rows; t0 += train_block) {
+        const int32_t t1 = std::min(t0 + train_block, train.rows);
+        // -2 Q T^t for the block pair.
+        cv::gemm(query.rowRange(q0, q1), train.rowRange(t0, t1), -2.0,
+                 cv::noArray(), 0.0, dots, cv::GEMM_2_T);
+        for (int32_t q = q0; q < q1; ++q) {
+          const float* row = dots.ptr<float>(q - q0);
+          const float query_norm = query_norms[q];
+          const float margin = error_scale * (query_norm + max_train_norm);
+          float* dist = &best_distance[(q - q0) * kept];
+          int32_t* index = &best_index[(q - q0) * kept];
+          std::vector<std::pair<float, int32_t>>& nearby = candidates[q - q0];
+          for (int32_t j = 0; j < t1 - t0; ++j) {
+            const float d = query_norm + train_norms[t0 + j] + row[j];
+            if (d >= dist[kept - 1] + margin) continue;
+            nearby.emplace_back(d, t0 + j);
+            if (d >= dist[kept - 1]) continue;
+            int32_t p = kept - 1;
+            for (; p > 0 && dist[p - 1] > d; --p) {
+              dist[p] = dist[p - 1];
+              index[p] = index[p - 1];
+            }
+            dist[p] = d;
+            index[p] = t0 + j;
+          }
+          if (static_cast<int32_t>(nearby.size()) > 4 * kept + 64) {
+            const float bound = dist[kept - 1] + margin;
+            nearby.erase(
+                std::remove_if(nearby.begin(), nearby.end(),
+                               [&](const std::pair<float, int32_t>& c) {
+                                 return c.first >= bound;
+                               }),
+                nearby.end());
+          }
+        }
+      }
+      for (int32_t q = q0; q < q1; ++q) {
+        const float bound =
+            best_distance[(q - q0) * kept + kept - 1] +
+            error_scale * (query_norms[q] + max_train_norm);
+        std::vector<cv::DMatch>& knn = matches[q];
+        knn.clear();
+        for (const auto& [d, index] : candidates[q - q0]) {
+          if (d >= bound) continue;
+          knn.emplace_back(q, index,
+                           std::sqrt(cv::hal::normL2Sqr_(
+                               query.ptr<float>(q), train.ptr<float>(index),
+                               dim)));
+        }
+        std::stable_sort(knn.begin(), knn.end());
+        if (static_cast<int32_t>(knn.size()) > k) knn.resize(k);
+      }
+    }
+  });
+  return absl::OkStatus();
+}
+
+absl::Status L2Matcher::Match(const cv::Mat& query, const cv::Mat& train,
+                              std::vector<cv::DMatch>& matches) const {
+  matches.clear();
+  const bool ratio_test = options_.ratio > 0 && options_.ratio < 1;
+  std::vector<std::vector<cv::DMatch>> forward;
+  RETURN_IF_ERROR(KnnMatch(query, train, ratio_test ? 2 : 1, forward));
+  std::vector<std::vector<cv::DMatch>> backward;
+  if (options_.cross_check) {
+    RETURN_IF_ERROR(KnnMatch(train, query, 1, backward));
+  }
+  for (const std::vector<cv::DMatch>& knn : forward) {
+    if (knn.empty()) continue;
+    const cv::DMatch& best = knn[0];
+    if (ratio_test && knn.size() > 1 &&
+        !(best.distance < options_.ratio * knn[1].distance)) {
+      continue;
+    }
+    if (options_.cross_check &&
+        (backward[best.trainIdx].empty() ||
+         backward[best.trainIdx][0].trainIdx != best.queryIdx)) {
+      continue;
+    }
+    matches.push_back(best);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace hello::keypoints
@@ -0,0 +1,51 @@
+#ifndef KEYPOINTS_L2_MATCHER_H_
+#define KEYPOINTS_L2_MATCHER_H_
+
+#include <cstdint>
+#include <vector>
+#include "absl/status/status.h"
+#include "opencv2/core.hpp"
+
+namespace hello::keypoints {
+
+// Exact brute force matcher for float descriptors (SIFT, KAZE) under the L2
+// distance. Squared distances of a block of queries to a block of train
+// rows are |q|^2 + |t|^2 - 2 q.t, the dot products come from one cv::gemm
+// per block pair and feed a running top-k selection per query. Every row
+// within the rounding error bound of the expansion from the k-th is
+// re-ranked with directly computed distances, so neither the neighbours
+// nor the reported distances carry its cancellation error. Query blocks
+// run in parallel.
+class L2Matcher {
+ public:
+  struct Options {
+    // Lowe's ratio test, the best match is kept only if its distance is
+    // below ratio times the second best. Values <= 0 or >= 1 disable it.
+    float ratio = 0.8f;
+    // Keep only matches that are also the best match of the train row
+    // among all the queries.
+    bool cross_check = true;
+    int32_t query_block = 256;
+    int32_t train_block = 1024;
+  };
+
+  explicit L2Matcher(const Options& options);
+  L2Matcher() : L2Matcher(Options()) {}
+
+  // The k nearest train rows of every query row, nearest first, with L2
+  // distances. Descriptors are CV_32F rows of the same width.
+  absl::Status KnnMatch(const cv::Mat& query, const cv::Mat& train, int32_t k,
+                        std::vector<std::vector<cv::DMatch>>& matches) const;
+
+  // At most one match per query, filtered by the ratio test and the cross
+  // check from the options.
+  absl::Status Match(const cv::Mat& query, const cv::Mat& train,
+                     std::vector<cv::DMatch>& matches) const;
+
+ private:
+  const Options options_;
+};
+
+}  // namespace hello::keypoints
+
+#endif  // KEYPOINTS_L2_MATCHER_H_
@@ -0,0 +1,88 @@
+#include "keypoints/l2_matcher.h"
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+#include "opencv2/core.hpp"
+#include "opencv2/features2d.hpp"
+
+namespace hello::keypoints {
+namespace {
+
+using ::testing::Eq;
+using ::testing::FloatNear;
+using ::testing::SizeIs;
+
+// SIFT-like magnitudes, large enough for the expanded distance to lose
+// precision.
+cv::Mat RandomDescriptors(int rows, int dim, uint64_t seed) {
+  cv::Mat descriptors(rows, dim, CV_32F);
+  cv::RNG rng(seed);
+  rng.fill(descriptors, cv::RNG::UNIFORM, 0, 200);
+  return descriptors;
+}
+
+TEST(L2MatcherTest, KnnMatchesBruteForce) {
+  const cv::Mat query = RandomDescriptors(300, 128, 1);
+  const cv::Mat train = RandomDescriptors(900, 128, 2);
+  // Small, uneven blocks so that the carry over between blocks is exercised.
+  L2Matcher::Options options;
+  options.query_block = 37;
+  options.train_block = 100;
+  std::vector<std::vector<cv::DMatch>> got;
+  ASSERT_TRUE(L2Matcher(options).KnnMatch(query, train, 3, got).ok());
+
+  std::vector<std::vector<cv::DMatch>> want;
+  cv::BFMatcher(cv::NORM_L2).knnMatch(query, train, want, 3);
+  ASSERT_THAT(got, SizeIs(want.size()));
+  for (size_t q = 0; q < got.size(); ++q) {
+    ASSERT_THAT(got[q], SizeIs(3));
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_THAT(got[q][i].trainIdx, Eq(want[q][i].trainIdx));
+      EXPECT_THAT(got[q][i].distance,
+                  FloatNear(want[q][i].distance, 1e-3f * want[q][i].distance));
+    }
+  }
+}
+
+TEST(L2MatcherTest, KnnRanksNearTiesByExactDistance) {
+  // A large common offset with tiny differences: the expanded distances of
+  // many rows are within rounding error of each other.
+  cv::Mat query = RandomDescriptors(50, 128, 4) * 0.01f + 200.0f;
+  cv::Mat train = RandomDescriptors(500, 128, 5) * 0.01f + 200.0f;
+  std::vector<std::vector<cv::DMatch>> got;
+  ASSERT_TRUE(L2Matcher().KnnMatch(query, train, 2, got).ok());
+
+  std::vector<std::vector<cv::DMatch>> want;
+  cv::BFMatcher(cv::NORM_L2).knnMatch(query, train, want, 2);
+  ASSERT_THAT(got, SizeIs(want.size()));
+  for (size_t q = 0; q < got.size(); ++q) {
+    ASSERT_THAT(got[q], SizeIs(2));
+    for (int i = 0; i < 2; ++i) {
+      EXPECT_THAT(got[q][i].distance,
+                  FloatNear(want[q][i].distance, 1e-4f * want[q][i].distance));
+    }
+  }
+}
+
+TEST(L2MatcherTest, CrossCheckKeepsPlantedMatches) {
+  const cv::Mat train = RandomDescriptors(400, 64, 3);
+  cv::Mat noise(train.rows, train.cols, CV_32F);
+  cv::randn(noise, 0, 1);
+  const cv::Mat query = train + noise;
+  L2Matcher::Options options;
+  options.ratio = 0;
+  std::vector<cv::DMatch> matches;
+  ASSERT_TRUE(L2Matcher(options).Match(query, train, matches).ok());
+  ASSERT_THAT(matches, SizeIs(query.rows));
+  for (const cv::DMatch& match : matches) {
+    EXPECT_THAT(match.trainIdx, Eq(match.queryIdx));
+  }
+}
+
+TEST(L2MatcherTest, RejectsBinaryDescriptors) {
+  const cv::Mat descriptors(10, 32, CV_8U, cv::Scalar(0));
+  std::vector<cv::DMatch> matches;
+  EXPECT_FALSE(L2Matcher().Match(descriptors, descriptors, matches).ok());
+}
+
+}  // namespace
+}  // namespace hello::keypoints
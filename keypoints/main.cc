@@ -8,12 +8,15 @@
 
 ABSL_FLAG(std::string, image_path, "testdata/box.png", "Image file path");
 ABSL_FLAG(std::string, scene_path, "testdata/box_in_scene.png", "Second file path");
+ABSL_FLAG(std::string, feature_cache, "",
+          "If set, detected features are cached in this directory");
 
 absl::Status Run() {
   return hello::keypoints::Run(hello::keypoints::DescriptorType::kSift,
     hello::keypoints::MatchAlgorithm::kBf,
     absl::GetFlag(FLAGS_image_path),
-    absl::GetFlag(FLAGS_scene_path));
+    absl::GetFlag(FLAGS_scene_path),
+    absl::GetFlag(FLAGS_feature_cache));
 }
 
 int main(int argc, char** argv) {
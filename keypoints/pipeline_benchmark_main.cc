@@ -0,0 +1,305 @@
+// Times detection, description, matching and homography estimation apart
+// for every DescriptorType and MatchAlgorithm on image pairs of testdata.
+// Combinations run in parallel, results go to the log and optionally to
+// CSV and JSON files.
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_replace.h"
+#include "absl/strings/str_split.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "keypoints/feature_extractor.h"
+#include "keypoints/keypoints.h"
+#include "keypoints/robust_homography.h"
+#include "keypoints/types.h"
+#include "opencv2/imgcodecs.hpp"
+#include "util/status_macros.h"
+
+ABSL_FLAG(std::vector<std::string>, pairs,
+          std::vector<std::string>({"box.png:box_in_scene.png",
+                                    "graf1.png:graf3.png",
+                                    "leuvenA.jpg:leuvenB.jpg"}),
+          "Image pairs as first:second");
+ABSL_FLAG(std::string, testdata, "testdata", "Directory of the images");
+ABSL_FLAG(bool, parallel, true,
+          "Run the combinations in parallel, faster but the timings of "
+          "concurrent runs disturb each other");
+ABSL_FLAG(std::string, csv, "", "If set, results are written there as CSV");
+ABSL_FLAG(std::string, json, "", "If set, results are written there as JSON");
+
+namespace {
+
+using ::hello::keypoints::DescriptorType;
+using ::hello::keypoints::MatchAlgorithm;
+
+struct NamedType {
+  const char* name;
+  DescriptorType type;
+};
+
+constexpr NamedType kTypes[] = {
+    {"fast", DescriptorType::kFast},   {"blob", DescriptorType::kBlob},
+    {"sift", DescriptorType::kSift},   {"orb", DescriptorType::kOrb},
+    {"brisk", DescriptorType::kBrisk}, {"kaze", DescriptorType::kKaze},
+    {"akaze", DescriptorType::kAkaze},
+};
+
+struct NamedAlgorithm {
+  const char* name;
+  MatchAlgorithm algorithm;
+};
+
+constexpr NamedAlgorithm kAlgorithms[] = {
+    {"bf", MatchAlgorithm::kBf},
+    {"knn", MatchAlgorithm::kKnn},
+};
+
+struct Combination {
+  int32_t pair;
+  const NamedType* type;
+  const NamedAlgorithm* algorithm;
+};
+
+struct Result {
+  std::string pair;
+  std::string type;
+  std::string algorithm;
+  int32_t keypoints1 = 0;
+  int32_t keypoints2 = 0;
+  double detect_ms = 0;
+  double describe_ms = 0;
+  double match_ms = 0;
+  double homography_ms = 0;
+  int32_t matches = 0;
+  int32_t inliers = 0;
+  std::string error;
+
+  double inlier_ratio() const {
+    return matches > 0 ? static_cast<double>(inliers) / matches : 0;
+  }
+};
+
+double Milliseconds(int64 start) {
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+void Benchmark(const cv::Mat& img1, const cv::Mat& img2,
+               const Combination& combination, Result& result) {
+  const cv::Ptr<cv::Feature2D> detector =
+      hello::keypoints::CreateFeature2D(combination.type->type);
+  std::vector<cv::KeyPoint> kpts1;
+  std::vector<cv::KeyPoint> kpts2;
+  int64 start = cv::getTickCount();
+  detector->detect(img1, kpts1);
+  detector->detect(img2, kpts2);
+  result.detect_ms = Milliseconds(start);
+  result.keypoints1 = static_cast<int32_t>(kpts1.size());
+  result.keypoints2 = static_cast<int32_t>(kpts2.size());
+
+  cv::Mat desc1;
+  cv::Mat desc2;
+  start = cv::getTickCount();
+  detector->compute(img1, kpts1, desc1);
+  detector->compute(img2, kpts2, desc2);
+  result.describe_ms = Milliseconds(start);
+
+  std::vector<cv::DMatch> matches;
+  start = cv::getTickCount();
+  const absl::Status status = hello::keypoints::match(
+      combination.algorithm->algorithm, desc1, desc2, matches);
+  result.match_ms = Milliseconds(start);
+  if (!status.ok()) {
+    result.error = std::string(status.message());
+    return;
+  }
+  result.matches = static_cast<int32_t>(matches.size());
+
+  std::vector<cv::Point2f> pts1;
+  std::vector<cv::Point2f> pts2;
+  std::vector<float> distances;
+  for (const cv::DMatch& m : matches) {
+    pts1.push_back(kpts1[m.queryIdx].pt);
+    pts2.push_back(kpts2[m.trainIdx].pt);
+    distances.push_back(m.distance);
+  }
+  start = cv::getTickCount();
+  const auto estimate =
+      hello::keypoints::RobustHomography().Estimate(pts1, pts2, distances);
+  result.homography_ms = Milliseconds(start);
+  if (!estimate.ok()) {
+    result.error = std::string(estimate.status().message());
+    return;
+  }
+  result.inliers = estimate->num_inliers;
+}
+
+// Quoted, with quotes doubled, if it holds a delimiter, quote or line end.
+std::string CsvField(absl::string_view text) {
+  if (text.find_first_of(",\"\r\n") == absl::string_view::npos) {
+    return std::string(text);
+  }
+  return absl::StrCat("\"", absl::StrReplaceAll(text, {{"\"", "\"\""}}),
+                      "\"");
+}
+
+// Quoted JSON string.
+std::string JsonString(absl::string_view text) {
+  std::string result = "\"";
+  for (const char c : text) {
+    switch (c) {
+      case '"':
+        result += "\\\"";
+        break;
+      case '\\':
+        result += "\\\\";
+        break;
+      case '\n':
+        result += "\\n";
+        break;
+      case '\r':
+        result += "\\r";
+        break;
+      case '\t':
+        result += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          absl::StrAppendFormat(&result, "\\u%04x", static_cast<int>(c));
+        } else {
+          result.push_back(c);
+        }
+    }
+  }
+  result.push_back('"');
+  return result;
+}
+
+absl::Status WriteCsv(const std::string& path,
+                      const std::vector<Result>& results) {
+  std::ofstream out(path);
+  if (!out) return absl::InternalError(absl::StrCat("Cannot write ", path));
+  out << "pair,type,algorithm,keypoints1,keypoints2,detect_ms,describe_ms,"
+         "match_ms,homography_ms,matches,inliers,inlier_ratio,error\n";
+  for (const Result& r : results) {
+    out << absl::StrFormat("%s,%s,%s,%d,%d,%.3f,%.3f,%.3f,%.3f,%d,%d,%.4f,%s\n",
+                           CsvField(r.pair), CsvField(r.type),
+                           CsvField(r.algorithm), r.keypoints1, r.keypoints2,
+                           r.detect_ms, r.describe_ms, r.match_ms,
+                           r.homography_ms, r.matches, r.inliers,
+                           r.inlier_ratio(), CsvField(r.error));
+  }
+  return out.good() ? absl::OkStatus()
+                    : absl::InternalError(absl::StrCat("Cannot write ", path));
+}
+
+absl::Status WriteJson(const std::string& path,
+                       const std::vector<Result>& results) {
+  std::ofstream out(path);
+  if (!out) return absl::InternalError(absl::StrCat("Cannot write ", path));
+  std::vector<std::string> objects;
+  for (const Result& r : results) {
+    objects.push_back(absl::StrFormat(
+        "  {\"pair\": %s, \"type\": %s, \"algorithm\": %s, "
+        "\"keypoints1\": %d, \"keypoints2\": %d, \"detect_ms\": %.3f, "
+        "\"describe_ms\": %.3f, \"match_ms\": %.3f, \"homography_ms\": %.3f, "
+        "\"matches\": %d, \"inliers\": %d, \"inlier_ratio\": %.4f, "
+        "\"error\": %s}",
+        JsonString(r.pair), JsonString(r.type), JsonString(r.algorithm),
+        r.keypoints1, r.keypoints2, r.detect_ms, r.describe_ms, r.match_ms,
+        r.homography_ms, r.matches, r.inliers, r.inlier_ratio(),
+        JsonString(r.error)));
+  }
+  out << "[\n" << absl::StrJoin(objects, ",\n") << "\n]\n";
+  return out.good() ? absl::OkStatus()
+                    : absl::InternalError(absl::StrCat("Cannot write ", path));
+}
+
+}  // namespace
+
+absl::Status Run() {
+  const std::string dir = absl::GetFlag(FLAGS_testdata);
+  const std::vector<std::string> pairs = absl::GetFlag(FLAGS_pairs);
+  std::vector<std::pair<cv::Mat, cv::Mat>> images;
+  for (const std::string& pair : pairs) {
+    const std::vector<std::string> names = absl::StrSplit(pair, ':');
+    if (names.size() != 2) {
+      return absl::InvalidArgumentError(absl::StrCat("Bad pair ", pair));
+    }
+    cv::Mat img1 =
+        cv::imread(absl::StrCat(dir, "/", names[0]), cv::IMREAD_GRAYSCALE);
+    cv::Mat img2 =
+        cv::imread(absl::StrCat(dir, "/", names[1]), cv::IMREAD_GRAYSCALE);
+    if (img1.empty() || img2.empty()) {
+      return absl::InvalidArgumentError(absl::StrCat("No images - ", pair));
+    }
+    images.emplace_back(img1, img2);
+  }
+
+  std::vector<Combination> combinations;
+  for (int32_t p = 0; p < static_cast<int32_t>(pairs.size()); ++p) {
+    for (const NamedType& type : kTypes) {
+      for (const NamedAlgorithm& algorithm : kAlgorithms) {
+        combinations.push_back({p, &type, &algorithm});
+      }
+    }
+  }
+  std::vector<Result> results(combinations.size());
+  auto run = [&](const cv::Range& range) {
+    for (int i = range.start; i < range.end; ++i) {
+      const Combination& c = combinations[i];
+      results[i].pair = pairs[c.pair];
+      results[i].type = c.type->name;
+      results[i].algorithm = c.algorithm->name;
+      Benchmark(images[c.pair].first, images[c.pair].second, c, results[i]);
+    }
+  };
+  const int num_combinations = static_cast<int>(combinations.size());
+  const int64 start = cv::getTickCount();
+  if (absl::GetFlag(FLAGS_parallel)) {
+    // One stripe per combination, they differ a lot in cost.
+    cv::parallel_for_(cv::Range(0, num_combinations), run, num_combinations);
+  } else {
+    run(cv::Range(0, num_combinations));
+  }
+  LOG(INFO) << absl::StreamFormat("%d combinations in %.1f ms",
+                                  num_combinations, Milliseconds(start));
+
+  LOG(INFO) << absl::StreamFormat(
+      "%-26s %-6s %-5s %7s %7s %9s %9s %9s %9s %7s %7s %6s", "pair", "type",
+      "algo", "kpts1", "kpts2", "detect", "describe", "match", "homog",
+      "matches", "inliers", "ratio");
+  for (const Result& r : results) {
+    LOG(INFO) << absl::StreamFormat(
+        "%-26s %-6s %-5s %7d %7d %9.1f %9.1f %9.1f %9.1f %7d %7d %6.2f %s",
+        r.pair, r.type, r.algorithm, r.keypoints1, r.keypoints2, r.detect_ms,
+        r.describe_ms, r.match_ms, r.homography_ms, r.matches, r.inliers,
+        r.inlier_ratio(), r.error);
+  }
+  if (const std::string csv = absl::GetFlag(FLAGS_csv); !csv.empty()) {
+    RETURN_IF_ERROR(WriteCsv(csv, results));
+  }
+  if (const std::string json = absl::GetFlag(FLAGS_json); !json.empty()) {
+    RETURN_IF_ERROR(WriteJson(json, results));
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,152 @@
+// Float, scalar quantized and product quantized SIFT descriptors of
+// testdata images: bytes per descriptor, k-NN matching time and recall of
+// the exact nearest neighbour.
+#include <string>
+#include <utility>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "keypoints/feature_extractor.h"
+#include "keypoints/l2_matcher.h"
+#include "keypoints/quantized_descriptors.h"
+#include "opencv2/imgcodecs.hpp"
+#include "status_macros.h"
+
+ABSL_FLAG(std::vector<std::string>, database,
+          std::vector<std::string>({"graf1.png", "leuvenA.jpg", "box.png",
+                                    "aero1.jpg", "lena.jpg", "building.jpg",
+                                    "baboon.jpg", "starry_night.jpg"}),
+          "Images whose descriptors are matched against");
+ABSL_FLAG(std::vector<std::string>, queries,
+          std::vector<std::string>({"graf3.png", "leuvenB.jpg",
+                                    "box_in_scene.png", "aero3.jpg"}),
+          "Images whose descriptors are the queries");
+ABSL_FLAG(std::string, testdata, "testdata", "Directory of the images");
+ABSL_FLAG(int32_t, k, 10, "Neighbours per query");
+ABSL_FLAG(std::vector<std::string>, subspaces,
+          std::vector<std::string>({"16", "32", "64"}),
+          "Product quantizer subspaces to compare");
+
+namespace {
+
+using ::hello::keypoints::ProductQuantizer;
+using ::hello::keypoints::ScalarQuantizer;
+
+double Milliseconds(int64 start) {
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+absl::StatusOr<cv::Mat> Describe(const std::vector<std::string>& images) {
+  const hello::keypoints::FeatureExtractor extractor(
+      hello::keypoints::DescriptorType::kSift);
+  cv::Mat all;
+  for (const std::string& name : images) {
+    const std::string path =
+        absl::StrCat(absl::GetFlag(FLAGS_testdata), "/", name);
+    const cv::Mat img = cv::imread(path, cv::IMREAD_GRAYSCALE);
+    if (img.empty()) {
+      return absl::InvalidArgumentError(absl::StrCat("No image - ", path));
+    }
+    std::vector<cv::KeyPoint> keypoints;
+    cv::Mat descriptors;
+    extractor.DetectAndCompute(img, keypoints, descriptors);
+    all.push_back(descriptors);
+  }
+  return all;
+}
+
+// Fractions of queries whose exact nearest neighbour is the first match
+// and is among all matches.
+std::pair<double, double> Recall(
+    const std::vector<std::vector<cv::DMatch>>& exact,
+    const std::vector<std::vector<cv::DMatch>>& matches) {
+  int first = 0;
+  int any = 0;
+  for (size_t q = 0; q < exact.size(); ++q) {
+    if (exact[q].empty() || matches[q].empty()) continue;
+    const int want = exact[q][0].trainIdx;
+    first += matches[q][0].trainIdx == want;
+    for (const cv::DMatch& m : matches[q]) {
+      if (m.trainIdx == want) {
+        ++any;
+        break;
+      }
+    }
+  }
+  return {static_cast<double>(first) / exact.size(),
+          static_cast<double>(any) / exact.size()};
+}
+
+void Report(const std::string& name, double bytes, double float_bytes,
+            double ms, std::pair<double, double> recall) {
+  LOG(INFO) << absl::StreamFormat("%-10s %6.0f %7.1fx %10.1f %9.3f %9.3f",
+                                  name, bytes, float_bytes / bytes, ms,
+                                  recall.first, recall.second);
+}
+
+}  // namespace
+
+absl::Status Run() {
+  ASSIGN_OR_RETURN(const cv::Mat train,
+                   Describe(absl::GetFlag(FLAGS_database)));
+  ASSIGN_OR_RETURN(const cv::Mat query,
+                   Describe(absl::GetFlag(FLAGS_queries)));
+  const int32_t k = absl::GetFlag(FLAGS_k);
+  LOG(INFO) << absl::StreamFormat("%d database, %d query descriptors",
+                                  train.rows, query.rows);
+  LOG(INFO) << absl::StreamFormat("%-10s %6s %8s %10s %9s %9s", "mode",
+                                  "bytes", "smaller", "match_ms", "recall@1",
+                                  absl::StrCat("recall@", k));
+
+  hello::keypoints::L2Matcher::Options options;
+  options.ratio = 0;
+  options.cross_check = false;
+  std::vector<std::vector<cv::DMatch>> exact;
+  int64 start = cv::getTickCount();
+  RETURN_IF_ERROR(
+      hello::keypoints::L2Matcher(options).KnnMatch(query, train, k, exact));
+  const double float_bytes = train.cols * sizeof(float);
+  Report("float", float_bytes, float_bytes, Milliseconds(start),
+         Recall(exact, exact));
+
+  ASSIGN_OR_RETURN(const ScalarQuantizer scalar, ScalarQuantizer::Train(train));
+  ASSIGN_OR_RETURN(const cv::Mat train_codes, scalar.Encode(train));
+  ASSIGN_OR_RETURN(const cv::Mat query_codes, scalar.Encode(query));
+  std::vector<std::vector<cv::DMatch>> matches;
+  start = cv::getTickCount();
+  RETURN_IF_ERROR(scalar.KnnMatch(query_codes, train_codes, k, matches));
+  Report("sq8", train_codes.cols, float_bytes, Milliseconds(start),
+         Recall(exact, matches));
+
+  for (const std::string& flag : absl::GetFlag(FLAGS_subspaces)) {
+    ProductQuantizer::Options pq_options;
+    if (!absl::SimpleAtoi(flag, &pq_options.num_subspaces)) {
+      return absl::InvalidArgumentError(absl::StrCat("Bad subspaces ", flag));
+    }
+    ASSIGN_OR_RETURN(const auto pq, ProductQuantizer::Train(train, pq_options));
+    ASSIGN_OR_RETURN(const cv::Mat codes, pq->Encode(train));
+    start = cv::getTickCount();
+    RETURN_IF_ERROR(pq->KnnMatch(query, codes, k, matches));
+    Report(absl::StrCat("pq", pq_options.num_subspaces), codes.cols,
+           float_bytes, Milliseconds(start), Recall(exact, matches));
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,264 @@
+#include "keypoints/quantized_descriptors.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
+#include "opencv2/core/hal/hal.hpp"
+#include "util/trace.h"
+
+namespace hello::keypoints {
+namespace {
+
+// The k smallest squared distances pushed so far, sorted.
+class TopK {
+ public:
+  explicit TopK(int32_t k) : k_(k) {}
+
+  float worst() const {
+    return static_cast<int32_t>(distances_.size()) < k_
+               ? std::numeric_limits<float>::max()
+               : distances_.back();
+  }
+
+  void Push(float distance, int32_t index) {
+    if (distance >= worst()) return;
+    const auto it =
+        std::upper_bound(distances_.begin(), distances_.end(), distance);
+    const auto at = it - distances_.begin();
+    distances_.insert(it, distance);
+    indices_.insert(indices_.begin() + at, index);
+    if (static_cast<int32_t>(distances_.size()) > k_) {
+      distances_.pop_back();
+      indices_.pop_back();
+    }
+  }
+
+  void Emit(int32_t query, std::vector<cv::DMatch>& matches) const {
+    matches.clear();
+    for (size_t j = 0; j < distances_.size(); ++j) {
+      matches.emplace_back(query, indices_[j], std::sqrt(distances_[j]));
+    }
+  }
+
+ private:
+  const int32_t k_;
+  std::vector<float> distances_;
+  std::vector<int32_t> indices_;
+};
+
+uint32_t SquaredDifference(const uint8_t* a, const uint8_t* b, int32_t n) {
+  uint32_t sum = 0;
+  for (int32_t i = 0; i < n; ++i) {
+    const int32_t d = static_cast<int32_t>(a[i]) - b[i];
+    sum += d * d;
+  }
+  return sum;
+}
+
+absl::Status CheckKnnArguments(const cv::Mat& query, int query_type,
+                               int32_t query_width, const cv::Mat& train,
+                               int32_t train_width, int32_t k) {
+  if (k < 1) return absl::InvalidArgumentError("k must be positive");
+  if ((!query.empty() && query.type() != query_type) ||
+      (!train.empty() && train.type() != CV_8U)) {
+    return absl::InvalidArgumentError("Unexpected descriptor or code type");
+  }
+  if ((!query.empty() && query.cols != query_width) ||
+      (!train.empty() && train.cols != train_width)) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Widths %d and %d, expected %d and %d", query.cols,
+                        train.cols, query_width, train_width));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::StatusOr<ScalarQuantizer> ScalarQuantizer::Train(
+    const cv::Mat& descriptors) {
+  if (descriptors.empty() || descriptors.type() != CV_32F) {
+    return absl::InvalidArgumentError("Need CV_32F training descriptors");
+  }
+  double min = 0;
+  double max = 0;
+  cv::minMaxLoc(descriptors, &min, &max);
+  const float step = max > min ? static_cast<float>((max - min) / 255) : 1.f;
+  return ScalarQuantizer(static_cast<float>(min), step);
+}
+
+absl::StatusOr<cv::Mat> ScalarQuantizer::Encode(
+    const cv::Mat& descriptors) const {
+  if (!descriptors.empty() && descriptors.type() != CV_32F) {
+    return absl::InvalidArgumentError("Descriptors must be CV_32F");
+  }
+  cv::Mat codes;
+  descriptors.convertTo(codes, CV_8U, 1 / step_, -offset_ / step_);
+  return codes;
+}
+
+cv::Mat ScalarQuantizer::Decode(const cv::Mat& codes) const {
+  cv::Mat descriptors;
+  codes.convertTo(descriptors, CV_32F, step_, offset_);
+  return descriptors;
+}
+
+absl::Status ScalarQuantizer::KnnMatch(
+    const cv::Mat& query_codes, const cv::Mat& train_codes, int32_t k,
+    std::vector<std::vector<cv::DMatch>>& matches) const {
+  TRACE_SCOPE("keypoints/scalar_quantized_knn");
+  matches.clear();
+  const int32_t width =
+      query_codes.empty() ? train_codes.cols : query_codes.cols;
+  if (auto status = CheckKnnArguments(query_codes, CV_8U, width, train_codes,
+                                      width, k);
+      !status.ok()) {
+    return status;
+  }
+  matches.resize(query_codes.rows);
+  if (train_codes.empty()) return absl::OkStatus();
+  const float scale = step_ * step_;
+  cv::parallel_for_(cv::Range(0, query_codes.rows), [&](const cv::Range& r) {
+    for (int32_t q = r.start; q < r.end; ++q) {
+      TopK top(k);
+      const uint8_t* query = query_codes.ptr<uint8_t>(q);
+      for (int32_t t = 0; t < train_codes.rows; ++t) {
+        top.Push(SquaredDifference(query, train_codes.ptr<uint8_t>(t), width) *
+                     scale,
+                 t);
+      }
+      top.Emit(q, matches[q]);
+    }
+  });
+  return absl::OkStatus();
+}
+
+ProductQuantizer::ProductQuantizer(int32_t dim, int32_t num_subspaces)
+    : dim_(dim),
+      num_subspaces_(num_subspaces),
+      sub_dim_(dim / num_subspaces),
+      centroids_(num_subspaces) {}
+
+absl::StatusOr<std::unique_ptr<ProductQuantizer>> ProductQuantizer::Train(
+    const cv::Mat& descriptors, const Options& options) {
+  TRACE_SCOPE("keypoints/product_quantizer_train");
+  if (descriptors.type() != CV_32F || descriptors.rows < kNumCentroids) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Need at least %d CV_32F training descriptors", kNumCentroids));
+  }
+  if (options.num_subspaces < 1 ||
+      descriptors.cols % options.num_subspaces != 0) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("%d subspaces don't divide the width %d",
+                        options.num_subspaces, descriptors.cols));
+  }
+  cv::Mat data = descriptors;
+  if (data.rows > options.max_training_descriptors &&
+      options.max_training_descriptors >= kNumCentroids) {
+    std::vector<int> order(data.rows);
+    std::iota(order.begin(), order.end(), 0);
+    cv::randShuffle(order);
+    cv::Mat sample(options.max_training_descriptors, data.cols, CV_32F);
+    for (int i = 0; i < sample.rows; ++i) {
+      data.row(order[i]).copyTo(sample.row(i));
+    }
+    data = sample;
+  }
+  auto quantizer = absl::WrapUnique(
+      new ProductQuantizer(descriptors.cols, options.num_subspaces));
+  const int32_t sub_dim = quantizer->sub_dim_;
+  for (int32_t s = 0; s < options.num_subspaces; ++s) {
+    const cv::Mat part =
+        data.colRange(s * sub_dim, (s + 1) * sub_dim).clone();
+    cv::Mat labels;
+    cv::kmeans(part, kNumCentroids, labels,
+               cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS,
+                                options.kmeans_iterations, 1e-4),
+               1, cv::KMEANS_PP_CENTERS, quantizer->centroids_[s]);
+  }
+  return quantizer;
+}
+
+absl::StatusOr<cv::Mat> ProductQuantizer::Encode(
+    const cv::Mat& descriptors) const {
+  TRACE_SCOPE("keypoints/product_quantizer_encode");
+  if (descriptors.empty()) return cv::Mat(0, num_subspaces_, CV_8U);
+  if (descriptors.type() != CV_32F || descriptors.cols != dim_) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Descriptors must be CV_32F of width %d", dim_));
+  }
+  cv::Mat codes(descriptors.rows, num_subspaces_, CV_8U);
+  cv::parallel_for_(cv::Range(0, descriptors.rows), [&](const cv::Range& r) {
+    for (int32_t i = r.start; i < r.end; ++i) {
+      const float* row = descriptors.ptr<float>(i);
+      uint8_t* code = codes.ptr<uint8_t>(i);
+      for (int32_t s = 0; s < num_subspaces_; ++s) {
+        float best = std::numeric_limits<float>::max();
+        for (int32_t c = 0; c < kNumCentroids; ++c) {
+          const float d = cv::hal::normL2Sqr_(
+              row + s * sub_dim_, centroids_[s].ptr<float>(c), sub_dim_);
+          if (d < best) {
+            best = d;
+            code[s] = static_cast<uint8_t>(c);
+          }
+        }
+      }
+    }
+  });
+  return codes;
+}
+
+cv::Mat ProductQuantizer::Decode(const cv::Mat& codes) const {
+  cv::Mat descriptors(codes.rows, dim_, CV_32F);
+  for (int32_t i = 0; i < codes.rows; ++i) {
+    const uint8_t* code = codes.ptr<uint8_t>(i);
+    float* row = descriptors.ptr<float>(i);
+    for (int32_t s = 0; s < num_subspaces_; ++s) {
+      std::copy_n(centroids_[s].ptr<float>(code[s]), sub_dim_,
+                  row + s * sub_dim_);
+    }
+  }
+  return descriptors;
+}
+
+absl::Status ProductQuantizer::KnnMatch(
+    const cv::Mat& query, const cv::Mat& train_codes, int32_t k,
+    std::vector<std::vector<cv::DMatch>>& matches) const {
+  TRACE_SCOPE("keypoints/product_quantized_knn");
+  matches.clear();
+  if (auto status = CheckKnnArguments(query, CV_32F, dim_, train_codes,
+                                      num_subspaces_, k);
+      !status.ok()) {
+    return status;
+  }
+  matches.resize(query.rows);
+  if (train_codes.empty()) return absl::OkStatus();
+  cv::parallel_for_(cv::Range(0, query.rows), [&](const cv::Range& r) {
+    // Squared distance of every query part to every centroid of its
+    // subspace.
+    std::vector<float> table(num_subspaces_ * kNumCentroids);
+    for (int32_t q = r.start; q < r.end; ++q) {
+      const float* row = query.ptr<float>(q);
+      for (int32_t s = 0; s < num_subspaces_; ++s) {
+        for (int32_t c = 0; c < kNumCentroids; ++c) {
+          table[s * kNumCentroids + c] = cv::hal::normL2Sqr_(
+              row + s * sub_dim_, centroids_[s].ptr<float>(c), sub_dim_);
+        }
+      }
+      TopK top(k);
+      for (int32_t t = 0; t < train_codes.rows; ++t) {
+        const uint8_t* code = train_codes.ptr<uint8_t>(t);
+        float distance = 0;
+        for (int32_t s = 0; s < num_subspaces_; ++s) {
+          distance += table[s * kNumCentroids + code[s]];
+        }
+        top.Push(distance, t);
+      }
+      top.Emit(q, matches[q]);
+    }
+  });
+  return absl::OkStatus();
+}
+
+}  // namespace hello::keypoints
@@ -0,0 +1,91 @@
+#ifndef KEYPOINTS_QUANTIZED_DESCRIPTORS_H_
+#define KEYPOINTS_QUANTIZED_DESCRIPTORS_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "opencv2/core.hpp"
+
+namespace hello::keypoints {
+
+// Float descriptors scaled to one byte per value with a single offset and
+// step for all dimensions, 4x smaller. The squared L2 distance of two
+// codes is the sum of squared byte differences times step^2, so codes are
+// matched without decoding.
+class ScalarQuantizer {
+ public:
+  // Range of the values of CV_32F training descriptors.
+  static absl::StatusOr<ScalarQuantizer> Train(const cv::Mat& descriptors);
+
+  // CV_8U codes, one row per descriptor, values outside the trained range
+  // are saturated.
+  absl::StatusOr<cv::Mat> Encode(const cv::Mat& descriptors) const;
+  cv::Mat Decode(const cv::Mat& codes) const;
+
+  // The k nearest train codes of every query code, nearest first, with
+  // approximate L2 distances. Query rows are matched in parallel.
+  absl::Status KnnMatch(const cv::Mat& query_codes,
+                        const cv::Mat& train_codes, int32_t k,
+                        std::vector<std::vector<cv::DMatch>>& matches) const;
+
+  float offset() const { return offset_; }
+  float step() const { return step_; }
+
+ private:
+  ScalarQuantizer(float offset, float step) : offset_(offset), step_(step) {}
+
+  float offset_;
+  float step_;
+};
+
+// Product quantization (Jegou et al.): the descriptor is split into
+// subspaces and every part is replaced by the index of its nearest of 256
+// centroids learned by k-means, so a 128 float SIFT descriptor shrinks
+// from 512 to num_subspaces bytes. Queries stay float and are compared
+// with the codes by asymmetric distance computation, one table of
+// distances from the query to all centroids turns every code distance into
+// num_subspaces lookups.
+class ProductQuantizer {
+ public:
+  struct Options {
+    // Must divide the descriptor width, 32 gives 16x compression for SIFT.
+    int32_t num_subspaces = 32;
+    int32_t kmeans_iterations = 20;
+    // Training descriptors are subsampled to this many.
+    int32_t max_training_descriptors = 50000;
+  };
+
+  static constexpr int32_t kNumCentroids = 256;
+
+  // From CV_32F descriptors, at least kNumCentroids of them.
+  static absl::StatusOr<std::unique_ptr<ProductQuantizer>> Train(
+      const cv::Mat& descriptors, const Options& options);
+
+  // CV_8U codes with num_subspaces bytes per descriptor.
+  absl::StatusOr<cv::Mat> Encode(const cv::Mat& descriptors) const;
+  cv::Mat Decode(const cv::Mat& codes) const;
+
+  // The k nearest train codes of every CV_32F query row, nearest first,
+  // with approximate L2 distances. Query rows are matched in parallel.
+  absl::Status KnnMatch(const cv::Mat& query, const cv::Mat& train_codes,
+                        int32_t k,
+                        std::vector<std::vector<cv::DMatch>>& matches) const;
+
+  int32_t num_subspaces() const { return num_subspaces_; }
+  int32_t dim() const { return dim_; }
+
+ private:
+  ProductQuantizer(int32_t dim, int32_t num_subspaces);
+
+  const int32_t dim_;
+  const int32_t num_subspaces_;
+  const int32_t sub_dim_;
+  // kNumCentroids rows of sub_dim_ values for every subspace.
+  std::vector<cv::Mat> centroids_;
+};
+
+}  // namespace hello::keypoints
+
+#endif  // KEYPOINTS_QUANTIZED_DESCRIPTORS_H_
@@ -0,0 +1,139 @@
+#include "keypoints/quantized_descriptors.h"
+#include <cmath>
+#include <vector>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+#include "keypoints/l2_matcher.h"
+
+namespace hello::keypoints {
+namespace {
+
+using ::testing::Eq;
+using ::testing::FloatNear;
+using ::testing::Ge;
+using ::testing::Le;
+using ::testing::SizeIs;
+
+// SIFT-like descriptors around a few hundred cluster centers.
+cv::Mat MakeDescriptors(int rows, int cols, uint64_t seed) {
+  cv::RNG rng(seed);
+  cv::Mat centers(300, cols, CV_32F);
+  rng.fill(centers, cv::RNG::UNIFORM, 0, 160);
+  cv::Mat descriptors(rows, cols, CV_32F);
+  for (int i = 0; i < rows; ++i) {
+    cv::Mat noise(1, cols, CV_32F);
+    rng.fill(noise, cv::RNG::NORMAL, 0, 8);
+    cv::Mat row = centers.row(rng.uniform(0, centers.rows)) + noise;
+    cv::max(row, 0.0, row);
+    row.copyTo(descriptors.row(i));
+  }
+  return descriptors;
+}
+
+// Fraction of queries whose exact nearest neighbour is among the matches.
+double Recall(const cv::Mat& query, const cv::Mat& train,
+              const std::vector<std::vector<cv::DMatch>>& matches) {
+  L2Matcher::Options options;
+  options.ratio = 0;
+  options.cross_check = false;
+  std::vector<std::vector<cv::DMatch>> exact;
+  EXPECT_TRUE(L2Matcher(options).KnnMatch(query, train, 1, exact).ok());
+  int found = 0;
+  for (int q = 0; q < query.rows; ++q) {
+    for (const cv::DMatch& m : matches[q]) {
+      if (m.trainIdx == exact[q][0].trainIdx) {
+        ++found;
+        break;
+      }
+    }
+  }
+  return static_cast<double>(found) / query.rows;
+}
+
+TEST(ScalarQuantizerTest, RoundTripsWithinHalfAStep) {
+  const cv::Mat descriptors = MakeDescriptors(500, 128, 1);
+  auto quantizer = ScalarQuantizer::Train(descriptors);
+  ASSERT_TRUE(quantizer.ok());
+  auto codes = quantizer->Encode(descriptors);
+  ASSERT_TRUE(codes.ok());
+  EXPECT_THAT(codes->type(), Eq(CV_8U));
+  EXPECT_THAT(codes->total() * codes->elemSize() * 4,
+              Eq(descriptors.total() * descriptors.elemSize()));
+  const cv::Mat decoded = quantizer->Decode(*codes);
+  EXPECT_THAT(cv::norm(decoded, descriptors, cv::NORM_INF),
+              Le(quantizer->step() * 0.501));
+}
+
+TEST(ScalarQuantizerTest, MatchesLikeFloat) {
+  const cv::Mat train = MakeDescriptors(2000, 128, 2);
+  const cv::Mat query = MakeDescriptors(200, 128, 3);
+  auto quantizer = ScalarQuantizer::Train(train);
+  ASSERT_TRUE(quantizer.ok());
+  auto train_codes = quantizer->Encode(train);
+  auto query_codes = quantizer->Encode(query);
+  ASSERT_TRUE(train_codes.ok() && query_codes.ok());
+  std::vector<std::vector<cv::DMatch>> matches;
+  ASSERT_TRUE(
+      quantizer->KnnMatch(*query_codes, *train_codes, 2, matches).ok());
+  ASSERT_THAT(matches, SizeIs(query.rows));
+  for (const auto& knn : matches) {
+    ASSERT_THAT(knn, SizeIs(2));
+    EXPECT_THAT(knn[0].distance, Le(knn[1].distance));
+  }
+  // Distances approximate the float ones.
+  const cv::DMatch& m = matches[0][0];
+  EXPECT_THAT(m.distance,
+              FloatNear(cv::norm(query.row(0), train.row(m.trainIdx)),
+                        quantizer->step() * 12));
+  EXPECT_THAT(Recall(query, train, matches), Ge(0.9));
+}
+
+TEST(ProductQuantizerTest, CompressesAndKeepsRecall) {
+  const cv::Mat train = MakeDescriptors(4000, 128, 4);
+  const cv::Mat query = MakeDescriptors(200, 128, 5);
+  ProductQuantizer::Options options;
+  options.num_subspaces = 32;
+  options.kmeans_iterations = 10;
+  auto quantizer = ProductQuantizer::Train(train, options);
+  ASSERT_TRUE(quantizer.ok()) << quantizer.status();
+  auto codes = (*quantizer)->Encode(train);
+  ASSERT_TRUE(codes.ok());
+  EXPECT_THAT(codes->cols, Eq(32));
+  EXPECT_THAT(codes->type(), Eq(CV_8U));
+
+  std::vector<std::vector<cv::DMatch>> matches;
+  ASSERT_TRUE((*quantizer)->KnnMatch(query, *codes, 10, matches).ok());
+  ASSERT_THAT(matches, SizeIs(query.rows));
+  EXPECT_THAT(matches[0], SizeIs(10));
+  EXPECT_THAT(Recall(query, train, matches), Ge(0.8));
+
+  // Decoded descriptors are closer to the originals than the spread of
+  // the data.
+  const cv::Mat decoded = (*quantizer)->Decode(*codes);
+  EXPECT_THAT(cv::norm(decoded, train) / std::sqrt(train.rows), Le(100.0));
+}
+
+TEST(ProductQuantizerTest, RejectsBadInput) {
+  const cv::Mat train = MakeDescriptors(300, 128, 6);
+  ProductQuantizer::Options options;
+  options.num_subspaces = 30;
+  EXPECT_THAT(ProductQuantizer::Train(train, options).status().code(),
+              Eq(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(
+      ProductQuantizer::Train(train.rowRange(0, 100), ProductQuantizer::Options())
+          .status()
+          .code(),
+      Eq(absl::StatusCode::kInvalidArgument));
+  options.num_subspaces = 16;
+  options.kmeans_iterations = 3;
+  auto quantizer = ProductQuantizer::Train(train, options);
+  ASSERT_TRUE(quantizer.ok());
+  std::vector<std::vector<cv::DMatch>> matches;
+  EXPECT_FALSE((*quantizer)
+                   ->KnnMatch(train.colRange(0, 64), cv::Mat(), 1, matches)
+                   .ok());
+  EXPECT_FALSE((*quantizer)->KnnMatch(train, cv::Mat(), 0, matches).ok());
+}
+
+}  // namespace
+}  // namespace hello::keypoints
@@ -0,0 +1,139 @@
+// Finds the reference images that look like the query with a vocabulary
+// tree, then verifies the shortlist with descriptor matching and a RANSAC
+// homography.
+#include <string>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "keypoints/feature_extractor.h"
+#include "keypoints/l2_matcher.h"
+#include "keypoints/vocabulary_tree.h"
+#include "opencv2/calib3d.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "status_macros.h"
+
+ABSL_FLAG(std::vector<std::string>, reference_paths,
+          std::vector<std::string>(
+              {"testdata/box_in_scene.png", "testdata/graf1.png",
+               "testdata/graf3.png", "testdata/leuvenA.jpg",
+               "testdata/leuvenB.jpg", "testdata/left01.jpg",
+               "testdata/building.jpg", "testdata/baboon.jpg",
+               "testdata/fruits.jpg", "testdata/home.jpg",
+               "testdata/butterfly.jpg", "testdata/aero1.jpg",
+               "testdata/board.jpg", "testdata/apple.jpg"}),
+          "Reference images");
+ABSL_FLAG(std::string, query_path, "testdata/box.png", "Query image");
+ABSL_FLAG(int32_t, shortlist, 5, "Candidates passed to verification");
+ABSL_FLAG(int32_t, branching, 10, "Vocabulary tree branching factor");
+ABSL_FLAG(int32_t, depth, 4, "Vocabulary tree depth");
+
+namespace {
+
+using ::hello::keypoints::FeatureBatch;
+
+double Milliseconds(int64 start) {
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+absl::StatusOr<cv::Mat> ReadGray(const std::string& image_path) {
+  cv::Mat img = cv::imread(image_path, cv::IMREAD_GRAYSCALE);
+  if (img.empty()) {
+    return absl::InvalidArgumentError(absl::StrCat("No image - ", image_path));
+  }
+  return img;
+}
+
+// RANSAC inliers of the ratio test matches, 0 if there are too few.
+absl::StatusOr<int> CountInliers(const std::vector<cv::KeyPoint>& kpts1,
+                                 const cv::Mat& desc1,
+                                 const std::vector<cv::KeyPoint>& kpts2,
+                                 const cv::Mat& desc2) {
+  hello::keypoints::L2Matcher::Options options;
+  options.cross_check = false;
+  std::vector<cv::DMatch> matches;
+  RETURN_IF_ERROR(
+      hello::keypoints::L2Matcher(options).Match(desc1, desc2, matches));
+  if (matches.size() < 4) return 0;
+  std::vector<cv::Point2f> pts1;
+  std::vector<cv::Point2f> pts2;
+  for (const cv::DMatch& match : matches) {
+    pts1.push_back(kpts1[match.queryIdx].pt);
+    pts2.push_back(kpts2[match.trainIdx].pt);
+  }
+  std::vector<uchar> mask;
+  cv::findHomography(pts1, pts2, cv::RANSAC, 4, mask);
+  return cv::countNonZero(mask);
+}
+
+}  // namespace
+
+absl::Status Run() {
+  const std::vector<std::string> paths = absl::GetFlag(FLAGS_reference_paths);
+  std::vector<cv::Mat> images;
+  for (const std::string& image_path : paths) {
+    ASSIGN_OR_RETURN(cv::Mat img, ReadGray(image_path));
+    images.push_back(img);
+  }
+  const hello::keypoints::FeatureExtractor extractor(
+      hello::keypoints::DescriptorType::kSift);
+  int64 start = cv::getTickCount();
+  const FeatureBatch references = extractor.ExtractBatch(images);
+  const double extract_ms = Milliseconds(start);
+
+  hello::keypoints::VocabularyTree::Options options;
+  options.branching = absl::GetFlag(FLAGS_branching);
+  options.depth = absl::GetFlag(FLAGS_depth);
+  start = cv::getTickCount();
+  ASSIGN_OR_RETURN(
+      auto tree,
+      hello::keypoints::VocabularyTree::Train(references.descriptors, options));
+  const double train_ms = Milliseconds(start);
+  start = cv::getTickCount();
+  hello::keypoints::ImageDatabase database(*tree);
+  for (int32_t i = 0; i < references.size(); ++i) {
+    RETURN_IF_ERROR(database.Add(references.descriptors_of(i)).status());
+  }
+  database.Finalize();
+  LOG(INFO) << absl::StreamFormat(
+      "%d images, %d descriptors, %d words: extract %.0f ms, train %.0f ms, "
+      "index %.0f ms",
+      references.size(), references.descriptors.rows, tree->num_words(),
+      extract_ms, train_ms, Milliseconds(start));
+
+  ASSIGN_OR_RETURN(const cv::Mat query,
+                   ReadGray(absl::GetFlag(FLAGS_query_path)));
+  std::vector<cv::KeyPoint> kpts;
+  cv::Mat desc;
+  extractor.DetectAndCompute(query, kpts, desc);
+  start = cv::getTickCount();
+  ASSIGN_OR_RETURN(auto candidates,
+                   database.Query(desc, absl::GetFlag(FLAGS_shortlist)));
+  LOG(INFO) << absl::StreamFormat("Query %.2f ms", Milliseconds(start));
+
+  for (const hello::keypoints::RetrievalCandidate& candidate : candidates) {
+    const int32_t id = candidate.image_id;
+    ASSIGN_OR_RETURN(const int inliers,
+                     CountInliers(kpts, desc, references.keypoints_of(id),
+                                  references.descriptors_of(id)));
+    LOG(INFO) << absl::StreamFormat("%-28s score %.3f inliers %d", paths[id],
+                                    candidate.score, inliers);
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
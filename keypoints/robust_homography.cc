@@ -0,0 +1,398 @@
+#include "keypoints/robust_homography.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include "absl/strings/str_cat.h"
+#include "opencv2/calib3d.hpp"
+#include "opencv2/imgproc.hpp"
+#include "util/trace.h"
+
+namespace hello::keypoints {
+namespace {
+
+constexpr int32_t kSampleSize = 4;
+// Cost of computing a model in point verifications and models per minimal
+// sample, the two constants of the SPRT decision threshold.
+constexpr double kModelCost = 200;
+constexpr double kModelsPerSample = 1;
+// Correspondences in a non-minimal sample of local optimization.
+constexpr int32_t kLoSampleSize = 12;
+// Local optimization starts at this multiple of the threshold and shrinks
+// it to the threshold over kLoSteps least squares fits.
+constexpr double kLoThresholdMultiplier = 3;
+constexpr int32_t kLoSteps = 4;
+// Smallest prefix of the ranking whose inlier ratio may end PROSAC.
+constexpr int32_t kMinProsacPrefix = 20;
+
+double SquaredError(const cv::Matx33d& h, const cv::Point2f& p,
+                    const cv::Point2f& q) {
+  const double w = h(2, 0) * p.x + h(2, 1) * p.y + h(2, 2);
+  if (std::abs(w) < std::numeric_limits<double>::epsilon()) {
+    return std::numeric_limits<double>::max();
+  }
+  const double dx = (h(0, 0) * p.x + h(0, 1) * p.y + h(0, 2)) / w - q.x;
+  const double dy = (h(1, 0) * p.x + h(1, 1) * p.y + h(1, 2)) / w - q.y;
+  return dx * dx + dy * dy;
+}
+
+double Orientation(const cv::Point2f& a, const cv::Point2f& b,
+                   const cv::Point2f& c) {
+  return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+// A sample is degenerate if three of its points are collinear in either
+// image, or if the triangles it spans are oriented inconsistently between
+// the images, which no homography of a plane in front of both cameras does.
+bool Degenerate(const cv::Point2f* p, const cv::Point2f* q) {
+  constexpr int32_t kTriples[4][3] = {{0, 1, 2}, {0, 1, 3}, {0, 2, 3},
+                                      {1, 2, 3}};
+  int32_t sign = 0;
+  for (const auto& t : kTriples) {
+    const double a = Orientation(p[t[0]], p[t[1]], p[t[2]]);
+    const double b = Orientation(q[t[0]], q[t[1]], q[t[2]]);
+    if (std::abs(a) < 1e-3 || std::abs(b) < 1e-3) return true;
+    const int32_t s = (a > 0) == (b > 0) ? 1 : -1;
+    if (sign != 0 && s != sign) return true;
+    sign = s;
+  }
+  return false;
+}
+
+// Least squares homography of the given correspondences, false if there
+// is none.
+bool Fit(const std::vector<cv::Point2f>& points1,
+         const std::vector<cv::Point2f>& points2,
+         const std::vector<int32_t>& indices, cv::Matx33d* h) {
+  std::vector<cv::Point2f> src;
+  std::vector<cv::Point2f> dst;
+  src.reserve(indices.size());
+  dst.reserve(indices.size());
+  for (int32_t i : indices) {
+    src.push_back(points1[i]);
+    dst.push_back(points2[i]);
+  }
+  const cv::Mat fit = cv::findHomography(src, dst, 0);
+  if (fit.empty()) return false;
+  *h = cv::Matx33d(fit);
+  return true;
+}
+
+// Wald's sequential probability ratio test for "the hypothesis is good".
+// A good model makes a random correspondence an inlier with probability
+// epsilon, a bad one with probability delta.
+class Sprt {
+ public:
+  // Both start low, so that little is rejected until a model was found.
+  Sprt() { Update(0.011, 0.01); }
+
+  void Update(double epsilon, double delta) {
+    delta_ = std::clamp(delta, 1e-4, 0.5);
+    epsilon_ = std::clamp(epsilon, delta_ * 1.1, 0.999);
+    const double c =
+        (1 - delta_) * std::log((1 - delta_) / (1 - epsilon_)) +
+        delta_ * std::log(delta_ / epsilon_);
+    const double k = kModelCost * c / kModelsPerSample + 1;
+    // Fixed point of A = k + log(A) above 1.
+    threshold_ = k;
+    for (int32_t i = 0; i < 100; ++i) {
+      const double next = k + std::log(threshold_);
+      if (std::abs(next - threshold_) < 1e-6) break;
+      threshold_ = next;
+    }
+    consistent_ratio_ = delta_ / epsilon_;
+    inconsistent_ratio_ = (1 - delta_) / (1 - epsilon_);
+  }
+
+  double epsilon() const { return epsilon_; }
+  double delta() const { return delta_; }
+  double threshold() const { return threshold_; }
+  double consistent_ratio() const { return consistent_ratio_; }
+  double inconsistent_ratio() const { return inconsistent_ratio_; }
+
+ private:
+  double epsilon_ = 0;
+  double delta_ = 0;
+  double threshold_ = 0;
+  double consistent_ratio_ = 0;
+  double inconsistent_ratio_ = 0;
+};
+
+// PROSAC sampling, Chum and Matas 2005. Samples come from the `pool` best
+// correspondences and always contain the worst of them, the pool grows
+// with the number of samples drawn so that after `max_samples` it is
+// uniform sampling from all of them.
+class ProsacSampler {
+ public:
+  ProsacSampler(int32_t n, int32_t max_samples) : growth_(n, 1) {
+    double t_n = max_samples;
+    for (int32_t i = 0; i < kSampleSize; ++i) {
+      t_n *= static_cast<double>(kSampleSize - i) / (n - i);
+    }
+    double t_n_prime = 1;
+    for (int32_t i = kSampleSize; i < n; ++i) {
+      const double t_next = t_n * (i + 1) / (i + 1 - kSampleSize);
+      t_n_prime += std::ceil(t_next - t_n);
+      growth_[i] = t_n_prime;
+      t_n = t_next;
+    }
+    max_samples_ = max_samples;
+    pool_ = kSampleSize;
+  }
+
+  // Fills positions into the quality order.
+  void Sample(cv::RNG& rng, int32_t* sample) {
+    const int32_t n = static_cast<int32_t>(growth_.size());
+    ++drawn_;
+    if (drawn_ > max_samples_) {
+      Uniform(rng, n, kSampleSize, sample);
+      return;
+    }
+    if (pool_ < n && drawn_ >= growth_[pool_ - 1]) ++pool_;
+    if (growth_[pool_ - 1] < drawn_) {
+      Uniform(rng, pool_, kSampleSize, sample);
+    } else {
+      Uniform(rng, pool_ - 1, kSampleSize - 1, sample);
+      sample[kSampleSize - 1] = pool_ - 1;
+    }
+  }
+
+  // Distinct values in [0, n).
+  static void Uniform(cv::RNG& rng, int32_t n, int32_t count,
+                      int32_t* sample) {
+    for (int32_t i = 0; i < count; ++i) {
+      bool repeated = true;
+      while (repeated) {
+        sample[i] = rng.uniform(0, n);
+        repeated = std::find(sample, sample + i, sample[i]) != sample + i;
+      }
+    }
+  }
+
+ private:
+  std::vector<double> growth_;
+  int32_t max_samples_ = 0;
+  int32_t pool_ = 0;
+  int32_t drawn_ = 0;
+};
+
+}  // namespace
+
+RobustHomography::RobustHomography(const Options& options)
+    : options_(options) {}
+
+absl::StatusOr<HomographyEstimate> RobustHomography::Estimate(
+    const std::vector<cv::Point2f>& points1,
+    const std::vector<cv::Point2f>& points2,
+    const std::vector<float>& quality) const {
+  TRACE_SCOPE("keypoints/robust_homography");
+  const int64 start = cv::getTickCount();
+  const int32_t n = static_cast<int32_t>(points1.size());
+  if (points2.size() != points1.size() ||
+      (!quality.empty() && quality.size() != points1.size())) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Mismatched sizes ", points1.size(), ", ",
+                     points2.size(), " and ", quality.size()));
+  }
+  if (n < kSampleSize) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Need at least 4 correspondences, got ", n));
+  }
+
+  cv::RNG rng(options_.seed);
+  // Correspondences best first for PROSAC.
+  std::vector<int32_t> ranked(n);
+  std::iota(ranked.begin(), ranked.end(), 0);
+  if (!quality.empty()) {
+    std::stable_sort(ranked.begin(), ranked.end(), [&](int32_t a, int32_t b) {
+      return quality[a] < quality[b];
+    });
+  }
+  // The SPRT needs the correspondences in random order.
+  std::vector<int32_t> shuffled(n);
+  std::iota(shuffled.begin(), shuffled.end(), 0);
+  for (int32_t i = n - 1; i > 0; --i) {
+    std::swap(shuffled[i], shuffled[rng.uniform(0, i + 1)]);
+  }
+
+  const double threshold_sqr = options_.threshold * options_.threshold;
+  HomographyEstimate estimate;
+  RobustHomographyStats& stats = estimate.stats;
+  auto inliers_of = [&](const cv::Matx33d& h, double max_error_sqr) {
+    std::vector<int32_t> inliers;
+    for (int32_t i = 0; i < n; ++i) {
+      if (SquaredError(h, points1[i], points2[i]) <= max_error_sqr) {
+        inliers.push_back(i);
+      }
+    }
+    stats.points_verified += n;
+    return inliers;
+  };
+
+  Sprt sprt;
+  double rejected_consistent = 0;
+  int64_t rejected_tested = 0;
+  ProsacSampler prosac(n, options_.max_iterations);
+  cv::Matx33d best;
+  std::vector<int32_t> best_inliers;
+  int64_t max_iterations = options_.max_iterations;
+
+  auto local_optimization = [&]() {
+    ++stats.local_optimizations;
+    const std::vector<int32_t> seed_inliers = best_inliers;
+    const int32_t sample_size =
+        std::min<int32_t>(kLoSampleSize, seed_inliers.size());
+    const int32_t rounds = static_cast<int32_t>(seed_inliers.size()) <=
+                                   kLoSampleSize
+                               ? 1
+                               : options_.lo_iterations;
+    std::vector<int32_t> sample(sample_size);
+    for (int32_t r = 0; r < rounds; ++r) {
+      std::vector<int32_t> positions(sample_size);
+      ProsacSampler::Uniform(rng, static_cast<int32_t>(seed_inliers.size()),
+                             sample_size, positions.data());
+      for (int32_t i = 0; i < sample_size; ++i) {
+        sample[i] = seed_inliers[positions[i]];
+      }
+      cv::Matx33d h;
+      if (!Fit(points1, points2, sample, &h)) continue;
+      for (int32_t step = 0; step < kLoSteps; ++step) {
+        const double scale = kLoThresholdMultiplier -
+                             (kLoThresholdMultiplier - 1) * step /
+                                 (kLoSteps - 1);
+        const std::vector<int32_t> inliers =
+            inliers_of(h, threshold_sqr * scale * scale);
+        if (static_cast<int32_t>(inliers.size()) < kSampleSize ||
+            !Fit(points1, points2, inliers, &h)) {
+          break;
+        }
+      }
+      std::vector<int32_t> inliers = inliers_of(h, threshold_sqr);
+      if (inliers.size() > best_inliers.size()) {
+        best = h;
+        best_inliers = std::move(inliers);
+      }
+    }
+  };
+
+  // Samples after which a better model would have been found with the
+  // desired confidence. A good sample is drawn with probability epsilon^4
+  // and, with the SPRT, passes it with probability 1 - 1 / threshold. With
+  // PROSAC the best correspondences are sampled first, so the inlier ratio
+  // of any prefix of the ranking that is too high to be chance will do.
+  auto samples_needed = [&](const std::vector<int32_t>& inliers) {
+    auto needed = [&](double epsilon) -> int64_t {
+      double success = std::pow(epsilon, kSampleSize);
+      if (options_.sprt) success *= 1 - 1 / sprt.threshold();
+      if (success >= 1) return 1;
+      if (success <= 0) return options_.max_iterations;
+      return static_cast<int64_t>(std::min<double>(
+          std::ceil(std::log(1 - options_.confidence) / std::log(1 - success)),
+          options_.max_iterations));
+    };
+    int64_t samples = needed(static_cast<double>(inliers.size()) / n);
+    if (!options_.prosac) return samples;
+    std::vector<char> is_inlier(n, 0);
+    for (int32_t i : inliers) is_inlier[i] = 1;
+    const double beta = sprt.delta();
+    int32_t prefix_inliers = 0;
+    for (int32_t prefix = 1; prefix <= n; ++prefix) {
+      prefix_inliers += is_inlier[ranked[prefix - 1]];
+      if (prefix < kMinProsacPrefix) continue;
+      // Upper 95% quantile of the support a bad model gets by chance, from
+      // the normal approximation of Binomial(prefix - 4, beta).
+      const int32_t m = prefix - kSampleSize;
+      const double chance =
+          kSampleSize + beta * m + 1.645 * std::sqrt(beta * (1 - beta) * m);
+      if (prefix_inliers > chance) {
+        samples = std::min(
+            samples, needed(static_cast<double>(prefix_inliers) / prefix));
+      }
+    }
+    return samples;
+  };
+
+  int32_t sample[kSampleSize];
+  cv::Point2f p[kSampleSize];
+  cv::Point2f q[kSampleSize];
+  while (stats.iterations < max_iterations) {
+    ++stats.iterations;
+    if (options_.prosac) {
+      prosac.Sample(rng, sample);
+      for (int32_t& s : sample) s = ranked[s];
+    } else {
+      ProsacSampler::Uniform(rng, n, kSampleSize, sample);
+    }
+    for (int32_t i = 0; i < kSampleSize; ++i) {
+      p[i] = points1[sample[i]];
+      q[i] = points2[sample[i]];
+    }
+    if (Degenerate(p, q)) continue;
+    const cv::Matx33d h(cv::getPerspectiveTransform(p, q));
+    if (!cv::checkRange(h)) continue;
+    ++stats.hypotheses;
+
+    // Verify in random order, giving up once the likelihood ratio of
+    // "bad" over "good" passes the SPRT threshold.
+    double likelihood = 1;
+    int32_t consistent = 0;
+    int32_t tested = 0;
+    bool rejected = false;
+    for (int32_t i : shuffled) {
+      ++tested;
+      if (SquaredError(h, points1[i], points2[i]) <= threshold_sqr) {
+        ++consistent;
+        likelihood *= sprt.consistent_ratio();
+      } else {
+        likelihood *= sprt.inconsistent_ratio();
+      }
+      if (options_.sprt && likelihood > sprt.threshold()) {
+        rejected = true;
+        break;
+      }
+    }
+    stats.points_verified += tested;
+    if (rejected) {
+      ++stats.rejected_early;
+      rejected_consistent += static_cast<double>(consistent) / tested;
+      ++rejected_tested;
+      const double delta = rejected_consistent / rejected_tested;
+      if (std::abs(delta - sprt.delta()) > 0.05 * sprt.delta()) {
+        sprt.Update(sprt.epsilon(), delta);
+      }
+      continue;
+    }
+    if (consistent <= static_cast<int32_t>(best_inliers.size())) continue;
+
+    best = h;
+    best_inliers = inliers_of(h, threshold_sqr);
+    if (options_.local_optimization) local_optimization();
+    sprt.Update(static_cast<double>(best_inliers.size()) / n, sprt.delta());
+    max_iterations = std::min(max_iterations, samples_needed(best_inliers));
+  }
+
+  if (static_cast<int32_t>(best_inliers.size()) < kSampleSize) {
+    stats.seconds = (cv::getTickCount() - start) / cv::getTickFrequency();
+    return absl::NotFoundError("No homography found");
+  }
+  // Polish on all inliers, kept only if it doesn't lose any.
+  cv::Matx33d polished;
+  if (Fit(points1, points2, best_inliers, &polished)) {
+    std::vector<int32_t> inliers = inliers_of(polished, threshold_sqr);
+    if (inliers.size() >= best_inliers.size()) {
+      best = polished;
+      best_inliers = std::move(inliers);
+    }
+  }
+  if (std::abs(best(2, 2)) > std::numeric_limits<double>::epsilon()) {
+    best *= 1.0 / best(2, 2);
+  }
+  estimate.homography = cv::Mat(best, true);
+  estimate.inlier_mask.assign(n, 0);
+  for (int32_t i : best_inliers) estimate.inlier_mask[i] = 1;
+  estimate.num_inliers = static_cast<int32_t>(best_inliers.size());
+  stats.seconds = (cv::getTickCount() - start) / cv::getTickFrequency();
+  return estimate;
+}
+
+}  // namespace hello::keypoints
@@ -0,0 +1,75 @@
+#ifndef KEYPOINTS_ROBUST_HOMOGRAPHY_H_
+#define KEYPOINTS_ROBUST_HOMOGRAPHY_H_
+
+#include <cstdint>
+#include <vector>
+#include "absl/status/statusor.h"
+#include "opencv2/core.hpp"
+
+namespace hello::keypoints {
+
+// What an estimation cost.
+struct RobustHomographyStats {
+  // Minimal samples drawn, degenerate ones included.
+  int32_t iterations = 0;
+  // Models computed from non-degenerate samples.
+  int32_t hypotheses = 0;
+  // Hypotheses the SPRT gave up on before checking every correspondence.
+  int32_t rejected_early = 0;
+  // Correspondences checked against a hypothesis, over all hypotheses.
+  int64_t points_verified = 0;
+  int32_t local_optimizations = 0;
+  double seconds = 0;
+};
+
+struct HomographyEstimate {
+  // 3x3 CV_64F mapping the first points onto the second.
+  cv::Mat homography;
+  // One entry per correspondence, 1 for inliers, as findHomography's mask.
+  std::vector<char> inlier_mask;
+  int32_t num_inliers = 0;
+  RobustHomographyStats stats;
+};
+
+// RANSAC for homographies in the spirit of USAC:
+//  - PROSAC draws samples from the best correspondences first and grows
+//    the pool towards uniform sampling, so good matches are tried early.
+//  - Wald's sequential probability ratio test stops verifying a hypothesis
+//    as soon as it is likely bad, with its parameters adapted on the fly.
+//  - Every new best model is refined by local optimization, least squares
+//    on non-minimal samples of its inliers with a shrinking threshold.
+// Iteration stops once `confidence` that the best model was found is met.
+class RobustHomography {
+ public:
+  struct Options {
+    // Maximum reprojection error of an inlier in pixels.
+    double threshold = 4.0;
+    double confidence = 0.995;
+    int32_t max_iterations = 10000;
+    bool prosac = true;
+    bool sprt = true;
+    bool local_optimization = true;
+    // Non-minimal samples drawn per local optimization.
+    int32_t lo_iterations = 10;
+    uint64_t seed = 0x2545f491;
+  };
+
+  explicit RobustHomography(const Options& options);
+  RobustHomography() : RobustHomography(Options()) {}
+
+  // `quality` ranks the correspondences for PROSAC, lower is better, e.g.
+  // the match distance. Empty means no ranking, the points are then taken
+  // in the given order. InvalidArgument on mismatched or too few points,
+  // NotFound if no homography explains at least four correspondences.
+  absl::StatusOr<HomographyEstimate> Estimate(
+      const std::vector<cv::Point2f>& points1,
+      const std::vector<cv::Point2f>& points2,
+      const std::vector<float>& quality) const;
+
+ private:
+  const Options options_;
+};
+
+}  // namespace hello::keypoints
+
+#endif  // KEYPOINTS_ROBUST_HOMOGRAPHY_H_
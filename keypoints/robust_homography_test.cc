@@ -0,0 +1,146 @@
+#include "keypoints/robust_homography.h"
+#include <string>
+#include <vector>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+
+namespace hello::keypoints {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Gt;
+using ::testing::Le;
+using ::testing::Lt;
+using ::testing::SizeIs;
+using ::testing::TestWithParam;
+using ::testing::ValuesIn;
+
+constexpr double kTruth[9] = {0.9, 0.1, 30, -0.05, 1.1, 20, 1e-4, 2e-4, 1};
+
+struct Correspondences {
+  std::vector<cv::Point2f> points1;
+  std::vector<cv::Point2f> points2;
+  std::vector<float> quality;
+  std::vector<char> inlier;
+};
+
+// Points mapped by kTruth with noise, every correspondence an outlier with
+// probability `outlier_ratio`. Outliers rank worse on average.
+Correspondences MakeCorrespondences(int n, double outlier_ratio) {
+  cv::RNG rng(7);
+  Correspondences c;
+  for (int i = 0; i < n; ++i) {
+    const cv::Point2f p(rng.uniform(0.f, 640.f), rng.uniform(0.f, 480.f));
+    const bool outlier = rng.uniform(0.0, 1.0) < outlier_ratio;
+    cv::Point2f q(rng.uniform(0.f, 640.f), rng.uniform(0.f, 480.f));
+    if (!outlier) {
+      const double w = kTruth[6] * p.x + kTruth[7] * p.y + kTruth[8];
+      q.x = (kTruth[0] * p.x + kTruth[1] * p.y + kTruth[2]) / w +
+            rng.gaussian(0.5);
+      q.y = (kTruth[3] * p.x + kTruth[4] * p.y + kTruth[5]) / w +
+            rng.gaussian(0.5);
+    }
+    c.points1.push_back(p);
+    c.points2.push_back(q);
+    c.quality.push_back(rng.uniform(0.f, 60.f) + (outlier ? 20 : 0));
+    c.inlier.push_back(!outlier);
+  }
+  return c;
+}
+
+struct TestCase {
+  std::string test_name;
+  double outlier_ratio;
+  bool prosac;
+  bool sprt;
+  bool local_optimization;
+};
+
+using RobustHomographyTest = TestWithParam<TestCase>;
+
+TEST_P(RobustHomographyTest, RecoversHomographyAndInliers) {
+  const TestCase& test_case = GetParam();
+  const Correspondences c = MakeCorrespondences(600, test_case.outlier_ratio);
+  RobustHomography::Options options;
+  options.prosac = test_case.prosac;
+  options.sprt = test_case.sprt;
+  options.local_optimization = test_case.local_optimization;
+  const absl::StatusOr<HomographyEstimate> estimate =
+      RobustHomography(options).Estimate(c.points1, c.points2, c.quality);
+  ASSERT_TRUE(estimate.ok()) << estimate.status();
+
+  ASSERT_THAT(estimate->inlier_mask, SizeIs(c.points1.size()));
+  int wrong = 0;
+  for (size_t i = 0; i < c.inlier.size(); ++i) {
+    wrong += estimate->inlier_mask[i] != c.inlier[i];
+  }
+  EXPECT_THAT(wrong, Le(3));
+  // Reprojection of the image corners against the true homography.
+  for (const cv::Point2f& p : {cv::Point2f(0, 0), cv::Point2f(640, 0),
+                               cv::Point2f(0, 480), cv::Point2f(640, 480)}) {
+    const cv::Matx33d h(estimate->homography);
+    const cv::Vec3d got = h * cv::Vec3d(p.x, p.y, 1);
+    const double w = kTruth[6] * p.x + kTruth[7] * p.y + kTruth[8];
+    const cv::Point2d want((kTruth[0] * p.x + kTruth[1] * p.y + kTruth[2]) / w,
+                           (kTruth[3] * p.x + kTruth[4] * p.y + kTruth[5]) / w);
+    EXPECT_THAT(cv::norm(cv::Point2d(got[0] / got[2], got[1] / got[2]) - want),
+                Lt(2.0));
+  }
+
+  const RobustHomographyStats& stats = estimate->stats;
+  EXPECT_THAT(stats.iterations, Le(options.max_iterations));
+  EXPECT_THAT(stats.hypotheses, Le(stats.iterations));
+  EXPECT_THAT(stats.rejected_early, Le(stats.hypotheses));
+  EXPECT_THAT(stats.points_verified, Gt(0));
+  EXPECT_THAT(stats.local_optimizations, test_case.local_optimization
+                                             ? Ge(1)
+                                             : Eq(0));
+  if (!test_case.sprt) EXPECT_THAT(stats.rejected_early, Eq(0));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    RobustHomographyTests, RobustHomographyTest,
+    ValuesIn<TestCase>({
+        {"Ransac", 0.5, false, false, false},
+        {"LoRansac", 0.5, false, false, true},
+        {"Sprt", 0.5, false, true, true},
+        {"Prosac", 0.5, true, false, true},
+        {"All", 0.5, true, true, true},
+        {"AllMostlyOutliers", 0.85, true, true, true},
+    }),
+    [](const testing::TestParamInfo<RobustHomographyTest::ParamType>& info) {
+      return info.param.test_name;
+    });
+
+TEST(RobustHomographyTest, SprtVerifiesFewerPoints) {
+  const Correspondences c = MakeCorrespondences(1000, 0.8);
+  RobustHomography::Options options;
+  options.prosac = false;
+  options.sprt = false;
+  const absl::StatusOr<HomographyEstimate> plain =
+      RobustHomography(options).Estimate(c.points1, c.points2, {});
+  options.sprt = true;
+  const absl::StatusOr<HomographyEstimate> sprt =
+      RobustHomography(options).Estimate(c.points1, c.points2, {});
+  ASSERT_TRUE(plain.ok() && sprt.ok());
+  EXPECT_THAT(sprt->stats.rejected_early, Gt(0));
+  EXPECT_THAT(sprt->stats.points_verified, Lt(plain->stats.points_verified));
+}
+
+TEST(RobustHomographyTest, RejectsBadInput) {
+  const std::vector<cv::Point2f> three(3);
+  const std::vector<cv::Point2f> four(4);
+  EXPECT_THAT(RobustHomography().Estimate(three, three, {}).status().code(),
+              Eq(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(RobustHomography().Estimate(four, three, {}).status().code(),
+              Eq(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(RobustHomography().Estimate(four, four, {1.f}).status().code(),
+              Eq(absl::StatusCode::kInvalidArgument));
+  // All points equal, every sample is degenerate.
+  EXPECT_THAT(RobustHomography().Estimate(four, four, {}).status().code(),
+              Eq(absl::StatusCode::kNotFound));
+}
+
+}  // namespace
+}  // namespace hello::keypoints
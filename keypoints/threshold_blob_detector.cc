@@ -0,0 +1,183 @@
+#include "keypoints/threshold_blob_detector.h"
+#include <algorithm>
+#include <cmath>
+#include "opencv2/imgproc.hpp"
+#include "util/trace.h"
+
+namespace hello::keypoints {
+
+ThresholdBlobDetector::ThresholdBlobDetector(
+    const Options& options, const cv::Ptr<cv::Feature2D>& descriptor)
+    : options_(options), descriptor_(descriptor) {}
+
+cv::Ptr<ThresholdBlobDetector> ThresholdBlobDetector::create(
+    const Options& options, const cv::Ptr<cv::Feature2D>& descriptor) {
+  return cv::Ptr<ThresholdBlobDetector>(
+      new ThresholdBlobDetector(options, descriptor));
+}
+
+int ThresholdBlobDetector::descriptorSize() const {
+  return descriptor_ ? descriptor_->descriptorSize() : 0;
+}
+
+int ThresholdBlobDetector::descriptorType() const {
+  return descriptor_ ? descriptor_->descriptorType() : CV_32F;
+}
+
+int ThresholdBlobDetector::defaultNorm() const {
+  return descriptor_ ? descriptor_->defaultNorm() : cv::NORM_L2;
+}
+
+std::vector<ThresholdBlobDetector::Blob> ThresholdBlobDetector::FindBlobs(
+    const cv::Mat& level_map, int32_t level) const {
+  // Pixels below the threshold of the level for dark blobs, at or above it
+  // for bright ones.
+  cv::Mat binary;
+  cv::compare(level_map, level, binary,
+              options_.blob_color == 0 ? cv::CMP_LE : cv::CMP_GT);
+  cv::Mat labels;
+  cv::Mat stats;
+  cv::Mat centroids;
+  const int n = cv::connectedComponentsWithStats(binary, labels, stats,
+                                                 centroids, 8, CV_32S);
+  std::vector<char> keep(n, 0);
+  for (int l = 1; l < n; ++l) {
+    const int area = stats.at<int>(l, cv::CC_STAT_AREA);
+    const int box = stats.at<int>(l, cv::CC_STAT_WIDTH) *
+                    stats.at<int>(l, cv::CC_STAT_HEIGHT);
+    keep[l] = area >= options_.min_area && area <= options_.max_area &&
+              area >= options_.min_extent * box;
+  }
+
+  // Central second moments of the kept regions.
+  std::vector<cv::Vec3d> moments(n);
+  for (int y = 0; y < labels.rows; ++y) {
+    const int* row = labels.ptr<int>(y);
+    for (int x = 0; x < labels.cols; ++x) {
+      const int l = row[x];
+      if (!keep[l]) continue;
+      const double dx = x - centroids.at<double>(l, 0);
+      const double dy = y - centroids.at<double>(l, 1);
+      moments[l] += cv::Vec3d(dx * dx, dy * dy, dx * dy);
+    }
+  }
+
+  std::vector<Blob> blobs;
+  for (int l = 1; l < n; ++l) {
+    if (!keep[l]) continue;
+    const double mu20 = moments[l][0];
+    const double mu02 = moments[l][1];
+    const double mu11 = moments[l][2];
+    const double denominator =
+        std::sqrt(4 * mu11 * mu11 + (mu20 - mu02) * (mu20 - mu02));
+    double ratio = 1;
+    if (denominator > 1e-2) {
+      const double imax = 0.5 * (mu20 + mu02) + 0.5 * denominator;
+      const double imin = 0.5 * (mu20 + mu02) - 0.5 * denominator;
+      ratio = imax > 0 ? imin / imax : 0;
+    }
+    if (ratio < options_.min_inertia_ratio) continue;
+    blobs.push_back({cv::Point2d(centroids.at<double>(l, 0),
+                                 centroids.at<double>(l, 1)),
+                     std::sqrt(stats.at<int>(l, cv::CC_STAT_AREA) / CV_PI)});
+  }
+  return blobs;
+}
+
+void ThresholdBlobDetector::Detect(const cv::Mat& image,
+                                   std::vector<cv::KeyPoint>& keypoints) const {
+  keypoints.clear();
+  std::vector<float> thresholds;
+  for (float t = options_.min_threshold;
+       t < options_.max_threshold && thresholds.size() < 255;
+       t += options_.threshold_step) {
+    thresholds.push_back(t);
+  }
+  if (thresholds.empty()) return;
+
+  // The level of every pixel is the number of thresholds at or below it,
+  // below the threshold of level i are exactly the pixels with level <= i.
+  cv::Mat lut(1, 256, CV_8U);
+  for (int v = 0; v < 256; ++v) {
+    lut.at<uint8_t>(v) = static_cast<uint8_t>(
+        std::upper_bound(thresholds.begin(), thresholds.end(),
+                         static_cast<float>(v)) -
+        thresholds.begin());
+  }
+  cv::Mat level_map;
+  cv::LUT(image, lut, level_map);
+
+  const int32_t num_levels = static_cast<int32_t>(thresholds.size());
+  std::vector<std::vector<Blob>> levels(num_levels);
+  cv::parallel_for_(cv::Range(0, num_levels), [&](const cv::Range& range) {
+    for (int32_t i = range.start; i < range.end; ++i) {
+      levels[i] = FindBlobs(level_map, i);
+    }
+  });
+
+  // Blobs of successive levels at the same place form a group, sorted by
+  // radius, as in SimpleBlobDetector.
+  std::vector<std::vector<Blob>> groups;
+  for (const std::vector<Blob>& level : levels) {
+    std::vector<std::vector<Blob>> new_groups;
+    for (const Blob& blob : level) {
+      bool is_new = true;
+      for (std::vector<Blob>& group : groups) {
+        const Blob& median = group[group.size() / 2];
+        const double dist = cv::norm(median.center - blob.center);
+        is_new = dist >= options_.min_dist_between_blobs &&
+                 dist >= median.radius && dist >= blob.radius;
+        if (!is_new) {
+          group.insert(std::upper_bound(group.begin(), group.end(), blob,
+                                        [](const Blob& a, const Blob& b) {
+                                          return a.radius < b.radius;
+                                        }),
+                       blob);
+          break;
+        }
+      }
+      if (is_new) new_groups.push_back({blob});
+    }
+    groups.insert(groups.end(), new_groups.begin(), new_groups.end());
+  }
+
+  for (const std::vector<Blob>& group : groups) {
+    if (static_cast<int32_t>(group.size()) < options_.min_repeatability) {
+      continue;
+    }
+    cv::Point2d sum(0, 0);
+    for (const Blob& blob : group) sum += blob.center;
+    const cv::Point2d center = sum * (1.0 / group.size());
+    keypoints.emplace_back(cv::Point2f(center),
+                           static_cast<float>(group[group.size() / 2].radius *
+                                              2));
+  }
+}
+
+void ThresholdBlobDetector::detectAndCompute(
+    cv::InputArray image_array, cv::InputArray mask,
+    std::vector<cv::KeyPoint>& keypoints, cv::OutputArray descriptors,
+    bool useProvidedKeypoints) {
+  TRACE_SCOPE("keypoints/threshold_blob_detector");
+  cv::Mat image = image_array.getMat();
+  if (image.channels() > 1) {
+    cv::cvtColor(image, image, cv::COLOR_BGR2GRAY);
+  }
+  if (image.depth() != CV_8U) {
+    image.convertTo(image, CV_8U);
+  }
+  if (!useProvidedKeypoints) {
+    Detect(image, keypoints);
+    if (!mask.empty()) {
+      cv::KeyPointsFilter::runByPixelsMask(keypoints, mask.getMat());
+    }
+  }
+  if (!descriptors.needed()) return;
+  if (!descriptor_) {
+    descriptors.release();
+    return;
+  }
+  descriptor_->compute(image, keypoints, descriptors);
+}
+
+}  // namespace hello::keypoints
@@ -0,0 +1,81 @@
+#ifndef KEYPOINTS_THRESHOLD_BLOB_DETECTOR_H_
+#define KEYPOINTS_THRESHOLD_BLOB_DETECTOR_H_
+
+#include <cstdint>
+#include <vector>
+#include "opencv2/features2d.hpp"
+
+namespace hello::keypoints {
+
+// Blob detector in the manner of cv::SimpleBlobDetector: the image is
+// thresholded at a series of levels, the connected regions of every level
+// are filtered by shape and regions found at the same place on enough
+// levels become keypoints. Unlike SimpleBlobDetector it
+//  - maps every pixel to its threshold level with one lookup table pass,
+//    after which each level is a single compare,
+//  - labels regions with connectedComponentsWithStats and one moment pass
+//    instead of tracing contours,
+//  - processes the levels in parallel,
+//  - describes the blobs, by default with SIFT at the blob scale, so the
+//    keypoints can be matched.
+class ThresholdBlobDetector : public cv::Feature2D {
+ public:
+  // Defaults follow cv::SimpleBlobDetector::Params.
+  struct Options {
+    float min_threshold = 50;
+    float max_threshold = 220;
+    float threshold_step = 10;
+    // 0 finds dark blobs, 255 bright ones.
+    uint8_t blob_color = 0;
+    // Levels a blob must be found on.
+    int32_t min_repeatability = 2;
+    float min_dist_between_blobs = 10;
+    float min_area = 25;
+    float max_area = 5000;
+    // Ratio of the smaller to the larger second moment, 1 for a circle.
+    float min_inertia_ratio = 0.1f;
+    // Area over bounding box area, takes the place of the convexity filter
+    // which would need the contour. pi / 4 for a circle.
+    float min_extent = 0.6f;
+  };
+
+  // `descriptor` computes the descriptors of the blobs, null for
+  // detection only.
+  static cv::Ptr<ThresholdBlobDetector> create(
+      const Options& options,
+      const cv::Ptr<cv::Feature2D>& descriptor = cv::SIFT::create());
+  static cv::Ptr<ThresholdBlobDetector> create() { return create(Options()); }
+
+  void detectAndCompute(cv::InputArray image, cv::InputArray mask,
+                        std::vector<cv::KeyPoint>& keypoints,
+                        cv::OutputArray descriptors,
+                        bool useProvidedKeypoints = false) override;
+
+  int descriptorSize() const override;
+  int descriptorType() const override;
+  int defaultNorm() const override;
+  cv::String getDefaultName() const override {
+    return "Feature2D.ThresholdBlobDetector";
+  }
+
+ private:
+  struct Blob {
+    cv::Point2d center;
+    double radius;
+  };
+
+  ThresholdBlobDetector(const Options& options,
+                        const cv::Ptr<cv::Feature2D>& descriptor);
+
+  // Blobs of the regions of one level that pass the filters.
+  std::vector<Blob> FindBlobs(const cv::Mat& level_map, int32_t level) const;
+  void Detect(const cv::Mat& image,
+              std::vector<cv::KeyPoint>& keypoints) const;
+
+  const Options options_;
+  const cv::Ptr<cv::Feature2D> descriptor_;
+};
+
+}  // namespace hello::keypoints
+
+#endif  // KEYPOINTS_THRESHOLD_BLOB_DETECTOR_H_
@@ -0,0 +1,92 @@
+#include "keypoints/threshold_blob_detector.h"
+#include <algorithm>
+#include <vector>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+#include "opencv2/imgproc.hpp"
+
+namespace hello::keypoints {
+namespace {
+
+using ::testing::Eq;
+using ::testing::FloatNear;
+using ::testing::Lt;
+using ::testing::SizeIs;
+
+struct Disc {
+  cv::Point center;
+  int radius;
+};
+
+const std::vector<Disc> kDiscs = {
+    {{60, 60}, 8}, {{160, 70}, 15}, {{280, 90}, 25}, {{90, 200}, 12},
+    {{220, 220}, 20}};
+
+// Dark discs, a dark elongated ellipse and a tiny dot on white.
+cv::Mat MakeScene() {
+  cv::Mat img(320, 400, CV_8UC1, cv::Scalar(255));
+  for (const Disc& disc : kDiscs) {
+    cv::circle(img, disc.center, disc.radius, cv::Scalar(0), -1,
+               cv::LINE_AA);
+  }
+  cv::ellipse(img, cv::Point(330, 250), cv::Size(40, 3), 30, 0, 360,
+              cv::Scalar(0), -1);
+  cv::circle(img, cv::Point(350, 40), 1, cv::Scalar(0), -1);
+  return img;
+}
+
+TEST(ThresholdBlobDetectorTest, FindsTheDiscs) {
+  const cv::Mat img = MakeScene();
+  std::vector<cv::KeyPoint> keypoints;
+  ThresholdBlobDetector::create()->detect(img, keypoints);
+  ASSERT_THAT(keypoints, SizeIs(kDiscs.size()));
+  for (const Disc& disc : kDiscs) {
+    const cv::KeyPoint* nearest = &keypoints[0];
+    for (const cv::KeyPoint& kp : keypoints) {
+      if (cv::norm(kp.pt - cv::Point2f(disc.center)) <
+          cv::norm(nearest->pt - cv::Point2f(disc.center))) {
+        nearest = &kp;
+      }
+    }
+    EXPECT_THAT(cv::norm(nearest->pt - cv::Point2f(disc.center)), Lt(1.0));
+    EXPECT_THAT(nearest->size, FloatNear(2 * disc.radius, 2));
+  }
+}
+
+TEST(ThresholdBlobDetectorTest, AgreesWithSimpleBlobDetector) {
+  const cv::Mat img = MakeScene();
+  std::vector<cv::KeyPoint> want;
+  cv::SimpleBlobDetector::create()->detect(img, want);
+  std::vector<cv::KeyPoint> got;
+  ThresholdBlobDetector::create()->detect(img, got);
+  ASSERT_THAT(got, SizeIs(want.size()));
+  for (const cv::KeyPoint& w : want) {
+    double best = 1e9;
+    for (const cv::KeyPoint& g : got) {
+      best = std::min(best, cv::norm(g.pt - w.pt));
+    }
+    EXPECT_THAT(best, Lt(1.5));
+  }
+}
+
+TEST(ThresholdBlobDetectorTest, DescribesBlobs) {
+  const cv::Mat img = MakeScene();
+  std::vector<cv::KeyPoint> keypoints;
+  cv::Mat descriptors;
+  const cv::Ptr<ThresholdBlobDetector> detector =
+      ThresholdBlobDetector::create();
+  detector->detectAndCompute(img, cv::noArray(), keypoints, descriptors);
+  EXPECT_THAT(descriptors.rows, Eq(static_cast<int>(keypoints.size())));
+  EXPECT_THAT(descriptors.cols, Eq(detector->descriptorSize()));
+
+  ThresholdBlobDetector::Options options;
+  options.blob_color = 255;
+  cv::Mat inverted = 255 - img;
+  ThresholdBlobDetector::create(options, nullptr)
+      ->detectAndCompute(inverted, cv::noArray(), keypoints, descriptors);
+  EXPECT_THAT(keypoints, SizeIs(kDiscs.size()));
+  EXPECT_TRUE(descriptors.empty());
+}
+
+}  // namespace
+}  // namespace hello::keypoints
@@ -0,0 +1,96 @@
+// Whole-image against tiled detection on an upscaled image, for every
+// DescriptorType: time, megapixels per second, keypoints and their spread.
+#include <string>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "keypoints/feature_extractor.h"
+#include "keypoints/tiled_detector.h"
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/imgproc.hpp"
+
+ABSL_FLAG(std::string, image_path, "testdata/graf1.png", "Image file path");
+ABSL_FLAG(int32_t, width, 3840, "The image is resized to this width");
+ABSL_FLAG(int32_t, cells, 8, "Cells per side");
+ABSL_FLAG(int32_t, max_per_cell, 200, "Keypoints kept per cell");
+
+namespace {
+
+using ::hello::keypoints::DescriptorType;
+
+struct NamedType {
+  const char* name;
+  DescriptorType type;
+};
+
+constexpr NamedType kTypes[] = {
+    {"fast", DescriptorType::kFast},   {"blob", DescriptorType::kBlob},
+    {"sift", DescriptorType::kSift},   {"orb", DescriptorType::kOrb},
+    {"brisk", DescriptorType::kBrisk}, {"kaze", DescriptorType::kKaze},
+    {"akaze", DescriptorType::kAkaze},
+};
+
+double Milliseconds(int64 start) {
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+void Report(const char* name, const char* mode, double ms, const cv::Mat& img,
+            const std::vector<cv::KeyPoint>& keypoints) {
+  const hello::keypoints::CoverageStats coverage =
+      hello::keypoints::MeasureCoverage(keypoints, img.size());
+  LOG(INFO) << absl::StreamFormat("%-6s %-6s %10.1f %8.2f %9d %9.2f %9.2f",
+                                  name, mode, ms, img.total() / ms / 1e3,
+                                  keypoints.size(), coverage.occupancy,
+                                  coverage.variation);
+}
+
+}  // namespace
+
+absl::Status Run() {
+  const std::string image_path = absl::GetFlag(FLAGS_image_path);
+  cv::Mat img = cv::imread(image_path, cv::IMREAD_GRAYSCALE);
+  if (img.empty()) {
+    return absl::InvalidArgumentError(absl::StrCat("No image - ", image_path));
+  }
+  const double scale = static_cast<double>(absl::GetFlag(FLAGS_width)) /
+                       img.cols;
+  cv::resize(img, img, cv::Size(), scale, scale, cv::INTER_CUBIC);
+  LOG(INFO) << absl::StreamFormat("%dx%d", img.cols, img.rows);
+
+  hello::keypoints::TiledDetector::Options options;
+  options.cells_x = absl::GetFlag(FLAGS_cells);
+  options.cells_y = absl::GetFlag(FLAGS_cells);
+  options.max_per_cell = absl::GetFlag(FLAGS_max_per_cell);
+  LOG(INFO) << absl::StreamFormat("%-6s %-6s %10s %8s %9s %9s %9s", "type",
+                                  "mode", "ms", "mpix_s", "keypoints",
+                                  "occupancy", "variation");
+  for (const NamedType& named : kTypes) {
+    std::vector<cv::KeyPoint> keypoints;
+    cv::Mat descriptors;
+    int64 start = cv::getTickCount();
+    hello::keypoints::FeatureExtractor(named.type)
+        .DetectAndCompute(img, keypoints, descriptors);
+    Report(named.name, "whole", Milliseconds(start), img, keypoints);
+    start = cv::getTickCount();
+    hello::keypoints::TiledDetector(named.type, options)
+        .DetectAndCompute(img, keypoints, descriptors);
+    Report(named.name, "tiled", Milliseconds(start), img, keypoints);
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,212 @@
+#include "keypoints/tiled_detector.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include "absl/container/flat_hash_map.h"
+#include "keypoints/fast_brief.h"
+#include "util/trace.h"
+
+namespace hello::keypoints {
+namespace {
+
+// Keypoints of one cell and the descriptor row of each.
+struct CellFeatures {
+  std::vector<cv::KeyPoint> keypoints;
+  cv::Mat descriptors;
+  std::vector<int32_t> rows;
+};
+
+int64_t GridKey(int32_t gx, int32_t gy) {
+  return (static_cast<int64_t>(gx) << 32) ^ static_cast<uint32_t>(gy);
+}
+
+}  // namespace
+
+int32_t MinTileOverlap(DescriptorType type) {
+  switch (type) {
+    case DescriptorType::kFast:
+      // The steered BRIEF patch and the FAST circle around its center.
+      return 2 * FastBrief::kPatchRadius + 1 + 6;
+    case DescriptorType::kOrb: {
+      const cv::Ptr<cv::ORB> orb =
+          CreateFeature2D(type).dynamicCast<cv::ORB>();
+      return static_cast<int32_t>(std::ceil(
+          orb->getPatchSize() *
+          std::pow(orb->getScaleFactor(), orb->getNLevels() - 1)));
+    }
+    case DescriptorType::kBrisk:
+      // Pattern radius 10.8 at scale 6, the last layer of 3 octaves.
+      return 130;
+    case DescriptorType::kBlob:
+    case DescriptorType::kSift:
+    case DescriptorType::kKaze:
+    case DescriptorType::kAkaze:
+      return 64;
+  }
+  return 64;
+}
+
+TiledDetector::TiledDetector(DescriptorType type, const Options& options)
+    : extractor_(type),
+      options_(options),
+      overlap_(std::max(options.overlap, MinTileOverlap(type))) {}
+
+cv::Rect TiledDetector::Cell(int32_t cx, int32_t cy,
+                             cv::Size image_size) const {
+  const int x0 = cx * image_size.width / options_.cells_x;
+  const int x1 = (cx + 1) * image_size.width / options_.cells_x;
+  const int y0 = cy * image_size.height / options_.cells_y;
+  const int y1 = (cy + 1) * image_size.height / options_.cells_y;
+  return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+void TiledDetector::DetectAndCompute(const cv::Mat& image,
+                                     std::vector<cv::KeyPoint>& keypoints,
+                                     cv::Mat& descriptors) const {
+  TRACE_SCOPE("keypoints/tiled_detect");
+  const int32_t num_cells = options_.cells_x * options_.cells_y;
+  const cv::Rect bounds(0, 0, image.cols, image.rows);
+  std::vector<CellFeatures> cells(num_cells);
+  cv::parallel_for_(cv::Range(0, num_cells), [&](const cv::Range& range) {
+    for (int32_t i = range.start; i < range.end; ++i) {
+      const cv::Rect core =
+          Cell(i % options_.cells_x, i / options_.cells_x, image.size());
+      const cv::Rect roi =
+          (core + cv::Size(2 * overlap_, 2 * overlap_) -
+           cv::Point(overlap_, overlap_)) &
+          bounds;
+      CellFeatures& cell = cells[i];
+      extractor_.DetectAndCompute(image(roi), cell.keypoints,
+                                  cell.descriptors);
+      // Keep what lies in the cell itself, the strongest first.
+      std::vector<int32_t> owned;
+      for (int32_t k = 0; k < static_cast<int32_t>(cell.keypoints.size());
+           ++k) {
+        cv::KeyPoint& kp = cell.keypoints[k];
+        kp.pt += cv::Point2f(roi.tl());
+        if (core.contains(cv::Point(cvFloor(kp.pt.x), cvFloor(kp.pt.y)))) {
+          owned.push_back(k);
+        }
+      }
+      std::stable_sort(owned.begin(), owned.end(), [&](int32_t a, int32_t b) {
+        return cell.keypoints[a].response > cell.keypoints[b].response;
+      });
+      if (options_.max_per_cell > 0 &&
+          static_cast<int32_t>(owned.size()) > options_.max_per_cell) {
+        owned.resize(options_.max_per_cell);
+      }
+      cell.rows = std::move(owned);
+    }
+  });
+
+  // Drop the weaker of near-duplicates that different cells found on both
+  // sides of their common border. Only keypoints that close to a border
+  // take part.
+  const float radius = options_.dedupe_radius;
+  struct Candidate {
+    int32_t cell;
+    int32_t index;
+  };
+  std::vector<Candidate> border;
+  std::vector<std::vector<bool>> dropped(num_cells);
+  for (int32_t i = 0; i < num_cells; ++i) {
+    dropped[i].assign(cells[i].rows.size(), false);
+    if (radius <= 0) continue;
+    const cv::Rect core =
+        Cell(i % options_.cells_x, i / options_.cells_x, image.size());
+    for (int32_t j = 0; j < static_cast<int32_t>(cells[i].rows.size()); ++j) {
+      const cv::Point2f& pt = cells[i].keypoints[cells[i].rows[j]].pt;
+      if (pt.x - core.x < radius || core.br().x - pt.x < radius ||
+          pt.y - core.y < radius || core.br().y - pt.y < radius) {
+        border.push_back({i, j});
+      }
+    }
+  }
+  auto keypoint_of = [&](const Candidate& c) -> const cv::KeyPoint& {
+    return cells[c.cell].keypoints[cells[c.cell].rows[c.index]];
+  };
+  std::stable_sort(border.begin(), border.end(),
+                   [&](const Candidate& a, const Candidate& b) {
+                     return keypoint_of(a).response > keypoint_of(b).response;
+                   });
+  absl::flat_hash_map<int64_t, std::vector<Candidate>> accepted;
+  for (const Candidate& candidate : border) {
+    const cv::KeyPoint& kp = keypoint_of(candidate);
+    const int32_t gx = static_cast<int32_t>(std::floor(kp.pt.x / radius));
+    const int32_t gy = static_cast<int32_t>(std::floor(kp.pt.y / radius));
+    bool duplicate = false;
+    for (int32_t dy = -1; dy <= 1 && !duplicate; ++dy) {
+      for (int32_t dx = -1; dx <= 1 && !duplicate; ++dx) {
+        auto it = accepted.find(GridKey(gx + dx, gy + dy));
+        if (it == accepted.end()) continue;
+        for (const Candidate& other : it->second) {
+          if (other.cell != candidate.cell &&
+              cv::norm(keypoint_of(other).pt - kp.pt) < radius) {
+            duplicate = true;
+            break;
+          }
+        }
+      }
+    }
+    if (duplicate) {
+      dropped[candidate.cell][candidate.index] = true;
+    } else {
+      accepted[GridKey(gx, gy)].push_back(candidate);
+    }
+  }
+
+  keypoints.clear();
+  descriptors.release();
+  int32_t total = 0;
+  int desc_cols = 0;
+  int desc_type = -1;
+  for (int32_t i = 0; i < num_cells; ++i) {
+    total += static_cast<int32_t>(
+        std::count(dropped[i].begin(), dropped[i].end(), false));
+    if (!cells[i].descriptors.empty()) {
+      desc_cols = cells[i].descriptors.cols;
+      desc_type = cells[i].descriptors.type();
+    }
+  }
+  keypoints.reserve(total);
+  if (desc_type >= 0) descriptors.create(total, desc_cols, desc_type);
+  for (int32_t i = 0; i < num_cells; ++i) {
+    const CellFeatures& cell = cells[i];
+    for (int32_t j = 0; j < static_cast<int32_t>(cell.rows.size()); ++j) {
+      if (dropped[i][j]) continue;
+      if (desc_type >= 0) {
+        cell.descriptors.row(cell.rows[j])
+            .copyTo(descriptors.row(static_cast<int>(keypoints.size())));
+      }
+      keypoints.push_back(cell.keypoints[cell.rows[j]]);
+    }
+  }
+}
+
+CoverageStats MeasureCoverage(const std::vector<cv::KeyPoint>& keypoints,
+                              cv::Size image_size, int32_t grid) {
+  CoverageStats stats;
+  if (grid <= 0 || image_size.area() == 0) return stats;
+  std::vector<int32_t> counts(grid * grid, 0);
+  for (const cv::KeyPoint& kp : keypoints) {
+    const int32_t gx = std::clamp(
+        static_cast<int32_t>(kp.pt.x * grid / image_size.width), 0, grid - 1);
+    const int32_t gy = std::clamp(
+        static_cast<int32_t>(kp.pt.y * grid / image_size.height), 0, grid - 1);
+    ++counts[gy * grid + gx];
+  }
+  const double n = counts.size();
+  const double mean =
+      std::accumulate(counts.begin(), counts.end(), 0.0) / n;
+  double variance = 0;
+  int32_t occupied = 0;
+  for (int32_t count : counts) {
+    variance += (count - mean) * (count - mean) / n;
+    occupied += count > 0;
+  }
+  stats.occupancy = occupied / n;
+  stats.variation = mean > 0 ? std::sqrt(variance) / mean : 0;
+  return stats;
+}
+
+}  // namespace hello::keypoints
@@ -0,0 +1,69 @@
+#ifndef KEYPOINTS_TILED_DETECTOR_H_
+#define KEYPOINTS_TILED_DETECTOR_H_
+
+#include <cstdint>
+#include <vector>
+#include "keypoints/feature_extractor.h"
+#include "keypoints/types.h"
+#include "opencv2/core.hpp"
+
+namespace hello::keypoints {
+
+// Detects features on a grid of overlapping cells in parallel, for large
+// images and for an even spread of keypoints. Every cell keeps only the
+// keypoints inside its own area, at most a quota of the strongest, and
+// near-duplicates across cell borders are reduced to the strongest one.
+class TiledDetector {
+ public:
+  struct Options {
+    int32_t cells_x = 4;
+    int32_t cells_y = 4;
+    // Pixels a cell reaches into its neighbours so that features near its
+    // border see their full support. Smaller values, the default included,
+    // are raised to MinTileOverlap() of the type.
+    int32_t overlap = 0;
+    // Strongest keypoints kept per cell by response, <= 0 keeps all.
+    int32_t max_per_cell = 500;
+    // Keypoints from different cells closer than this are duplicates.
+    float dedupe_radius = 2.0f;
+  };
+
+  TiledDetector(DescriptorType type, const Options& options);
+  explicit TiledDetector(DescriptorType type)
+      : TiledDetector(type, Options()) {}
+
+  void DetectAndCompute(const cv::Mat& image,
+                        std::vector<cv::KeyPoint>& keypoints,
+                        cv::Mat& descriptors) const;
+
+ private:
+  cv::Rect Cell(int32_t cx, int32_t cy, cv::Size image_size) const;
+
+  const FeatureExtractor extractor_;
+  const Options options_;
+  const int32_t overlap_;
+};
+
+// Pixels a tile must reach past a keypoint on its border for the largest
+// keypoints of `type` to be detected and described as in the whole image:
+// the patch diameter at the coarsest pyramid level for FAST, ORB and BRISK.
+// The coarsest octaves of the scale-space detectors (SIFT, KAZE, AKAZE and
+// the SIFT-described blobs) grow with the image, for them this covers the
+// first octaves and larger features near cell borders may still differ.
+int32_t MinTileOverlap(DescriptorType type);
+
+struct CoverageStats {
+  // Fraction of the grid cells with at least one keypoint.
+  double occupancy = 0;
+  // Standard deviation over mean of the keypoints per grid cell, 0 for a
+  // perfectly even spread.
+  double variation = 0;
+};
+
+// Spatial spread of keypoints over a grid x grid partition of the image.
+CoverageStats MeasureCoverage(const std::vector<cv::KeyPoint>& keypoints,
+                              cv::Size image_size, int32_t grid = 8);
+
+}  // namespace hello::keypoints
+
+#endif  // KEYPOINTS_TILED_DETECTOR_H_
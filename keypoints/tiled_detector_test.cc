@@ -0,0 +1,108 @@
+#include "keypoints/tiled_detector.h"
+#include <cmath>
+#include <string>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+#include "opencv2/imgproc.hpp"
+
+namespace hello::keypoints {
+namespace {
+
+using ::testing::DoubleNear;
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Gt;
+using ::testing::Le;
+using ::testing::SizeIs;
+using ::testing::TestWithParam;
+using ::testing::ValuesIn;
+
+// Dense texture in the top left quarter, a few shapes elsewhere.
+cv::Mat MakeClumpedScene() {
+  cv::Mat img(480, 640, CV_8UC1, cv::Scalar(40));
+  cv::RNG rng(3);
+  cv::Mat noise(240, 320, CV_8UC1);
+  rng.fill(noise, cv::RNG::UNIFORM, 0, 256);
+  cv::GaussianBlur(noise, noise, cv::Size(0, 0), 1.5);
+  noise.copyTo(img(cv::Rect(0, 0, 320, 240)));
+  for (int i = 0; i < 30; ++i) {
+    cv::circle(img, cv::Point(rng.uniform(340, 620), rng.uniform(20, 460)),
+               rng.uniform(4, 12), cv::Scalar(rng.uniform(120, 255)), -1);
+  }
+  return img;
+}
+
+struct TestCase {
+  std::string test_name;
+  DescriptorType type;
+};
+
+using TiledDetectorTest = TestWithParam<TestCase>;
+
+TEST_P(TiledDetectorTest, RespectsQuotasAndBorders) {
+  const cv::Mat img = MakeClumpedScene();
+  TiledDetector::Options options;
+  options.cells_x = 4;
+  options.cells_y = 3;
+  options.max_per_cell = 40;
+  std::vector<cv::KeyPoint> keypoints;
+  cv::Mat descriptors;
+  TiledDetector(GetParam().type, options)
+      .DetectAndCompute(img, keypoints, descriptors);
+
+  ASSERT_THAT(keypoints, SizeIs(Gt(0)));
+  EXPECT_THAT(descriptors.rows, Eq(static_cast<int>(keypoints.size())));
+  std::vector<int> per_cell(12, 0);
+  for (const cv::KeyPoint& kp : keypoints) {
+    ASSERT_TRUE(cv::Rect(0, 0, img.cols, img.rows).contains(kp.pt));
+    ++per_cell[static_cast<int>(kp.pt.y) / 160 * 4 +
+               static_cast<int>(kp.pt.x) / 160];
+  }
+  for (int count : per_cell) EXPECT_THAT(count, Le(40));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    TiledDetectorTests, TiledDetectorTest,
+    ValuesIn<TestCase>({{"Fast", DescriptorType::kFast},
+                        {"Sift", DescriptorType::kSift},
+                        {"Orb", DescriptorType::kOrb},
+                        {"Akaze", DescriptorType::kAkaze}}),
+    [](const testing::TestParamInfo<TiledDetectorTest::ParamType>& info) {
+      return info.param.test_name;
+    });
+
+TEST(TiledDetectorTest, SpreadsKeypointsMoreEvenly) {
+  const cv::Mat img = MakeClumpedScene();
+  std::vector<cv::KeyPoint> whole;
+  cv::Mat descriptors;
+  FeatureExtractor(DescriptorType::kOrb)
+      .DetectAndCompute(img, whole, descriptors);
+  TiledDetector::Options options;
+  options.max_per_cell = 30;
+  std::vector<cv::KeyPoint> tiled;
+  TiledDetector(DescriptorType::kOrb, options)
+      .DetectAndCompute(img, tiled, descriptors);
+  EXPECT_THAT(MeasureCoverage(tiled, img.size()).variation,
+              Le(MeasureCoverage(whole, img.size()).variation));
+}
+
+TEST(MinTileOverlapTest, CoversTheLargestOrbPatch) {
+  // 31 pixel patches at 1.2^7 of the image size.
+  EXPECT_THAT(MinTileOverlap(DescriptorType::kOrb), Ge(111));
+  EXPECT_THAT(MinTileOverlap(DescriptorType::kFast), Gt(31));
+}
+
+TEST(MeasureCoverageTest, CountsOccupiedCells) {
+  const std::vector<cv::KeyPoint> keypoints = {
+      cv::KeyPoint(10, 10, 1), cv::KeyPoint(90, 90, 1),
+      cv::KeyPoint(95, 95, 1)};
+  const CoverageStats stats =
+      MeasureCoverage(keypoints, cv::Size(100, 100), 2);
+  EXPECT_THAT(stats.occupancy, DoubleNear(0.5, 1e-9));
+  // Counts 1, 0, 0, 2: mean 0.75, deviation sqrt(0.6875).
+  EXPECT_THAT(stats.variation, DoubleNear(std::sqrt(0.6875) / 0.75, 1e-9));
+  EXPECT_THAT(MeasureCoverage({}, cv::Size(100, 100)).occupancy, Ge(0.0));
+}
+
+}  // namespace
+}  // namespace hello::keypoints
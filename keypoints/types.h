@@ -0,0 +1,19 @@
+#ifndef KEYPOINTS_TYPES_H_
+#define KEYPOINTS_TYPES_H_
+
+namespace hello::keypoints {
+
+enum class DescriptorType {
+  kFast,
+  kBlob,
+  kSift,
+  kOrb,
+  kBrisk,
+  kKaze,
+  kAkaze,
+};
+
+enum class MatchAlgorithm { kBf, kKnn };
+
+}  // namespace hello::keypoints
+#endif  // KEYPOINTS_TYPES_H_
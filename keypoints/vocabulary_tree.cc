@@ -0,0 +1,238 @@
+#include "keypoints/vocabulary_tree.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "opencv2/core/hal/hal.hpp"
+#include "status_macros.h"
+#include "util/trace.h"
+
+namespace hello::keypoints {
+namespace {
+
+// Images of a query are scored in up to this many parallel stripes.
+constexpr int32_t kMaxStripes = 16;
+
+absl::StatusOr<cv::Mat> ToFloat(const cv::Mat& descriptors) {
+  if (descriptors.type() == CV_32F) return descriptors;
+  if (descriptors.type() != CV_8U) {
+    return absl::InvalidArgumentError("Descriptors must be CV_32F or CV_8U");
+  }
+  cv::Mat bits(descriptors.rows, descriptors.cols * 8, CV_32F);
+  for (int r = 0; r < descriptors.rows; ++r) {
+    const uint8_t* in = descriptors.ptr<uint8_t>(r);
+    float* out = bits.ptr<float>(r);
+    for (int b = 0; b < descriptors.cols; ++b) {
+      for (int i = 0; i < 8; ++i) out[b * 8 + i] = (in[b] >> (7 - i)) & 1;
+    }
+  }
+  return bits;
+}
+
+}  // namespace
+
+VocabularyTree::VocabularyTree(const Options& options) : options_(options) {}
+
+absl::StatusOr<std::unique_ptr<VocabularyTree>> VocabularyTree::Train(
+    const cv::Mat& descriptors, const Options& options) {
+  TRACE_SCOPE("keypoints/vocabulary_train");
+  if (descriptors.empty()) {
+    return absl::InvalidArgumentError("No training descriptors");
+  }
+  if (options.branching < 2 || options.depth < 1) {
+    return absl::InvalidArgumentError("Branching must be >= 2, depth >= 1");
+  }
+  ASSIGN_OR_RETURN(cv::Mat data, ToFloat(descriptors));
+  if (data.rows > options.max_training_descriptors) {
+    std::vector<int> order(data.rows);
+    std::iota(order.begin(), order.end(), 0);
+    cv::randShuffle(order);
+    cv::Mat sample(options.max_training_descriptors, data.cols, CV_32F);
+    for (int i = 0; i < sample.rows; ++i) {
+      data.row(order[i]).copyTo(sample.row(i));
+    }
+    data = sample;
+  }
+  auto tree = absl::WrapUnique(new VocabularyTree(options));
+  tree->nodes_.emplace_back();
+  tree->centers_ = cv::Mat::zeros(1, data.cols, CV_32F);
+  tree->Split(data, 0, 0);
+  return tree;
+}
+
+void VocabularyTree::Split(const cv::Mat& data, int32_t node, int32_t level) {
+  if (level == options_.depth || data.rows <= options_.branching) {
+    nodes_[node].word = num_words_++;
+    return;
+  }
+  cv::Mat labels;
+  cv::Mat centers;
+  cv::kmeans(data, options_.branching, labels,
+             cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS,
+                              options_.kmeans_iterations, 1e-4),
+             1, cv::KMEANS_PP_CENTERS, centers);
+  const int32_t first = static_cast<int32_t>(nodes_.size());
+  nodes_[node].first_child = first;
+  nodes_[node].num_children = options_.branching;
+  for (int32_t c = 0; c < options_.branching; ++c) {
+    nodes_.emplace_back();
+    centers_.push_back(centers.row(c));
+  }
+
+  std::vector<int32_t> counts(options_.branching, 0);
+  for (int i = 0; i < data.rows; ++i) ++counts[labels.at<int>(i)];
+  std::vector<cv::Mat> subsets(options_.branching);
+  for (int32_t c = 0; c < options_.branching; ++c) {
+    subsets[c].create(counts[c], data.cols, CV_32F);
+    counts[c] = 0;
+  }
+  for (int i = 0; i < data.rows; ++i) {
+    const int c = labels.at<int>(i);
+    data.row(i).copyTo(subsets[c].row(counts[c]++));
+  }
+  for (int32_t c = 0; c < options_.branching; ++c) {
+    if (subsets[c].empty()) {
+      nodes_[first + c].word = num_words_++;
+    } else {
+      Split(subsets[c], first + c, level + 1);
+    }
+  }
+}
+
+int32_t VocabularyTree::QuantizeRow(const float* descriptor) const {
+  int32_t node = 0;
+  while (nodes_[node].word < 0) {
+    const Node& parent = nodes_[node];
+    float best = std::numeric_limits<float>::max();
+    for (int32_t c = 0; c < parent.num_children; ++c) {
+      const int32_t child = parent.first_child + c;
+      const float d = cv::hal::normL2Sqr_(
+          descriptor, centers_.ptr<float>(child), centers_.cols);
+      if (d < best) {
+        best = d;
+        node = child;
+      }
+    }
+  }
+  return nodes_[node].word;
+}
+
+absl::StatusOr<std::vector<int32_t>> VocabularyTree::Quantize(
+    const cv::Mat& descriptors) const {
+  TRACE_SCOPE("keypoints/vocabulary_quantize");
+  ASSIGN_OR_RETURN(const cv::Mat data, ToFloat(descriptors));
+  if (!data.empty() && data.cols != centers_.cols) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Descriptor width ", data.cols, ", the tree has ", centers_.cols));
+  }
+  std::vector<int32_t> words(data.rows);
+  cv::parallel_for_(cv::Range(0, data.rows), [&](const cv::Range& range) {
+    for (int i = range.start; i < range.end; ++i) {
+      words[i] = QuantizeRow(data.ptr<float>(i));
+    }
+  });
+  return words;
+}
+
+ImageDatabase::ImageDatabase(const VocabularyTree& tree)
+    : tree_(tree), postings_(tree.num_words()) {}
+
+absl::StatusOr<int32_t> ImageDatabase::Add(const cv::Mat& descriptors) {
+  ASSIGN_OR_RETURN(std::vector<int32_t> words, tree_.Quantize(descriptors));
+  std::sort(words.begin(), words.end());
+  const int32_t image_id = num_images_++;
+  for (size_t i = 0; i < words.size();) {
+    size_t j = i;
+    while (j < words.size() && words[j] == words[i]) ++j;
+    postings_[words[i]].push_back({image_id, static_cast<float>(j - i)});
+    i = j;
+  }
+  finalized_ = false;
+  return image_id;
+}
+
+void ImageDatabase::Finalize() {
+  idf_.assign(postings_.size(), 0);
+  image_norms_.assign(num_images_, 0);
+  for (size_t w = 0; w < postings_.size(); ++w) {
+    if (postings_[w].empty()) continue;
+    idf_[w] = std::log(static_cast<float>(num_images_) / postings_[w].size());
+    for (const Posting& posting : postings_[w]) {
+      const float weight = posting.count * idf_[w];
+      image_norms_[posting.image_id] += weight * weight;
+    }
+  }
+  for (float& norm : image_norms_) norm = std::sqrt(norm);
+  finalized_ = true;
+}
+
+absl::StatusOr<std::vector<RetrievalCandidate>> ImageDatabase::Query(
+    const cv::Mat& descriptors, int32_t max_candidates) const {
+  TRACE_SCOPE("keypoints/vocabulary_query");
+  if (!finalized_) {
+    return absl::FailedPreconditionError(
+        "Finalize() the database after adding images");
+  }
+  ASSIGN_OR_RETURN(std::vector<int32_t> words, tree_.Quantize(descriptors));
+  std::sort(words.begin(), words.end());
+  // Normalized TF-IDF vector of the query.
+  std::vector<std::pair<int32_t, float>> query;
+  float query_norm = 0;
+  for (size_t i = 0; i < words.size();) {
+    size_t j = i;
+    while (j < words.size() && words[j] == words[i]) ++j;
+    const float weight = (j - i) * idf_[words[i]];
+    if (weight > 0) {
+      query.emplace_back(words[i], weight);
+      query_norm += weight * weight;
+    }
+    i = j;
+  }
+  if (query.empty()) return std::vector<RetrievalCandidate>();
+  query_norm = std::sqrt(query_norm);
+
+  // Every stripe owns a range of image ids, so no two threads touch the
+  // same score.
+  std::vector<float> scores(num_images_, 0);
+  const int32_t num_stripes = std::min(num_images_, kMaxStripes);
+  cv::parallel_for_(cv::Range(0, num_stripes), [&](const cv::Range& range) {
+    for (int32_t stripe = range.start; stripe < range.end; ++stripe) {
+      const int32_t begin = num_images_ * stripe / num_stripes;
+      const int32_t end = num_images_ * (stripe + 1) / num_stripes;
+      for (const auto& [word, weight] : query) {
+        const std::vector<Posting>& postings = postings_[word];
+        auto it = std::lower_bound(
+            postings.begin(), postings.end(), begin,
+            [](const Posting& p, int32_t id) { return p.image_id < id; });
+        for (; it != postings.end() && it->image_id < end; ++it) {
+          scores[it->image_id] += weight * it->count * idf_[word];
+        }
+      }
+      for (int32_t id = begin; id < end; ++id) {
+        if (image_norms_[id] > 0) {
+          scores[id] /= query_norm * image_norms_[id];
+        }
+      }
+    }
+  });
+
+  std::vector<RetrievalCandidate> candidates;
+  for (int32_t id = 0; id < num_images_; ++id) {
+    if (scores[id] > 0) candidates.push_back({id, scores[id]});
+  }
+  const size_t n = std::min<size_t>(std::max(max_candidates, 0),
+                                    candidates.size());
+  std::partial_sort(candidates.begin(), candidates.begin() + n,
+                    candidates.end(),
+                    [](const RetrievalCandidate& a,
+                       const RetrievalCandidate& b) {
+                      return a.score > b.score;
+                    });
+  candidates.resize(n);
+  return candidates;
+}
+
+}  // namespace hello::keypoints
@@ -0,0 +1,97 @@
+#ifndef KEYPOINTS_VOCABULARY_TREE_H_
+#define KEYPOINTS_VOCABULARY_TREE_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "opencv2/core.hpp"
+
+namespace hello::keypoints {
+
+// Hierarchical k-means over descriptors (Nister & Stewenius), the leaves
+// are the visual words. Binary descriptors are unpacked to one float per
+// bit, so that squared L2 distances equal Hamming distances.
+class VocabularyTree {
+ public:
+  struct Options {
+    int32_t branching = 10;
+    // Up to branching^depth words.
+    int32_t depth = 4;
+    int32_t kmeans_iterations = 10;
+    // Training descriptors are subsampled to this many.
+    int32_t max_training_descriptors = 200000;
+  };
+
+  static absl::StatusOr<std::unique_ptr<VocabularyTree>> Train(
+      const cv::Mat& descriptors, const Options& options);
+
+  // Word of every descriptor row, rows are quantized in parallel.
+  absl::StatusOr<std::vector<int32_t>> Quantize(
+      const cv::Mat& descriptors) const;
+
+  int32_t num_words() const { return num_words_; }
+
+ private:
+  struct Node {
+    int32_t first_child = -1;
+    int32_t num_children = 0;
+    int32_t word = -1;
+  };
+
+  explicit VocabularyTree(const Options& options);
+  void Split(const cv::Mat& data, int32_t node, int32_t level);
+  int32_t QuantizeRow(const float* descriptor) const;
+
+  const Options options_;
+  std::vector<Node> nodes_;
+  // Center of every node, the row of the root is unused.
+  cv::Mat centers_;
+  int32_t num_words_ = 0;
+};
+
+struct RetrievalCandidate {
+  int32_t image_id;
+  // Cosine similarity of the TF-IDF vectors.
+  float score;
+};
+
+// Inverted file over the words of a VocabularyTree that ranks images by
+// TF-IDF similarity. Images are added one by one, Finalize() then computes
+// the weights and Query() can run concurrently from several threads.
+class ImageDatabase {
+ public:
+  // The tree must outlive the database.
+  explicit ImageDatabase(const VocabularyTree& tree);
+
+  // Returns the id of the image, ids are consecutive from 0.
+  absl::StatusOr<int32_t> Add(const cv::Mat& descriptors);
+
+  void Finalize();
+
+  // The best scoring images, most similar first. Images are scored in
+  // parallel stripes.
+  absl::StatusOr<std::vector<RetrievalCandidate>> Query(
+      const cv::Mat& descriptors, int32_t max_candidates) const;
+
+  int32_t size() const { return num_images_; }
+
+ private:
+  struct Posting {
+    int32_t image_id;
+    float count;
+  };
+
+  const VocabularyTree& tree_;
+  // Postings of every word, ordered by image id.
+  std::vector<std::vector<Posting>> postings_;
+  std::vector<float> idf_;
+  std::vector<float> image_norms_;
+  int32_t num_images_ = 0;
+  bool finalized_ = false;
+};
+
+}  // namespace hello::keypoints
+
+#endif  // KEYPOINTS_VOCABULARY_TREE_H_
@@ -0,0 +1,74 @@
+#include "keypoints/vocabulary_tree.h"
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+#include "opencv2/core.hpp"
+
+namespace hello::keypoints {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Gt;
+using ::testing::Le;
+using ::testing::SizeIs;
+
+// Every image draws its descriptors around its own set of centers.
+cv::Mat ImageDescriptors(const cv::Mat& centers, int image, int rows,
+                         cv::RNG& rng) {
+  cv::Mat descriptors(rows, centers.cols, CV_32F);
+  rng.fill(descriptors, cv::RNG::NORMAL, 0, 2);
+  for (int i = 0; i < rows; ++i) {
+    descriptors.row(i) += centers.row(image * 10 + rng.uniform(0, 10));
+  }
+  return descriptors;
+}
+
+TEST(VocabularyTreeTest, RetrievesTheMatchingImage) {
+  cv::RNG rng(1);
+  cv::Mat centers(80, 32, CV_32F);
+  rng.fill(centers, cv::RNG::UNIFORM, 0, 100);
+  std::vector<cv::Mat> images;
+  cv::Mat all;
+  for (int image = 0; image < 8; ++image) {
+    images.push_back(ImageDescriptors(centers, image, 300, rng));
+    all.push_back(images.back());
+  }
+  VocabularyTree::Options options;
+  options.branching = 4;
+  options.depth = 4;
+  auto tree = VocabularyTree::Train(all, options);
+  ASSERT_TRUE(tree.ok()) << tree.status();
+  EXPECT_THAT((*tree)->num_words(), Le(256));
+
+  ImageDatabase database(**tree);
+  for (const cv::Mat& image : images) ASSERT_TRUE(database.Add(image).ok());
+  EXPECT_FALSE(database.Query(images[0], 3).ok());
+  database.Finalize();
+
+  for (int image = 0; image < 8; ++image) {
+    auto candidates =
+        database.Query(ImageDescriptors(centers, image, 100, rng), 3);
+    ASSERT_TRUE(candidates.ok()) << candidates.status();
+    ASSERT_THAT(*candidates, SizeIs(Gt(0)));
+    EXPECT_THAT((*candidates)[0].image_id, Eq(image));
+  }
+}
+
+TEST(VocabularyTreeTest, QuantizesBinaryDescriptors) {
+  cv::Mat descriptors(500, 32, CV_8U);
+  cv::randu(descriptors, 0, 256);
+  VocabularyTree::Options options;
+  options.branching = 5;
+  options.depth = 2;
+  auto tree = VocabularyTree::Train(descriptors, options);
+  ASSERT_TRUE(tree.ok()) << tree.status();
+  auto words = (*tree)->Quantize(descriptors);
+  ASSERT_TRUE(words.ok());
+  ASSERT_THAT(*words, SizeIs(500));
+  for (int32_t word : *words) {
+    EXPECT_THAT(word, Le((*tree)->num_words() - 1));
+  }
+  EXPECT_FALSE((*tree)->Quantize(cv::Mat(3, 16, CV_8U)).ok());
+}
+
+}  // namespace
+}  // namespace hello::keypoints
@@ -0,0 +1,124 @@
+#include "misc/async_video_writer.h"
+#include <algorithm>
+#include <utility>
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_format.h"
+#include "opencv2/imgcodecs.hpp"
+
+namespace hello::misc {
+namespace {
+
+// Whether `pattern` has exactly one integer conversion, with optional flags
+// and width, and no other conversion than "%%".
+bool IsFramePattern(absl::string_view pattern) {
+  int32_t conversions = 0;
+  for (size_t i = 0; i < pattern.size(); ++i) {
+    if (pattern[i] != '%') continue;
+    if (++i < pattern.size() && pattern[i] == '%') continue;
+    while (i < pattern.size() && absl::StrContains("-+ #0", pattern[i])) ++i;
+    while (i < pattern.size() && absl::ascii_isdigit(pattern[i])) ++i;
+    if (i == pattern.size() || !absl::StrContains("diouxX", pattern[i])) {
+      return false;
+    }
+    ++conversions;
+  }
+  return conversions == 1;
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<AsyncVideoWriter>> AsyncVideoWriter::Open(
+    absl::string_view file_path, cv::Size frame_size, const Options& options) {
+  if (frame_size.width <= 0 || frame_size.height <= 0) {
+    return absl::InvalidArgumentError("Frame size should be positive");
+  }
+  std::unique_ptr<AsyncVideoWriter> writer(
+      new AsyncVideoWriter(std::string(file_path), options));
+  if (writer->image_sequence_ && !IsFramePattern(file_path)) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "'%s' should have one integer conversion such as %%05d", file_path));
+  }
+  if (!writer->image_sequence_) {
+    if (options.fourcc.size() != 4) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Bad fourcc '%s'", options.fourcc));
+    }
+    const int fourcc =
+        cv::VideoWriter::fourcc(options.fourcc[0], options.fourcc[1],
+                                options.fourcc[2], options.fourcc[3]);
+    if (!writer->writer_.open(writer->file_path_, fourcc, options.fps,
+                              frame_size)) {
+      return absl::InternalError(
+          absl::StrFormat("Failed to open video writer: %s", file_path));
+    }
+  }
+  writer->encoder_ = std::thread(&AsyncVideoWriter::Encode, writer.get());
+  return writer;
+}
+
+AsyncVideoWriter::AsyncVideoWriter(std::string file_path,
+                                   const Options& options)
+    : file_path_(std::move(file_path)),
+      options_(options),
+      image_sequence_(absl::StrContains(file_path_, '%')),
+      queue_(options.queue_capacity) {}
+
+AsyncVideoWriter::~AsyncVideoWriter() { Close().IgnoreError(); }
+
+bool AsyncVideoWriter::Write(const cv::Mat& frame) {
+  // Only the encoder pops, so a frame that finds the queue full would be
+  // dropped anyway and isn't worth copying.
+  const bool full = !options_.block_when_full &&
+                    queue_.size() >= queue_.capacity();
+  // The caller is free to reuse its buffer once this returns.
+  const bool queued = !full && (options_.block_when_full
+                                    ? queue_.Push(frame.clone())
+                                    : queue_.TryPush(frame.clone()));
+  absl::MutexLock lock(&mutex_);
+  if (!queued) ++stats_.frames_dropped;
+  stats_.backlog = static_cast<int32_t>(queue_.size());
+  stats_.max_backlog = std::max(stats_.max_backlog, stats_.backlog);
+  return queued;
+}
+
+void AsyncVideoWriter::Encode() {
+  int64_t index = 0;
+  while (std::optional<cv::Mat> frame = queue_.Pop()) {
+    const absl::Time start = absl::Now();
+    bool ok = true;
+    if (image_sequence_) {
+      ok = cv::imwrite(cv::format(file_path_.c_str(), static_cast<int>(index)), *frame);
+    } else {
+      writer_.write(*frame);
+    }
+    ++index;
+    absl::MutexLock lock(&mutex_);
+    stats_.encode_time += absl::Now() - start;
+    stats_.backlog = static_cast<int32_t>(queue_.size());
+    if (ok) {
+      ++stats_.frames_written;
+    } else if (status_.ok()) {
+      status_ = absl::InternalError(absl::StrFormat(
+          "Failed to write frame %d to %s", index - 1, file_path_));
+    }
+  }
+}
+
+absl::Status AsyncVideoWriter::Close() {
+  if (!closed_) {
+    closed_ = true;
+    queue_.Close();
+    if (encoder_.joinable()) encoder_.join();
+    writer_.release();
+  }
+  absl::MutexLock lock(&mutex_);
+  return status_;
+}
+
+AsyncWriterStats AsyncVideoWriter::stats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+}  // namespace hello::misc
@@ -0,0 +1,82 @@
+#ifndef MISC_ASYNC_VIDEO_WRITER_H_
+#define MISC_ASYNC_VIDEO_WRITER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "opencv2/videoio.hpp"
+#include "util/bounded_queue.h"
+
+namespace hello::misc {
+
+struct AsyncWriterStats {
+  int64_t frames_written = 0;
+  // Frames rejected because the encode queue was full.
+  int64_t frames_dropped = 0;
+  // Frames waiting to be encoded.
+  int32_t backlog = 0;
+  int32_t max_backlog = 0;
+  absl::Duration encode_time;
+};
+
+// Encodes frames on a dedicated thread so that the producer never waits for
+// the encoder. Frames go through a bounded queue, when it is full a frame is
+// either dropped or the producer blocks, depending on the options.
+class AsyncVideoWriter {
+ public:
+  struct Options {
+    // Frames per second of the output video.
+    double fps = 25;
+    // Four character codec, ignored for image sequences.
+    std::string fourcc = "MJPG";
+    int32_t queue_capacity = 64;
+    // Wait for room in the queue instead of dropping the frame.
+    bool block_when_full = false;
+  };
+
+  // `file_path` with a printf pattern such as "/tmp/canny_%05d.png" writes
+  // an image sequence with cv::imwrite, the pattern must have exactly one
+  // integer conversion. Anything else goes to cv::VideoWriter.
+  static absl::StatusOr<std::unique_ptr<AsyncVideoWriter>> Open(
+      absl::string_view file_path, cv::Size frame_size,
+      const Options& options);
+
+  // Closes the writer, see Close().
+  ~AsyncVideoWriter();
+
+  // Queues a copy of the frame. Returns false if it was dropped.
+  bool Write(const cv::Mat& frame);
+
+  // Encodes everything that is queued and stops the encoder thread. Returns
+  // the first encode error if there was one.
+  absl::Status Close();
+
+  AsyncWriterStats stats() const;
+
+ private:
+  AsyncVideoWriter(std::string file_path, const Options& options);
+  void Encode();
+
+  const std::string file_path_;
+  const Options options_;
+  const bool image_sequence_;
+  cv::VideoWriter writer_;
+  util::BoundedQueue<cv::Mat> queue_;
+  std::thread encoder_;
+  bool closed_ = false;
+
+  mutable absl::Mutex mutex_;
+  AsyncWriterStats stats_ ABSL_GUARDED_BY(mutex_);
+  absl::Status status_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace hello::misc
+
+#endif  // MISC_ASYNC_VIDEO_WRITER_H_
@@ -0,0 +1,105 @@
+#include "misc/async_video_writer.h"
+#include <filesystem>
+#include <string>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+
+namespace hello::misc {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Gt;
+using ::testing::Le;
+
+// Empty directory for an image sequence, frames are written as %03d.png.
+std::string SequencePattern(const std::string& name) {
+  const std::string directory = ::testing::TempDir() + "/" + name;
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  return directory + "/%03d.png";
+}
+
+int64_t CountFiles(const std::string& pattern) {
+  const std::filesystem::path directory =
+      std::filesystem::path(pattern).parent_path();
+  int64_t files = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+    files += entry.is_regular_file();
+  }
+  return files;
+}
+
+constexpr int kFrames = 50;
+
+TEST(AsyncVideoWriter, DropsWhenFullAndFlushesTheRest) {
+  const std::string pattern = SequencePattern("async_writer_drop");
+  AsyncVideoWriter::Options options;
+  options.queue_capacity = 1;
+  absl::StatusOr<std::unique_ptr<AsyncVideoWriter>> writer =
+      AsyncVideoWriter::Open(pattern, cv::Size(64, 48), options);
+  ASSERT_TRUE(writer.ok()) << writer.status();
+  cv::Mat frame(48, 64, CV_8UC3);
+  int64_t accepted = 0;
+  for (int i = 0; i < kFrames; ++i) {
+    frame.setTo(cv::Scalar::all(i));
+    accepted += (*writer)->Write(frame);
+  }
+  ASSERT_TRUE((*writer)->Close().ok());
+
+  const AsyncWriterStats stats = (*writer)->stats();
+  EXPECT_THAT(accepted, Gt(0));
+  EXPECT_THAT(stats.frames_written, Eq(accepted));
+  EXPECT_THAT(stats.frames_dropped, Eq(kFrames - accepted));
+  EXPECT_THAT(stats.max_backlog, Le(1));
+  EXPECT_THAT(CountFiles(pattern), Eq(accepted));
+}
+
+TEST(AsyncVideoWriter, BlockingWriterKeepsEveryFrame) {
+  const std::string pattern = SequencePattern("async_writer_block");
+  AsyncVideoWriter::Options options;
+  options.queue_capacity = 1;
+  options.block_when_full = true;
+  absl::StatusOr<std::unique_ptr<AsyncVideoWriter>> writer =
+      AsyncVideoWriter::Open(pattern, cv::Size(64, 48), options);
+  ASSERT_TRUE(writer.ok()) << writer.status();
+  const cv::Mat frame(48, 64, CV_8UC3, cv::Scalar(10, 20, 30));
+  for (int i = 0; i < kFrames; ++i) {
+    EXPECT_TRUE((*writer)->Write(frame));
+  }
+  ASSERT_TRUE((*writer)->Close().ok());
+
+  const AsyncWriterStats stats = (*writer)->stats();
+  EXPECT_THAT(stats.frames_written, Eq(kFrames));
+  EXPECT_THAT(stats.frames_dropped, Eq(0));
+  EXPECT_THAT(CountFiles(pattern), Eq(kFrames));
+}
+
+TEST(AsyncVideoWriter, RejectsBadSequencePatterns) {
+  const std::string directory =
+      std::filesystem::path(SequencePattern("async_writer_pattern"))
+          .parent_path()
+          .string();
+  for (const char* pattern : {"%s.png", "%d_%d.png", "%ld.png", "%.png"}) {
+    EXPECT_THAT(AsyncVideoWriter::Open(directory + "/" + pattern,
+                                       cv::Size(64, 48),
+                                       AsyncVideoWriter::Options())
+                    .status()
+                    .code(),
+                Eq(absl::StatusCode::kInvalidArgument))
+        << pattern;
+  }
+  EXPECT_TRUE(AsyncVideoWriter::Open(directory + "/100%%_%04d.png",
+                                     cv::Size(64, 48),
+                                     AsyncVideoWriter::Options())
+                  .ok());
+}
+
+TEST(AsyncVideoWriter, RejectsEmptyFrameSize) {
+  EXPECT_FALSE(AsyncVideoWriter::Open(SequencePattern("async_writer_empty"),
+                                      cv::Size(0, 48),
+                                      AsyncVideoWriter::Options())
+                   .ok());
+}
+
+}  // namespace
+}  // namespace hello::misc
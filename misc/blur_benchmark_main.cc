@@ -0,0 +1,92 @@
+// Compares cv::GaussianBlur with the recursive Gaussian across sigmas and
+// reports accuracy and the speed crossover.
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "misc/recursive_gaussian.h"
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/imgproc.hpp"
+#include "status_macros.h"
+
+ABSL_FLAG(std::string, image_path, "testdata/starry_night.jpg", "Input image");
+ABSL_FLAG(int32_t, repeats, 10, "Number of runs per measurement");
+ABSL_FLAG(bool, use_float, false, "Benchmark CV_32F instead of CV_8U");
+
+namespace {
+
+// Returns the best of `repeats` runs in milliseconds.
+template <typename F>
+double TimeMs(int repeats, F&& f) {
+  double best = std::numeric_limits<double>::max();
+  for (int i = 0; i < repeats; ++i) {
+    const int64 start = cv::getTickCount();
+    f();
+    const double ms =
+        (cv::getTickCount() - start) / cv::getTickFrequency() * 1000.0;
+    best = std::min(best, ms);
+  }
+  return best;
+}
+
+}  // namespace
+
+absl::Status Run() {
+  cv::Mat img = cv::imread(absl::GetFlag(FLAGS_image_path));
+  if (img.empty()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Failed to load ", absl::GetFlag(FLAGS_image_path)));
+  }
+  if (absl::GetFlag(FLAGS_use_float)) img.convertTo(img, CV_32FC3);
+  const int repeats = absl::GetFlag(FLAGS_repeats);
+
+  LOG(INFO) << absl::StreamFormat("Image %d x %d, %d channels, %s", img.cols,
+                                  img.rows, img.channels(),
+                                  img.depth() == CV_8U ? "8-bit" : "float");
+  LOG(INFO) << absl::StreamFormat("%6s %12s %12s %8s %10s %10s", "sigma",
+                                  "fir_ms", "iir_ms", "speedup", "max_err",
+                                  "mean_err");
+  const std::vector<double> sigmas = {1, 2, 3, 5, 8, 10, 15, 20, 30, 40, 50};
+  for (const double sigma : sigmas) {
+    cv::Mat fir;
+    cv::Mat iir;
+    const double fir_ms = TimeMs(repeats, [&] {
+      cv::GaussianBlur(img, fir, cv::Size(0, 0), sigma, sigma,
+                       cv::BORDER_REPLICATE);
+    });
+    absl::Status status;
+    const double iir_ms = TimeMs(repeats, [&] {
+      status.Update(hello::misc::RecursiveGaussianBlur(img, iir, sigma));
+    });
+    RETURN_IF_ERROR(status);
+
+    cv::Mat difference;
+    cv::absdiff(fir, iir, difference);
+    double max_error = 0;
+    cv::minMaxLoc(difference.reshape(1), nullptr, &max_error);
+    const double mean_error = cv::mean(difference.reshape(1))[0];
+    LOG(INFO) << absl::StreamFormat("%6.1f %12.2f %12.2f %8.2f %10.3f %10.4f",
+                                    sigma, fir_ms, iir_ms, fir_ms / iir_ms,
+                                    max_error, mean_error);
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
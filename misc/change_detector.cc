@@ -0,0 +1,56 @@
+#include "misc/change_detector.h"
+#include <algorithm>
+#include "opencv2/imgproc.hpp"
+
+namespace hello::misc {
+
+ChangeDetector::ChangeDetector(const Options& options) : options_(options) {}
+
+cv::Rect ChangeDetector::FrameTile(int32_t tx, int32_t ty,
+                                   cv::Size frame_size) const {
+  const int x0 = tx * frame_size.width / options_.tiles_x;
+  const int x1 = (tx + 1) * frame_size.width / options_.tiles_x;
+  const int y0 = ty * frame_size.height / options_.tiles_y;
+  const int y1 = (ty + 1) * frame_size.height / options_.tiles_y;
+  return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+std::vector<cv::Rect> ChangeDetector::Detect(const cv::Mat& frame) {
+  const int cell = options_.signature_cell;
+  // Shrink first so that the color conversion only touches the thumbnail.
+  cv::Mat thumbnail;
+  cv::resize(frame, thumbnail,
+             cv::Size(options_.tiles_x * cell, options_.tiles_y * cell), 0, 0,
+             cv::INTER_AREA);
+  if (thumbnail.channels() == 3) {
+    cv::cvtColor(thumbnail, signature_, cv::COLOR_BGR2GRAY);
+  } else {
+    signature_ = thumbnail;
+  }
+
+  std::vector<cv::Rect> changed;
+  if (frame.size() != frame_size_ || reference_.empty()) {
+    frame_size_ = frame.size();
+    signature_.copyTo(reference_);
+    for (int32_t ty = 0; ty < options_.tiles_y; ++ty) {
+      for (int32_t tx = 0; tx < options_.tiles_x; ++tx) {
+        changed.push_back(FrameTile(tx, ty, frame_size_));
+      }
+    }
+    return changed;
+  }
+
+  cv::absdiff(signature_, reference_, difference_);
+  for (int32_t ty = 0; ty < options_.tiles_y; ++ty) {
+    for (int32_t tx = 0; tx < options_.tiles_x; ++tx) {
+      const cv::Rect cell_rect(tx * cell, ty * cell, cell, cell);
+      if (cv::mean(difference_(cell_rect))[0] > options_.threshold) {
+        signature_(cell_rect).copyTo(reference_(cell_rect));
+        changed.push_back(FrameTile(tx, ty, frame_size_));
+      }
+    }
+  }
+  return changed;
+}
+
+}  // namespace hello::misc
@@ -0,0 +1,48 @@
+#ifndef MISC_CHANGE_DETECTOR_H_
+#define MISC_CHANGE_DETECTOR_H_
+
+#include <cstdint>
+#include <vector>
+#include "opencv2/core.hpp"
+
+namespace hello::misc {
+
+// Finds the tiles of a frame that changed since they were last reported.
+// Frames are compared through a small gray signature (an INTER_AREA
+// thumbnail), so the cost is a fraction of any per-pixel processing.
+class ChangeDetector {
+ public:
+  struct Options {
+    int32_t tiles_x = 8;
+    int32_t tiles_y = 6;
+    // Side of a tile in the signature, in signature pixels.
+    int32_t signature_cell = 8;
+    // Mean absolute difference of a tile signature, in gray levels, above
+    // which the tile counts as changed.
+    double threshold = 3.0;
+  };
+
+  explicit ChangeDetector(const Options& options);
+  ChangeDetector() : ChangeDetector(Options()) {}
+
+  // Returns the changed tiles in frame coordinates and makes their current
+  // signature the reference, so the caller is expected to reprocess them.
+  // Unchanged tiles keep their old reference so that slow drift is caught
+  // eventually. The first frame, or a change of size, reports every tile.
+  std::vector<cv::Rect> Detect(const cv::Mat& frame);
+
+  int32_t num_tiles() const { return options_.tiles_x * options_.tiles_y; }
+
+ private:
+  cv::Rect FrameTile(int32_t tx, int32_t ty, cv::Size frame_size) const;
+
+  const Options options_;
+  cv::Size frame_size_;
+  cv::Mat reference_;
+  cv::Mat signature_;
+  cv::Mat difference_;
+};
+
+}  // namespace hello::misc
+
+#endif  // MISC_CHANGE_DETECTOR_H_
@@ -0,0 +1,45 @@
+#include "misc/change_detector.h"
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+#include "opencv2/imgproc.hpp"
+
+namespace hello::misc {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::IsEmpty;
+using ::testing::SizeIs;
+
+TEST(ChangeDetector, ReportsEverythingFirstAndNothingForStaticFrames) {
+  ChangeDetector detector;
+  const cv::Mat frame(480, 640, CV_8UC3, cv::Scalar(20, 40, 60));
+  EXPECT_THAT(detector.Detect(frame), SizeIs(detector.num_tiles()));
+  EXPECT_THAT(detector.Detect(frame), IsEmpty());
+  EXPECT_THAT(detector.Detect(frame.clone()), IsEmpty());
+}
+
+TEST(ChangeDetector, ReportsOnlyTheChangedTile) {
+  ChangeDetector::Options options;
+  options.tiles_x = 4;
+  options.tiles_y = 4;
+  ChangeDetector detector(options);
+  cv::Mat frame(400, 400, CV_8UC3, cv::Scalar::all(0));
+  detector.Detect(frame);
+
+  cv::rectangle(frame, cv::Rect(110, 210, 60, 60), cv::Scalar::all(255), -1);
+  EXPECT_THAT(detector.Detect(frame),
+              ElementsAre(cv::Rect(100, 200, 100, 100)));
+  // The tile was accepted as the new reference.
+  EXPECT_THAT(detector.Detect(frame), IsEmpty());
+}
+
+TEST(ChangeDetector, ReportsEverythingWhenSizeChanges) {
+  ChangeDetector detector;
+  detector.Detect(cv::Mat(480, 640, CV_8UC1, cv::Scalar::all(0)));
+  EXPECT_THAT(detector.Detect(cv::Mat(240, 320, CV_8UC1, cv::Scalar::all(0))),
+              SizeIs(Eq(detector.num_tiles())));
+}
+
+}  // namespace
+}  // namespace hello::misc
@@ -6,8 +6,35 @@
 #include "absl/strings/str_format.h"
 #include "misc/misc.h"
 
+ABSL_FLAG(std::string, demo, "picture_canny",
+          "One of picture_canny, video_canny, recursive_blurring");
+ABSL_FLAG(std::string, output_path, "",
+          "video_canny: record the composite to this video or image pattern");
+ABSL_FLAG(std::string, video_path, "", "video_canny: input video");
+ABSL_FLAG(bool, motion_gating, false,
+          "video_canny: reprocess only the tiles that changed");
+ABSL_FLAG(double, change_threshold, 3.0,
+          "video_canny: tile difference in gray levels that counts as change");
+ABSL_FLAG(bool, headless, false, "video_canny: no windows, no frame pacing");
+ABSL_FLAG(double, sigma, 20.0, "recursive_blurring: Gaussian sigma");
+
 absl::Status Run() {
-  return hello::misc::ShowPictureCanny();
+  const std::string demo = absl::GetFlag(FLAGS_demo);
+  if (demo == "picture_canny") return hello::misc::ShowPictureCanny();
+  if (demo == "video_canny") {
+    hello::misc::VideoCannyOptions options;
+    options.video_path = absl::GetFlag(FLAGS_video_path);
+    options.output_path = absl::GetFlag(FLAGS_output_path);
+    options.motion_gating = absl::GetFlag(FLAGS_motion_gating);
+    options.change_threshold = absl::GetFlag(FLAGS_change_threshold);
+    options.headless = absl::GetFlag(FLAGS_headless);
+    return hello::misc::ShowVideoCanny(options);
+  }
+  if (demo == "recursive_blurring") {
+    return hello::misc::ShowPictureRecursiveBlurring(
+        absl::GetFlag(FLAGS_sigma));
+  }
+  return absl::InvalidArgumentError(absl::StrFormat("Unknown demo %s", demo));
 }
 
 int main(int argc, char** argv) {
@@ -18,4 +45,4 @@ int main(int argc, char** argv) {
   }
   LOG(INFO) << "Done";
   return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -1,10 +1,18 @@
 #include "misc.h"
 #include <glog/logging.h>
+#include <algorithm>
+#include <ctime>
 #include <filesystem>
+#include <memory>
+#include <vector>
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "misc/async_video_writer.h"
+#include "misc/change_detector.h"
+#include "misc/recursive_gaussian.h"
 #include "opencv2/highgui.hpp"
 #include "opencv2/imgproc.hpp"
+#include "util/trace.h"
 
 namespace hello::misc {
 using ::std::filesystem::path;
@@ -40,65 +48,68 @@ absl::Status ShowVideo() {
   return absl::OkStatus();
 }
 
-namespace global {
-using ::std::filesystem::path;
-
-int run;
-int dont_set;
-int current_pos;
-cv::VideoCapture cap;
+namespace {
+// Playback state shared between the loop and the trackbar callback, passed
+// through the callback user data so that several players can coexist.
+struct TaskBarPlayer {
+  int run = 1;  // start out in single step mode
+  int dont_set = 0;
+  int current_pos = 0;
+  cv::VideoCapture cap;
+};
 
-void OnTrackbarSlide(int, void*) {
-  cap.set(cv::CAP_PROP_POS_FRAMES, current_pos);
-  if (!dont_set) run = 1;
-  dont_set = 0;
+void OnTrackbarSlide(int, void* user_data) {
+  auto* player = static_cast<TaskBarPlayer*>(user_data);
+  player->cap.set(cv::CAP_PROP_POS_FRAMES, player->current_pos);
+  if (!player->dont_set) player->run = 1;
+  player->dont_set = 0;
 }
+}  // namespace
 
 absl::Status ShowVideoWithTaskBar() {
   int slider_position = 0;
-  run = 1;
-  dont_set = 0; // start out in single step mode
+  TaskBarPlayer player;
   cv::namedWindow("Example 2-4", cv::WINDOW_AUTOSIZE);
-  cap.open((path(kTestDataPath) / "Megamind.avi").string());
-  int frames = (int)cap.get(cv::CAP_PROP_FRAME_COUNT);
-  int width = (int)cap.get(cv::CAP_PROP_FRAME_WIDTH);
-  int height = (int)cap.get(cv::CAP_PROP_FRAME_HEIGHT);
+  player.cap.open((path(kTestDataPath) / "Megamind.avi").string());
+  int frames = (int)player.cap.get(cv::CAP_PROP_FRAME_COUNT);
+  int width = (int)player.cap.get(cv::CAP_PROP_FRAME_WIDTH);
+  int height = (int)player.cap.get(cv::CAP_PROP_FRAME_HEIGHT);
 
   LOG(INFO) << absl::StreamFormat("Video has %d frames of %d x %d", frames,
                                   width, height);
   cv::createTrackbar("Position", "Example 2-4", &slider_position, frames,
-                     OnTrackbarSlide);
+                     OnTrackbarSlide, &player);
 
   cv::Mat frame;
   for (;;) {
-    if (run != 0) {
-      cap >> frame;
+    if (player.run != 0) {
+      player.cap >> frame;
       if (frame.empty()) break;
-      current_pos = (int)cap.get(cv::CAP_PROP_POS_FRAMES);
-      dont_set = 1;
+      player.current_pos = (int)player.cap.get(cv::CAP_PROP_POS_FRAMES);
+      player.dont_set = 1;
 
-      cv::setTrackbarPos("Position", "Example 2-4", current_pos);
+      cv::setTrackbarPos("Position", "Example 2-4", player.current_pos);
       cv::imshow("Example 2-4", frame);
-      run -= 1;
+      player.run -= 1;
     }
     char c = (char)cv::waitKey(10);
     if (c == 's') {
       // single step
-      run = 1;
-      LOG(INFO) << "Single step, run = " << run;
+      player.run = 1;
+      LOG(INFO) << "Single step, run = " << player.run;
     }
 
     if (c == 'r') {
       // run mode
-      run = -1;
-      LOG(INFO) << "RunInstrinsicCalibration mode, run = " << run;
+      player.run = -1;
+      LOG(INFO) << "RunInstrinsicCalibration mode, run = " << player.run;
     }
 
     if (c == 27) break;
   }
   return absl::OkStatus();
 }
-} // namespace global
+
 absl::Status ShowPictureBlurring() {
   cv::Mat img = cv::imread((path(kTestDataPath) / "starry_night.jpg").string());
   if (img.empty()) return absl::InternalError("No image");
@@ -113,6 +124,18 @@ absl::Status ShowPictureBlurring() {
   return absl::OkStatus();
 }
 
+absl::Status ShowPictureRecursiveBlurring(double sigma) {
+  cv::Mat img = cv::imread((path(kTestDataPath) / "starry_night.jpg").string());
+  if (img.empty()) return absl::InternalError("No image");
+  cv::Mat out;
+  if (const auto status = RecursiveGaussianBlur(img, out, sigma); !status.ok())
+    return status;
+  cv::imshow("Recursive-in", img);
+  cv::imshow(absl::StrFormat("Recursive-out sigma %.1f", sigma), out);
+  cv::waitKey(0);
+  return absl::OkStatus();
+}
+
 absl::Status ShowPicturePyrDown() {
   cv::Mat img = cv::imread((path(kTestDataPath) / "starry_night.jpg").string());
   if (img.empty()) return absl::InternalError("No image");
@@ -143,9 +166,47 @@ absl::Status ShowPictureCanny() {
   return absl::OkStatus();
 }
 
-absl::Status ShowVideoCanny() {
+namespace {
+// Computes gray and Canny for `tile` of the frame and updates the three
+// panels of the composite. Canny runs on a slightly larger area so that the
+// Sobel and non-maximum suppression neighbourhoods see real pixels; edge
+// hysteresis does not cross tile borders.
+void ProcessTile(const cv::Mat& frame, const cv::Rect& tile, cv::Mat& gray,
+                 cv::Mat& canny, cv::Mat& all) {
+  constexpr int kMargin = 4;
+  const cv::Rect padded =
+      cv::Rect(tile.x - kMargin, tile.y - kMargin, tile.width + 2 * kMargin,
+               tile.height + 2 * kMargin) &
+      cv::Rect(0, 0, frame.cols, frame.rows);
+  const cv::Rect inner = tile - padded.tl();
+  cv::Mat padded_gray;
+  cv::Mat padded_canny;
+  {
+    TRACE_SCOPE("misc/gray");
+    cv::cvtColor(frame(padded), padded_gray, cv::COLOR_BGR2GRAY);
+  }
+  {
+    TRACE_SCOPE("misc/canny");
+    cv::Canny(padded_gray, padded_canny, 100, 255);
+  }
+  TRACE_SCOPE("misc/composite");
+  padded_gray(inner).copyTo(gray(tile));
+  padded_canny(inner).copyTo(canny(tile));
+  // question a
+  frame(tile).copyTo(all(tile));
+  cv::Mat sub = all(tile + cv::Point(frame.cols, 0));
+  cv::cvtColor(gray(tile), sub, cv::COLOR_GRAY2BGR);
+  sub = all(tile + cv::Point(2 * frame.cols, 0));
+  cv::cvtColor(canny(tile), sub, cv::COLOR_GRAY2BGR);
+}
+}  // namespace
+
+absl::Status ShowVideoCanny(const VideoCannyOptions& options) {
   cv::VideoCapture capture;
-  const std::string file_path = (path(kTestDataPath) / "Megamind.avi").string();
+  const std::string file_path =
+      options.video_path.empty()
+          ? (path(kTestDataPath) / "Megamind.avi").string()
+          : options.video_path;
   capture.open(file_path);
   if (!capture.isOpened()) {
     return absl::InternalError(
@@ -155,42 +216,101 @@ absl::Status ShowVideoCanny() {
   cv::Mat frame;
   cv::Mat gray;
   cv::Mat canny;
+  cv::Mat all;
   int delay = 1000 / rate;
   LOG(INFO) << "rate = " << rate << ", delay = " << delay;
+  std::unique_ptr<AsyncVideoWriter> writer;
+  if (!options.output_path.empty()) {
+    const cv::Size size(3 * (int)capture.get(cv::CAP_PROP_FRAME_WIDTH),
+                        (int)capture.get(cv::CAP_PROP_FRAME_HEIGHT));
+    AsyncVideoWriter::Options writer_options;
+    writer_options.fps = rate;
+    writer_options.queue_capacity = options.output_queue_capacity;
+    auto opened = AsyncVideoWriter::Open(options.output_path, size,
+                                         writer_options);
+    if (!opened.ok()) return opened.status();
+    writer = std::move(opened).value();
+  }
+  ChangeDetector::Options detector_options;
+  detector_options.threshold = options.change_threshold;
+  ChangeDetector detector(detector_options);
+  int64_t frames = 0;
+  int64_t skipped_frames = 0;
+  int64_t processed_pixels = 0;
+  int64_t total_pixels = 0;
+  const std::clock_t cpu_start = std::clock();
   while (1) {
-    capture >> frame;
+    {
+      TRACE_SCOPE("misc/decode");
+      capture >> frame;
+    }
     if (!frame.data) break;
-    //(1)
+    {
+      TRACE_SCOPE("misc/frame");
+      std::vector<cv::Rect> tiles;
+      if (all.rows != frame.rows || all.cols != 3 * frame.cols) {
+        gray.create(frame.size(), CV_8UC1);
+        canny.create(frame.size(), CV_8UC1);
+        all.create(frame.rows, 3 * frame.cols, CV_8UC3);
+      }
+      if (options.motion_gating) {
+        TRACE_SCOPE("misc/change_detection");
+        tiles = detector.Detect(frame);
+      } else {
+        tiles.push_back(cv::Rect(0, 0, frame.cols, frame.rows));
+      }
+      //(1), (2), (3) only where something changed
+      for (const cv::Rect& tile : tiles) {
+        ProcessTile(frame, tile, gray, canny, all);
+        processed_pixels += tile.area();
+      }
+      total_pixels += frame.total();
+      ++frames;
+      if (tiles.empty()) {
+        ++skipped_frames;
+      } else {
+        // question b
+        cv::Scalar color = CV_RGB(255, 0, 0);
+        cv::putText(all, "raw video", cv::Point(50, 30),
+                    cv::FONT_HERSHEY_DUPLEX, 1.0f, color);
+        putText(all, "gray video", cv::Point(50 + frame.cols, 30),
+                cv::FONT_HERSHEY_DUPLEX, 1.0f, color);
+        putText(all, "canny video", cv::Point(50 + 2 * frame.cols, 30),
+                cv::FONT_HERSHEY_DUPLEX, 1.0f, color);
+      }
+    }
+    if (writer != nullptr) writer->Write(all);
+    if (options.headless) continue;
+
     imshow("Raw Video", frame);
-    //(2)
-    cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
     imshow("Gray Video", gray);
-    //(3)
-    Canny(gray, canny, 100, 255);
     imshow("Canny Video", canny);
-    // question a
-    cv::Mat all(frame.rows, 3 * frame.cols, CV_8UC3, cv::Scalar::all(0));
-    cv::cvtColor(gray, gray, cv::COLOR_GRAY2BGR);
-    cv::cvtColor(canny, canny, cv::COLOR_GRAY2BGR);
-    cv::Mat sub = all.colRange(0, frame.cols);
-    frame.copyTo(sub);
-    sub = all.colRange(frame.cols, 2 * frame.cols);
-    gray.copyTo(sub);
-    sub = all.colRange(2 * frame.cols, 3 * frame.cols);
-    canny.copyTo(sub);
-    // question b
-    cv::Scalar color = CV_RGB(255, 0, 0);
-    cv::putText(all, "raw video", cv::Point(50, 30), cv::FONT_HERSHEY_DUPLEX,
-                1.0f, color);
-    putText(all, "gray video", cv::Point(50 + frame.cols, 30),
-            cv::FONT_HERSHEY_DUPLEX, 1.0f, color);
-    putText(all, "canny video", cv::Point(50 + 2 * frame.cols, 30),
-            cv::FONT_HERSHEY_DUPLEX, 1.0f, color);
     imshow("all Video", all);
-
     if ((cv::waitKey(delay) & 255) == 27) break;
   }
-  cv::waitKey();
+  const double cpu_seconds =
+      static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+  LOG(INFO) << absl::StreamFormat(
+      "Frames %d, skipped %d (%.1f%%), processed %.1f%% of the pixels, "
+      "CPU %.2f s",
+      frames, skipped_frames,
+      100.0 * skipped_frames / std::max<int64_t>(frames, 1),
+      100.0 * processed_pixels / std::max<int64_t>(total_pixels, 1),
+      cpu_seconds);
+  LOG(INFO) << "Latency:\n" << hello::util::Tracer::Get().SummaryTable();
+  if (writer != nullptr) {
+    const absl::Status status = writer->Close();
+    const AsyncWriterStats stats = writer->stats();
+    LOG(INFO) << absl::StreamFormat(
+        "Recorded %d frames to %s, dropped %d, max backlog %d, encode %.2f "
+        "ms/frame",
+        stats.frames_written, options.output_path, stats.frames_dropped,
+        stats.max_backlog,
+        absl::ToDoubleMilliseconds(stats.encode_time) /
+            std::max<int64_t>(stats.frames_written, 1));
+    if (!status.ok()) return status;
+  }
+  if (!options.headless) cv::waitKey();
   capture.release();
   return absl::OkStatus();
 }
@@ -1,18 +1,37 @@
 #ifndef MISC_MISC_H_
 #define MISC_MISC_H_
 
+#include <cstdint>
+#include <string>
 #include "absl/status/status.h"
 
 namespace hello::misc {
-namespace global {
-absl::Status ShowVideoWithTaskBar();
-}  // namespace global
+struct VideoCannyOptions {
+  // Defaults to testdata/Megamind.avi.
+  std::string video_path;
+  // When set the raw | gray | canny composite is recorded there, either a
+  // video file or an image sequence pattern such as "/tmp/canny_%05d.png".
+  std::string output_path;
+  // Composites waiting for the encoder, more are dropped.
+  int32_t output_queue_capacity = 64;
+  // Only reprocess the tiles that changed since the previous frame and reuse
+  // the previous results elsewhere, see ChangeDetector.
+  bool motion_gating = false;
+  // Mean absolute gray level difference of a tile thumbnail that counts as a
+  // change.
+  double change_threshold = 3.0;
+  // No windows and no frame pacing, for measurements.
+  bool headless = false;
+};
 
 absl::Status ShowPicture();
 absl::Status ShowVideo();
+absl::Status ShowVideoWithTaskBar();
 absl::Status ShowPictureBlurring();
+// Same as above with the recursive Gaussian, the cost does not grow with sigma.
+absl::Status ShowPictureRecursiveBlurring(double sigma);
 absl::Status ShowPicturePyrDown();
 absl::Status ShowPictureCanny();
-absl::Status ShowVideoCanny();
+absl::Status ShowVideoCanny(const VideoCannyOptions& options = {});
 }  // namespace hello::misc
 #endif  // MISC_MISC_H_
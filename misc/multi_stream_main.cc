@@ -0,0 +1,89 @@
+// Runs gray + Canny over many video streams on one shared worker pool.
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "misc/stream_processor.h"
+#include "opencv2/imgproc.hpp"
+#include "status_macros.h"
+#include "util/trace.h"
+
+ABSL_FLAG(std::vector<std::string>, video_paths, {"testdata/Megamind.avi"},
+          "Comma separated videos, reused round robin for all the streams");
+ABSL_FLAG(int32_t, num_streams, 16, "Number of concurrent streams");
+ABSL_FLAG(int32_t, num_threads, 0, "Worker threads, zero is one per core");
+ABSL_FLAG(int32_t, queue_capacity, 4, "Decoded frames queued per stream");
+ABSL_FLAG(bool, realtime, false,
+          "Deliver frames at the source frame rate and drop late ones");
+ABSL_FLAG(bool, scaling, false,
+          "Repeat the run with 1, 2, 4, ... threads up to the core count");
+
+namespace {
+
+void GrayCanny(const cv::Mat& frame) {
+  cv::Mat gray;
+  cv::Mat canny;
+  cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+  cv::Canny(gray, canny, 100, 255);
+}
+
+absl::StatusOr<double> RunStreams(int32_t num_threads) {
+  const std::vector<std::string> paths = absl::GetFlag(FLAGS_video_paths);
+  if (paths.empty()) return absl::InvalidArgumentError("No video paths");
+  hello::misc::MultiStreamRunner runner(num_threads);
+  for (int32_t i = 0; i < absl::GetFlag(FLAGS_num_streams); ++i) {
+    runner.AddStream(std::make_unique<hello::misc::StreamProcessor>(
+        paths[i % paths.size()], GrayCanny,
+        absl::GetFlag(FLAGS_queue_capacity), absl::GetFlag(FLAGS_realtime)));
+  }
+  RETURN_IF_ERROR(runner.Run());
+  LOG(INFO) << "Latency:\n" << hello::util::Tracer::Get().SummaryTable();
+  hello::util::Tracer::Get().Clear();
+  return runner.throughput();
+}
+
+}  // namespace
+
+absl::Status Run() {
+  // Parallelism comes from the streams, OpenCV's own threads would only
+  // oversubscribe the cores.
+  cv::setNumThreads(1);
+  if (!absl::GetFlag(FLAGS_scaling)) {
+    return RunStreams(absl::GetFlag(FLAGS_num_threads)).status();
+  }
+  const int32_t cores =
+      std::max<int32_t>(1, std::thread::hardware_concurrency());
+  std::vector<std::pair<int32_t, double>> results;
+  for (int32_t threads = 1;; threads = std::min(threads * 2, cores)) {
+    ASSIGN_OR_RETURN(const double fps, RunStreams(threads));
+    results.emplace_back(threads, fps);
+    if (threads == cores) break;
+  }
+  LOG(INFO) << absl::StreamFormat("%8s %12s %8s", "threads", "fps", "scale");
+  for (const auto& [threads, fps] : results) {
+    LOG(INFO) << absl::StreamFormat("%8d %12.1f %8.2f", threads, fps,
+                                    fps / results.front().second);
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+#include "misc/recursive_gaussian.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "absl/strings/str_format.h"
+#include "opencv2/imgproc.hpp"
+
+namespace hello::misc {
+namespace {
+
+// The recursion is not accurate below this sigma.
+constexpr double kMinSigma = 0.5;
+// Backward pass initialization needs three rows.
+constexpr int kMinSize = 4;
+// Number of floats processed by one task, 1 KB per row keeps the three
+// previous rows of a stripe in L1.
+constexpr int kStripeWidth = 256;
+
+// Runs the causal and anti-causal passes down the columns of a single channel
+// CV_32F image in place. Columns are independent, so the inner loops run
+// across a stripe of columns and vectorize; stripes run in parallel.
+void FilterColumns(cv::Mat& img, const RecursiveGaussianCoefficients& c) {
+  const int rows = img.rows;
+  const int cols = img.cols;
+  const int stripes = (cols + kStripeWidth - 1) / kStripeWidth;
+  cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+    std::vector<float> first(kStripeWidth);
+    std::vector<float> last(kStripeWidth);
+    // y[rows] and y[rows + 1] of the backward pass.
+    std::vector<float> tail(2 * kStripeWidth);
+    for (int s = range.start; s < range.end; ++s) {
+      const int x0 = s * kStripeWidth;
+      const int width = std::min(kStripeWidth, cols - x0);
+      std::copy_n(img.ptr<float>(0) + x0, width, first.data());
+      std::copy_n(img.ptr<float>(rows - 1) + x0, width, last.data());
+
+      // Causal pass. Rows above the image are the steady state of the
+      // replicated first row, which is the first row itself.
+      for (int r = 0; r < rows; ++r) {
+        float* __restrict row = img.ptr<float>(r) + x0;
+        const float* __restrict w1 =
+            r >= 1 ? img.ptr<float>(r - 1) + x0 : first.data();
+        const float* __restrict w2 =
+            r >= 2 ? img.ptr<float>(r - 2) + x0 : first.data();
+        const float* __restrict w3 =
+            r >= 3 ? img.ptr<float>(r - 3) + x0 : first.data();
+        for (int x = 0; x < width; ++x) {
+          row[x] = c.b * row[x] + c.a1 * w1[x] + c.a2 * w2[x] + c.a3 * w3[x];
+        }
+      }
+
+      // Triggs - Sdika initialization of y[rows - 1], y[rows], y[rows + 1].
+      {
+        float* __restrict y0 = img.ptr<float>(rows - 1) + x0;
+        const float* __restrict w1 = img.ptr<float>(rows - 2) + x0;
+        const float* __restrict w2 = img.ptr<float>(rows - 3) + x0;
+        float* __restrict y1 = tail.data();
+        float* __restrict y2 = tail.data() + kStripeWidth;
+        for (int x = 0; x < width; ++x) {
+          const float u0 = y0[x] - last[x];
+          const float u1 = w1[x] - last[x];
+          const float u2 = w2[x] - last[x];
+          y0[x] = last[x] +
+                  c.b * (c.m[0][0] * u0 + c.m[0][1] * u1 + c.m[0][2] * u2);
+          y1[x] = last[x] +
+                  c.b * (c.m[1][0] * u0 + c.m[1][1] * u1 + c.m[1][2] * u2);
+          y2[x] = last[x] +
+                  c.b * (c.m[2][0] * u0 + c.m[2][1] * u1 + c.m[2][2] * u2);
+        }
+      }
+
+      // Anti-causal pass.
+      auto y_row = [&](int r) -> const float* {
+        return r < rows ? img.ptr<float>(r) + x0
+                        : tail.data() + (r - rows) * kStripeWidth;
+      };
+      for (int r = rows - 2; r >= 0; --r) {
+        float* __restrict row = img.ptr<float>(r) + x0;
+        const float* __restrict y1 = y_row(r + 1);
+        const float* __restrict y2 = y_row(r + 2);
+        const float* __restrict y3 = y_row(r + 3);
+        for (int x = 0; x < width; ++x) {
+          row[x] = c.b * row[x] + c.a1 * y1[x] + c.a2 * y2[x] + c.a3 * y3[x];
+        }
+      }
+    }
+  });
+}
+
+}  // namespace
+
+RecursiveGaussianCoefficients MakeRecursiveGaussianCoefficients(double sigma) {
+  // Young, van Vliet "Recursive implementation of the Gaussian filter", 1995.
+  const double q = sigma >= 2.5
+                       ? 0.98711 * sigma - 0.96330
+                       : 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+  const double q2 = q * q;
+  const double q3 = q2 * q;
+  const double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+  const double a1 = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+  const double a2 = -(1.4281 * q2 + 1.26661 * q3) / b0;
+  const double a3 = (0.422205 * q3) / b0;
+
+  // Triggs, Sdika "Boundary conditions for Young - van Vliet recursive
+  // filtering", 2006.
+  const double scale = 1.0 / ((1.0 + a1 - a2 + a3) * (1.0 - a1 - a2 - a3) *
+                              (1.0 + a2 + (a1 - a3) * a3));
+  RecursiveGaussianCoefficients c;
+  c.b = static_cast<float>(1.0 - (a1 + a2 + a3));
+  c.a1 = static_cast<float>(a1);
+  c.a2 = static_cast<float>(a2);
+  c.a3 = static_cast<float>(a3);
+  c.m[0][0] = scale * (-a3 * a1 + 1.0 - a3 * a3 - a2);
+  c.m[0][1] = scale * (a3 + a1) * (a2 + a3 * a1);
+  c.m[0][2] = scale * a3 * (a1 + a3 * a2);
+  c.m[1][0] = scale * (a1 + a3 * a2);
+  c.m[1][1] = -scale * (a2 - 1.0) * (a2 + a3 * a1);
+  c.m[1][2] = -scale * a3 * (a3 * a1 + a3 * a3 + a2 - 1.0);
+  c.m[2][0] = scale * (a3 * a1 + a2 + a1 * a1 - a2 * a2);
+  c.m[2][1] = scale * (a1 * a2 + a3 * a2 * a2 - a1 * a3 * a3 -
+                       a3 * a3 * a3 - a3 * a2 + a3);
+  c.m[2][2] = scale * a3 * (a1 + a3 * a2);
+  return c;
+}
+
+absl::Status RecursiveGaussianBlur(const cv::Mat& src, cv::Mat& dst,
+                                   double sigma_x, double sigma_y) {
+  if (src.empty()) return absl::InvalidArgumentError("Empty image");
+  if (src.depth() != CV_8U && src.depth() != CV_32F) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Unsupported depth %i, expected CV_8U or CV_32F", src.depth()));
+  }
+  if (src.channels() > 4) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Unsupported number of channels %i", src.channels()));
+  }
+  if (sigma_y <= 0) sigma_y = sigma_x;
+  if (sigma_x <= 0) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Sigma should be positive, got %f", sigma_x));
+  }
+  if (sigma_x < kMinSigma || sigma_y < kMinSigma || src.rows < kMinSize ||
+      src.cols < kMinSize) {
+    cv::GaussianBlur(src, dst, cv::Size(0, 0), sigma_x, sigma_y,
+                     cv::BORDER_REPLICATE);
+    return absl::OkStatus();
+  }
+
+  cv::Mat work;
+  src.convertTo(work, CV_MAKETYPE(CV_32F, src.channels()));
+
+  // Vertical pass, every channel of every column is an independent signal.
+  cv::Mat plane = work.reshape(1);
+  FilterColumns(plane, MakeRecursiveGaussianCoefficients(sigma_y));
+
+  // Horizontal pass runs down the columns of the transposed image, so it
+  // vectorizes the same way and its stripes are the rows of the source.
+  cv::Mat transposed;
+  cv::transpose(work, transposed);
+  plane = transposed.reshape(1);
+  FilterColumns(plane, MakeRecursiveGaussianCoefficients(sigma_x));
+  cv::transpose(transposed, work);
+
+  work.convertTo(dst, src.type());
+  return absl::OkStatus();
+}
+
+}  // namespace hello::misc
@@ -0,0 +1,36 @@
+#ifndef MISC_RECURSIVE_GAUSSIAN_H_
+#define MISC_RECURSIVE_GAUSSIAN_H_
+
+#include "absl/status/status.h"
+#include "opencv2/core.hpp"
+
+namespace hello::misc {
+
+// Coefficients of the third order Young - van Vliet recursive Gaussian:
+//   w[n] = b * x[n] + a1 * w[n - 1] + a2 * w[n - 2] + a3 * w[n - 3]
+// followed by the same recursion running backwards over w.
+struct RecursiveGaussianCoefficients {
+  float b;
+  float a1;
+  float a2;
+  float a3;
+  // Triggs - Sdika 3x3 matrix that initializes the backward pass so that the
+  // result matches an infinite replicate border.
+  float m[3][3];
+};
+
+// Computes the coefficients for the given sigma, sigma should be >= 0.5.
+RecursiveGaussianCoefficients MakeRecursiveGaussianCoefficients(double sigma);
+
+// Blurs the image with a recursive (IIR) approximation of the Gaussian whose
+// cost per pixel does not depend on sigma. The border is BORDER_REPLICATE.
+// * src - CV_8U or CV_32F image with 1 to 4 channels
+// * sigma_y - when zero it is set to sigma_x
+// Sigmas below 0.5 fall back to cv::GaussianBlur, the recursion is not
+// accurate there and FIR kernels are tiny anyway.
+absl::Status RecursiveGaussianBlur(const cv::Mat& src, cv::Mat& dst,
+                                   double sigma_x, double sigma_y = 0);
+
+}  // namespace hello::misc
+
+#endif  // MISC_RECURSIVE_GAUSSIAN_H_
@@ -0,0 +1,86 @@
+#include "misc/recursive_gaussian.h"
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+#include "opencv2/imgproc.hpp"
+
+namespace hello::misc {
+namespace {
+
+using ::testing::Le;
+using ::testing::TestWithParam;
+using ::testing::ValuesIn;
+
+// Sharp edges are the worst case for the recursive approximation.
+cv::Mat MakeShapes(int type) {
+  cv::Mat img(240, 320, CV_8UC3, cv::Scalar::all(0));
+  cv::rectangle(img, cv::Rect(40, 30, 120, 80), cv::Scalar(255, 128, 0), -1);
+  cv::circle(img, cv::Point(220, 150), 60, cv::Scalar(0, 255, 255), -1);
+  cv::line(img, cv::Point(0, 239), cv::Point(319, 0), cv::Scalar::all(200), 3);
+  cv::Mat out;
+  img.convertTo(out, type);
+  return out;
+}
+
+struct TestCase {
+  std::string test_name;
+  int type;
+  double sigma;
+};
+
+using RecursiveGaussianTest = TestWithParam<TestCase>;
+
+TEST_P(RecursiveGaussianTest, MatchesGaussianBlur) {
+  const TestCase& test_case = GetParam();
+  const cv::Mat img = MakeShapes(test_case.type);
+  cv::Mat want;
+  cv::GaussianBlur(img, want, cv::Size(0, 0), test_case.sigma, test_case.sigma,
+                   cv::BORDER_REPLICATE);
+  cv::Mat got;
+  ASSERT_TRUE(RecursiveGaussianBlur(img, got, test_case.sigma).ok());
+  ASSERT_EQ(got.type(), img.type());
+  ASSERT_EQ(got.size(), img.size());
+
+  cv::Mat difference;
+  cv::absdiff(got, want, difference);
+  double max_error = 0;
+  cv::minMaxLoc(difference.reshape(1), nullptr, &max_error);
+  const cv::Scalar mean_error = cv::mean(difference);
+  EXPECT_THAT(max_error, Le(6.0));
+  for (int c = 0; c < img.channels(); ++c) {
+    EXPECT_THAT(mean_error[c], Le(0.5));
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    RecursiveGaussianTests, RecursiveGaussianTest,
+    ValuesIn<TestCase>({{"Gray8Sigma5", CV_8UC1, 5.0},
+                        {"Color8Sigma5", CV_8UC3, 5.0},
+                        {"Color8Sigma20", CV_8UC3, 20.0},
+                        {"Float4Sigma10", CV_32FC4, 10.0},
+                        {"Float3Sigma40", CV_32FC3, 40.0}}),
+    [](const testing::TestParamInfo<RecursiveGaussianTest::ParamType>& info) {
+      return info.param.test_name;
+    });
+
+TEST(RecursiveGaussian, KeepsConstantImage) {
+  const cv::Mat img(100, 130, CV_8UC3, cv::Scalar(10, 100, 250));
+  cv::Mat got;
+  ASSERT_TRUE(RecursiveGaussianBlur(img, got, 30.0).ok());
+  cv::Mat difference;
+  cv::absdiff(got, img, difference);
+  double max_error = 0;
+  cv::minMaxLoc(difference.reshape(1), nullptr, &max_error);
+  EXPECT_THAT(max_error, Le(1.0));
+}
+
+TEST(RecursiveGaussian, RejectsUnsupportedInput) {
+  cv::Mat got;
+  EXPECT_FALSE(
+      RecursiveGaussianBlur(cv::Mat(10, 10, CV_16UC1), got, 5.0).ok());
+  EXPECT_FALSE(RecursiveGaussianBlur(cv::Mat(), got, 5.0).ok());
+  EXPECT_FALSE(
+      RecursiveGaussianBlur(cv::Mat(10, 10, CV_8UC1), got, -1.0).ok());
+}
+
+}  // namespace
+}  // namespace hello::misc
@@ -0,0 +1,187 @@
+#include "misc/stream_processor.h"
+#include <algorithm>
+#include <thread>
+#include <utility>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "glog/logging.h"
+#include "util/trace.h"
+
+namespace hello::misc {
+
+double StreamStats::fps() const {
+  const double seconds = absl::ToDoubleSeconds(elapsed);
+  return seconds > 0 ? frames_processed / seconds : 0;
+}
+
+StreamProcessor::StreamProcessor(std::string source, FrameFunction function,
+                                 int32_t queue_capacity, bool realtime)
+    : source_(std::move(source)),
+      function_(std::move(function)),
+      queue_capacity_(std::max(queue_capacity, 1)),
+      realtime_(realtime) {
+  stats_.source = source_;
+}
+
+absl::Status StreamProcessor::Open() {
+  if (!capture_.open(source_)) {
+    return absl::InternalError(absl::StrCat("Failed to open video - ", source_));
+  }
+  source_fps_ = capture_.get(cv::CAP_PROP_FPS);
+  if (source_fps_ <= 0) source_fps_ = 30;
+  start_ = absl::Now();
+  return absl::OkStatus();
+}
+
+bool StreamProcessor::Decode() {
+  TRACE_SCOPE("stream/decode");
+  cv::Mat frame;
+  if (!capture_.read(frame) || frame.empty()) {
+    end_of_stream_ = true;
+    return false;
+  }
+  queue_.push_back(std::move(frame));
+  int64_t dropped = 0;
+  while (static_cast<int32_t>(queue_.size()) > queue_capacity_) {
+    queue_.pop_front();
+    ++dropped;
+  }
+  absl::MutexLock lock(&mutex_);
+  ++stats_.frames_decoded;
+  stats_.frames_dropped += dropped;
+  stats_.queue_depth = static_cast<int32_t>(queue_.size());
+  stats_.max_queue_depth = std::max(stats_.max_queue_depth, stats_.queue_depth);
+  return true;
+}
+
+StreamProcessor::StepResult StreamProcessor::Step() {
+  if (!end_of_stream_) {
+    if (realtime_) {
+      // Everything the camera has produced by now.
+      const int64_t due = static_cast<int64_t>(
+          absl::ToDoubleSeconds(absl::Now() - start_) * source_fps_);
+      int64_t decoded = stats().frames_decoded;
+      while (decoded < due && Decode()) ++decoded;
+    } else if (queue_.empty()) {
+      Decode();
+    }
+  }
+  if (queue_.empty()) {
+    return end_of_stream_ ? StepResult::kFinished : StepResult::kIdle;
+  }
+
+  cv::Mat frame = std::move(queue_.front());
+  queue_.pop_front();
+  {
+    TRACE_SCOPE("stream/process");
+    function_(frame);
+  }
+
+  absl::MutexLock lock(&mutex_);
+  ++stats_.frames_processed;
+  stats_.queue_depth = static_cast<int32_t>(queue_.size());
+  stats_.elapsed = absl::Now() - start_;
+  return StepResult::kProcessed;
+}
+
+StreamStats StreamProcessor::stats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+MultiStreamRunner::MultiStreamRunner(int32_t num_threads)
+    : num_threads_(num_threads > 0
+                       ? num_threads
+                       : std::max<int32_t>(
+                             1, std::thread::hardware_concurrency())) {}
+
+void MultiStreamRunner::AddStream(std::unique_ptr<StreamProcessor> stream) {
+  streams_.push_back(std::move(stream));
+}
+
+absl::Status MultiStreamRunner::Run(absl::Duration report_interval) {
+  if (streams_.empty()) return absl::InvalidArgumentError("No streams");
+  for (auto& stream : streams_) {
+    if (const auto status = stream->Open(); !status.ok()) return status;
+  }
+  {
+    absl::MutexLock lock(&mutex_);
+    ready_.clear();
+    for (size_t i = 0; i < streams_.size(); ++i) ready_.push_back(i);
+    active_ = streams_.size();
+  }
+  LOG(INFO) << absl::StreamFormat("Running %d streams on %d threads",
+                                  streams_.size(), num_threads_);
+
+  const absl::Time start = absl::Now();
+  std::vector<std::thread> workers;
+  workers.reserve(num_threads_);
+  for (int32_t i = 0; i < num_threads_; ++i) {
+    workers.emplace_back(&MultiStreamRunner::Work, this);
+  }
+  for (;;) {
+    mutex_.Lock();
+    const bool done = mutex_.AwaitWithTimeout(
+        absl::Condition(this, &MultiStreamRunner::Done), report_interval);
+    mutex_.Unlock();
+    if (done) break;
+    Report();
+  }
+  for (auto& worker : workers) worker.join();
+
+  const double seconds = absl::ToDoubleSeconds(absl::Now() - start);
+  int64_t total = 0;
+  for (const auto& stats : Stats()) total += stats.frames_processed;
+  throughput_ = seconds > 0 ? total / seconds : 0;
+  Report();
+  LOG(INFO) << absl::StreamFormat(
+      "Processed %d frames in %.2f s, aggregate %.1f fps", total, seconds,
+      throughput_);
+  return absl::OkStatus();
+}
+
+void MultiStreamRunner::Work() {
+  for (;;) {
+    size_t index;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(this, &MultiStreamRunner::HasWork));
+      if (active_ == 0) return;
+      index = ready_.front();
+      ready_.pop_front();
+    }
+    const StreamProcessor::StepResult result = streams_[index]->Step();
+    {
+      absl::MutexLock lock(&mutex_);
+      if (result == StreamProcessor::StepResult::kFinished) {
+        --active_;
+      } else {
+        ready_.push_back(index);
+      }
+    }
+    // Realtime streams have nothing to do until the next frame is due.
+    if (result == StreamProcessor::StepResult::kIdle) {
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+  }
+}
+
+std::vector<StreamStats> MultiStreamRunner::Stats() const {
+  std::vector<StreamStats> stats;
+  stats.reserve(streams_.size());
+  for (const auto& stream : streams_) stats.push_back(stream->stats());
+  return stats;
+}
+
+void MultiStreamRunner::Report() const {
+  for (const auto& stats : Stats()) {
+    LOG(INFO) << absl::StreamFormat(
+        "%s: %6.1f fps, processed %d, decoded %d, dropped %d, queue %d "
+        "(max %d)",
+        stats.source, stats.fps(), stats.frames_processed,
+        stats.frames_decoded, stats.frames_dropped, stats.queue_depth,
+        stats.max_queue_depth);
+  }
+}
+
+}  // namespace hello::misc
@@ -0,0 +1,115 @@
+#ifndef MISC_STREAM_PROCESSOR_H_
+#define MISC_STREAM_PROCESSOR_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "opencv2/videoio.hpp"
+
+namespace hello::misc {
+
+// Per-frame work of a stream. Called from pool threads but never concurrently
+// for the same stream, so the function may keep per-stream state.
+using FrameFunction = std::function<void(const cv::Mat& frame)>;
+
+struct StreamStats {
+  std::string source;
+  int64_t frames_decoded = 0;
+  int64_t frames_processed = 0;
+  // Frames that were decoded but pushed out of the full queue.
+  int64_t frames_dropped = 0;
+  int32_t queue_depth = 0;
+  int32_t max_queue_depth = 0;
+  absl::Duration elapsed;
+
+  double fps() const;
+};
+
+// One video source with its own capture, frame queue and statistics, there is
+// no shared state between instances.
+class StreamProcessor {
+ public:
+  enum class StepResult { kProcessed, kIdle, kFinished };
+
+  // * queue_capacity - decoded frames waiting to be processed, the oldest one
+  //   is dropped when a new frame does not fit
+  // * realtime - frames become available at the source frame rate as they
+  //   would from a camera, otherwise as fast as they are consumed
+  StreamProcessor(std::string source, FrameFunction function,
+                  int32_t queue_capacity = 4, bool realtime = false);
+
+  absl::Status Open();
+
+  // Decodes the frames that are due and processes the oldest queued one.
+  // Must not be called concurrently for the same instance.
+  StepResult Step();
+
+  // Safe to call from any thread.
+  StreamStats stats() const;
+
+ private:
+  // Returns false at the end of the stream.
+  bool Decode();
+
+  const std::string source_;
+  const FrameFunction function_;
+  const int32_t queue_capacity_;
+  const bool realtime_;
+  cv::VideoCapture capture_;
+  double source_fps_ = 0;
+  bool end_of_stream_ = false;
+  absl::Time start_;
+  std::deque<cv::Mat> queue_;
+
+  mutable absl::Mutex mutex_;
+  StreamStats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Multiplexes many streams over one pool of worker threads. Streams are
+// served round robin one frame at a time so that a fast source cannot starve
+// the others, and a stream is never stepped by two workers at once.
+class MultiStreamRunner {
+ public:
+  // * num_threads - zero means one per hardware thread
+  explicit MultiStreamRunner(int32_t num_threads = 0);
+
+  void AddStream(std::unique_ptr<StreamProcessor> stream);
+
+  // Opens all the streams and runs them to the end, logging the statistics
+  // every `report_interval`.
+  absl::Status Run(absl::Duration report_interval = absl::Seconds(1));
+
+  std::vector<StreamStats> Stats() const;
+
+  // Total processed frames per second of the last Run().
+  double throughput() const { return throughput_; }
+
+ private:
+  void Work();
+  void Report() const;
+  bool HasWork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return !ready_.empty() || active_ == 0;
+  }
+  bool Done() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return active_ == 0;
+  }
+
+  const int32_t num_threads_;
+  std::vector<std::unique_ptr<StreamProcessor>> streams_;
+  double throughput_ = 0;
+
+  absl::Mutex mutex_;
+  std::deque<size_t> ready_ ABSL_GUARDED_BY(mutex_);
+  size_t active_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace hello::misc
+
+#endif  // MISC_STREAM_PROCESSOR_H_
@@ -0,0 +1,140 @@
+// ColorQuantizer against cv::kmeans over all pixels on an image scaled up
+// to --megapixels, reporting time and PSNR to the original for both.
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "ml/color_quantizer.h"
+#include "opencv2/core.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/imgproc.hpp"
+#include "status_macros.h"
+
+ABSL_FLAG(std::string, image_path, "testdata/starry_night.jpg",
+          "Image to quantize");
+ABSL_FLAG(double, megapixels, 24, "The image is resized to this many pixels");
+ABSL_FLAG(int32_t, colors, 16, "Palette size, at most 256");
+ABSL_FLAG(int32_t, sample_size, 100000, "Pixels the palette is fitted on");
+ABSL_FLAG(int32_t, lut_bits, 5, "Lookup table bits per channel");
+ABSL_FLAG(bool, cv_kmeans, true, "Also run cv::kmeans on all pixels");
+ABSL_FLAG(int32_t, iterations, 100,
+          "Iterations at most, of the palette fit and of cv::kmeans");
+ABSL_FLAG(double, epsilon, 1e-3,
+          "Both k-means stop once no center moves further than this");
+ABSL_FLAG(std::string, output_path, "",
+          "If set, the quantized image is written there");
+
+namespace {
+
+double Milliseconds(int64 start) {
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+double Psnr(const cv::Mat& original, const cv::Mat& quantized) {
+  const double mse = cv::norm(original, quantized, cv::NORM_L2SQR) /
+                     (static_cast<double>(original.total()) * 3);
+  if (mse == 0) return std::numeric_limits<double>::infinity();
+  return 10 * std::log10(255.0 * 255.0 / mse);
+}
+
+void Report(const std::string& method, double fit_ms, double assign_ms,
+            double psnr) {
+  LOG(INFO) << absl::StreamFormat("%-16s %10.1f %10.1f %10.1f %8.2f", method,
+                                  fit_ms, assign_ms, fit_ms + assign_ms, psnr);
+}
+
+// cv::kmeans on every pixel, the baseline.
+cv::Mat KMeansAllPixels(const cv::Mat& image, int32_t colors,
+                        double& fit_ms, double& assign_ms) {
+  int64 start = cv::getTickCount();
+  cv::Mat points;
+  image.reshape(1, static_cast<int>(image.total())).convertTo(points, CV_32F);
+  cv::Mat labels;
+  cv::Mat centers;
+  cv::kmeans(points, colors, labels,
+             cv::TermCriteria(cv::TermCriteria::EPS | cv::TermCriteria::COUNT,
+                              absl::GetFlag(FLAGS_iterations),
+                              absl::GetFlag(FLAGS_epsilon)),
+             1, cv::KMEANS_PP_CENTERS, centers);
+  fit_ms = Milliseconds(start);
+  start = cv::getTickCount();
+  cv::Mat quantized(image.size(), CV_8UC3);
+  cv::Vec3b* out = quantized.ptr<cv::Vec3b>();
+  for (size_t i = 0; i < image.total(); ++i) {
+    const float* center = centers.ptr<float>(labels.at<int>(i));
+    out[i] = cv::Vec3b(cv::saturate_cast<uint8_t>(center[0]),
+                       cv::saturate_cast<uint8_t>(center[1]),
+                       cv::saturate_cast<uint8_t>(center[2]));
+  }
+  assign_ms = Milliseconds(start);
+  return quantized;
+}
+
+}  // namespace
+
+absl::Status Run() {
+  const std::string path = absl::GetFlag(FLAGS_image_path);
+  const cv::Mat original = cv::imread(path, cv::IMREAD_COLOR);
+  if (original.empty()) {
+    return absl::NotFoundError(absl::StrCat("No image - ", path));
+  }
+  const double scale = std::sqrt(absl::GetFlag(FLAGS_megapixels) * 1e6 /
+                                 original.total());
+  cv::Mat image;
+  cv::resize(original, image, cv::Size(), scale, scale, cv::INTER_LINEAR);
+  LOG(INFO) << absl::StreamFormat("%s at %dx%d, %.1f megapixels", path,
+                                  image.cols, image.rows,
+                                  image.total() / 1e6);
+
+  hello::ml::ColorQuantizer::Options options;
+  options.colors = absl::GetFlag(FLAGS_colors);
+  options.sample_size = absl::GetFlag(FLAGS_sample_size);
+  options.lut_bits = absl::GetFlag(FLAGS_lut_bits);
+  options.kmeans.max_iterations = absl::GetFlag(FLAGS_iterations);
+  options.kmeans.epsilon = absl::GetFlag(FLAGS_epsilon);
+  int64 start = cv::getTickCount();
+  ASSIGN_OR_RETURN(const std::unique_ptr<hello::ml::ColorQuantizer> quantizer,
+                   hello::ml::ColorQuantizer::Fit(image, options));
+  const double fit_ms = Milliseconds(start);
+  start = cv::getTickCount();
+  ASSIGN_OR_RETURN(const cv::Mat quantized, quantizer->Quantize(image));
+  const double assign_ms = Milliseconds(start);
+
+  LOG(INFO) << absl::StreamFormat(
+      "%.2f palette colors per lookup table cell",
+      quantizer->mean_candidates());
+  LOG(INFO) << absl::StreamFormat("%-16s %10s %10s %10s %8s", "method",
+                                  "fit_ms", "assign_ms", "total_ms", "psnr");
+  Report("sample+lut", fit_ms, assign_ms, Psnr(image, quantized));
+  if (absl::GetFlag(FLAGS_cv_kmeans)) {
+    double cv_fit_ms = 0;
+    double cv_assign_ms = 0;
+    const cv::Mat cv_quantized =
+        KMeansAllPixels(image, options.colors, cv_fit_ms, cv_assign_ms);
+    Report("cv::kmeans", cv_fit_ms, cv_assign_ms, Psnr(image, cv_quantized));
+  }
+  const std::string output_path = absl::GetFlag(FLAGS_output_path);
+  if (!output_path.empty() && !cv::imwrite(output_path, quantized)) {
+    return absl::InternalError(absl::StrCat("Can't write ", output_path));
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
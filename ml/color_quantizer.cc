@@ -0,0 +1,196 @@
+#include "ml/color_quantizer.h"
+#include <algorithm>
+#include <limits>
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "status_macros.h"
+#include "util/trace.h"
+
+namespace hello::ml {
+namespace {
+
+// Cells whose candidates one task lists.
+constexpr int32_t kCellBlock = 4096;
+
+int32_t SquaredDistance(const cv::Vec3b& a, int32_t b, int32_t g, int32_t r) {
+  const int32_t db = a[0] - b;
+  const int32_t dg = a[1] - g;
+  const int32_t dr = a[2] - r;
+  return db * db + dg * dg + dr * dr;
+}
+
+absl::Status CheckImage(const cv::Mat& image) {
+  if (image.empty() || image.type() != CV_8UC3) {
+    return absl::InvalidArgumentError("Image must be non empty CV_8UC3");
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<ColorQuantizer>> ColorQuantizer::Fit(
+    const cv::Mat& image, const Options& options) {
+  TRACE_SCOPE("ml/color_quantizer_fit");
+  RETURN_IF_ERROR(CheckImage(image));
+  const int64_t num_pixels = image.total();
+  // Every pixel when there are fewer than the sample size.
+  const bool sample = num_pixels > options.sample_size;
+  const int32_t n =
+      static_cast<int32_t>(sample ? options.sample_size : num_pixels);
+  cv::Mat points(n, 3, CV_32F);
+  cv::RNG rng(options.seed);
+  for (int32_t i = 0; i < n; ++i) {
+    const int64_t pixel =
+        sample ? static_cast<int64_t>(rng.uniform(0.0, 1.0) * num_pixels) : i;
+    const cv::Vec3b& color = image.at<cv::Vec3b>(
+        static_cast<int>(pixel / image.cols),
+        static_cast<int>(pixel % image.cols));
+    float* point = points.ptr<float>(i);
+    for (int32_t c = 0; c < 3; ++c) point[c] = color[c];
+  }
+  KMeansEngine::Options kmeans = options.kmeans;
+  kmeans.seed = options.seed;
+  ASSIGN_OR_RETURN(const KMeansResult clusters,
+                   KMeansEngine(kmeans).Cluster(points, options.colors));
+  std::vector<cv::Vec3b> palette(options.colors);
+  for (int32_t j = 0; j < options.colors; ++j) {
+    const float* center = clusters.centers.ptr<float>(j);
+    for (int32_t c = 0; c < 3; ++c) {
+      palette[j][c] = cv::saturate_cast<uint8_t>(center[c]);
+    }
+  }
+  return FromPalette(palette, options.lut_bits);
+}
+
+absl::StatusOr<std::unique_ptr<ColorQuantizer>> ColorQuantizer::FromPalette(
+    const std::vector<cv::Vec3b>& palette, int32_t lut_bits) {
+  if (palette.empty() || palette.size() > kMaxColors) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Palette of %d colors, 1 to %d supported", palette.size(),
+        kMaxColors));
+  }
+  if (lut_bits < 1 || lut_bits > 8) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Bad lookup table bits %d", lut_bits));
+  }
+  return std::unique_ptr<ColorQuantizer>(
+      new ColorQuantizer(palette, lut_bits));
+}
+
+ColorQuantizer::ColorQuantizer(const std::vector<cv::Vec3b>& palette,
+                               int32_t lut_bits)
+    : palette_(palette), lut_bits_(lut_bits) {
+  TRACE_SCOPE("ml/color_quantizer_lut");
+  const int32_t shift = 8 - lut_bits_;
+  const int32_t side = 1 << lut_bits_;
+  const int32_t num_cells = side * side * side;
+  const int32_t num_colors = static_cast<int32_t>(palette_.size());
+  const int32_t num_blocks = (num_cells + kCellBlock - 1) / kCellBlock;
+  offsets_.assign(num_cells + 1, 0);
+  std::vector<std::vector<uint8_t>> block_candidates(num_blocks);
+  cv::parallel_for_(cv::Range(0, num_blocks), [&](const cv::Range& range) {
+    std::vector<int32_t> nearest(num_colors);
+    for (int32_t block = range.start; block < range.end; ++block) {
+      const int32_t end = std::min(num_cells, (block + 1) * kCellBlock);
+      for (int32_t cell = block * kCellBlock; cell < end; ++cell) {
+        const int32_t lo[3] = {(cell >> (2 * lut_bits_)) << shift,
+                               ((cell >> lut_bits_) & (side - 1)) << shift,
+                               (cell & (side - 1)) << shift};
+        const int32_t hi = (1 << shift) - 1;
+        // Every color of the cell is within `bound` of some palette color.
+        int32_t bound = std::numeric_limits<int32_t>::max();
+        for (int32_t j = 0; j < num_colors; ++j) {
+          int32_t farthest = 0;
+          nearest[j] = 0;
+          for (int32_t c = 0; c < 3; ++c) {
+            const int32_t v = palette_[j][c];
+            const int32_t below = std::max(lo[c] - v, 0);
+            const int32_t above = std::max(v - (lo[c] + hi), 0);
+            const int32_t gap = below + above;
+            nearest[j] += gap * gap;
+            const int32_t far = std::max(v - lo[c], lo[c] + hi - v);
+            farthest += far * far;
+          }
+          bound = std::min(bound, farthest);
+        }
+        for (int32_t j = 0; j < num_colors; ++j) {
+          if (nearest[j] <= bound) {
+            block_candidates[block].push_back(static_cast<uint8_t>(j));
+            ++offsets_[cell + 1];
+          }
+        }
+      }
+    }
+  });
+  for (int32_t cell = 0; cell < num_cells; ++cell) {
+    offsets_[cell + 1] += offsets_[cell];
+  }
+  candidates_.reserve(offsets_.back());
+  for (const std::vector<uint8_t>& block : block_candidates) {
+    candidates_.insert(candidates_.end(), block.begin(), block.end());
+  }
+}
+
+double ColorQuantizer::mean_candidates() const {
+  return static_cast<double>(candidates_.size()) / (offsets_.size() - 1);
+}
+
+template <typename Store>
+void ColorQuantizer::ForEachLabel(const cv::Mat& image, Store&& store) const {
+  const int32_t shift = 8 - lut_bits_;
+  cv::parallel_for_(cv::Range(0, image.rows), [&](const cv::Range& range) {
+    std::vector<int32_t> cells(image.cols);
+    for (int32_t y = range.start; y < range.end; ++y) {
+      const uint8_t* __restrict pixels = image.ptr<uint8_t>(y);
+      // A plain loop over the row that the compiler vectorizes.
+      int32_t* __restrict row_cells = cells.data();
+      for (int32_t x = 0; x < image.cols; ++x) {
+        row_cells[x] = ((pixels[3 * x] >> shift) << (2 * lut_bits_)) |
+                       ((pixels[3 * x + 1] >> shift) << lut_bits_) |
+                       (pixels[3 * x + 2] >> shift);
+      }
+      for (int32_t x = 0; x < image.cols; ++x) {
+        const int32_t begin = offsets_[row_cells[x]];
+        const int32_t end = offsets_[row_cells[x] + 1];
+        uint8_t label = candidates_[begin];
+        if (end - begin > 1) {
+          const int32_t b = pixels[3 * x];
+          const int32_t g = pixels[3 * x + 1];
+          const int32_t r = pixels[3 * x + 2];
+          int32_t best = SquaredDistance(palette_[label], b, g, r);
+          for (int32_t i = begin + 1; i < end; ++i) {
+            const int32_t d =
+                SquaredDistance(palette_[candidates_[i]], b, g, r);
+            if (d < best) {
+              best = d;
+              label = candidates_[i];
+            }
+          }
+        }
+        store(y, x, label);
+      }
+    }
+  });
+}
+
+absl::StatusOr<cv::Mat> ColorQuantizer::Labels(const cv::Mat& image) const {
+  TRACE_SCOPE("ml/color_quantizer_labels");
+  RETURN_IF_ERROR(CheckImage(image));
+  cv::Mat labels(image.size(), CV_8U);
+  ForEachLabel(image, [&](int32_t y, int32_t x, uint8_t label) {
+    labels.ptr<uint8_t>(y)[x] = label;
+  });
+  return labels;
+}
+
+absl::StatusOr<cv::Mat> ColorQuantizer::Quantize(const cv::Mat& image) const {
+  TRACE_SCOPE("ml/color_quantizer_quantize");
+  RETURN_IF_ERROR(CheckImage(image));
+  cv::Mat quantized(image.size(), CV_8UC3);
+  ForEachLabel(image, [&](int32_t y, int32_t x, uint8_t label) {
+    quantized.ptr<cv::Vec3b>(y)[x] = palette_[label];
+  });
+  return quantized;
+}
+
+}  // namespace hello::ml
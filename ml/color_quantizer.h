@@ -0,0 +1,69 @@
+#ifndef ML_COLOR_QUANTIZER_H_
+#define ML_COLOR_QUANTIZER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "absl/status/statusor.h"
+#include "ml/kmeans_engine.h"
+#include "opencv2/core.hpp"
+
+namespace hello::ml {
+
+// Reduces BGR images to a palette of at most 256 colors. The palette is
+// fitted by KMeansEngine on a random sample of the pixels. Pixels are then
+// mapped through a lookup table over the color cube, cut into 2^lut_bits
+// cells per channel: every cell lists the palette colors that can be the
+// nearest to some color in it, those within the smallest farthest
+// distance from the cell of any palette color. Most cells list a single
+// color, so most pixels take one lookup, the others compare the few colors
+// listed. The mapping is the exact nearest palette color, ties going to
+// the lowest index. Rows are mapped in parallel.
+class ColorQuantizer {
+ public:
+  struct Options {
+    int32_t colors = 16;
+    // Pixels the palette is fitted on, drawn with replacement.
+    int32_t sample_size = 100000;
+    uint64_t seed = 0x5eed;
+    int32_t lut_bits = 5;
+    KMeansEngine::Options kmeans;
+  };
+
+  static constexpr int32_t kMaxColors = 256;
+
+  // From a CV_8UC3 image.
+  static absl::StatusOr<std::unique_ptr<ColorQuantizer>> Fit(
+      const cv::Mat& image, const Options& options);
+  static absl::StatusOr<std::unique_ptr<ColorQuantizer>> FromPalette(
+      const std::vector<cv::Vec3b>& palette, int32_t lut_bits);
+
+  // CV_8U index in the palette of every pixel of a CV_8UC3 image.
+  absl::StatusOr<cv::Mat> Labels(const cv::Mat& image) const;
+  // The image with every pixel replaced by its palette color.
+  absl::StatusOr<cv::Mat> Quantize(const cv::Mat& image) const;
+
+  const std::vector<cv::Vec3b>& palette() const { return palette_; }
+  // Palette colors listed per cell, on average. 1 means one lookup per
+  // pixel.
+  double mean_candidates() const;
+
+ private:
+  ColorQuantizer(const std::vector<cv::Vec3b>& palette, int32_t lut_bits);
+
+  // Calls store(row, column, label) for every pixel of the image.
+  template <typename Store>
+  void ForEachLabel(const cv::Mat& image, Store&& store) const;
+
+  const std::vector<cv::Vec3b> palette_;
+  const int32_t lut_bits_;
+  // The palette colors of cell c are candidates_[offsets_[c]] up to
+  // candidates_[offsets_[c + 1]]. Cells are indexed by the high bits of
+  // B, G and R, in that order.
+  std::vector<int32_t> offsets_;
+  std::vector<uint8_t> candidates_;
+};
+
+}  // namespace hello::ml
+
+#endif  // ML_COLOR_QUANTIZER_H_
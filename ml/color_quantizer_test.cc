@@ -0,0 +1,110 @@
+#include "ml/color_quantizer.h"
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+
+namespace hello::ml {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Le;
+
+int32_t BruteForceLabel(const std::vector<cv::Vec3b>& palette,
+                        const cv::Vec3b& color) {
+  int32_t best = 0;
+  int32_t best_distance = std::numeric_limits<int32_t>::max();
+  for (size_t j = 0; j < palette.size(); ++j) {
+    int32_t distance = 0;
+    for (int32_t c = 0; c < 3; ++c) {
+      const int32_t d = palette[j][c] - color[c];
+      distance += d * d;
+    }
+    if (distance < best_distance) {
+      best_distance = distance;
+      best = static_cast<int32_t>(j);
+    }
+  }
+  return best;
+}
+
+TEST(ColorQuantizer, LabelsAreTheNearestPaletteColor) {
+  cv::RNG rng(3);
+  std::vector<cv::Vec3b> palette(37);
+  for (cv::Vec3b& color : palette) {
+    for (int32_t c = 0; c < 3; ++c) color[c] = rng.uniform(0, 256);
+  }
+  // Duplicates tie, the lowest index wins.
+  palette[20] = palette[3];
+  cv::Mat image(96, 128, CV_8UC3);
+  for (int32_t y = 0; y < image.rows; ++y) {
+    for (int32_t x = 0; x < image.cols; ++x) {
+      cv::Vec3b& color = image.at<cv::Vec3b>(y, x);
+      for (int32_t c = 0; c < 3; ++c) color[c] = rng.uniform(0, 256);
+    }
+  }
+  for (int32_t lut_bits : {1, 4, 6}) {
+    absl::StatusOr<std::unique_ptr<ColorQuantizer>> quantizer =
+        ColorQuantizer::FromPalette(palette, lut_bits);
+    ASSERT_TRUE(quantizer.ok()) << quantizer.status();
+    absl::StatusOr<cv::Mat> labels = (*quantizer)->Labels(image);
+    ASSERT_TRUE(labels.ok()) << labels.status();
+    int32_t mismatches = 0;
+    for (int32_t y = 0; y < image.rows; ++y) {
+      for (int32_t x = 0; x < image.cols; ++x) {
+        mismatches += labels->at<uint8_t>(y, x) !=
+                      BruteForceLabel(palette, image.at<cv::Vec3b>(y, x));
+      }
+    }
+    EXPECT_THAT(mismatches, Eq(0)) << lut_bits << " bits";
+  }
+}
+
+TEST(ColorQuantizer, FitReproducesFewColors) {
+  const cv::Vec3b colors[] = {cv::Vec3b(10, 20, 30), cv::Vec3b(200, 40, 40),
+                              cv::Vec3b(30, 220, 90), cv::Vec3b(250, 250, 0)};
+  cv::Mat image(200, 300, CV_8UC3);
+  for (int32_t y = 0; y < image.rows; ++y) {
+    for (int32_t x = 0; x < image.cols; ++x) {
+      image.at<cv::Vec3b>(y, x) = colors[(y / 50 + x / 75) % 4];
+    }
+  }
+  ColorQuantizer::Options options;
+  options.colors = 4;
+  options.sample_size = 5000;
+  absl::StatusOr<std::unique_ptr<ColorQuantizer>> quantizer =
+      ColorQuantizer::Fit(image, options);
+  ASSERT_TRUE(quantizer.ok()) << quantizer.status();
+  // A color cell holds few colors.
+  EXPECT_THAT((*quantizer)->mean_candidates(), Le(2));
+  absl::StatusOr<cv::Mat> quantized = (*quantizer)->Quantize(image);
+  ASSERT_TRUE(quantized.ok()) << quantized.status();
+  int32_t changed = 0;
+  for (int32_t y = 0; y < image.rows; ++y) {
+    for (int32_t x = 0; x < image.cols; ++x) {
+      changed +=
+          quantized->at<cv::Vec3b>(y, x) != image.at<cv::Vec3b>(y, x);
+    }
+  }
+  EXPECT_THAT(changed, Eq(0));
+}
+
+TEST(ColorQuantizer, RejectsBadInput) {
+  EXPECT_FALSE(ColorQuantizer::FromPalette({}, 5).ok());
+  EXPECT_FALSE(
+      ColorQuantizer::FromPalette(std::vector<cv::Vec3b>(257), 5).ok());
+  EXPECT_FALSE(
+      ColorQuantizer::FromPalette(std::vector<cv::Vec3b>(4), 0).ok());
+  absl::StatusOr<std::unique_ptr<ColorQuantizer>> quantizer =
+      ColorQuantizer::FromPalette(std::vector<cv::Vec3b>(4), 5);
+  ASSERT_TRUE(quantizer.ok()) << quantizer.status();
+  EXPECT_FALSE((*quantizer)->Labels(cv::Mat(4, 4, CV_8U)).ok());
+  EXPECT_FALSE(
+      ColorQuantizer::Fit(cv::Mat(4, 4, CV_32F), ColorQuantizer::Options())
+          .ok());
+}
+
+}  // namespace
+}  // namespace hello::ml
@@ -0,0 +1,123 @@
+// LoadCsv against cv::ml::TrainData::loadFromCSV on a CSV file, repeated
+// --copies times into a scratch file to reach training set sizes.
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "ml/csv_loader.h"
+#include "opencv2/core.hpp"
+#include "opencv2/ml.hpp"
+#include "status_macros.h"
+
+ABSL_FLAG(std::string, csv_path, "testdata/mushroom/agaricus-lepiota.data",
+          "CSV file without header");
+ABSL_FLAG(int32_t, copies, 200, "Copies of the file loaded at once");
+ABSL_FLAG(std::string, scratch_path, "/tmp/csv_benchmark.csv",
+          "Where the copies are written");
+ABSL_FLAG(int32_t, response_column, 0, "Column of the responses");
+ABSL_FLAG(bool, all_categorical, true, "Treat all columns as categorical");
+ABSL_FLAG(int32_t, repeats, 3, "Loads per loader, the fastest is reported");
+ABSL_FLAG(int64_t, chunk_size, 8 << 20, "Bytes per LoadCsv parse task");
+
+namespace {
+
+double Milliseconds(int64 start) {
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+absl::Status WriteCopies(const std::string& from, const std::string& to,
+                         int32_t copies) {
+  std::ifstream in(from, std::ios::binary);
+  if (!in) return absl::NotFoundError(absl::StrCat("No file ", from));
+  std::stringstream contents;
+  contents << in.rdbuf();
+  std::string text = contents.str();
+  if (!text.empty() && text.back() != '\n') text.push_back('\n');
+  std::ofstream out(to, std::ios::binary);
+  for (int32_t i = 0; i < copies && out; ++i) out << text;
+  if (!out) return absl::InternalError(absl::StrCat("Can't write ", to));
+  return absl::OkStatus();
+}
+
+void Report(const std::string& loader, double ms, int rows, double bytes) {
+  LOG(INFO) << absl::StreamFormat("%-14s %10.1f %10d %10.1f", loader, ms,
+                                  rows, bytes / (1 << 20) / (ms / 1000));
+}
+
+}  // namespace
+
+absl::Status Run() {
+  std::string path = absl::GetFlag(FLAGS_csv_path);
+  const int32_t copies = absl::GetFlag(FLAGS_copies);
+  if (copies > 1) {
+    const std::string scratch = absl::GetFlag(FLAGS_scratch_path);
+    RETURN_IF_ERROR(WriteCopies(path, scratch, copies));
+    path = scratch;
+  }
+  std::error_code error;
+  const double bytes = std::filesystem::file_size(path, error);
+  if (error) return absl::NotFoundError(absl::StrCat("No file ", path));
+
+  hello::ml::CsvOptions options;
+  options.response_column = absl::GetFlag(FLAGS_response_column);
+  options.all_categorical = absl::GetFlag(FLAGS_all_categorical);
+  options.chunk_size = absl::GetFlag(FLAGS_chunk_size);
+  const int32_t repeats = std::max(1, absl::GetFlag(FLAGS_repeats));
+  double load_csv_ms = std::numeric_limits<double>::max();
+  int load_csv_rows = 0;
+  int32_t num_columns = 0;
+  for (int32_t i = 0; i < repeats; ++i) {
+    const int64 start = cv::getTickCount();
+    ASSIGN_OR_RETURN(const hello::ml::CsvData data,
+                     hello::ml::LoadCsv(path, options));
+    load_csv_ms = std::min(load_csv_ms, Milliseconds(start));
+    load_csv_rows = data.train_data->getNSamples();
+    num_columns = static_cast<int32_t>(data.categories.size());
+  }
+
+  const std::string var_types =
+      options.all_categorical ? absl::StrFormat("cat[0-%d]", num_columns - 1)
+                              : "";
+  double cv_ms = std::numeric_limits<double>::max();
+  int cv_rows = 0;
+  for (int32_t i = 0; i < repeats; ++i) {
+    const int64 start = cv::getTickCount();
+    const cv::Ptr<cv::ml::TrainData> data = cv::ml::TrainData::loadFromCSV(
+        path, 0, options.response_column, options.response_column + 1,
+        var_types);
+    cv_ms = std::min(cv_ms, Milliseconds(start));
+    cv_rows = data.empty() ? 0 : data->getNSamples();
+  }
+
+  LOG(INFO) << absl::StreamFormat("%s, %.1f MB", path, bytes / (1 << 20));
+  LOG(INFO) << absl::StreamFormat("%-14s %10s %10s %10s", "loader", "ms",
+                                  "rows", "MB/s");
+  Report("loadFromCSV", cv_ms, cv_rows, bytes);
+  Report("LoadCsv", load_csv_ms, load_csv_rows, bytes);
+  if (cv_rows != load_csv_rows) {
+    return absl::InternalError(absl::StrFormat(
+        "Row counts differ, %d vs %d", cv_rows, load_csv_rows));
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,317 @@
+#include "ml/csv_loader.h"
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "util/trace.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace hello::ml {
+namespace {
+
+// The file contents, memory-mapped read-only, read into memory where mmap
+// isn't available.
+class MappedFile {
+ public:
+  static absl::StatusOr<std::unique_ptr<MappedFile>> Open(
+      const std::string& path) {
+    auto file = absl::WrapUnique(new MappedFile());
+#ifndef _WIN32
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return absl::NotFoundError(absl::StrCat("No file ", path));
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+      ::close(fd);
+      return absl::InvalidArgumentError(absl::StrCat("Empty file ", path));
+    }
+    void* data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+      return absl::InternalError(absl::StrCat("Can't map ", path));
+    }
+    // Read once from start to end.
+    ::madvise(data, st.st_size, MADV_SEQUENTIAL);
+    file->data_ = static_cast<const char*>(data);
+    file->size_ = st.st_size;
+    file->mapped_ = true;
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return absl::NotFoundError(absl::StrCat("No file ", path));
+    file->buffer_.resize(static_cast<size_t>(in.tellg()));
+    if (file->buffer_.empty()) {
+      return absl::InvalidArgumentError(absl::StrCat("Empty file ", path));
+    }
+    in.seekg(0);
+    if (!in.read(file->buffer_.data(), file->buffer_.size())) {
+      return absl::DataLossError(absl::StrCat("Can't read ", path));
+    }
+    file->data_ = file->buffer_.data();
+    file->size_ = file->buffer_.size();
+#endif
+    return file;
+  }
+
+  ~MappedFile() {
+#ifndef _WIN32
+    if (mapped_) ::munmap(const_cast<char*>(data_), size_);
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  absl::string_view contents() const { return {data_, size_}; }
+
+ private:
+  MappedFile() = default;
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  bool mapped_ = false;
+  std::vector<char> buffer_;
+};
+
+// Cuts the first line off `text`.
+absl::string_view NextLine(absl::string_view& text) {
+  const size_t end = text.find('\n');
+  const absl::string_view line = text.substr(0, end);
+  text.remove_prefix(end == absl::string_view::npos ? text.size() : end + 1);
+  return line;
+}
+
+void SplitFields(absl::string_view line, char delimiter,
+                 std::vector<absl::string_view>& fields) {
+  fields.clear();
+  for (absl::string_view field : absl::StrSplit(line, delimiter)) {
+    fields.push_back(absl::StripAsciiWhitespace(field));
+  }
+}
+
+// Lines of the file parsed by one task.
+struct Chunk {
+  absl::string_view text;
+  // Lines read, blank ones included, up to the failing one if any.
+  int64_t lines = 0;
+  int64_t rows = 0;
+  // Row major, categorical values are codes in `categories`.
+  std::vector<float> values;
+  // Per column, the categories in order of first appearance in the chunk.
+  std::vector<std::vector<absl::string_view>> categories;
+  // Per column, the merged code of every chunk code.
+  std::vector<std::vector<int32_t>> codes;
+  absl::Status status;
+};
+
+void ParseChunk(const CsvOptions& options,
+                const std::vector<uint8_t>& categorical, Chunk& chunk) {
+  const size_t num_columns = categorical.size();
+  std::vector<absl::flat_hash_map<absl::string_view, int32_t>> dictionaries(
+      num_columns);
+  chunk.categories.resize(num_columns);
+  std::vector<absl::string_view> fields;
+  absl::string_view text = chunk.text;
+  while (!text.empty()) {
+    const absl::string_view line =
+        absl::StripAsciiWhitespace(NextLine(text));
+    ++chunk.lines;
+    if (line.empty()) continue;
+    SplitFields(line, options.delimiter, fields);
+    if (fields.size() != num_columns) {
+      chunk.status = absl::InvalidArgumentError(absl::StrFormat(
+          "%d fields, expected %d", fields.size(), num_columns));
+      return;
+    }
+    for (size_t c = 0; c < num_columns; ++c) {
+      const absl::string_view field = fields[c];
+      float value;
+      if (categorical[c]) {
+        const auto [it, inserted] = dictionaries[c].try_emplace(
+            field, static_cast<int32_t>(chunk.categories[c].size()));
+        if (inserted) chunk.categories[c].push_back(field);
+        value = static_cast<float>(it->second);
+      } else if (field.size() == 1 && field[0] == options.missing) {
+        value = cv::ml::TrainData::missingValue();
+      } else if (!absl::SimpleAtof(field, &value)) {
+        chunk.status = absl::InvalidArgumentError(absl::StrFormat(
+            "Column %d, '%s' is not a number", c, field));
+        return;
+      }
+      chunk.values.push_back(value);
+    }
+    ++chunk.rows;
+  }
+}
+
+}  // namespace
+
+absl::StatusOr<CsvData> LoadCsv(absl::string_view path,
+                                const CsvOptions& options) {
+  TRACE_SCOPE("ml/load_csv");
+  const std::string file_path(path);
+  absl::StatusOr<std::unique_ptr<MappedFile>> file =
+      MappedFile::Open(file_path);
+  if (!file.ok()) return file.status();
+  if (options.chunk_size < 1) {
+    return absl::InvalidArgumentError("Chunk size must be positive");
+  }
+  absl::string_view text = (*file)->contents();
+  for (int32_t i = 0; i < options.header_lines; ++i) NextLine(text);
+
+  // The first row sets the columns and their types.
+  absl::string_view rest = text;
+  absl::string_view first_row;
+  while (!rest.empty() && first_row.empty()) {
+    first_row = absl::StripAsciiWhitespace(NextLine(rest));
+  }
+  if (first_row.empty()) {
+    return absl::InvalidArgumentError(absl::StrCat("No rows in ", file_path));
+  }
+  std::vector<absl::string_view> fields;
+  SplitFields(first_row, options.delimiter, fields);
+  const int32_t num_columns = static_cast<int32_t>(fields.size());
+  if (num_columns < 2) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "%s has %d column, an input and a response are needed", file_path,
+        num_columns));
+  }
+  const int32_t response_column = options.response_column < 0
+                                      ? num_columns - 1
+                                      : options.response_column;
+  if (response_column >= num_columns) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Response column %d of %d", response_column, num_columns));
+  }
+  std::vector<uint8_t> categorical(num_columns, options.all_categorical);
+  for (int32_t column : options.categorical_columns) {
+    if (column < 0 || column >= num_columns) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Categorical column %d of %d", column, num_columns));
+    }
+    categorical[column] = 1;
+  }
+  for (int32_t c = 0; c < num_columns; ++c) {
+    float value;
+    const bool missing =
+        fields[c].size() == 1 && fields[c][0] == options.missing;
+    if (!missing && !absl::SimpleAtof(fields[c], &value)) categorical[c] = 1;
+  }
+
+  std::vector<Chunk> chunks;
+  while (!text.empty()) {
+    size_t end = std::min<size_t>(text.size(), options.chunk_size);
+    const size_t line_end = text.find('\n', end - 1);
+    end = line_end == absl::string_view::npos ? text.size() : line_end + 1;
+    chunks.emplace_back().text = text.substr(0, end);
+    text.remove_prefix(end);
+  }
+  {
+    TRACE_SCOPE("ml/load_csv/parse");
+    cv::parallel_for_(cv::Range(0, static_cast<int>(chunks.size())),
+                      [&](const cv::Range& range) {
+                        for (int i = range.start; i < range.end; ++i) {
+                          ParseChunk(options, categorical, chunks[i]);
+                        }
+                      });
+  }
+
+  // Merges the dictionaries, in file order so that codes don't depend on
+  // the chunks.
+  CsvData data;
+  data.response_column = response_column;
+  data.categories.resize(num_columns);
+  std::vector<absl::flat_hash_map<absl::string_view, int32_t>> dictionaries(
+      num_columns);
+  std::vector<int64_t> row_offsets = {0};
+  int64_t line = options.header_lines;
+  for (Chunk& chunk : chunks) {
+    if (!chunk.status.ok()) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "%s line %d: %s", file_path, line + chunk.lines,
+          chunk.status.message()));
+    }
+    line += chunk.lines;
+    row_offsets.push_back(row_offsets.back() + chunk.rows);
+    chunk.codes.resize(num_columns);
+    for (int32_t c = 0; c < num_columns; ++c) {
+      for (absl::string_view value : chunk.categories[c]) {
+        const auto [it, inserted] = dictionaries[c].try_emplace(
+            value, static_cast<int32_t>(data.categories[c].size()));
+        if (inserted) data.categories[c].emplace_back(value);
+        chunk.codes[c].push_back(it->second);
+      }
+    }
+  }
+
+  const int64_t num_rows = row_offsets.back();
+  if (num_rows > std::numeric_limits<int>::max()) {
+    return absl::OutOfRangeError(
+        absl::StrFormat("%d rows are more than cv::Mat holds", num_rows));
+  }
+  cv::Mat samples(static_cast<int>(num_rows), num_columns - 1, CV_32F);
+  cv::Mat responses(static_cast<int>(num_rows), 1, CV_32F);
+  {
+    TRACE_SCOPE("ml/load_csv/encode");
+    cv::parallel_for_(
+        cv::Range(0, static_cast<int>(chunks.size())),
+        [&](const cv::Range& range) {
+          for (int i = range.start; i < range.end; ++i) {
+            Chunk& chunk = chunks[i];
+            for (int64_t r = 0; r < chunk.rows; ++r) {
+              const int row = static_cast<int>(row_offsets[i] + r);
+              const float* values = &chunk.values[r * num_columns];
+              float* inputs = samples.ptr<float>(row);
+              for (int32_t c = 0; c < num_columns; ++c) {
+                float value = values[c];
+                if (categorical[c]) {
+                  value = static_cast<float>(
+                      chunk.codes[c][static_cast<int32_t>(value)]);
+                }
+                if (c == response_column) {
+                  responses.at<float>(row) = value;
+                } else {
+                  *inputs++ = value;
+                }
+              }
+            }
+            chunk.values = std::vector<float>();
+          }
+        });
+  }
+
+  // Inputs, then the response.
+  cv::Mat var_type(1, num_columns, CV_8U);
+  int32_t input = 0;
+  for (int32_t c = 0; c < num_columns; ++c) {
+    const uint8_t type =
+        categorical[c] ? cv::ml::VAR_CATEGORICAL : cv::ml::VAR_ORDERED;
+    if (c == response_column) {
+      var_type.at<uint8_t>(num_columns - 1) = type;
+    } else {
+      var_type.at<uint8_t>(input++) = type;
+    }
+  }
+  data.train_data =
+      cv::ml::TrainData::create(samples, cv::ml::ROW_SAMPLE, responses,
+                                cv::noArray(), cv::noArray(), cv::noArray(),
+                                var_type);
+  return data;
+}
+
+}  // namespace hello::ml
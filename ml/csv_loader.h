@@ -0,0 +1,52 @@
+#ifndef ML_CSV_LOADER_H_
+#define ML_CSV_LOADER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "opencv2/ml.hpp"
+
+namespace hello::ml {
+
+struct CsvOptions {
+  int32_t header_lines = 0;
+  // Column of the responses, -1 for the last. The other columns are the
+  // inputs.
+  int32_t response_column = -1;
+  char delimiter = ',';
+  // A field made of this character alone is a missing value. It stays a
+  // category of its own in categorical columns, in numeric columns it
+  // becomes cv::ml::TrainData::missingValue().
+  char missing = '?';
+  // Columns whose first value isn't a number are categorical, these are
+  // categorical whatever their values.
+  std::vector<int32_t> categorical_columns;
+  bool all_categorical = false;
+  // Bytes parsed per task, chunks end at line ends.
+  int64_t chunk_size = 8 << 20;
+};
+
+struct CsvData {
+  cv::Ptr<cv::ml::TrainData> train_data;
+  // Per column of the file, the value of every category code, empty for
+  // numeric columns. Codes are in order of first appearance in the file.
+  std::vector<std::vector<std::string>> categories;
+  int32_t response_column = 0;
+};
+
+// Loads a CSV file into ROW_SAMPLE TrainData, in place of
+// cv::ml::TrainData::loadFromCSV for files of gigabytes. The file is
+// memory-mapped and split into chunks at line ends that are parsed in
+// parallel, each dictionary encoding its categorical columns. The chunk
+// dictionaries are then merged, in file order, and the chunk codes mapped
+// to the merged ones in parallel. Blank lines are skipped, fields are
+// trimmed, and rows with the wrong number of fields or a non numeric value
+// in a numeric column fail with the line number.
+absl::StatusOr<CsvData> LoadCsv(absl::string_view path,
+                                const CsvOptions& options);
+
+}  // namespace hello::ml
+
+#endif  // ML_CSV_LOADER_H_
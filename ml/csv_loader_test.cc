@@ -0,0 +1,112 @@
+#include "ml/csv_loader.h"
+#include <fstream>
+#include <string>
+#include "absl/strings/str_cat.h"
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+
+namespace hello::ml {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::HasSubstr;
+
+std::string WriteFile(const std::string& name, const std::string& contents) {
+  const std::string path = ::testing::TempDir() + "/" + name;
+  std::ofstream(path, std::ios::binary) << contents;
+  return path;
+}
+
+TEST(LoadCsv, EncodesCategoriesAndPlacesTheResponse) {
+  const std::string path = WriteFile(
+      "mixed.csv",
+      "size,color,weight,label\r\n"
+      "1.5, red ,10,yes\r\n"
+      "\r\n"
+      "2,blue,?,no\r\n"
+      "3,red,30,no\n");
+  CsvOptions options;
+  options.header_lines = 1;
+  absl::StatusOr<CsvData> data = LoadCsv(path, options);
+  ASSERT_TRUE(data.ok()) << data.status();
+  EXPECT_THAT(data->response_column, Eq(3));
+  EXPECT_THAT(data->categories[1], ElementsAre("red", "blue"));
+  EXPECT_THAT(data->categories[3], ElementsAre("yes", "no"));
+  EXPECT_TRUE(data->categories[0].empty());
+
+  const cv::Mat samples = data->train_data->getSamples();
+  ASSERT_THAT(samples.rows, Eq(3));
+  ASSERT_THAT(samples.cols, Eq(3));
+  EXPECT_THAT(samples.at<float>(0, 0), Eq(1.5f));
+  EXPECT_THAT(samples.at<float>(1, 1), Eq(1));
+  EXPECT_THAT(samples.at<float>(2, 1), Eq(0));
+  EXPECT_THAT(samples.at<float>(1, 2),
+              Eq(cv::ml::TrainData::missingValue()));
+  const cv::Mat responses = data->train_data->getResponses();
+  EXPECT_THAT(responses.at<float>(0), Eq(0));
+  EXPECT_THAT(responses.at<float>(2), Eq(1));
+  const cv::Mat var_type = data->train_data->getVarType();
+  EXPECT_THAT(var_type.at<uint8_t>(1), Eq(cv::ml::VAR_CATEGORICAL));
+  EXPECT_THAT(var_type.at<uint8_t>(2), Eq(cv::ml::VAR_ORDERED));
+}
+
+TEST(LoadCsv, ChunksDontChangeTheResult) {
+  std::string contents;
+  const char* colors[] = {"red", "green", "blue", "cyan", "black"};
+  for (int i = 0; i < 500; ++i) {
+    absl::StrAppend(&contents, colors[(i * 7) % 5], ",", i * 0.5, ",",
+                    colors[(i * 3) % 5], "\n");
+  }
+  const std::string path = WriteFile("chunks.csv", contents);
+  CsvOptions options;
+  options.response_column = 0;
+  absl::StatusOr<CsvData> whole = LoadCsv(path, options);
+  options.chunk_size = 37;
+  absl::StatusOr<CsvData> chunked = LoadCsv(path, options);
+  ASSERT_TRUE(whole.ok()) << whole.status();
+  ASSERT_TRUE(chunked.ok()) << chunked.status();
+  EXPECT_THAT(chunked->categories, Eq(whole->categories));
+  const cv::Mat a = whole->train_data->getSamples();
+  const cv::Mat b = chunked->train_data->getSamples();
+  ASSERT_THAT(b.rows, Eq(500));
+  EXPECT_THAT(cv::norm(a, b, cv::NORM_INF), Eq(0));
+  EXPECT_THAT(cv::norm(whole->train_data->getResponses(),
+                       chunked->train_data->getResponses(), cv::NORM_INF),
+              Eq(0));
+}
+
+TEST(LoadCsv, ReportsTheFailingLine) {
+  const std::string path = WriteFile("bad.csv",
+                                     "1,a,x\n"
+                                     "2,b,y\n"
+                                     "\n"
+                                     "3,c\n"
+                                     "4,d,z\n");
+  CsvOptions options;
+  options.chunk_size = 8;
+  absl::StatusOr<CsvData> data = LoadCsv(path, options);
+  ASSERT_FALSE(data.ok());
+  EXPECT_THAT(data.status().code(), Eq(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(data.status().message(), HasSubstr("line 4"));
+
+  const std::string numbers = WriteFile("numbers.csv", "1,2\n3,x\n");
+  data = LoadCsv(numbers, CsvOptions());
+  ASSERT_FALSE(data.ok());
+  EXPECT_THAT(data.status().message(), HasSubstr("line 2"));
+}
+
+TEST(LoadCsv, FailsOnMissingOrEmptyFiles) {
+  absl::StatusOr<CsvData> data =
+      LoadCsv(::testing::TempDir() + "/no_such.csv", CsvOptions());
+  EXPECT_THAT(data.status().code(), Eq(absl::StatusCode::kNotFound));
+  data = LoadCsv(WriteFile("empty.csv", ""), CsvOptions());
+  EXPECT_THAT(data.status().code(), Eq(absl::StatusCode::kInvalidArgument));
+  CsvOptions options;
+  options.header_lines = 1;
+  data = LoadCsv(WriteFile("header.csv", "a,b\n"), options);
+  EXPECT_THAT(data.status().code(), Eq(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace hello::ml
@@ -1,6 +1,7 @@
 #include <glog/logging.h>
 #include "absl/strings/str_format.h"
 #include "absl/status/status.h"
+#include "ml/csv_loader.h"
 #include "opencv2/ml.hpp"
 #include "opencv2/opencv.hpp"
 
@@ -14,24 +15,15 @@ namespace hello::ml {
 constexpr char kDirectory[] = "testdata/mushroom/agaricus-lepiota.data";
 
 absl::Status RunDecisionTrees() {
-  cv::Ptr<cv::ml::TrainData> data_set = cv::ml::TrainData::loadFromCSV(
-      kDirectory,  // Input file name
-      0,           // Header lines (ignore this many)
-      0,           // Responses are (start) at thie column
-      1,           // Inputs start at this column
-      "cat[0-22]"  // All 23 columns are categorical
-  );
-
-  // Use defaults for delimeter (',') and missch ('?')
-  // Verify that we read in what we think.
-  //
-  LOG(INFO) << "Foo: " << data_set->getNSamples();
+  // Responses are in the first column, all 23 columns are categorical.
+  // Use defaults for delimeter (',') and missing ('?').
+  CsvOptions options;
+  options.response_column = 0;
+  options.all_categorical = true;
+  absl::StatusOr<CsvData> csv = LoadCsv(kDirectory, options);
+  if (!csv.ok()) return csv.status();
+  cv::Ptr<cv::ml::TrainData> data_set = csv->train_data;
   const int n_samples = data_set->getNSamples();
-  // If file path is wrong, it does not really work.
-  if (n_samples == 0)
-    return absl::InternalError(
-        absl::StrFormat("Could not read file: %s", kDirectory));
-
   LOG(INFO) << absl::StreamFormat("Read %i samples from %s", n_samples,
                                   kDirectory);
 
@@ -77,9 +69,8 @@ absl::Status RunDecisionTrees() {
                                              false,   // use train data
                                              results  // cv::noArray()
   );
-  std::vector<cv::String> names;
-  data_set->getNames(names);
-  cv::Mat flags = data_set->getVarSymbolFlags();
+  // Class names by response code.
+  const std::vector<std::string>& names = csv->categories[0];
 
   // Compute some statistics on our own:
   //
@@ -91,8 +82,8 @@ absl::Status RunDecisionTrees() {
     for (int i = 0; i < data_set->getNTrainSamples(); ++i) {
       float received = results.at<float>(i, 0);
       float expected = expected_responses.at<float>(i, 0);
-      cv::String r_str = names[(int)received];
-      cv::String e_str = names[(int)expected];
+      const std::string& r_str = names[(int)received];
+      const std::string& e_str = names[(int)expected];
       LOG(INFO) << absl::StreamFormat("Expected: %s, got %s", e_str, r_str);
       if (received == expected)
         good++;
@@ -0,0 +1,148 @@
+// KMeansEngine against cv::kmeans with k-means++ seeding on Gaussian blobs,
+// for every combination of the number of points, clusters and dimensions.
+// Compactness is the sum of squared distances to the centers, lower is
+// better; distances are point to center distances per point, seeding
+// included.
+#include <string>
+#include <utility>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "ml/kmeans_engine.h"
+#include "opencv2/core.hpp"
+#include "status_macros.h"
+
+ABSL_FLAG(std::vector<std::string>, points,
+          std::vector<std::string>({"10000", "100000", "1000000"}),
+          "Numbers of points");
+ABSL_FLAG(std::vector<std::string>, clusters,
+          std::vector<std::string>({"8", "64"}), "Numbers of clusters");
+ABSL_FLAG(std::vector<std::string>, dims,
+          std::vector<std::string>({"2", "16", "64"}), "Point dimensions");
+ABSL_FLAG(int32_t, iterations, 100, "Iterations at most");
+ABSL_FLAG(int32_t, attempts, 1, "Restarts, the most compact is kept");
+ABSL_FLAG(int32_t, batch_size, 1024, "Points per mini-batch");
+ABSL_FLAG(int32_t, cv_max_points, 1000000,
+          "cv::kmeans is skipped on more points than this");
+
+namespace {
+
+double Milliseconds(int64 start) {
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+absl::StatusOr<std::vector<int32_t>> ParseCounts(
+    const std::vector<std::string>& flag) {
+  std::vector<int32_t> counts;
+  for (const std::string& count : flag) {
+    int32_t value;
+    if (!absl::SimpleAtoi(count, &value) || value <= 0) {
+      return absl::InvalidArgumentError(absl::StrCat("Bad count - ", count));
+    }
+    counts.push_back(value);
+  }
+  return counts;
+}
+
+// `n` points spread over `k` Gaussian blobs with centers uniform in
+// [0, 100]^dim.
+cv::Mat Blobs(int32_t n, int32_t k, int32_t dim) {
+  cv::RNG rng(12345);
+  cv::Mat centers(k, dim, CV_32F);
+  rng.fill(centers, cv::RNG::UNIFORM, 0, 100);
+  cv::Mat points(n, dim, CV_32F);
+  rng.fill(points, cv::RNG::NORMAL, 0, 5);
+  for (int32_t i = 0; i < n; ++i) points.row(i) += centers.row(i % k);
+  return points;
+}
+
+void Report(int32_t n, int32_t k, int32_t dim, const std::string& method,
+            double ms, double compactness, const std::string& iterations,
+            const std::string& distances) {
+  LOG(INFO) << absl::StreamFormat("%9d %5d %4d %-10s %10.1f %14.6g %6s %10s",
+                                  n, k, dim, method, ms, compactness,
+                                  iterations, distances);
+}
+
+}  // namespace
+
+absl::Status Run() {
+  ASSIGN_OR_RETURN(const std::vector<int32_t> point_counts,
+                   ParseCounts(absl::GetFlag(FLAGS_points)));
+  ASSIGN_OR_RETURN(const std::vector<int32_t> cluster_counts,
+                   ParseCounts(absl::GetFlag(FLAGS_clusters)));
+  ASSIGN_OR_RETURN(const std::vector<int32_t> dims,
+                   ParseCounts(absl::GetFlag(FLAGS_dims)));
+  const int32_t iterations = absl::GetFlag(FLAGS_iterations);
+  const int32_t attempts = absl::GetFlag(FLAGS_attempts);
+  hello::ml::KMeansEngine::Options options;
+  options.max_iterations = iterations;
+  options.attempts = attempts;
+  options.batch_size = absl::GetFlag(FLAGS_batch_size);
+  using Algorithm = hello::ml::KMeansEngine::Algorithm;
+  const std::vector<std::pair<std::string, Algorithm>> algorithms = {
+      {"lloyd", Algorithm::kLloyd},
+      {"hamerly", Algorithm::kHamerly},
+      {"minibatch", Algorithm::kMiniBatch}};
+
+  LOG(INFO) << absl::StreamFormat("%9s %5s %4s %-10s %10s %14s %6s %10s",
+                                  "points", "k", "dim", "method", "ms",
+                                  "compactness", "iters", "distances");
+  for (int32_t n : point_counts) {
+    for (int32_t k : cluster_counts) {
+      if (k > n) continue;
+      for (int32_t dim : dims) {
+        const cv::Mat points = Blobs(n, k, dim);
+        if (n <= absl::GetFlag(FLAGS_cv_max_points)) {
+          cv::Mat labels;
+          cv::Mat centers;
+          const int64 start = cv::getTickCount();
+          const double compactness = cv::kmeans(
+              points, k, labels,
+              cv::TermCriteria(cv::TermCriteria::EPS | cv::TermCriteria::COUNT,
+                               iterations, options.epsilon),
+              attempts, cv::KMEANS_PP_CENTERS, centers);
+          Report(n, k, dim, "cv::kmeans", Milliseconds(start), compactness,
+                 "-", "-");
+        } else {
+          LOG(INFO) << absl::StreamFormat(
+              "%9d %5d %4d %-10s skipped, more than --cv_max_points", n, k,
+              dim, "cv::kmeans");
+        }
+        for (const auto& [name, algorithm] : algorithms) {
+          options.algorithm = algorithm;
+          const int64 start = cv::getTickCount();
+          ASSIGN_OR_RETURN(
+              const hello::ml::KMeansResult result,
+              hello::ml::KMeansEngine(options).Cluster(points, k));
+          const double ms = Milliseconds(start);
+          const double distances =
+              static_cast<double>(result.distance_computations) / n;
+          Report(n, k, dim, name, ms, result.compactness,
+                 absl::StrCat(result.iterations),
+                 absl::StrFormat("%.1f", distances));
+        }
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
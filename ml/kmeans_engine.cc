@@ -0,0 +1,524 @@
+#include "ml/kmeans_engine.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "opencv2/core/hal/hal.hpp"
+#include "util/trace.h"
+
+namespace hello::ml {
+namespace {
+
+using Algorithm = KMeansEngine::Algorithm;
+
+constexpr int32_t kChunk = KMeansEngine::kChunk;
+// Center sums are accumulated per block of chunks rather than per chunk so
+// that their memory stays a small multiple of K * D.
+constexpr int32_t kMaxBlocks = 32;
+constexpr float kInfinity = std::numeric_limits<float>::max();
+
+// Generator of chunk `chunk` in step `step`, -1 for draws that are not
+// per chunk.
+cv::RNG ChunkRng(uint64_t seed, int64_t step, int32_t chunk) {
+  // splitmix64 of the three.
+  uint64_t x = seed ^ (static_cast<uint64_t>(step) << 24) ^
+               static_cast<uint64_t>(static_cast<int64_t>(chunk));
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return cv::RNG(x ^ (x >> 31));
+}
+
+// Index in `candidates` and squared distance of the nearest and the second
+// nearest of `count` rows of width `dim` to `point`.
+struct Nearest {
+  int32_t index = 0;
+  float distance = kInfinity;
+  float second = kInfinity;
+};
+
+Nearest FindNearest(const float* point, const float* candidates,
+                    int32_t count, int32_t dim) {
+  Nearest nearest;
+  for (int32_t j = 0; j < count; ++j) {
+    const float d = cv::hal::normL2Sqr_(point, candidates + j * dim, dim);
+    if (d < nearest.distance) {
+      nearest.second = nearest.distance;
+      nearest.distance = d;
+      nearest.index = j;
+    } else if (d < nearest.second) {
+      nearest.second = d;
+    }
+  }
+  return nearest;
+}
+
+// Clustering from one seed.
+class Attempt {
+ public:
+  Attempt(const KMeansEngine::Options& options, uint64_t seed,
+          const cv::Mat& points, int32_t k)
+      : options_(options),
+        seed_(seed),
+        points_(points.ptr<float>()),
+        n_(points.rows),
+        dim_(points.cols),
+        k_(k),
+        num_chunks_((n_ + kChunk - 1) / kChunk),
+        num_blocks_(std::min(num_chunks_, kMaxBlocks)),
+        labels_(n_) {}
+
+  KMeansResult Run() {
+    SeedCenters();
+    switch (options_.algorithm) {
+      case Algorithm::kLloyd:
+        Lloyd();
+        break;
+      case Algorithm::kHamerly:
+        Hamerly();
+        break;
+      case Algorithm::kMiniBatch:
+        MiniBatch();
+        break;
+    }
+    KMeansResult result;
+    result.centers = cv::Mat(k_, dim_, CV_32F);
+    std::copy(centers_.begin(), centers_.end(), result.centers.ptr<float>());
+    result.compactness = Compactness();
+    result.labels = std::move(labels_);
+    result.iterations = iterations_;
+    result.distance_computations = distance_computations_;
+    return result;
+  }
+
+ private:
+  const float* Point(int64_t i) const { return points_ + i * dim_; }
+
+  // Runs body(begin, end, block) on the points of every block in
+  // parallel. Blocks are made of whole chunks.
+  template <typename Body>
+  void ForEachBlock(Body&& body) const {
+    cv::parallel_for_(cv::Range(0, num_blocks_), [&](const cv::Range& range) {
+      for (int32_t b = range.start; b < range.end; ++b) {
+        const int32_t begin = b * num_chunks_ / num_blocks_ * kChunk;
+        const int32_t end =
+            std::min(n_, (b + 1) * num_chunks_ / num_blocks_ * kChunk);
+        body(begin, end, b);
+      }
+    });
+  }
+
+  // k-means||, from one uniformly drawn point.
+  void SeedCenters() {
+    TRACE_SCOPE("ml/kmeans/seed");
+    cv::RNG rng = ChunkRng(seed_, -1, -1);
+    const int32_t first = rng.uniform(0, n_);
+    std::vector<float> candidates(Point(first), Point(first) + dim_);
+    std::vector<float> distances(n_, kInfinity);
+    std::vector<int32_t> nearest(n_, 0);
+    UpdateNearest(candidates, 0, distances, nearest);
+
+    const double oversampling = options_.oversampling * k_;
+    std::vector<std::vector<int32_t>> sampled(num_chunks_);
+    for (int32_t round = 0; round < options_.seeding_rounds; ++round) {
+      const double cost = Sum(distances);
+      if (cost <= 0) break;
+      cv::parallel_for_(
+          cv::Range(0, num_chunks_), [&](const cv::Range& range) {
+            for (int32_t c = range.start; c < range.end; ++c) {
+              cv::RNG chunk_rng = ChunkRng(seed_, round, c);
+              sampled[c].clear();
+              const int32_t end = std::min(n_, (c + 1) * kChunk);
+              for (int32_t i = c * kChunk; i < end; ++i) {
+                if (chunk_rng.uniform(0.0, 1.0) <
+                    oversampling * distances[i] / cost) {
+                  sampled[c].push_back(i);
+                }
+              }
+            }
+          });
+      const int32_t from = static_cast<int32_t>(candidates.size()) / dim_;
+      for (const std::vector<int32_t>& chunk : sampled) {
+        for (int32_t i : chunk) {
+          candidates.insert(candidates.end(), Point(i), Point(i) + dim_);
+        }
+      }
+      UpdateNearest(candidates, from, distances, nearest);
+    }
+
+    const int32_t num_candidates =
+        static_cast<int32_t>(candidates.size()) / dim_;
+    std::vector<double> weights(num_candidates, 0);
+    for (int32_t i = 0; i < n_; ++i) ++weights[nearest[i]];
+    ReduceCandidates(candidates, weights, rng);
+  }
+
+  // Lowers `distances` and moves `nearest` for the candidates from `from`
+  // on.
+  void UpdateNearest(const std::vector<float>& candidates, int32_t from,
+                     std::vector<float>& distances,
+                     std::vector<int32_t>& nearest) {
+    const int32_t count = static_cast<int32_t>(candidates.size()) / dim_;
+    ForEachBlock([&](int32_t begin, int32_t end, int32_t) {
+      const float* added = candidates.data() + from * dim_;
+      for (int32_t i = begin; i < end; ++i) {
+        const Nearest found = FindNearest(Point(i), added, count - from, dim_);
+        if (found.distance < distances[i]) {
+          distances[i] = found.distance;
+          nearest[i] = from + found.index;
+        }
+      }
+    });
+    distance_computations_ += static_cast<int64_t>(n_) * (count - from);
+  }
+
+  double Sum(const std::vector<float>& values) const {
+    std::vector<double> sums(num_blocks_, 0);
+    ForEachBlock([&](int32_t begin, int32_t end, int32_t block) {
+      double sum = 0;
+      for (int32_t i = begin; i < end; ++i) sum += values[i];
+      sums[block] = sum;
+    });
+    double sum = 0;
+    for (double s : sums) sum += s;
+    return sum;
+  }
+
+  // Weighted k-means++ and Lloyd iterations over the candidates. Points
+  // are drawn uniformly to make up for fewer distinct candidates than K.
+  void ReduceCandidates(const std::vector<float>& candidates,
+                        const std::vector<double>& weights, cv::RNG& rng) {
+    const int32_t m = static_cast<int32_t>(weights.size());
+    auto candidate = [&](int32_t j) { return candidates.data() + j * dim_; };
+    auto draw = [&](const std::vector<double>& mass) {
+      double total = 0;
+      for (double w : mass) total += w;
+      if (total <= 0) return -1;
+      double target = rng.uniform(0.0, total);
+      for (int32_t j = 0; j < m; ++j) {
+        target -= mass[j];
+        if (target < 0 && mass[j] > 0) return j;
+      }
+      for (int32_t j = m - 1; j >= 0; --j) {
+        if (mass[j] > 0) return j;
+      }
+      return -1;
+    };
+
+    centers_.clear();
+    std::vector<double> distances(m, std::numeric_limits<double>::max());
+    std::vector<double> mass(m);
+    for (int32_t c = 0; c < k_; ++c) {
+      for (int32_t j = 0; j < m; ++j) {
+        mass[j] = c == 0 ? weights[j] : weights[j] * distances[j];
+      }
+      const int32_t j = draw(mass);
+      const float* center = j >= 0 ? candidate(j) : Point(rng.uniform(0, n_));
+      centers_.insert(centers_.end(), center, center + dim_);
+      for (int32_t i = 0; i < m; ++i) {
+        distances[i] = std::min<double>(
+            distances[i], cv::hal::normL2Sqr_(candidate(i), center, dim_));
+      }
+    }
+    distance_computations_ += static_cast<int64_t>(m) * k_;
+
+    std::vector<int32_t> labels(m);
+    std::vector<double> sums(k_ * dim_);
+    std::vector<double> counts(k_);
+    for (int32_t iteration = 0; iteration < options_.max_iterations;
+         ++iteration) {
+      bool changed = iteration == 0;
+      for (int32_t i = 0; i < m; ++i) {
+        const int32_t label =
+            FindNearest(candidate(i), centers_.data(), k_, dim_).index;
+        changed |= label != labels[i];
+        labels[i] = label;
+      }
+      distance_computations_ += static_cast<int64_t>(m) * k_;
+      if (!changed) break;
+      std::fill(sums.begin(), sums.end(), 0);
+      std::fill(counts.begin(), counts.end(), 0);
+      for (int32_t i = 0; i < m; ++i) {
+        double* sum = &sums[labels[i] * dim_];
+        for (int32_t d = 0; d < dim_; ++d) {
+          sum[d] += weights[i] * candidate(i)[d];
+        }
+        counts[labels[i]] += weights[i];
+      }
+      for (int32_t c = 0; c < k_; ++c) {
+        if (counts[c] <= 0) continue;
+        for (int32_t d = 0; d < dim_; ++d) {
+          centers_[c * dim_ + d] =
+              static_cast<float>(sums[c * dim_ + d] / counts[c]);
+        }
+      }
+    }
+  }
+
+  // Labels every point with its nearest center, returns the number of
+  // labels changed. Keeps the bounds if given.
+  int64_t Assign(std::vector<float>* upper, std::vector<float>* lower) {
+    std::vector<int64_t> changed(num_blocks_, 0);
+    ForEachBlock([&](int32_t begin, int32_t end, int32_t block) {
+      for (int32_t i = begin; i < end; ++i) {
+        const Nearest found = FindNearest(Point(i), centers_.data(), k_, dim_);
+        changed[block] += found.index != labels_[i];
+        labels_[i] = found.index;
+        if (upper != nullptr) {
+          (*upper)[i] = std::sqrt(found.distance);
+          (*lower)[i] = std::sqrt(found.second);
+        }
+      }
+    });
+    distance_computations_ += static_cast<int64_t>(n_) * k_;
+    int64_t total = 0;
+    for (int64_t c : changed) total += c;
+    return total;
+  }
+
+  // Moves every center to the mean of its points, keeps the centers without
+  // any. Returns how far each moved.
+  std::vector<float> UpdateCenters() {
+    std::vector<double> sums(static_cast<size_t>(num_blocks_) * k_ * dim_, 0);
+    std::vector<int64_t> counts(static_cast<size_t>(num_blocks_) * k_, 0);
+    ForEachBlock([&](int32_t begin, int32_t end, int32_t block) {
+      double* block_sums = &sums[static_cast<size_t>(block) * k_ * dim_];
+      int64_t* block_counts = &counts[static_cast<size_t>(block) * k_];
+      for (int32_t i = begin; i < end; ++i) {
+        double* sum = block_sums + labels_[i] * dim_;
+        const float* point = Point(i);
+        for (int32_t d = 0; d < dim_; ++d) sum[d] += point[d];
+        ++block_counts[labels_[i]];
+      }
+    });
+    std::vector<float> shifts(k_, 0);
+    std::vector<float> center(dim_);
+    for (int32_t c = 0; c < k_; ++c) {
+      int64_t count = 0;
+      std::fill(center.begin(), center.end(), 0.0f);
+      for (int32_t b = 0; b < num_blocks_; ++b) {
+        count += counts[static_cast<size_t>(b) * k_ + c];
+      }
+      if (count == 0) continue;
+      for (int32_t d = 0; d < dim_; ++d) {
+        double sum = 0;
+        for (int32_t b = 0; b < num_blocks_; ++b) {
+          sum += sums[(static_cast<size_t>(b) * k_ + c) * dim_ + d];
+        }
+        center[d] = static_cast<float>(sum / count);
+      }
+      float* old = &centers_[c * dim_];
+      shifts[c] = std::sqrt(cv::hal::normL2Sqr_(old, center.data(), dim_));
+      std::copy(center.begin(), center.end(), old);
+    }
+    return shifts;
+  }
+
+  void Lloyd() {
+    TRACE_SCOPE("ml/kmeans/lloyd");
+    Assign(nullptr, nullptr);
+    while (iterations_ < options_.max_iterations) {
+      const std::vector<float> shifts = UpdateCenters();
+      ++iterations_;
+      const int64_t changed = Assign(nullptr, nullptr);
+      if (changed == 0 ||
+          *std::max_element(shifts.begin(), shifts.end()) <= options_.epsilon) {
+        break;
+      }
+    }
+  }
+
+  void Hamerly() {
+    TRACE_SCOPE("ml/kmeans/hamerly");
+    // Distances, not squared, for the triangle inequality.
+    std::vector<float> upper(n_);
+    std::vector<float> lower(n_);
+    Assign(&upper, &lower);
+    std::vector<float> half_gaps(k_);
+    std::vector<int64_t> changed(num_blocks_);
+    std::vector<int64_t> computations(num_blocks_);
+    while (iterations_ < options_.max_iterations) {
+      const std::vector<float> shifts = UpdateCenters();
+      ++iterations_;
+
+      // A point's lower bound drops by the largest shift among the other
+      // centers.
+      int32_t largest = 0;
+      for (int32_t c = 1; c < k_; ++c) {
+        if (shifts[c] > shifts[largest]) largest = c;
+      }
+      float second_largest = 0;
+      for (int32_t c = 0; c < k_; ++c) {
+        if (c != largest) second_largest = std::max(second_largest, shifts[c]);
+      }
+      // Half the distance from every center to its nearest other, a point
+      // within it of its center is nearest to it.
+      for (int32_t c = 0; c < k_; ++c) {
+        float gap = kInfinity;
+        for (int32_t o = 0; o < k_; ++o) {
+          if (o == c) continue;
+          gap = std::min(gap, cv::hal::normL2Sqr_(&centers_[c * dim_],
+                                                  &centers_[o * dim_], dim_));
+        }
+        half_gaps[c] = gap == kInfinity ? kInfinity : 0.5f * std::sqrt(gap);
+      }
+
+      std::fill(changed.begin(), changed.end(), 0);
+      std::fill(computations.begin(), computations.end(), 0);
+      ForEachBlock([&](int32_t begin, int32_t end, int32_t block) {
+        for (int32_t i = begin; i < end; ++i) {
+          const int32_t label = labels_[i];
+          upper[i] += shifts[label];
+          lower[i] -= label == largest ? second_largest : shifts[largest];
+          const float bound = std::max(half_gaps[label], lower[i]);
+          if (upper[i] <= bound) continue;
+          // Tightens the upper bound before scanning all centers.
+          upper[i] = std::sqrt(cv::hal::normL2Sqr_(
+              Point(i), &centers_[label * dim_], dim_));
+          ++computations[block];
+          if (upper[i] <= bound) continue;
+          const Nearest found =
+              FindNearest(Point(i), centers_.data(), k_, dim_);
+          computations[block] += k_;
+          changed[block] += found.index != label;
+          labels_[i] = found.index;
+          upper[i] = std::sqrt(found.distance);
+          lower[i] = std::sqrt(found.second);
+        }
+      });
+      int64_t total_changed = 0;
+      for (int32_t b = 0; b < num_blocks_; ++b) {
+        total_changed += changed[b];
+        distance_computations_ += computations[b];
+      }
+      if (total_changed == 0 ||
+          *std::max_element(shifts.begin(), shifts.end()) <= options_.epsilon) {
+        break;
+      }
+    }
+  }
+
+  void MiniBatch() {
+    TRACE_SCOPE("ml/kmeans/mini_batch");
+    const int32_t batch_size = std::max(1, std::min(options_.batch_size, n_));
+    std::vector<int32_t> batch(batch_size);
+    std::vector<int32_t> batch_labels(batch_size);
+    std::vector<int64_t> counts(k_, 0);
+    std::vector<float> previous;
+    while (iterations_ < options_.max_iterations) {
+      // Steps past those of the seeding rounds.
+      cv::RNG rng =
+          ChunkRng(seed_, options_.seeding_rounds + iterations_, -1);
+      for (int32_t& i : batch) i = rng.uniform(0, n_);
+      cv::parallel_for_(
+          cv::Range(0, (batch_size + kChunk - 1) / kChunk),
+          [&](const cv::Range& range) {
+            for (int32_t c = range.start; c < range.end; ++c) {
+              const int32_t end = std::min(batch_size, (c + 1) * kChunk);
+              for (int32_t b = c * kChunk; b < end; ++b) {
+                batch_labels[b] =
+                    FindNearest(Point(batch[b]), centers_.data(), k_, dim_)
+                        .index;
+              }
+            }
+          });
+      distance_computations_ += static_cast<int64_t>(batch_size) * k_;
+      previous = centers_;
+      // Each center is the running mean of the batch points it was given.
+      for (int32_t b = 0; b < batch_size; ++b) {
+        const int32_t label = batch_labels[b];
+        const float rate = 1.0f / static_cast<float>(++counts[label]);
+        float* center = &centers_[label * dim_];
+        const float* point = Point(batch[b]);
+        for (int32_t d = 0; d < dim_; ++d) {
+          center[d] += rate * (point[d] - center[d]);
+        }
+      }
+      ++iterations_;
+      float shift = 0;
+      for (int32_t c = 0; c < k_; ++c) {
+        shift = std::max(shift, cv::hal::normL2Sqr_(&previous[c * dim_],
+                                                    &centers_[c * dim_], dim_));
+      }
+      if (std::sqrt(shift) <= options_.epsilon) break;
+    }
+    Assign(nullptr, nullptr);
+  }
+
+  double Compactness() const {
+    std::vector<double> sums(num_blocks_, 0);
+    ForEachBlock([&](int32_t begin, int32_t end, int32_t block) {
+      double sum = 0;
+      for (int32_t i = begin; i < end; ++i) {
+        sum += cv::hal::normL2Sqr_(Point(i), &centers_[labels_[i] * dim_],
+                                   dim_);
+      }
+      sums[block] = sum;
+    });
+    double sum = 0;
+    for (double s : sums) sum += s;
+    return sum;
+  }
+
+  const KMeansEngine::Options& options_;
+  const uint64_t seed_;
+  const float* const points_;
+  const int32_t n_;
+  const int32_t dim_;
+  const int32_t k_;
+  const int32_t num_chunks_;
+  const int32_t num_blocks_;
+  // K x D, row major.
+  std::vector<float> centers_;
+  std::vector<int32_t> labels_;
+  int32_t iterations_ = 0;
+  int64_t distance_computations_ = 0;
+};
+
+}  // namespace
+
+absl::StatusOr<KMeansResult> KMeansEngine::Cluster(const cv::Mat& points,
+                                                   int32_t k) const {
+  TRACE_SCOPE("ml/kmeans");
+  if (points.empty() || points.depth() != CV_32F) {
+    return absl::InvalidArgumentError("Points must be non empty CV_32F rows");
+  }
+  cv::Mat data = points.reshape(1, points.rows);
+  if (!data.isContinuous()) data = data.clone();
+  if (k < 1 || k > data.rows) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Bad number of clusters %d for %d points", k,
+                        data.rows));
+  }
+  if (options_.max_iterations < 1 || options_.attempts < 1) {
+    return absl::InvalidArgumentError(
+        "Iterations and attempts must be positive");
+  }
+
+  std::vector<KMeansResult> results(options_.attempts);
+  auto run = [&](int32_t attempt) {
+    // Decorrelates the attempts, ChunkRng mixes the seed again.
+    const uint64_t seed = options_.seed + attempt * 0x9e3779b97f4a7c15ull;
+    results[attempt] = Attempt(options_, seed, data, k).Run();
+  };
+  if (options_.attempts >= cv::getNumThreads()) {
+    // Chunks of an attempt run serially inside the parallel region.
+    cv::parallel_for_(cv::Range(0, options_.attempts),
+                      [&](const cv::Range& range) {
+                        for (int32_t a = range.start; a < range.end; ++a) {
+                          run(a);
+                        }
+                      });
+  } else {
+    for (int32_t a = 0; a < options_.attempts; ++a) run(a);
+  }
+  size_t best = 0;
+  for (size_t a = 1; a < results.size(); ++a) {
+    if (results[a].compactness < results[best].compactness) best = a;
+  }
+  return std::move(results[best]);
+}
+
+}  // namespace hello::ml
@@ -0,0 +1,75 @@
+#ifndef ML_KMEANS_ENGINE_H_
+#define ML_KMEANS_ENGINE_H_
+
+#include <cstdint>
+#include <vector>
+#include "absl/status/statusor.h"
+#include "opencv2/core.hpp"
+
+namespace hello::ml {
+
+struct KMeansResult {
+  // K x D, CV_32F.
+  cv::Mat centers;
+  // Nearest center of every point.
+  std::vector<int32_t> labels;
+  // Sum of the squared distances of the points to their centers, as
+  // returned by cv::kmeans.
+  double compactness = 0;
+  // Of the best attempt.
+  int32_t iterations = 0;
+  // Point to center distances computed by the best attempt, seeding
+  // included, the work the bounds save.
+  int64_t distance_computations = 0;
+};
+
+// K-means for point sets far larger than cv::kmeans is meant for. Points
+// are processed in fixed chunks across cores, so a seed gives the same
+// clustering whatever the number of threads.
+//  - Seeding is k-means||: a few rounds each sample about `oversampling` *
+//    K points with probability proportional to their squared distance to
+//    the candidates so far, then the candidates, weighted by the points
+//    nearest to them, are reduced to K by k-means++ and Lloyd iterations.
+//  - kHamerly keeps for every point an upper bound on the distance to its
+//    center and a lower bound on the distance to the second nearest, and
+//    skips the points the bounds and the half distance from their center
+//    to the nearest other center show can't change cluster. The result is
+//    that of kLloyd, up to rounding at near ties, with a fraction of the
+//    distances.
+//  - kMiniBatch moves the centers towards random batches of points with
+//    per center learning rates, then labels all points once.
+// Restarts run in parallel, keeping the most compact.
+class KMeansEngine {
+ public:
+  enum class Algorithm { kLloyd, kHamerly, kMiniBatch };
+
+  struct Options {
+    Algorithm algorithm = Algorithm::kHamerly;
+    int32_t max_iterations = 100;
+    // Stops once no center moves further than this.
+    double epsilon = 1e-3;
+    int32_t attempts = 1;
+    uint64_t seed = 0x5eed;
+    int32_t seeding_rounds = 5;
+    // Candidates sampled per round, in multiples of K.
+    double oversampling = 2;
+    int32_t batch_size = 1024;
+  };
+
+  // Points processed by one task.
+  static constexpr int32_t kChunk = 4096;
+
+  explicit KMeansEngine(const Options& options) : options_(options) {}
+  KMeansEngine() : KMeansEngine(Options()) {}
+
+  // Clusters the CV_32F rows of `points` into `k` clusters, 1 <= k <= rows.
+  absl::StatusOr<KMeansResult> Cluster(const cv::Mat& points,
+                                       int32_t k) const;
+
+ private:
+  const Options options_;
+};
+
+}  // namespace hello::ml
+
+#endif  // ML_KMEANS_ENGINE_H_
@@ -0,0 +1,149 @@
+#include "ml/kmeans_engine.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+#include "opencv2/core/hal/hal.hpp"
+
+namespace hello::ml {
+namespace {
+
+using ::testing::ElementsAreArray;
+using ::testing::Eq;
+using ::testing::Le;
+using ::testing::Lt;
+using ::testing::SizeIs;
+
+constexpr int32_t kClusters = 8;
+constexpr int32_t kDim = 4;
+
+// `per_cluster` points around each of kClusters centers on a grid with
+// spacing 100 and unit variance, and the centers.
+cv::Mat Blobs(int32_t per_cluster, cv::Mat& centers) {
+  cv::RNG rng(7);
+  centers = cv::Mat(kClusters, kDim, CV_32F);
+  cv::Mat points(kClusters * per_cluster, kDim, CV_32F);
+  for (int32_t c = 0; c < kClusters; ++c) {
+    for (int32_t d = 0; d < kDim; ++d) {
+      centers.at<float>(c, d) = 100.0f * ((c >> d) & 1) + 50.0f * (d == 3) * c;
+    }
+    for (int32_t i = 0; i < per_cluster; ++i) {
+      for (int32_t d = 0; d < kDim; ++d) {
+        points.at<float>(c * per_cluster + i, d) =
+            centers.at<float>(c, d) + static_cast<float>(rng.gaussian(1));
+      }
+    }
+  }
+  return points;
+}
+
+// Distance from every found center to the nearest true one.
+float WorstCenterError(const cv::Mat& found, const cv::Mat& truth) {
+  float worst = 0;
+  for (int32_t i = 0; i < found.rows; ++i) {
+    float best = std::numeric_limits<float>::max();
+    for (int32_t j = 0; j < truth.rows; ++j) {
+      best = std::min(best, cv::hal::normL2Sqr_(found.ptr<float>(i),
+                                                truth.ptr<float>(j), kDim));
+    }
+    worst = std::max(worst, std::sqrt(best));
+  }
+  return worst;
+}
+
+TEST(KMeansEngine, RecoversSeparatedClusters) {
+  cv::Mat truth;
+  const cv::Mat points = Blobs(2000, truth);
+  absl::StatusOr<KMeansResult> result =
+      KMeansEngine().Cluster(points, kClusters);
+  ASSERT_TRUE(result.ok()) << result.status();
+  EXPECT_THAT(result->labels, SizeIs(points.rows));
+  EXPECT_THAT(WorstCenterError(result->centers, truth), Lt(0.2f));
+  // About kDim per point for unit variance.
+  EXPECT_THAT(result->compactness / points.rows, Lt(1.2 * kDim));
+}
+
+TEST(KMeansEngine, HamerlyMatchesLloydWithFewerDistances) {
+  // Without clusters to find, Lloyd iterations go on for a while.
+  cv::Mat points(20000, 2, CV_32F);
+  cv::RNG rng(7);
+  for (int32_t i = 0; i < points.rows; ++i) {
+    points.at<float>(i, 0) = rng.uniform(0.0f, 100.0f);
+    points.at<float>(i, 1) = rng.uniform(0.0f, 100.0f);
+  }
+  KMeansEngine::Options options;
+  options.algorithm = KMeansEngine::Algorithm::kLloyd;
+  absl::StatusOr<KMeansResult> lloyd =
+      KMeansEngine(options).Cluster(points, 16);
+  options.algorithm = KMeansEngine::Algorithm::kHamerly;
+  absl::StatusOr<KMeansResult> hamerly =
+      KMeansEngine(options).Cluster(points, 16);
+  ASSERT_TRUE(lloyd.ok()) << lloyd.status();
+  ASSERT_TRUE(hamerly.ok()) << hamerly.status();
+  EXPECT_THAT(hamerly->labels, ElementsAreArray(lloyd->labels));
+  EXPECT_THAT(hamerly->iterations, Eq(lloyd->iterations));
+  EXPECT_THAT(hamerly->distance_computations,
+              Lt(lloyd->distance_computations / 2));
+}
+
+TEST(KMeansEngine, MiniBatchIsCloseToLloyd) {
+  cv::Mat truth;
+  const cv::Mat points = Blobs(5000, truth);
+  KMeansEngine::Options options;
+  options.algorithm = KMeansEngine::Algorithm::kLloyd;
+  absl::StatusOr<KMeansResult> lloyd =
+      KMeansEngine(options).Cluster(points, kClusters);
+  options.algorithm = KMeansEngine::Algorithm::kMiniBatch;
+  options.batch_size = 256;
+  options.max_iterations = 50;
+  absl::StatusOr<KMeansResult> mini_batch =
+      KMeansEngine(options).Cluster(points, kClusters);
+  ASSERT_TRUE(lloyd.ok()) << lloyd.status();
+  ASSERT_TRUE(mini_batch.ok()) << mini_batch.status();
+  EXPECT_THAT(mini_batch->compactness, Le(1.05 * lloyd->compactness));
+}
+
+TEST(KMeansEngine, AttemptsAreRepeatable) {
+  cv::Mat truth;
+  const cv::Mat points = Blobs(1000, truth);
+  KMeansEngine::Options options;
+  options.attempts = 6;
+  // With more threads than attempts these run one after the other with
+  // parallel chunks, with a single thread the attempts are the parallel
+  // loop. Both must agree.
+  const int threads = cv::getNumThreads();
+  cv::setNumThreads(8);
+  absl::StatusOr<KMeansResult> first =
+      KMeansEngine(options).Cluster(points, 6);
+  cv::setNumThreads(1);
+  absl::StatusOr<KMeansResult> second =
+      KMeansEngine(options).Cluster(points, 6);
+  cv::setNumThreads(threads);
+  ASSERT_TRUE(first.ok()) << first.status();
+  ASSERT_TRUE(second.ok()) << second.status();
+  EXPECT_THAT(first->compactness, Eq(second->compactness));
+  EXPECT_THAT(first->labels, ElementsAreArray(second->labels));
+}
+
+TEST(KMeansEngine, HandlesMoreClustersThanDistinctPoints) {
+  cv::Mat points(100, kDim, CV_32F);
+  for (int32_t i = 0; i < points.rows; ++i) {
+    for (int32_t d = 0; d < kDim; ++d) points.at<float>(i, d) = i % 3;
+  }
+  absl::StatusOr<KMeansResult> result = KMeansEngine().Cluster(points, 10);
+  ASSERT_TRUE(result.ok()) << result.status();
+  EXPECT_THAT(result->compactness, Eq(0));
+}
+
+TEST(KMeansEngine, RejectsBadClusterCounts) {
+  cv::Mat truth;
+  const cv::Mat points = Blobs(10, truth);
+  EXPECT_FALSE(KMeansEngine().Cluster(points, 0).ok());
+  EXPECT_FALSE(KMeansEngine().Cluster(points, points.rows + 1).ok());
+  EXPECT_FALSE(KMeansEngine().Cluster(cv::Mat(), 1).ok());
+}
+
+}  // namespace
+}  // namespace hello::ml
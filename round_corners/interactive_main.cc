@@ -10,18 +10,14 @@
 #include "opencv2/opencv.hpp"
 #include "status_macros.h"
 #include "absl/strings/str_format.h"
+#include "util/trace.h"
 
 ABSL_FLAG(std::string, input_image_path,
           "round_corners/testdata/round_corners.jpg", "Input image");
+ABSL_FLAG(std::string, trace_path, "",
+          "If set, Chrome trace_event JSON of the stages is written there");
 
 absl::Status Run() {
-
-  auto log_latency = [&](int64 start, absl::string_view label) {
-    const int64 end = cv::getTickCount();
-    const double time_ms = (end - start) / cv::getTickFrequency() * 1000.0;
-    LOG(INFO) << absl::StreamFormat("%s:  %.0f ms", label, time_ms);
-  };
-
   constexpr absl::string_view kWindow = "Input";
   constexpr absl::string_view kContours = "Contours";
   cv::namedWindow(kWindow.data(), cv::WINDOW_FREERATIO);
@@ -34,52 +30,68 @@ absl::Status Run() {
         absl::StrCat("Failed to load ", absl::GetFlag(FLAGS_input_image_path)));
   }
 
-  // Preprocessing
-  int64 start = cv::getTickCount();
-  cv::Mat gray;
-  cv::Mat blurred;
-  cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
-  cv::GaussianBlur(gray, blurred, cv::Size(5, 5), 0);  // Noise suppression
-  log_latency(start, "Smoothing:");
-
-  // Thresholding
   cv::Mat thresholded;
-  cv::adaptiveThreshold(blurred, thresholded, 255,
-                        cv::ADAPTIVE_THRESH_GAUSSIAN_C, cv::THRESH_BINARY_INV,
-                        11, 2);
-  log_latency(start, "Thresholding:");
+  std::vector<std::vector<cv::Point>> contours;
+  std::vector<cv::Point2f> corners(4);
+  {
+    TRACE_SCOPE("round_corners/total");
+    // Preprocessing
+    cv::Mat blurred;
+    {
+      TRACE_SCOPE("round_corners/smoothing");
+      cv::Mat gray;
+      cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
+      cv::GaussianBlur(gray, blurred, cv::Size(5, 5), 0);  // Noise suppression
+    }
 
-  // Morphology
-  cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
-  cv::dilate(thresholded, thresholded, kernel);
-  log_latency(start, "Dilate:");
+    // Thresholding
+    {
+      TRACE_SCOPE("round_corners/thresholding");
+      cv::adaptiveThreshold(blurred, thresholded, 255,
+                            cv::ADAPTIVE_THRESH_GAUSSIAN_C,
+                            cv::THRESH_BINARY_INV, 11, 2);
+    }
 
-  // Find the largest contours
-  std::vector<std::vector<cv::Point>> contours;
-  cv::findContours(thresholded, contours, cv::RETR_EXTERNAL,
-                   cv::CHAIN_APPROX_SIMPLE);
-  log_latency(start, "Contours:");
-  double max_area = 0;
-  std::vector<cv::Point> largest_contour;
-  for (size_t i = 0; i < contours.size(); ++i) {
-    double area = cv::contourArea(contours[i]);
-    if (area > max_area) {
-      max_area = area;
-      largest_contour = contours[i];
+    // Morphology
+    {
+      TRACE_SCOPE("round_corners/dilate");
+      cv::Mat kernel =
+          cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
+      cv::dilate(thresholded, thresholded, kernel);
     }
-  }
-  if (largest_contour.size() < 4)
-    return absl::InvalidArgumentError("Not enough points");
 
-  // Simplifies contour into a polygon with fewer vertices
-  // while retaining its overall shape.
-  std::vector<cv::Point2f> corners(4);
-  cv::approxPolyDP(/*curve=*/largest_contour,
-                   /*approxCurve=*/corners, /*epsilon=*/
-                   0.02 * cv::arcLength(largest_contour,
-                                        /*closed=*/true),
-                   /*closed=*/true);
-  log_latency(start, "Total latency");
+    // Find the largest contours
+    {
+      TRACE_SCOPE("round_corners/contours");
+      cv::findContours(thresholded, contours, cv::RETR_EXTERNAL,
+                       cv::CHAIN_APPROX_SIMPLE);
+    }
+    TRACE_SCOPE("round_corners/polygon");
+    double max_area = 0;
+    std::vector<cv::Point> largest_contour;
+    for (size_t i = 0; i < contours.size(); ++i) {
+      double area = cv::contourArea(contours[i]);
+      if (area > max_area) {
+        max_area = area;
+        largest_contour = contours[i];
+      }
+    }
+    if (largest_contour.size() < 4)
+      return absl::InvalidArgumentError("Not enough points");
+
+    // Simplifies contour into a polygon with fewer vertices
+    // while retaining its overall shape.
+    cv::approxPolyDP(/*curve=*/largest_contour,
+                     /*approxCurve=*/corners, /*epsilon=*/
+                     0.02 * cv::arcLength(largest_contour,
+                                          /*closed=*/true),
+                     /*closed=*/true);
+  }
+  LOG(INFO) << "Latency:\n" << hello::util::Tracer::Get().SummaryTable();
+  if (!absl::GetFlag(FLAGS_trace_path).empty()) {
+    RETURN_IF_ERROR(hello::util::Tracer::Get().WriteChromeTrace(
+        absl::GetFlag(FLAGS_trace_path)));
+  }
 
   // Draw points
   const cv::Scalar kRED(0, 0, 255);
@@ -1,9 +1,11 @@
 #include "sfm/reconstruction.h"
 #include <fstream>
 #include "absl/strings/str_format.h"
+#include "keypoints/feature_cache.h"
 #include "opencv2/calib3d.hpp"
 #include "opencv2/features2d.hpp"
 #include "opencv2/opencv.hpp"
+#include "util/trace.h"
 
 namespace sfm {
 Reconstruction::Reconstruction() {
@@ -19,6 +21,10 @@ void Reconstruction::SetIntrinsics(double fx, double fy, double cx, double cy) {
   camera_matrix_.at<double>(1, 2) = cy;
 }
 
+void Reconstruction::SetFeatureCacheDirectory(absl::string_view directory) {
+  feature_cache_directory_ = std::string(directory);
+}
+
 absl::Status Reconstruction::LoadImages(
     const std::vector<std::string>& image_paths) {
   images_.clear();
@@ -53,8 +59,13 @@ absl::StatusOr<std::vector<int32_t>> Reconstruction::DetectFeatures(
     default:
       return absl::InternalError("Unknown descriptor type");
   }
+  if (!feature_cache_directory_.empty()) {
+    detector = hello::keypoints::CachedFeature2D::create(
+        detector, feature_cache_directory_);
+  }
 
   for (size_t i = 0; i < images_.size(); ++i) {
+    TRACE_SCOPE("sfm/detect_features");
     std::vector<cv::KeyPoint> kp;
     cv::Mat des;
     cv::Mat gray;
@@ -75,6 +86,7 @@ std::vector<int32_t> Reconstruction::MatchFeatures(float ratio_threshold) {
   std::vector<int32_t> match_counts;
 
   for (size_t i = 0; i < images_.size() - 1; ++i) {
+    TRACE_SCOPE("sfm/match_features");
     std::vector<std::vector<cv::DMatch>> knn_matches;
     std::vector<cv::DMatch> good_matches;
 
@@ -107,6 +119,7 @@ std::vector<int32_t> Reconstruction::MatchFeatures(float ratio_threshold) {
 
 absl::Status Reconstruction::EstimateCameraPoses() {
   for (size_t i = 0; i < feature_matches_.size(); ++i) {
+    TRACE_SCOPE("sfm/estimate_pose");
     std::vector<cv::Point2f> pts1;
     std::vector<cv::Point2f> pts2;
 
@@ -149,6 +162,7 @@ absl::Status Reconstruction::TriangulatePoints() {
   std::vector<cv::Vec3b> all_point_colors;
 
   for (size_t i = 0; i < feature_matches_.size(); ++i) {
+    TRACE_SCOPE("sfm/triangulate");
     // Get camera projection matrices
     cv::Mat P1 = camera_matrix_ * camera_poses_[i];
     cv::Mat P2 = camera_matrix_ * camera_poses_[i + 1];
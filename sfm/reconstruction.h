@@ -1,6 +1,7 @@
 #ifndef RECONSTRUCTION_H
 #define RECONSTRUCTION_H
 
+#include <string>
 #include <vector>
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -20,6 +21,9 @@ class Reconstruction {
   Reconstruction();
 
   void SetIntrinsics(double fx, double fy, double cx, double cy);
+  // Keeps detected features in a hello::keypoints::FeatureCache there, so
+  // that repeat runs skip detection.
+  void SetFeatureCacheDirectory(absl::string_view directory);
   absl::Status LoadImages(const std::vector<std::string>& image_paths);
   absl::StatusOr<std::vector<int32_t>> DetectFeatures(
       DescriptorType descriptor_type = DescriptorType::kSift);
@@ -33,6 +37,7 @@ class Reconstruction {
 
  private:
   cv::Mat camera_matrix_;
+  std::string feature_cache_directory_;
   std::vector<cv::Mat> images_;
   std::vector<cv::Mat> camera_poses_;
   std::vector<std::vector<cv::KeyPoint>> keypoints_;
@@ -1,4 +1,6 @@
 #include <filesystem>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
@@ -6,6 +8,12 @@
 #include "glog/logging.h"
 #include "sfm/reconstruction.h"
 #include "status_macros.h"
+#include "util/trace.h"
+
+ABSL_FLAG(std::string, trace_path, "",
+          "If set, Chrome trace_event JSON of the stages is written there");
+ABSL_FLAG(std::string, feature_cache, "",
+          "If set, detected features are cached in this directory");
 
 absl::StatusOr<std::vector<std::string>> GetFilesFromDirectory(
     absl::string_view dir) {
@@ -32,6 +40,7 @@ absl::Status Run() {
 
   ASSIGN_OR_RETURN(auto image_paths, GetFilesFromDirectory("testdata/sfm"));
   reconstruction.SetIntrinsics(fx, fy, cx, cy);
+  reconstruction.SetFeatureCacheDirectory(absl::GetFlag(FLAGS_feature_cache));
   RETURN_IF_ERROR(reconstruction.LoadImages(image_paths));
   LOG(INFO) << "Detecting features...";
   ASSIGN_OR_RETURN(auto features, reconstruction.DetectFeatures());
@@ -55,11 +64,18 @@ absl::Status Run() {
   LOG(INFO) << absl::StreamFormat("Saving 3D point cloud...");
   RETURN_IF_ERROR(reconstruction.SavePointCloud("/tmp/bottle.ply"));
 
+  LOG(INFO) << "Latency:\n" << hello::util::Tracer::Get().SummaryTable();
+  if (!absl::GetFlag(FLAGS_trace_path).empty()) {
+    RETURN_IF_ERROR(hello::util::Tracer::Get().WriteChromeTrace(
+        absl::GetFlag(FLAGS_trace_path)));
+  }
+
   return absl::OkStatus();
 }
 
 int main(int argc, char** argv) {
   google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
   FLAGS_alsologtostderr = true;
   auto status = Run();
   if (!status.ok()) {
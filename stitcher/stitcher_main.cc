@@ -7,6 +7,8 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "glog/logging.h"
+#include "keypoints/feature_cache.h"
+#include "opencv2/features2d.hpp"
 #include "opencv2/highgui.hpp"
 #include "opencv2/imgcodecs.hpp"
 #include "opencv2/stitching.hpp"
@@ -15,6 +17,8 @@
 ABSL_FLAG(std::string, images_directory, "stitcher/testdata",
           "Directory of images to be stitched");
 ABSL_FLAG(std::string, output_panorama, "", "Output of the stitcher.");
+ABSL_FLAG(std::string, feature_cache, "",
+          "If set, ORB features are cached in this directory");
 
 absl::Status Run() {
   LOG(INFO) << "Running stitcher";
@@ -40,7 +44,25 @@ absl::Status Run() {
 
   cv::Mat pano;
   cv::Ptr<cv::Stitcher> stitcher = cv::Stitcher::create(cv::Stitcher::SCANS);
+  cv::Ptr<hello::keypoints::CachedFeature2D> cached_finder;
+  if (!absl::GetFlag(FLAGS_feature_cache).empty()) {
+    // ORB is the stitcher's default features finder.
+    cached_finder = hello::keypoints::CachedFeature2D::create(
+        cv::ORB::create(), absl::GetFlag(FLAGS_feature_cache));
+    stitcher->setFeaturesFinder(cached_finder);
+  }
+  const int64 start = cv::getTickCount();
   cv::Stitcher::Status status = stitcher->stitch(images, pano);
+  LOG(INFO) << absl::StreamFormat(
+      "Stitched in %.0f ms",
+      (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency());
+  if (cached_finder) {
+    LOG(INFO) << absl::StreamFormat(
+        "Feature cache keypoint hits %d, misses %d, descriptor hits %d, "
+        "misses %d",
+        cached_finder->hits(), cached_finder->misses(),
+        cached_finder->descriptor_hits(), cached_finder->descriptor_misses());
+  }
   if (status != cv::Stitcher::OK) {
     return absl::InternalError(
         absl::StrFormat("Can't stitch images, error code = %i", status));
@@ -0,0 +1,71 @@
+// Runs FlowTrackingPipeline on a video and reports the frame rate and the
+// latency of every stage.
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "status_macros.h"
+#include "tracking/flow_tracking_pipeline.h"
+
+ABSL_FLAG(std::string, video_path, "testdata/test.avi", "Video file path");
+ABSL_FLAG(int32_t, max_frames, 0, "Frames to process at most, 0 for all");
+ABSL_FLAG(bool, use_predictions, true,
+          "Start the optical flow search at the Kalman predictions with a "
+          "smaller window and fewer pyramid levels");
+ABSL_FLAG(int32_t, max_corners, 500, "Corners to track at most");
+
+namespace {
+
+void Report(const char* stage, std::vector<double> ms) {
+  if (ms.empty()) return;
+  std::sort(ms.begin(), ms.end());
+  double total = 0;
+  for (double m : ms) total += m;
+  LOG(INFO) << absl::StreamFormat("%-10s %8.3f %8.3f %8.3f", stage,
+                                  total / ms.size(), ms[ms.size() / 2],
+                                  ms[ms.size() * 99 / 100]);
+}
+
+}  // namespace
+
+absl::Status Run() {
+  hello::tracking::FlowTrackingPipeline::Options options;
+  options.max_frames = absl::GetFlag(FLAGS_max_frames);
+  options.use_predictions = absl::GetFlag(FLAGS_use_predictions);
+  options.max_corners = absl::GetFlag(FLAGS_max_corners);
+  options.min_corners = options.max_corners / 2;
+  ASSIGN_OR_RETURN(const hello::tracking::FlowTrackingStats stats,
+                   hello::tracking::FlowTrackingPipeline(options).Run(
+                       absl::GetFlag(FLAGS_video_path)));
+  if (stats.frames == 0) return absl::NotFoundError("No frames");
+  LOG(INFO) << absl::StreamFormat(
+      "%d frames in %.2f s, %.1f fps, %.0f tracks per frame, %.1f%% "
+      "measured",
+      stats.frames, stats.seconds, stats.fps(),
+      static_cast<double>(stats.tracks) / stats.frames,
+      stats.tracks > 0 ? 100.0 * stats.measured / stats.tracks : 0.0);
+  LOG(INFO) << absl::StreamFormat("%-10s %8s %8s %8s", "stage", "mean_ms",
+                                  "p50_ms", "p99_ms");
+  Report("decode", stats.decode_ms);
+  Report("flow", stats.flow_ms);
+  Report("filter", stats.filter_ms);
+  Report("latency", stats.latency_ms);
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
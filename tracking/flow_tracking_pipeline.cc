@@ -0,0 +1,254 @@
+#include "tracking/flow_tracking_pipeline.h"
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include "absl/strings/str_cat.h"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/video/tracking.hpp"
+#include "opencv2/videoio.hpp"
+#include "tracking/kalman_bank.h"
+#include "util/bounded_queue.h"
+#include "util/trace.h"
+
+namespace hello::tracking {
+namespace {
+
+using Bank = KalmanBank<4, 2>;
+
+double Milliseconds(int64 start) {
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+struct DecodedFrame {
+  // Tick count when decoding started.
+  int64 start;
+  cv::Mat gray;
+  double decode_ms;
+};
+
+// Flow measurements of a frame, one per track in the order of the
+// prediction they started from, and the corners to start new tracks at.
+struct Measurement {
+  int64 start;
+  std::vector<cv::Point2f> points;
+  std::vector<uint8_t> found;
+  std::vector<cv::Point2f> new_corners;
+  double decode_ms;
+  double flow_ms;
+};
+
+// Filtered positions of the tracks in a frame and their predicted
+// positions in the next.
+struct Prediction {
+  std::vector<cv::Point2f> positions;
+  std::vector<cv::Point2f> predicted;
+};
+
+Bank::Model ConstantVelocity(const FlowTrackingPipeline::Options& options) {
+  Bank::Model model;
+  model.transition = {1, 0, 1, 0,  //
+                      0, 1, 0, 1,  //
+                      0, 0, 1, 0,  //
+                      0, 0, 0, 1};
+  model.measurement = {1, 0, 0, 0,  //
+                       0, 1, 0, 0};
+  for (int i = 0; i < 4; ++i) {
+    model.process_noise[i * 4 + i] = options.process_noise;
+  }
+  model.measurement_noise = {options.measurement_noise, 0,  //
+                             0, options.measurement_noise};
+  return model;
+}
+
+void Decode(const FlowTrackingPipeline::Options& options,
+            cv::VideoCapture& capture,
+            util::BoundedQueue<DecodedFrame>& frames) {
+  cv::Mat frame;
+  for (int64_t index = 0;
+       options.max_frames <= 0 || index < options.max_frames; ++index) {
+    DecodedFrame decoded{cv::getTickCount(), cv::Mat(), 0};
+    {
+      TRACE_SCOPE("tracking/flow_pipeline/decode");
+      if (!capture.read(frame)) break;
+      cv::cvtColor(frame, decoded.gray, cv::COLOR_BGR2GRAY);
+      decoded.decode_ms = Milliseconds(decoded.start);
+    }
+    if (!frames.Push(std::move(decoded))) break;
+  }
+  frames.Close();
+}
+
+void Flow(const FlowTrackingPipeline::Options& options,
+          util::BoundedQueue<DecodedFrame>& frames,
+          util::BoundedQueue<Prediction>& predictions,
+          util::BoundedQueue<Measurement>& measurements) {
+  // The pyramids serve both searches.
+  const int32_t pyramid_window =
+      std::max(options.window, options.predicted_window);
+  const int32_t pyramid_levels =
+      std::max(options.levels, options.predicted_levels);
+  const cv::TermCriteria criteria(
+      cv::TermCriteria::MAX_ITER | cv::TermCriteria::EPS, 20, 0.03);
+  std::vector<cv::Mat> previous_pyramid;
+  while (std::optional<DecodedFrame> frame = frames.Pop()) {
+    // Spans and times leave out the waits on the queues, the pyramid is
+    // built while the filter still works on the previous frame.
+    Measurement measurement{frame->start, {}, {}, {}, frame->decode_ms, 0};
+    std::vector<cv::Mat> pyramid;
+    {
+      TRACE_SCOPE("tracking/flow_pipeline/pyramid");
+      const int64 start = cv::getTickCount();
+      cv::buildOpticalFlowPyramid(frame->gray, pyramid,
+                                  cv::Size(pyramid_window, pyramid_window),
+                                  pyramid_levels);
+      measurement.flow_ms = Milliseconds(start);
+    }
+    std::optional<Prediction> prediction;
+    if (!previous_pyramid.empty()) {
+      prediction = predictions.Pop();
+      if (!prediction) break;
+    }
+
+    {
+      TRACE_SCOPE("tracking/flow_pipeline/flow");
+      const int64 start = cv::getTickCount();
+      if (prediction && !prediction->positions.empty()) {
+        int32_t window = options.window;
+        int32_t levels = options.levels;
+        int flags = 0;
+        if (options.use_predictions) {
+          measurement.points = std::move(prediction->predicted);
+          window = options.predicted_window;
+          levels = options.predicted_levels;
+          flags = cv::OPTFLOW_USE_INITIAL_FLOW;
+        }
+        std::vector<float> errors;
+        cv::calcOpticalFlowPyrLK(previous_pyramid, pyramid,
+                                 prediction->positions, measurement.points,
+                                 measurement.found, errors,
+                                 cv::Size(window, window), levels, criteria,
+                                 flags);
+      }
+
+      const int32_t tracked = static_cast<int32_t>(
+          std::count(measurement.found.begin(), measurement.found.end(), 1));
+      if (tracked < options.min_corners) {
+        // Away from the corners still tracked.
+        cv::Mat mask(frame->gray.size(), CV_8U, cv::Scalar(255));
+        for (size_t i = 0; i < measurement.points.size(); ++i) {
+          if (!measurement.found[i]) continue;
+          cv::circle(mask, measurement.points[i],
+                     cvRound(options.min_corner_distance), cv::Scalar(0), -1);
+        }
+        cv::goodFeaturesToTrack(frame->gray, measurement.new_corners,
+                                options.max_corners - tracked,
+                                options.corner_quality,
+                                options.min_corner_distance, mask);
+      }
+      measurement.flow_ms += Milliseconds(start);
+    }
+    previous_pyramid = std::move(pyramid);
+    if (!measurements.Push(std::move(measurement))) break;
+  }
+  // Lets decoding stop too if this stage stopped early.
+  frames.Close();
+  measurements.Close();
+}
+
+void Filter(const FlowTrackingPipeline::Options& options,
+            util::BoundedQueue<Measurement>& measurements,
+            util::BoundedQueue<Prediction>& predictions,
+            FlowTrackingStats& stats) {
+  Bank bank(ConstantVelocity(options));
+  std::vector<int32_t> misses;
+  std::vector<float> planes;
+  std::vector<uint8_t> matched;
+  while (std::optional<Measurement> measurement = measurements.Pop()) {
+    Prediction prediction;
+    {
+      TRACE_SCOPE("tracking/flow_pipeline/filter");
+      const int64 start = cv::getTickCount();
+      const int32_t n = bank.size();
+      planes.assign(2 * n, 0);
+      matched.assign(n, 0);
+      const int32_t num_measured =
+          std::min(n, static_cast<int32_t>(measurement->found.size()));
+      for (int32_t t = 0; t < num_measured; ++t) {
+        if (!measurement->found[t]) continue;
+        const cv::Point2f& p = measurement->points[t];
+        if (bank.MahalanobisSquared(t, {p.x, p.y}) > options.gate) continue;
+        planes[t] = p.x;
+        planes[n + t] = p.y;
+        matched[t] = 1;
+        ++stats.measured;
+      }
+      bank.Correct(planes.data(), matched.data());
+
+      // From the back as Remove() moves the last track into the gap.
+      for (int32_t t = n - 1; t >= 0; --t) {
+        misses[t] = matched[t] ? 0 : misses[t] + 1;
+        if (misses[t] > options.max_misses) {
+          bank.Remove(t);
+          misses[t] = misses.back();
+          misses.pop_back();
+        }
+      }
+      const float variance = options.measurement_noise;
+      const float velocity_variance = options.initial_velocity_variance;
+      for (const cv::Point2f& corner : measurement->new_corners) {
+        bank.Add({corner.x, corner.y, 0, 0},
+                 {variance, variance, velocity_variance, velocity_variance});
+        misses.push_back(0);
+      }
+      stats.tracks += bank.size();
+
+      for (int32_t t = 0; t < bank.size(); ++t) {
+        prediction.positions.emplace_back(bank.state(t, 0), bank.state(t, 1));
+      }
+      bank.Predict();
+      for (int32_t t = 0; t < bank.size(); ++t) {
+        prediction.predicted.emplace_back(bank.state(t, 0), bank.state(t, 1));
+      }
+      stats.decode_ms.push_back(measurement->decode_ms);
+      stats.flow_ms.push_back(measurement->flow_ms);
+      stats.filter_ms.push_back(Milliseconds(start));
+      stats.latency_ms.push_back(Milliseconds(measurement->start));
+      ++stats.frames;
+    }
+    // The flow stage takes it unless the video has ended.
+    if (!predictions.Push(std::move(prediction))) break;
+  }
+  predictions.Close();
+}
+
+}  // namespace
+
+absl::StatusOr<FlowTrackingStats> FlowTrackingPipeline::Run(
+    absl::string_view video_path) const {
+  cv::VideoCapture capture(std::string{video_path});
+  if (!capture.isOpened()) {
+    return absl::InvalidArgumentError(absl::StrCat("No video - ", video_path));
+  }
+  util::BoundedQueue<DecodedFrame> frames(options_.queue_capacity);
+  util::BoundedQueue<Measurement> measurements(options_.queue_capacity);
+  // At most one prediction is ever waiting, the one after the last frame.
+  util::BoundedQueue<Prediction> predictions(2);
+  FlowTrackingStats stats;
+  const int64 start = cv::getTickCount();
+  std::thread decode(Decode, std::cref(options_), std::ref(capture),
+                     std::ref(frames));
+  std::thread flow(Flow, std::cref(options_), std::ref(frames),
+                   std::ref(predictions), std::ref(measurements));
+  std::thread filter(Filter, std::cref(options_), std::ref(measurements),
+                     std::ref(predictions), std::ref(stats));
+  decode.join();
+  flow.join();
+  filter.join();
+  stats.seconds = Milliseconds(start) / 1000;
+  return stats;
+}
+
+}  // namespace hello::tracking
@@ -0,0 +1,82 @@
+#ifndef TRACKING_FLOW_TRACKING_PIPELINE_H_
+#define TRACKING_FLOW_TRACKING_PIPELINE_H_
+
+#include <cstdint>
+#include <vector>
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "opencv2/core.hpp"
+
+namespace hello::tracking {
+
+// Per frame times of a FlowTrackingPipeline run, in milliseconds.
+struct FlowTrackingStats {
+  int64_t frames = 0;
+  double seconds = 0;
+  std::vector<double> decode_ms;
+  std::vector<double> flow_ms;
+  std::vector<double> filter_ms;
+  // From the start of decoding a frame to the end of its correction.
+  std::vector<double> latency_ms;
+  // Tracks and the tracks measured by optical flow, summed over frames.
+  int64_t tracks = 0;
+  int64_t measured = 0;
+
+  double fps() const { return seconds > 0 ? frames / seconds : 0; }
+};
+
+// Tracks corners through a video with pyramidal Lucas-Kanade optical flow
+// fused with constant velocity Kalman filters, in three stages on their own
+// threads joined by bounded queues:
+//  - decode reads and converts the frames to gray,
+//  - flow builds the pyramid of each frame and tracks the corners from
+//    their filtered positions in the previous frame, starting the search
+//    at the positions the filters predict for this frame so that a smaller
+//    window and fewer pyramid levels do, and detects new corners when too
+//    few are left,
+//  - filter corrects the tracks with the flow measurements that fall
+//    within their gate, drops tracks lost for too long, starts tracks for
+//    new corners and predicts the next frame, which it hands back to the
+//    flow stage.
+// The flow stage waits for the predictions of the frame after building its
+// pyramid, so the filter of one frame overlaps the decoding and the pyramid
+// of the next.
+class FlowTrackingPipeline {
+ public:
+  struct Options {
+    int32_t max_frames = 0;  // <= 0 for all.
+    int32_t queue_capacity = 4;
+    int32_t max_corners = 500;
+    // Corners are detected again when fewer than this are tracked.
+    int32_t min_corners = 250;
+    double corner_quality = 0.01;
+    double min_corner_distance = 7;
+    // Search without predictions, on the first frames or when disabled.
+    int32_t window = 21;
+    int32_t levels = 3;
+    // Search starting from the predictions.
+    bool use_predictions = true;
+    int32_t predicted_window = 11;
+    int32_t predicted_levels = 1;
+    // Bound on the squared Mahalanobis distance of a measurement to its
+    // prediction, the 99% chi-square quantile for 2 degrees of freedom.
+    float gate = 9.21f;
+    int32_t max_misses = 3;
+    // Kalman filter variances, in pixels.
+    float process_noise = 0.5f;
+    float measurement_noise = 1;
+    float initial_velocity_variance = 25;
+  };
+
+  explicit FlowTrackingPipeline(const Options& options) : options_(options) {}
+  FlowTrackingPipeline() : FlowTrackingPipeline(Options()) {}
+
+  absl::StatusOr<FlowTrackingStats> Run(absl::string_view video_path) const;
+
+ private:
+  const Options options_;
+};
+
+}  // namespace hello::tracking
+
+#endif  // TRACKING_FLOW_TRACKING_PIPELINE_H_
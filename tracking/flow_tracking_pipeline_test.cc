@@ -0,0 +1,38 @@
+#include "tracking/flow_tracking_pipeline.h"
+#include <memory>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+#include "tools/cpp/runfiles/runfiles.h"
+
+namespace hello::tracking {
+namespace {
+
+using ::bazel::tools::cpp::runfiles::Runfiles;
+using ::testing::Eq;
+using ::testing::Gt;
+using ::testing::NotNull;
+using ::testing::SizeIs;
+
+constexpr char kVideoPath[] = "_main/testdata/test.avi";
+
+TEST(FlowTrackingPipeline, TracksCornersThroughTheVideo) {
+  std::unique_ptr<Runfiles> runfiles(Runfiles::CreateForTest());
+  ASSERT_THAT(runfiles, NotNull());
+  FlowTrackingPipeline::Options options;
+  options.max_frames = 20;
+  absl::StatusOr<FlowTrackingStats> stats =
+      FlowTrackingPipeline(options).Run(runfiles->Rlocation(kVideoPath));
+  ASSERT_TRUE(stats.ok()) << stats.status();
+  EXPECT_THAT(stats->frames, Eq(20));
+  EXPECT_THAT(stats->latency_ms, SizeIs(20));
+  EXPECT_THAT(stats->tracks, Gt(0));
+  // Most tracks keep being found by the flow between frames.
+  EXPECT_THAT(stats->measured, Gt(stats->tracks / 2));
+}
+
+TEST(FlowTrackingPipeline, FailsOnMissingVideo) {
+  EXPECT_FALSE(FlowTrackingPipeline().Run("no_such_video.avi").ok());
+}
+
+}  // namespace
+}  // namespace hello::tracking
@@ -0,0 +1,346 @@
+#ifndef TRACKING_KALMAN_BANK_H_
+#define TRACKING_KALMAN_BANK_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace hello::tracking {
+
+// Linear Kalman filters for many tracks that share one model, with the
+// state and measurement sizes fixed at compile time. Tracks are stored as
+// a structure of arrays: every state element and every covariance entry
+// is a plane of floats indexed by track, so Predict() and Correct() run
+// the same small, fully unrolled matrix arithmetic over contiguous lanes
+// of tracks, which the compiler vectorizes. Both work through blocks of
+// kBlock tracks with scratch space on the stack and don't allocate.
+template <int N, int M>
+class KalmanBank {
+ public:
+  static_assert(N > 0 && M > 0, "Dimensions must be positive");
+
+  // Row-major matrices of the model, the noise covariances symmetric.
+  struct Model {
+    // N x N state transition.
+    std::array<float, N * N> transition{};
+    // M x N measurement matrix.
+    std::array<float, M * N> measurement{};
+    // N x N process noise covariance.
+    std::array<float, N * N> process_noise{};
+    // M x M measurement noise covariance.
+    std::array<float, M * M> measurement_noise{};
+  };
+
+  // Tracks processed together, the scratch space of a block lives on the
+  // stack.
+  static constexpr int kBlock = 64;
+
+  explicit KalmanBank(const Model& model, int32_t capacity = 1024)
+      : model_(model) {
+    Reserve(std::max(capacity, 1));
+  }
+
+  int32_t size() const { return size_; }
+
+  // Adds a track with the given state and a diagonal covariance, returns
+  // its index. Allocates only when the capacity is exceeded.
+  int32_t Add(const std::array<float, N>& state, float variance) {
+    std::array<float, N> variances;
+    variances.fill(variance);
+    return Add(state, variances);
+  }
+  // As above with a variance for every state element.
+  int32_t Add(const std::array<float, N>& state,
+              const std::array<float, N>& variances) {
+    if (size_ == capacity_) Reserve(2 * capacity_);
+    const int32_t t = size_++;
+    for (int i = 0; i < N; ++i) {
+      state_[i * capacity_ + t] = state[i];
+      for (int j = 0; j < N; ++j) {
+        covariance_[(i * N + j) * capacity_ + t] = i == j ? variances[i] : 0;
+      }
+    }
+    return t;
+  }
+
+  // Removes track t, the last track takes its index.
+  void Remove(int32_t t) {
+    const int32_t last = --size_;
+    for (int i = 0; i < N; ++i) {
+      state_[i * capacity_ + t] = state_[i * capacity_ + last];
+    }
+    for (int i = 0; i < N * N; ++i) {
+      covariance_[i * capacity_ + t] = covariance_[i * capacity_ + last];
+    }
+  }
+
+  void Clear() { size_ = 0; }
+
+  float state(int32_t t, int i) const { return state_[i * capacity_ + t]; }
+  float covariance(int32_t t, int i, int j) const {
+    return covariance_[(i * N + j) * capacity_ + t];
+  }
+
+  // x = F x, P = F P F^T + Q for all tracks.
+  void Predict() {
+    const float* f = model_.transition.data();
+    for (int32_t begin = 0; begin < size_; begin += kBlock) {
+      const int n = std::min<int32_t>(kBlock, size_ - begin);
+      float x[N][kBlock];
+      for (int i = 0; i < N; ++i) {
+        Zero(x[i], n);
+        for (int j = 0; j < N; ++j) {
+          Axpy(f[i * N + j], StatePlane(j) + begin, x[i], n);
+        }
+      }
+      for (int i = 0; i < N; ++i) std::copy_n(x[i], n, StatePlane(i) + begin);
+
+      // fp = F P, then P = fp F^T + Q. Only the upper triangle of P is
+      // computed and mirrored, which also keeps rounding from building up
+      // an antisymmetric part.
+      float fp[N * N][kBlock];
+      for (int i = 0; i < N; ++i) {
+        for (int k = 0; k < N; ++k) {
+          float* out = fp[i * N + k];
+          Zero(out, n);
+          for (int j = 0; j < N; ++j) {
+            Axpy(f[i * N + j], CovariancePlane(j, k) + begin, out, n);
+          }
+        }
+      }
+      for (int i = 0; i < N; ++i) {
+        for (int k = i; k < N; ++k) {
+          float* out = CovariancePlane(i, k) + begin;
+          Fill(out, model_.process_noise[i * N + k], n);
+          for (int j = 0; j < N; ++j) {
+            Axpy(f[k * N + j], fp[i * N + j], out, n);
+          }
+          if (k != i) std::copy_n(out, n, CovariancePlane(k, i) + begin);
+        }
+      }
+    }
+  }
+
+  // Corrects every track with its measurement. `measurements` holds M
+  // planes of size() floats, element m of the measurement of track t at
+  // [m * size() + t]. Tracks whose `mask` entry is 0 keep their predicted
+  // state, a null mask corrects all.
+  void Correct(const float* measurements, const uint8_t* mask = nullptr) {
+    const float* h = model_.measurement.data();
+    for (int32_t begin = 0; begin < size_; begin += kBlock) {
+      const int n = std::min<int32_t>(kBlock, size_ - begin);
+      // Innovation y = z - H x, 0 for masked tracks whose measurement may
+      // be anything.
+      float y[M][kBlock];
+      for (int m = 0; m < M; ++m) {
+        std::copy_n(measurements + m * size_ + begin, n, y[m]);
+        for (int j = 0; j < N; ++j) {
+          Axpy(-h[m * N + j], StatePlane(j) + begin, y[m], n);
+        }
+        if (mask != nullptr) {
+          for (int t = 0; t < n; ++t) y[m][t] = mask[begin + t] ? y[m][t] : 0;
+        }
+      }
+      // pht = P H^T, N x M.
+      float pht[N * M][kBlock];
+      for (int i = 0; i < N; ++i) {
+        for (int m = 0; m < M; ++m) {
+          float* out = pht[i * M + m];
+          Zero(out, n);
+          for (int j = 0; j < N; ++j) {
+            Axpy(h[m * N + j], CovariancePlane(i, j) + begin, out, n);
+          }
+        }
+      }
+      float s_inv[M * M][kBlock];
+      InnovationInverse(pht, n, s_inv);
+      // Gain K = P H^T S^-1, zeroed for masked tracks so that the update
+      // below leaves them as they are.
+      float k[N * M][kBlock];
+      for (int i = 0; i < N; ++i) {
+        for (int m = 0; m < M; ++m) {
+          float* out = k[i * M + m];
+          Zero(out, n);
+          for (int b = 0; b < M; ++b) {
+            Multiply(pht[i * M + b], s_inv[b * M + m], out, n);
+          }
+          if (mask != nullptr) {
+            for (int t = 0; t < n; ++t) out[t] = mask[begin + t] ? out[t] : 0;
+          }
+        }
+      }
+      // x += K y, P -= K (P H^T)^T, upper triangle mirrored as above.
+      for (int i = 0; i < N; ++i) {
+        for (int m = 0; m < M; ++m) {
+          Multiply(k[i * M + m], y[m], StatePlane(i) + begin, n);
+        }
+      }
+      for (int i = 0; i < N; ++i) {
+        for (int j = i; j < N; ++j) {
+          float* out = CovariancePlane(i, j) + begin;
+          for (int m = 0; m < M; ++m) {
+            MultiplySubtract(k[i * M + m], pht[j * M + m], out, n);
+          }
+          if (j != i) std::copy_n(out, n, CovariancePlane(j, i) + begin);
+        }
+      }
+    }
+  }
+
+  // Predicted measurement H x of track t.
+  std::array<float, M> PredictedMeasurement(int32_t t) const {
+    const float* h = model_.measurement.data();
+    std::array<float, M> z{};
+    for (int a = 0; a < M; ++a) {
+      for (int j = 0; j < N; ++j) z[a] += h[a * N + j] * state(t, j);
+    }
+    return z;
+  }
+
+  // Innovation covariance S = H P H^T + R of track t, row-major.
+  std::array<float, M * M> InnovationCovariance(int32_t t) const {
+    const float* h = model_.measurement.data();
+    std::array<float, M * M> s;
+    for (int a = 0; a < M; ++a) {
+      for (int b = 0; b < M; ++b) {
+        float sum = model_.measurement_noise[a * M + b];
+        for (int i = 0; i < N; ++i) {
+          for (int j = 0; j < N; ++j) {
+            sum += h[a * N + i] * covariance(t, i, j) * h[b * N + j];
+          }
+        }
+        s[a * M + b] = sum;
+      }
+    }
+    return s;
+  }
+
+  // Squared Mahalanobis distance of measurement z to the predicted
+  // measurement of track t, under the innovation covariance.
+  float MahalanobisSquared(int32_t t, const std::array<float, M>& z) const {
+    const std::array<float, M> predicted = PredictedMeasurement(t);
+    const std::array<float, M * M> covariance = InnovationCovariance(t);
+    float y[M];
+    float s[M][2 * M];
+    for (int a = 0; a < M; ++a) {
+      y[a] = z[a] - predicted[a];
+      for (int b = 0; b < M; ++b) {
+        s[a][b] = covariance[a * M + b];
+        s[a][M + b] = a == b ? 1.f : 0.f;
+      }
+    }
+    GaussJordan(s);
+    float d = 0;
+    for (int a = 0; a < M; ++a) {
+      for (int b = 0; b < M; ++b) d += y[a] * s[a][M + b] * y[b];
+    }
+    return d;
+  }
+
+ private:
+  float* StatePlane(int i) { return state_.data() + i * capacity_; }
+  float* CovariancePlane(int i, int j) {
+    return covariance_.data() + (i * N + j) * capacity_;
+  }
+
+  void Reserve(int32_t capacity) {
+    std::vector<float> state(N * capacity);
+    std::vector<float> covariance(N * N * capacity);
+    for (int i = 0; i < N; ++i) {
+      std::copy_n(state_.data() + i * capacity_, size_,
+                  state.data() + i * capacity);
+    }
+    for (int i = 0; i < N * N; ++i) {
+      std::copy_n(covariance_.data() + i * capacity_, size_,
+                  covariance.data() + i * capacity);
+    }
+    state_ = std::move(state);
+    covariance_ = std::move(covariance);
+    capacity_ = capacity;
+  }
+
+  // S^-1 for every lane with S = H P H^T + R = H pht + R, by Gauss-Jordan
+  // elimination without pivoting, S is symmetric positive definite.
+  void InnovationInverse(const float (*pht)[kBlock], int n,
+                         float (*s_inv)[kBlock]) const {
+    const float* h = model_.measurement.data();
+    float s[M * M][kBlock];
+    for (int a = 0; a < M; ++a) {
+      for (int b = 0; b < M; ++b) {
+        float* out = s[a * M + b];
+        Fill(out, model_.measurement_noise[a * M + b], n);
+        for (int i = 0; i < N; ++i) {
+          Axpy(h[a * N + i], pht[i * M + b], out, n);
+        }
+        Fill(s_inv[a * M + b], a == b ? 1.f : 0.f, n);
+      }
+    }
+    for (int p = 0; p < M; ++p) {
+      float inv_pivot[kBlock];
+      for (int t = 0; t < n; ++t) inv_pivot[t] = 1.f / s[p * M + p][t];
+      for (int c = 0; c < M; ++c) {
+        for (int t = 0; t < n; ++t) {
+          s[p * M + c][t] *= inv_pivot[t];
+          s_inv[p * M + c][t] *= inv_pivot[t];
+        }
+      }
+      for (int r = 0; r < M; ++r) {
+        if (r == p) continue;
+        float factor[kBlock];
+        std::copy_n(s[r * M + p], n, factor);
+        for (int c = 0; c < M; ++c) {
+          MultiplySubtract(factor, s[p * M + c], s[r * M + c], n);
+          MultiplySubtract(factor, s_inv[p * M + c], s_inv[r * M + c], n);
+        }
+      }
+    }
+  }
+
+  // Inverts the left half of [S | I] into the right half.
+  static void GaussJordan(float (&s)[M][2 * M]) {
+    for (int p = 0; p < M; ++p) {
+      const float inv_pivot = 1.f / s[p][p];
+      for (int c = 0; c < 2 * M; ++c) s[p][c] *= inv_pivot;
+      for (int r = 0; r < M; ++r) {
+        if (r == p) continue;
+        const float factor = s[r][p];
+        for (int c = 0; c < 2 * M; ++c) s[r][c] -= factor * s[p][c];
+      }
+    }
+  }
+
+  static void Zero(float* out, int n) { std::fill_n(out, n, 0.f); }
+  static void Fill(float* out, float value, int n) {
+    std::fill_n(out, n, value);
+  }
+  // out += a * x
+  static void Axpy(float a, const float* __restrict x, float* __restrict out,
+                   int n) {
+    for (int t = 0; t < n; ++t) out[t] += a * x[t];
+  }
+  // out += x * y, lane by lane.
+  static void Multiply(const float* __restrict x, const float* __restrict y,
+                       float* __restrict out, int n) {
+    for (int t = 0; t < n; ++t) out[t] += x[t] * y[t];
+  }
+  // out -= x * y, lane by lane.
+  static void MultiplySubtract(const float* __restrict x,
+                               const float* __restrict y,
+                               float* __restrict out, int n) {
+    for (int t = 0; t < n; ++t) out[t] -= x[t] * y[t];
+  }
+
+  const Model model_;
+  int32_t size_ = 0;
+  int32_t capacity_ = 0;
+  // N planes of capacity_ floats.
+  std::vector<float> state_;
+  // N * N planes of capacity_ floats, row-major.
+  std::vector<float> covariance_;
+};
+
+}  // namespace hello::tracking
+
+#endif  // TRACKING_KALMAN_BANK_H_
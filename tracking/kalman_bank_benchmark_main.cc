@@ -0,0 +1,149 @@
+// Tracks per second of KalmanBank against one cv::KalmanFilter per track,
+// for a 2D constant velocity model with position measurements. Both get
+// the same measurements, the largest state difference between them is
+// reported as a check.
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "opencv2/video/tracking.hpp"
+#include "tracking/kalman_bank.h"
+
+ABSL_FLAG(std::string, tracks, "1000,10000,100000",
+          "Comma separated numbers of tracks");
+ABSL_FLAG(int32_t, frames, 50, "Predict and correct steps per run");
+
+namespace {
+
+using Bank = hello::tracking::KalmanBank<4, 2>;
+
+double Milliseconds(int64 start) {
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+Bank::Model ConstantVelocity() {
+  Bank::Model model;
+  model.transition = {1, 0, 1, 0, 0, 1, 0, 1, 0, 0, 1, 0, 0, 0, 0, 1};
+  model.measurement = {1, 0, 0, 0, 0, 1, 0, 0};
+  for (int i = 0; i < 4; ++i) model.process_noise[i * 4 + i] = 1e-2f;
+  model.measurement_noise = {1, 0, 0, 1};
+  return model;
+}
+
+void Benchmark(int32_t num_tracks, int32_t frames) {
+  const Bank::Model model = ConstantVelocity();
+  cv::RNG rng(num_tracks);
+  std::vector<std::array<float, 4>> initial(num_tracks);
+  for (std::array<float, 4>& state : initial) {
+    state = {rng.uniform(0.f, 1000.f), rng.uniform(0.f, 1000.f),
+             rng.uniform(-5.f, 5.f), rng.uniform(-5.f, 5.f)};
+  }
+  // Measurements of all frames in the plane layout of the bank.
+  std::vector<float> measurements(static_cast<size_t>(frames) * 2 *
+                                  num_tracks);
+  for (int32_t f = 0; f < frames; ++f) {
+    float* z = &measurements[static_cast<size_t>(f) * 2 * num_tracks];
+    for (int32_t t = 0; t < num_tracks; ++t) {
+      z[t] = initial[t][0] + (f + 1) * initial[t][2] + rng.gaussian(1);
+      z[num_tracks + t] =
+          initial[t][1] + (f + 1) * initial[t][3] + rng.gaussian(1);
+    }
+  }
+
+  std::vector<cv::KalmanFilter> filters(num_tracks);
+  for (int32_t t = 0; t < num_tracks; ++t) {
+    cv::KalmanFilter& filter = filters[t];
+    filter.init(4, 2, 0);
+    cv::Mat(4, 4, CV_32F, const_cast<float*>(model.transition.data()))
+        .copyTo(filter.transitionMatrix);
+    cv::Mat(2, 4, CV_32F, const_cast<float*>(model.measurement.data()))
+        .copyTo(filter.measurementMatrix);
+    cv::setIdentity(filter.processNoiseCov, cv::Scalar(1e-2));
+    cv::setIdentity(filter.measurementNoiseCov, cv::Scalar(1));
+    cv::setIdentity(filter.errorCovPost, cv::Scalar(10));
+    cv::Mat(4, 1, CV_32F, initial[t].data()).copyTo(filter.statePost);
+  }
+  cv::Mat z(2, 1, CV_32F);
+  int64 start = cv::getTickCount();
+  for (int32_t f = 0; f < frames; ++f) {
+    const float* frame = &measurements[static_cast<size_t>(f) * 2 *
+                                       num_tracks];
+    for (int32_t t = 0; t < num_tracks; ++t) {
+      filters[t].predict();
+      z.at<float>(0) = frame[t];
+      z.at<float>(1) = frame[num_tracks + t];
+      filters[t].correct(z);
+    }
+  }
+  const double opencv_ms = Milliseconds(start);
+
+  Bank bank(model, num_tracks);
+  for (const std::array<float, 4>& state : initial) bank.Add(state, 10);
+  start = cv::getTickCount();
+  for (int32_t f = 0; f < frames; ++f) {
+    bank.Predict();
+    bank.Correct(&measurements[static_cast<size_t>(f) * 2 * num_tracks]);
+  }
+  const double bank_ms = Milliseconds(start);
+
+  double max_difference = 0;
+  for (int32_t t = 0; t < num_tracks; ++t) {
+    for (int i = 0; i < 4; ++i) {
+      max_difference =
+          std::max<double>(max_difference,
+                           std::abs(bank.state(t, i) -
+                                    filters[t].statePost.at<float>(i)));
+    }
+  }
+  const double updates = static_cast<double>(num_tracks) * frames;
+  LOG(INFO) << absl::StreamFormat("%8d %14.0f %14.0f %8.1fx %12.2e",
+                                  num_tracks, updates * 1000 / opencv_ms,
+                                  updates * 1000 / bank_ms,
+                                  opencv_ms / bank_ms, max_difference);
+}
+
+}  // namespace
+
+absl::Status Run() {
+  std::vector<int32_t> track_counts;
+  for (absl::string_view count :
+       absl::StrSplit(absl::GetFlag(FLAGS_tracks), ',', absl::SkipEmpty())) {
+    int32_t value;
+    if (!absl::SimpleAtoi(count, &value) || value <= 0) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Bad number of tracks - ", count));
+    }
+    track_counts.push_back(value);
+  }
+  const int32_t frames = absl::GetFlag(FLAGS_frames);
+  if (frames <= 0) {
+    return absl::InvalidArgumentError("--frames must be positive");
+  }
+  LOG(INFO) << absl::StreamFormat("%8s %14s %14s %9s %12s", "tracks",
+                                  "opencv_per_s", "bank_per_s", "speedup",
+                                  "max_diff");
+  for (int32_t num_tracks : track_counts) Benchmark(num_tracks, frames);
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+#include "tracking/kalman_bank.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+#include "opencv2/video/tracking.hpp"
+
+namespace hello::tracking {
+namespace {
+
+using ::testing::Eq;
+using ::testing::FloatNear;
+
+using ConstantVelocityBank = KalmanBank<4, 2>;
+
+// x, y, vx, vy, measuring the position.
+ConstantVelocityBank::Model ConstantVelocity() {
+  ConstantVelocityBank::Model model;
+  model.transition = {1, 0, 1, 0,  //
+                      0, 1, 0, 1,  //
+                      0, 0, 1, 0,  //
+                      0, 0, 0, 1};
+  model.measurement = {1, 0, 0, 0,  //
+                       0, 1, 0, 0};
+  for (int i = 0; i < 4; ++i) model.process_noise[i * 4 + i] = 1e-2f;
+  model.measurement_noise = {0.5f, 0.1f,  //
+                             0.1f, 0.5f};
+  return model;
+}
+
+cv::KalmanFilter MakeFilter(const ConstantVelocityBank::Model& model,
+                            const std::array<float, 4>& state,
+                            float variance) {
+  cv::KalmanFilter filter(4, 2, 0);
+  cv::Mat(4, 4, CV_32F, const_cast<float*>(model.transition.data()))
+      .copyTo(filter.transitionMatrix);
+  cv::Mat(2, 4, CV_32F, const_cast<float*>(model.measurement.data()))
+      .copyTo(filter.measurementMatrix);
+  cv::Mat(4, 4, CV_32F, const_cast<float*>(model.process_noise.data()))
+      .copyTo(filter.processNoiseCov);
+  cv::Mat(2, 2, CV_32F, const_cast<float*>(model.measurement_noise.data()))
+      .copyTo(filter.measurementNoiseCov);
+  cv::Mat(4, 1, CV_32F, const_cast<float*>(state.data()))
+      .copyTo(filter.statePost);
+  cv::setIdentity(filter.errorCovPost, cv::Scalar(variance));
+  return filter;
+}
+
+TEST(KalmanBank, MatchesKalmanFilter) {
+  const ConstantVelocityBank::Model model = ConstantVelocity();
+  // More tracks than a block, and a small capacity to have the bank grow.
+  constexpr int32_t kTracks = 150;
+  ConstantVelocityBank bank(model, 16);
+  std::vector<cv::KalmanFilter> filters;
+  cv::RNG rng(7);
+  for (int32_t t = 0; t < kTracks; ++t) {
+    const std::array<float, 4> state = {
+        rng.uniform(0.f, 100.f), rng.uniform(0.f, 100.f),
+        rng.uniform(-2.f, 2.f), rng.uniform(-2.f, 2.f)};
+    EXPECT_THAT(bank.Add(state, 2), Eq(t));
+    filters.push_back(MakeFilter(model, state, 2));
+  }
+
+  std::vector<float> measurements(2 * kTracks);
+  std::vector<uint8_t> mask(kTracks);
+  for (int32_t step = 0; step < 20; ++step) {
+    bank.Predict();
+    for (int32_t t = 0; t < kTracks; ++t) {
+      const cv::Mat predicted = filters[t].predict();
+      mask[t] = (t + step) % 3 != 0;
+      measurements[t] = predicted.at<float>(0) + rng.gaussian(1);
+      measurements[kTracks + t] = predicted.at<float>(1) + rng.gaussian(1);
+      if (mask[t]) {
+        filters[t].correct((cv::Mat_<float>(2, 1) << measurements[t],
+                            measurements[kTracks + t]));
+      }
+    }
+    bank.Correct(measurements.data(), mask.data());
+
+    for (int32_t t = 0; t < kTracks; ++t) {
+      // Without a measurement the filter keeps the prediction.
+      const cv::Mat& state =
+          mask[t] ? filters[t].statePost : filters[t].statePre;
+      const cv::Mat& covariance =
+          mask[t] ? filters[t].errorCovPost : filters[t].errorCovPre;
+      for (int i = 0; i < 4; ++i) {
+        ASSERT_THAT(bank.state(t, i), FloatNear(state.at<float>(i), 1e-3f))
+            << "track " << t << " step " << step;
+        for (int j = 0; j < 4; ++j) {
+          ASSERT_THAT(bank.covariance(t, i, j),
+                      FloatNear(covariance.at<float>(i, j), 1e-4f))
+              << "track " << t << " step " << step;
+        }
+      }
+    }
+  }
+}
+
+TEST(KalmanBank, RemoveMovesTheLastTrack) {
+  ConstantVelocityBank bank(ConstantVelocity());
+  bank.Add({1, 2, 3, 4}, 1);
+  bank.Add({5, 6, 7, 8}, 2);
+  bank.Add({9, 10, 11, 12}, 3);
+  bank.Remove(0);
+  EXPECT_THAT(bank.size(), Eq(2));
+  EXPECT_THAT(bank.state(0, 0), Eq(9));
+  EXPECT_THAT(bank.covariance(0, 1, 1), Eq(3));
+  EXPECT_THAT(bank.state(1, 0), Eq(5));
+  bank.Clear();
+  EXPECT_THAT(bank.size(), Eq(0));
+}
+
+TEST(KalmanBank, ScalarFilter) {
+  // A constant observed directly converges to the mean of the
+  // measurements: with no process noise, the filter is the running mean.
+  KalmanBank<1, 1>::Model model;
+  model.transition = {1};
+  model.measurement = {1};
+  model.measurement_noise = {1};
+  KalmanBank<1, 1> bank(model);
+  bank.Add({0}, 1e6f);
+  const std::array<float, 4> measurements = {2, 4, 6, 8};
+  for (float z : measurements) {
+    bank.Predict();
+    bank.Correct(&z);
+  }
+  EXPECT_THAT(bank.state(0, 0), FloatNear(5, 1e-3f));
+  EXPECT_THAT(bank.covariance(0, 0, 0), FloatNear(0.25f, 1e-4f));
+}
+
+TEST(KalmanBank, MahalanobisSquared) {
+  ConstantVelocityBank::Model model = ConstantVelocity();
+  model.measurement_noise = {1, 0, 0, 3};
+  ConstantVelocityBank bank(model);
+  bank.Add({10, 20, 0, 0}, 1);
+  // S = diag(2, 4).
+  EXPECT_THAT(bank.MahalanobisSquared(0, {10, 20}), FloatNear(0, 1e-6f));
+  EXPECT_THAT(bank.MahalanobisSquared(0, {12, 20}), FloatNear(2, 1e-5f));
+  EXPECT_THAT(bank.MahalanobisSquared(0, {12, 24}), FloatNear(6, 1e-5f));
+}
+
+}  // namespace
+}  // namespace hello::tracking
@@ -1,14 +1,86 @@
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "tracking/simulation.h"
 #include "tracking/tracking.h"
 
 ABSL_FLAG(std::string, image_path, "testdata/test.avi", "Image file path");
+ABSL_FLAG(bool, headless, false,
+          "Run the simulation as fast as possible without a window and "
+          "compare cv::KalmanFilter with KalmanBank");
+ABSL_FLAG(uint64_t, seed, 0x5eed, "Seed of the headless simulation");
+ABSL_FLAG(int32_t, steps, 100000, "Steps of the headless simulation");
+ABSL_FLAG(int32_t, targets, 1, "Targets of the headless simulation");
+ABSL_FLAG(std::string, trace_csv, "",
+          "Writes the per step errors and timings of the headless "
+          "simulation to this file if set");
+
+namespace {
+
+void Summarize(const char* name, const hello::tracking::SimulationTrace& trace,
+               int32_t targets) {
+  std::vector<double> seconds = trace.seconds;
+  std::sort(seconds.begin(), seconds.end());
+  double total = 0;
+  for (double s : seconds) total += s;
+  LOG(INFO) << absl::StreamFormat(
+      "%-14s %10.6f %10.3f %10.3f %10.3f %14.0f", name, trace.RmsError(),
+      total / seconds.size() * 1e6, seconds[seconds.size() / 2] * 1e6,
+      seconds[seconds.size() * 99 / 100] * 1e6,
+      seconds.size() * static_cast<double>(targets) / total);
+}
+
+absl::Status WriteTraces(const std::string& path,
+                         const hello::tracking::SimulationTrace& opencv,
+                         const hello::tracking::SimulationTrace& bank) {
+  std::ofstream out(path);
+  if (!out) return absl::InternalError(absl::StrCat("Can't write ", path));
+  out << "step,opencv_squared_error,bank_squared_error,opencv_us,bank_us\n";
+  for (size_t i = 0; i < opencv.seconds.size(); ++i) {
+    out << absl::StreamFormat("%d,%g,%g,%.3f,%.3f\n", i,
+                              opencv.squared_errors[i], bank.squared_errors[i],
+                              opencv.seconds[i] * 1e6, bank.seconds[i] * 1e6);
+  }
+  out.close();
+  if (!out) return absl::InternalError(absl::StrCat("Can't write ", path));
+  return absl::OkStatus();
+}
+
+absl::Status RunHeadless() {
+  hello::tracking::SimulationOptions options;
+  options.seed = absl::GetFlag(FLAGS_seed);
+  options.steps = absl::GetFlag(FLAGS_steps);
+  options.targets = absl::GetFlag(FLAGS_targets);
+  if (options.steps <= 0 || options.targets <= 0) {
+    return absl::InvalidArgumentError(
+        "--steps and --targets must be positive");
+  }
+  const hello::tracking::SimulationTrace opencv =
+      hello::tracking::SimulateKalmanFilter(options);
+  const hello::tracking::SimulationTrace bank =
+      hello::tracking::SimulateKalmanBank(options);
+  LOG(INFO) << absl::StreamFormat("%-14s %10s %10s %10s %10s %14s", "filter",
+                                  "rms_error", "mean_us", "p50_us", "p99_us",
+                                  "updates_per_s");
+  Summarize("KalmanFilter", opencv, options.targets);
+  Summarize("KalmanBank", bank, options.targets);
+  const std::string trace_csv = absl::GetFlag(FLAGS_trace_csv);
+  if (!trace_csv.empty()) return WriteTraces(trace_csv, opencv, bank);
+  return absl::OkStatus();
+}
+
+}  // namespace
 
 absl::Status Run() {
+  if (absl::GetFlag(FLAGS_headless)) return RunHeadless();
   return hello::tracking::Kalman(absl::GetFlag(FLAGS_image_path));
 }
 
@@ -20,4 +92,4 @@ int main(int argc, char** argv) {
   }
   LOG(INFO) << "Done";
   return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,160 @@
+// Per-frame latency of MultiObjectTracker on simulated scenes: objects
+// move at constant velocity with random accelerations and bounce off the
+// borders, each is detected with some probability and position noise, and
+// clutter detections are spread uniformly. Identity switches, a confirmed
+// track changing the object it follows, measure the association quality.
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "opencv2/core.hpp"
+#include "tracking/multi_object_tracker.h"
+
+ABSL_FLAG(std::string, objects, "1000,5000,10000",
+          "Comma separated numbers of objects");
+ABSL_FLAG(int32_t, frames, 100, "Frames per run");
+ABSL_FLAG(int32_t, width, 3840, "Scene width in pixels");
+ABSL_FLAG(int32_t, height, 2160, "Scene height in pixels");
+ABSL_FLAG(double, detection_probability, 0.95,
+          "Probability that an object is detected in a frame");
+ABSL_FLAG(double, clutter, 0.05,
+          "Clutter detections per frame as a fraction of the objects");
+ABSL_FLAG(double, noise, 1, "Standard deviation of detected positions");
+
+namespace {
+
+struct Object {
+  cv::Point2f position;
+  cv::Point2f velocity;
+};
+
+void Benchmark(int32_t num_objects) {
+  const int32_t frames = absl::GetFlag(FLAGS_frames);
+  const float width = static_cast<float>(absl::GetFlag(FLAGS_width));
+  const float height = static_cast<float>(absl::GetFlag(FLAGS_height));
+  const double detection_probability =
+      absl::GetFlag(FLAGS_detection_probability);
+  const int32_t clutter =
+      static_cast<int32_t>(absl::GetFlag(FLAGS_clutter) * num_objects);
+  const double noise = absl::GetFlag(FLAGS_noise);
+
+  cv::RNG rng(num_objects);
+  std::vector<Object> objects(num_objects);
+  for (Object& object : objects) {
+    object.position = {rng.uniform(0.f, width), rng.uniform(0.f, height)};
+    object.velocity = {rng.uniform(-3.f, 3.f), rng.uniform(-3.f, 3.f)};
+  }
+
+  hello::tracking::MultiObjectTracker tracker;
+  std::vector<cv::Point2f> detections;
+  // Object of every detection, -1 for clutter.
+  std::vector<int32_t> truth;
+  std::unordered_map<int64_t, int32_t> followed;
+  std::vector<double> ms;
+  double gate_ms = 0;
+  double assignment_ms = 0;
+  int64_t gated_pairs = 0;
+  int64_t switches = 0;
+  size_t confirmed = 0;
+  for (int32_t frame = 0; frame < frames; ++frame) {
+    detections.clear();
+    truth.clear();
+    for (int32_t i = 0; i < num_objects; ++i) {
+      Object& object = objects[i];
+      object.velocity += cv::Point2f(static_cast<float>(rng.gaussian(0.1)),
+                                     static_cast<float>(rng.gaussian(0.1)));
+      object.position += object.velocity;
+      if (object.position.x < 0 || object.position.x >= width) {
+        object.velocity.x = -object.velocity.x;
+        object.position.x = std::clamp(object.position.x, 0.f, width - 1);
+      }
+      if (object.position.y < 0 || object.position.y >= height) {
+        object.velocity.y = -object.velocity.y;
+        object.position.y = std::clamp(object.position.y, 0.f, height - 1);
+      }
+      if (rng.uniform(0., 1.) >= detection_probability) continue;
+      detections.push_back(
+          object.position +
+          cv::Point2f(static_cast<float>(rng.gaussian(noise)),
+                      static_cast<float>(rng.gaussian(noise))));
+      truth.push_back(i);
+    }
+    for (int32_t i = 0; i < clutter; ++i) {
+      detections.emplace_back(rng.uniform(0.f, width),
+                              rng.uniform(0.f, height));
+      truth.push_back(-1);
+    }
+
+    const std::vector<hello::tracking::MultiObjectTracker::Track> tracks =
+        tracker.Update(detections);
+    const hello::tracking::MultiObjectTrackerStats& stats = tracker.stats();
+    ms.push_back(stats.seconds * 1000);
+    gate_ms += stats.gate_seconds * 1000;
+    assignment_ms += stats.assignment_seconds * 1000;
+    gated_pairs += stats.gated_pairs;
+    confirmed = tracks.size();
+    for (const auto& track : tracks) {
+      if (track.detection < 0 || truth[track.detection] < 0) continue;
+      auto [it, inserted] =
+          followed.emplace(track.id, truth[track.detection]);
+      if (!inserted && it->second != truth[track.detection]) {
+        ++switches;
+        it->second = truth[track.detection];
+      }
+    }
+  }
+
+  double total = 0;
+  for (double m : ms) total += m;
+  std::sort(ms.begin(), ms.end());
+  LOG(INFO) << absl::StreamFormat(
+      "%8d %9.3f %9.3f %9.3f %9.3f %9.3f %8.2f %9d %9d", num_objects,
+      total / frames, ms[ms.size() / 2], ms[ms.size() * 99 / 100],
+      gate_ms / frames, assignment_ms / frames,
+      static_cast<double>(gated_pairs) / frames / num_objects, confirmed,
+      switches);
+}
+
+}  // namespace
+
+absl::Status Run() {
+  std::vector<int32_t> object_counts;
+  for (absl::string_view count :
+       absl::StrSplit(absl::GetFlag(FLAGS_objects), ',', absl::SkipEmpty())) {
+    int32_t value;
+    if (!absl::SimpleAtoi(count, &value) || value <= 0) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Bad number of objects - ", count));
+    }
+    object_counts.push_back(value);
+  }
+  if (absl::GetFlag(FLAGS_frames) <= 0) {
+    return absl::InvalidArgumentError("--frames must be positive");
+  }
+  LOG(INFO) << absl::StreamFormat(
+      "%8s %9s %9s %9s %9s %9s %8s %9s %9s", "objects", "mean_ms", "p50_ms",
+      "p99_ms", "gate_ms", "assign_ms", "pairs", "confirmed", "switches");
+  for (int32_t num_objects : object_counts) Benchmark(num_objects);
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
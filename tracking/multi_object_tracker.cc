@@ -0,0 +1,198 @@
+#include "tracking/multi_object_tracker.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include "util/trace.h"
+
+namespace hello::tracking {
+namespace {
+
+double Seconds(int64 start) {
+  return (cv::getTickCount() - start) / cv::getTickFrequency();
+}
+
+KalmanBank<4, 2>::Model ConstantVelocity(
+    const MultiObjectTracker::Options& options) {
+  // State x, y, vx, vy, measuring x, y.
+  KalmanBank<4, 2>::Model model;
+  model.transition = {1, 0, 1, 0,  //
+                      0, 1, 0, 1,  //
+                      0, 0, 1, 0,  //
+                      0, 0, 0, 1};
+  model.measurement = {1, 0, 0, 0,  //
+                       0, 1, 0, 0};
+  for (int i = 0; i < 4; ++i) {
+    model.process_noise[i * 4 + i] = options.process_noise;
+  }
+  model.measurement_noise = {options.measurement_noise, 0,  //
+                             0, options.measurement_noise};
+  return model;
+}
+
+}  // namespace
+
+MultiObjectTracker::MultiObjectTracker(const Options& options)
+    : options_(options), bank_(ConstantVelocity(options)) {}
+
+void MultiObjectTracker::Gate(const std::vector<cv::Point2f>& detections) {
+  costs_.Clear();
+  costs_.num_columns = static_cast<int32_t>(detections.size());
+  if (detections.empty()) {
+    for (int32_t t = 0; t < bank_.size(); ++t) costs_.EndRow();
+    return;
+  }
+
+  // Detections sorted into grid cells by counting.
+  float min_x = detections[0].x;
+  float min_y = detections[0].y;
+  float max_x = min_x;
+  float max_y = min_y;
+  for (const cv::Point2f& d : detections) {
+    min_x = std::min(min_x, d.x);
+    min_y = std::min(min_y, d.y);
+    max_x = std::max(max_x, d.x);
+    max_y = std::max(max_y, d.y);
+  }
+  // Cells grow for sparse detections so the grid stays within a few cells
+  // per detection.
+  const float cell_size = std::max(
+      options_.cell_size,
+      std::sqrt((max_x - min_x) * (max_y - min_y) / (4 * detections.size())));
+  const int32_t cols = static_cast<int32_t>((max_x - min_x) / cell_size) + 1;
+  const int32_t rows = static_cast<int32_t>((max_y - min_y) / cell_size) + 1;
+  auto cell_of = [&](const cv::Point2f& d) {
+    return static_cast<int32_t>((d.y - min_y) / cell_size) * cols +
+           static_cast<int32_t>((d.x - min_x) / cell_size);
+  };
+  cell_offsets_.assign(rows * cols + 1, 0);
+  for (const cv::Point2f& d : detections) ++cell_offsets_[cell_of(d) + 1];
+  for (int32_t c = 0; c < rows * cols; ++c) {
+    cell_offsets_[c + 1] += cell_offsets_[c];
+  }
+  cell_detections_.resize(detections.size());
+  cell_fill_.assign(cell_offsets_.begin(), cell_offsets_.end() - 1);
+  for (size_t i = 0; i < detections.size(); ++i) {
+    cell_detections_[cell_fill_[cell_of(detections[i])]++] =
+        static_cast<int32_t>(i);
+  }
+
+  // Cells overlapping the bounding box of the gate ellipse of each track,
+  // which extends sqrt(gate * S_ii) along axis i.
+  const float gate = options_.gate;
+  for (int32_t t = 0; t < bank_.size(); ++t) {
+    const std::array<float, 2> z = bank_.PredictedMeasurement(t);
+    const std::array<float, 4> s = bank_.InnovationCovariance(t);
+    const float det = s[0] * s[3] - s[1] * s[2];
+    const float a = s[3] / det;
+    const float b = -s[1] / det;
+    const float c = s[0] / det;
+    const float rx = std::sqrt(gate * s[0]);
+    const float ry = std::sqrt(gate * s[3]);
+    const int32_t x0 = std::max(
+        0, static_cast<int32_t>(std::floor((z[0] - rx - min_x) / cell_size)));
+    const int32_t x1 = std::min(
+        cols - 1,
+        static_cast<int32_t>(std::floor((z[0] + rx - min_x) / cell_size)));
+    const int32_t y0 = std::max(
+        0, static_cast<int32_t>(std::floor((z[1] - ry - min_y) / cell_size)));
+    const int32_t y1 = std::min(
+        rows - 1,
+        static_cast<int32_t>(std::floor((z[1] + ry - min_y) / cell_size)));
+    for (int32_t y = y0; y <= y1; ++y) {
+      for (int32_t x = x0; x <= x1; ++x) {
+        const int32_t cell = y * cols + x;
+        for (int32_t k = cell_offsets_[cell]; k < cell_offsets_[cell + 1];
+             ++k) {
+          const int32_t i = cell_detections_[k];
+          const float dx = detections[i].x - z[0];
+          const float dy = detections[i].y - z[1];
+          const float d2 = a * dx * dx + 2 * b * dx * dy + c * dy * dy;
+          if (d2 <= gate) costs_.Add(i, d2);
+        }
+      }
+    }
+    costs_.EndRow();
+  }
+}
+
+std::vector<MultiObjectTracker::Track> MultiObjectTracker::Update(
+    const std::vector<cv::Point2f>& detections) {
+  TRACE_SCOPE("tracking/multi_object_tracker");
+  const int64 start = cv::getTickCount();
+  stats_ = MultiObjectTrackerStats();
+  stats_.detections = static_cast<int32_t>(detections.size());
+  bank_.Predict();
+  const int32_t num_tracks = bank_.size();
+  stats_.tracks = num_tracks;
+
+  int64 stage = cv::getTickCount();
+  Gate(detections);
+  stats_.gated_pairs = static_cast<int32_t>(costs_.costs.size());
+  stats_.gate_seconds = Seconds(stage);
+
+  stage = cv::getTickCount();
+  const std::vector<int32_t> assignment =
+      AuctionAssignment(costs_, options_.gate, options_.assignment_epsilon);
+  stats_.assignment_seconds = Seconds(stage);
+
+  // Measurements in the plane layout of the bank, only read for matched
+  // tracks.
+  measurements_.assign(2 * num_tracks, 0);
+  matched_.assign(num_tracks, 0);
+  detection_matched_.assign(detections.size(), 0);
+  for (int32_t t = 0; t < num_tracks; ++t) {
+    const int32_t i = assignment[t];
+    lifecycles_[t].detection = i;
+    if (i < 0) continue;
+    measurements_[t] = detections[i].x;
+    measurements_[num_tracks + t] = detections[i].y;
+    matched_[t] = 1;
+    detection_matched_[i] = 1;
+    ++stats_.matched;
+  }
+  bank_.Correct(measurements_.data(), matched_.data());
+
+  // Deaths, from the back as Remove() moves the last track into the gap.
+  for (int32_t t = num_tracks - 1; t >= 0; --t) {
+    Lifecycle& lifecycle = lifecycles_[t];
+    if (matched_[t]) {
+      ++lifecycle.hits;
+      lifecycle.misses = 0;
+      continue;
+    }
+    ++lifecycle.misses;
+    if (lifecycle.misses > options_.max_misses ||
+        lifecycle.hits < options_.min_hits) {
+      bank_.Remove(t);
+      lifecycles_[t] = lifecycles_.back();
+      lifecycles_.pop_back();
+      ++stats_.deaths;
+    }
+  }
+
+  // Births.
+  const float position_variance = options_.measurement_noise;
+  const float velocity_variance = options_.initial_velocity_variance;
+  for (size_t i = 0; i < detections.size(); ++i) {
+    if (detection_matched_[i]) continue;
+    bank_.Add({detections[i].x, detections[i].y, 0, 0},
+              {position_variance, position_variance, velocity_variance,
+               velocity_variance});
+    lifecycles_.push_back({next_id_++, 1, 0, static_cast<int32_t>(i)});
+    ++stats_.births;
+  }
+
+  std::vector<Track> confirmed;
+  for (int32_t t = 0; t < bank_.size(); ++t) {
+    const Lifecycle& lifecycle = lifecycles_[t];
+    if (lifecycle.hits < options_.min_hits) continue;
+    confirmed.push_back(
+        {lifecycle.id, cv::Point2f(bank_.state(t, 0), bank_.state(t, 1)),
+         cv::Point2f(bank_.state(t, 2), bank_.state(t, 3)),
+         lifecycle.detection});
+  }
+  stats_.seconds = Seconds(start);
+  return confirmed;
+}
+
+}  // namespace hello::tracking
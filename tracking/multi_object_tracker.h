@@ -0,0 +1,110 @@
+#ifndef TRACKING_MULTI_OBJECT_TRACKER_H_
+#define TRACKING_MULTI_OBJECT_TRACKER_H_
+
+#include <cstdint>
+#include <vector>
+#include "opencv2/core.hpp"
+#include "tracking/kalman_bank.h"
+#include "tracking/sparse_assignment.h"
+
+namespace hello::tracking {
+
+// Statistics of the last frame of a MultiObjectTracker.
+struct MultiObjectTrackerStats {
+  int32_t detections = 0;
+  // Tracks after prediction, before births and deaths.
+  int32_t tracks = 0;
+  // Track and detection pairs within the gate.
+  int32_t gated_pairs = 0;
+  int32_t matched = 0;
+  int32_t births = 0;
+  int32_t deaths = 0;
+  double gate_seconds = 0;
+  double assignment_seconds = 0;
+  double seconds = 0;
+};
+
+// Tracks point objects through frames of detections with constant
+// velocity Kalman filters kept in a KalmanBank. Every frame the tracks
+// are predicted, each track is gated to the detections within a chi-square
+// bound of the Mahalanobis distance, found through a uniform grid of the
+// detections, and the gated pairs are assigned with AuctionAssignment.
+// Matched tracks are corrected, unmatched detections start tentative
+// tracks which are confirmed after min_hits matches in a row, and tracks
+// are dropped after max_misses frames without a match, tentative ones
+// after the first.
+class MultiObjectTracker {
+ public:
+  struct Options {
+    // Bound on the squared Mahalanobis distance, the 99% quantile of the
+    // chi-square distribution with 2 degrees of freedom. A track left
+    // unmatched costs as much as a detection right on the bound.
+    float gate = 9.21f;
+    // Variance added to every state element per frame.
+    float process_noise = 1;
+    // Variance of the detected positions, in pixels^2.
+    float measurement_noise = 4;
+    // Velocity variance of new tracks, in (pixels / frame)^2.
+    float initial_velocity_variance = 100;
+    int32_t min_hits = 3;
+    int32_t max_misses = 5;
+    // Side of the cells of the detection grid, in pixels.
+    float cell_size = 32;
+    // Accuracy of the assignment, see AuctionAssignment.
+    float assignment_epsilon = 1e-2f;
+  };
+
+  struct Track {
+    int64_t id;
+    cv::Point2f position;
+    // Pixels per frame.
+    cv::Point2f velocity;
+    // Index of the detection the track was matched to in the last frame,
+    // -1 for none.
+    int32_t detection;
+  };
+
+  explicit MultiObjectTracker(const Options& options);
+  MultiObjectTracker() : MultiObjectTracker(Options()) {}
+
+  // Advances by one frame with its detections, returns the confirmed
+  // tracks.
+  std::vector<Track> Update(const std::vector<cv::Point2f>& detections);
+
+  const MultiObjectTrackerStats& stats() const { return stats_; }
+  // Tentative and confirmed tracks.
+  int32_t num_tracks() const { return bank_.size(); }
+
+ private:
+  using Bank = KalmanBank<4, 2>;
+
+  struct Lifecycle {
+    int64_t id;
+    int32_t hits;
+    int32_t misses;
+    int32_t detection;
+  };
+
+  // Fills costs_ with the gated pairs, a row per track.
+  void Gate(const std::vector<cv::Point2f>& detections);
+
+  const Options options_;
+  Bank bank_;
+  // Parallel to the tracks of bank_.
+  std::vector<Lifecycle> lifecycles_;
+  int64_t next_id_ = 0;
+  MultiObjectTrackerStats stats_;
+
+  // Scratch space kept between frames.
+  SparseCostMatrix costs_;
+  std::vector<int32_t> cell_offsets_;
+  std::vector<int32_t> cell_detections_;
+  std::vector<int32_t> cell_fill_;
+  std::vector<float> measurements_;
+  std::vector<uint8_t> matched_;
+  std::vector<uint8_t> detection_matched_;
+};
+
+}  // namespace hello::tracking
+
+#endif  // TRACKING_MULTI_OBJECT_TRACKER_H_
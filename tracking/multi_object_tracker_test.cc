@@ -0,0 +1,90 @@
+#include "tracking/multi_object_tracker.h"
+#include <cstdint>
+#include <vector>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+
+namespace hello::tracking {
+namespace {
+
+using ::testing::Eq;
+using ::testing::FloatNear;
+using ::testing::SizeIs;
+
+TEST(MultiObjectTracker, ConfirmsAfterMinHits) {
+  MultiObjectTracker tracker;
+  for (int32_t frame = 0; frame < 2; ++frame) {
+    EXPECT_THAT(tracker.Update({cv::Point2f(10 + frame, 10)}), SizeIs(0));
+  }
+  const std::vector<MultiObjectTracker::Track> tracks =
+      tracker.Update({cv::Point2f(12, 10)});
+  ASSERT_THAT(tracks, SizeIs(1));
+  EXPECT_THAT(tracks[0].detection, Eq(0));
+  EXPECT_THAT(tracks[0].velocity.x, FloatNear(1, 0.3f));
+}
+
+TEST(MultiObjectTracker, DropsTentativeTracksOnMiss) {
+  MultiObjectTracker tracker;
+  tracker.Update({cv::Point2f(10, 10)});
+  EXPECT_THAT(tracker.num_tracks(), Eq(1));
+  tracker.Update({});
+  EXPECT_THAT(tracker.num_tracks(), Eq(0));
+  EXPECT_THAT(tracker.stats().deaths, Eq(1));
+}
+
+TEST(MultiObjectTracker, CoastsThroughMissesThenDrops) {
+  MultiObjectTracker::Options options;
+  options.max_misses = 2;
+  MultiObjectTracker tracker(options);
+  for (int32_t frame = 0; frame < 5; ++frame) {
+    tracker.Update({cv::Point2f(100 + 5 * frame, 50)});
+  }
+  // Coasting, the track keeps moving.
+  std::vector<MultiObjectTracker::Track> tracks = tracker.Update({});
+  ASSERT_THAT(tracks, SizeIs(1));
+  EXPECT_THAT(tracks[0].detection, Eq(-1));
+  EXPECT_THAT(tracks[0].position.x, FloatNear(125, 1));
+  EXPECT_THAT(tracker.Update({}), SizeIs(1));
+  EXPECT_THAT(tracker.Update({}), SizeIs(0));
+}
+
+TEST(MultiObjectTracker, KeepsIdentitiesOfCrossingObjects) {
+  // Two objects swap places along x on parallel lines 6 pixels apart.
+  MultiObjectTracker::Options options;
+  options.measurement_noise = 1;
+  options.process_noise = 0.01f;
+  MultiObjectTracker tracker(options);
+  std::vector<MultiObjectTracker::Track> tracks;
+  for (int32_t frame = 0; frame <= 40; ++frame) {
+    tracks = tracker.Update({cv::Point2f(4.f * frame, 100),
+                             cv::Point2f(160 - 4.f * frame, 106)});
+  }
+  ASSERT_THAT(tracks, SizeIs(2));
+  for (const MultiObjectTracker::Track& track : tracks) {
+    // Ids are given in detection order, the first object's track is 0.
+    EXPECT_THAT(track.detection, Eq(track.id));
+  }
+  EXPECT_THAT(tracker.num_tracks(), Eq(2));
+}
+
+TEST(MultiObjectTracker, AssociatesManyObjects) {
+  // A grid of objects moving together, densely enough that the gates of
+  // neighbours overlap.
+  MultiObjectTracker tracker;
+  std::vector<cv::Point2f> detections;
+  for (int32_t frame = 0; frame < 10; ++frame) {
+    detections.clear();
+    for (int32_t y = 0; y < 40; ++y) {
+      for (int32_t x = 0; x < 50; ++x) {
+        detections.emplace_back(20.f * x + 2 * frame, 20.f * y + frame);
+      }
+    }
+    tracker.Update(detections);
+  }
+  EXPECT_THAT(tracker.stats().matched, Eq(2000));
+  EXPECT_THAT(tracker.stats().births, Eq(0));
+  EXPECT_THAT(tracker.num_tracks(), Eq(2000));
+}
+
+}  // namespace
+}  // namespace hello::tracking
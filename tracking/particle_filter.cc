@@ -0,0 +1,212 @@
+#include "tracking/particle_filter.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "glog/logging.h"
+#include "util/trace.h"
+
+namespace hello::tracking {
+namespace {
+
+constexpr float kPi = static_cast<float>(CV_PI);
+constexpr float kTwoPi = static_cast<float>(2 * CV_PI);
+
+// Generator of chunk `chunk` in step `step`, -1 for draws that are not
+// per chunk.
+cv::RNG ChunkRng(uint64_t seed, int64_t step, int32_t chunk) {
+  // splitmix64 of the three.
+  uint64_t x = seed ^ (static_cast<uint64_t>(step) << 24) ^
+               static_cast<uint64_t>(static_cast<int64_t>(chunk));
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return cv::RNG(x ^ (x >> 31));
+}
+
+// `options`, which must have particles to size the arrays with.
+const AngularParticleFilter::Options& Checked(
+    const AngularParticleFilter::Options& options) {
+  CHECK_GT(options.num_particles, 0);
+  return options;
+}
+
+}  // namespace
+
+AngularParticleFilter::AngularParticleFilter(const Options& options)
+    : options_(Checked(options)),
+      angles_(options.num_particles),
+      velocities_(options.num_particles),
+      weights_(options.num_particles, 1),
+      weight_sum_(options.num_particles),
+      cos_(options.num_particles),
+      sin_(options.num_particles),
+      chunk_max_(num_chunks()),
+      chunk_sums_(num_chunks()),
+      resampled_angles_(options.num_particles),
+      resampled_velocities_(options.num_particles),
+      effective_sample_size_(options.num_particles) {
+  cv::parallel_for_(cv::Range(0, num_chunks()), [&](const cv::Range& range) {
+    for (int32_t c = range.start; c < range.end; ++c) {
+      const int32_t begin = c * kChunk;
+      const int32_t n = std::min(kChunk, options_.num_particles - begin);
+      cv::RNG rng = ChunkRng(options_.seed, step_, c);
+      rng.fill(cv::Mat(1, n, CV_32F, angles_.data() + begin),
+               cv::RNG::UNIFORM, -kPi, kPi);
+      rng.fill(cv::Mat(1, n, CV_32F, velocities_.data() + begin),
+               cv::RNG::NORMAL, 0, options_.initial_velocity_sigma);
+    }
+  });
+}
+
+void AngularParticleFilter::Predict() {
+  TRACE_SCOPE("tracking/particle_filter/predict");
+  ++step_;
+  const float sigma = std::sqrt(options_.process_noise);
+  cv::parallel_for_(cv::Range(0, num_chunks()), [&](const cv::Range& range) {
+    float angle_noise[kChunk];
+    float velocity_noise[kChunk];
+    for (int32_t c = range.start; c < range.end; ++c) {
+      const int32_t begin = c * kChunk;
+      const int32_t n = std::min(kChunk, options_.num_particles - begin);
+      cv::RNG rng = ChunkRng(options_.seed, step_, c);
+      rng.fill(cv::Mat(1, n, CV_32F, angle_noise), cv::RNG::NORMAL, 0, sigma);
+      rng.fill(cv::Mat(1, n, CV_32F, velocity_noise), cv::RNG::NORMAL, 0,
+               sigma);
+      float* __restrict angles = angles_.data() + begin;
+      float* __restrict velocities = velocities_.data() + begin;
+      for (int32_t i = 0; i < n; ++i) {
+        const float angle = angles[i] + velocities[i] + angle_noise[i];
+        // Kept in [-pi, pi) so that float precision doesn't run out.
+        angles[i] = angle - kTwoPi * std::floor((angle + kPi) / kTwoPi);
+        velocities[i] += velocity_noise[i];
+      }
+    }
+  });
+}
+
+void AngularParticleFilter::Correct(const cv::Point2f& measurement) {
+  TRACE_SCOPE("tracking/particle_filter/correct");
+  const float radius = options_.radius;
+  const float zx = measurement.x;
+  const float zy = measurement.y;
+  const float scale = -0.5f / options_.measurement_noise;
+
+  // Log likelihoods are taken relative to their maximum, so the first pass
+  // finds it.
+  cv::parallel_for_(cv::Range(0, num_chunks()), [&](const cv::Range& range) {
+    for (int32_t c = range.start; c < range.end; ++c) {
+      const int32_t begin = c * kChunk;
+      const int32_t n = std::min(kChunk, options_.num_particles - begin);
+      const float* __restrict angles = angles_.data() + begin;
+      float* __restrict cosines = cos_.data() + begin;
+      float* __restrict sines = sin_.data() + begin;
+      float max_log_likelihood = -std::numeric_limits<float>::infinity();
+      for (int32_t i = 0; i < n; ++i) {
+        cosines[i] = std::cos(angles[i]);
+        sines[i] = std::sin(angles[i]);
+        const float dx = radius * cosines[i] - zx;
+        const float dy = radius * sines[i] - zy;
+        max_log_likelihood =
+            std::max(max_log_likelihood, scale * (dx * dx + dy * dy));
+      }
+      chunk_max_[c] = max_log_likelihood;
+    }
+  });
+  const float max_log_likelihood =
+      *std::max_element(chunk_max_.begin(), chunk_max_.end());
+
+  // The previous weights are normalized on the way.
+  const float normalization = static_cast<float>(1 / weight_sum_);
+  cv::parallel_for_(cv::Range(0, num_chunks()), [&](const cv::Range& range) {
+    for (int32_t c = range.start; c < range.end; ++c) {
+      const int32_t begin = c * kChunk;
+      const int32_t n = std::min(kChunk, options_.num_particles - begin);
+      const float* __restrict cosines = cos_.data() + begin;
+      const float* __restrict sines = sin_.data() + begin;
+      const float* __restrict velocities = velocities_.data() + begin;
+      float* __restrict weights = weights_.data() + begin;
+      for (int32_t i = 0; i < n; ++i) {
+        const float dx = radius * cosines[i] - zx;
+        const float dy = radius * sines[i] - zy;
+        weights[i] *= normalization * std::exp(scale * (dx * dx + dy * dy) -
+                                               max_log_likelihood);
+      }
+      std::array<double, 5> sums = {0, 0, 0, 0, 0};
+      for (int32_t i = 0; i < n; ++i) {
+        sums[0] += weights[i];
+        sums[1] += weights[i] * weights[i];
+        sums[2] += weights[i] * cosines[i];
+        sums[3] += weights[i] * sines[i];
+        sums[4] += weights[i] * velocities[i];
+      }
+      chunk_sums_[c] = sums;
+    }
+  });
+  std::array<double, 5> sums = {0, 0, 0, 0, 0};
+  for (const std::array<double, 5>& chunk : chunk_sums_) {
+    for (int k = 0; k < 5; ++k) sums[k] += chunk[k];
+  }
+  if (!(sums[0] > 0)) {
+    // Every weight underflowed, the measurement is too unlikely to tell
+    // the particles apart.
+    std::fill(weights_.begin(), weights_.end(), 1.f);
+    weight_sum_ = options_.num_particles;
+    effective_sample_size_ = options_.num_particles;
+    return;
+  }
+  weight_sum_ = sums[0];
+  effective_sample_size_ = sums[0] * sums[0] / sums[1];
+  angle_ = static_cast<float>(std::atan2(sums[3], sums[2]));
+  angular_velocity_ = static_cast<float>(sums[4] / sums[0]);
+
+  if (effective_sample_size_ <
+      options_.resample_threshold * options_.num_particles) {
+    Resample();
+  }
+}
+
+void AngularParticleFilter::Resample() {
+  TRACE_SCOPE("tracking/particle_filter/resample");
+  ++num_resamples_;
+  // New particle j is the one where the normalized cumulative weight
+  // passes (offset + j) / num_particles. Chunk c holds the cumulative
+  // weights [starts[c], starts[c + 1]) and places the new particles whose
+  // positions fall in it.
+  const int32_t num_particles = options_.num_particles;
+  std::vector<double> starts(num_chunks() + 1, 0);
+  for (int32_t c = 0; c < num_chunks(); ++c) {
+    starts[c + 1] = starts[c] + chunk_sums_[c][0] / weight_sum_;
+  }
+  const double offset = ChunkRng(options_.seed, step_, -1).uniform(0., 1.);
+  auto first_new = [&](int32_t c) {
+    if (c == num_chunks()) return num_particles;
+    return std::clamp(
+        static_cast<int32_t>(std::ceil(starts[c] * num_particles - offset)),
+        0, num_particles);
+  };
+  cv::parallel_for_(cv::Range(0, num_chunks()), [&](const cv::Range& range) {
+    for (int32_t c = range.start; c < range.end; ++c) {
+      const int32_t begin = c * kChunk;
+      const int32_t end = std::min(begin + kChunk, num_particles);
+      const int32_t j_end = first_new(c + 1);
+      double cumulative = starts[c] * num_particles;
+      int32_t i = begin;
+      double next = cumulative + weights_[i] * num_particles / weight_sum_;
+      for (int32_t j = first_new(c); j < j_end; ++j) {
+        while (next <= offset + j && i + 1 < end) {
+          cumulative = next;
+          ++i;
+          next = cumulative + weights_[i] * num_particles / weight_sum_;
+        }
+        resampled_angles_[j] = angles_[i];
+        resampled_velocities_[j] = velocities_[i];
+      }
+    }
+  });
+  angles_.swap(resampled_angles_);
+  velocities_.swap(resampled_velocities_);
+  std::fill(weights_.begin(), weights_.end(), 1.f);
+  weight_sum_ = num_particles;
+}
+
+}  // namespace hello::tracking
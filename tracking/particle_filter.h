@@ -0,0 +1,90 @@
+#ifndef TRACKING_PARTICLE_FILTER_H_
+#define TRACKING_PARTICLE_FILTER_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "opencv2/core.hpp"
+
+namespace hello::tracking {
+
+// Particle filter for the angular motion model of Kalman(): the state is
+// the angle and the angular velocity, and the measurement is the point the
+// angle projects to on a circle, radius * (cos, sin), which is nonlinear in
+// the state. Particles are kept as a structure of arrays and processed in
+// chunks across cores: propagation and likelihood are plain loops over
+// the arrays, and resampling is systematic, with every chunk placing its
+// own share of the new particles from a prefix sum of the weights. Each
+// chunk draws from its own generator seeded by the step and the chunk, so
+// runs are repeatable whatever the number of threads.
+class AngularParticleFilter {
+ public:
+  struct Options {
+    // Must be positive.
+    int32_t num_particles = 100000;
+    uint64_t seed = 0x5eed;
+    // Radius of the circle in pixels.
+    float radius = 166;
+    // Variance of the angle and the angular velocity noise per step.
+    float process_noise = 1e-5f;
+    // Variance of the measured coordinates in pixels^2.
+    float measurement_noise = 16;
+    // Initial angles are uniform, initial velocities normal with this
+    // standard deviation.
+    float initial_velocity_sigma = 0.1f;
+    // Resamples when the effective sample size drops below this fraction
+    // of the particles.
+    float resample_threshold = 0.5f;
+  };
+
+  // Particles processed by one task.
+  static constexpr int32_t kChunk = 4096;
+
+  explicit AngularParticleFilter(const Options& options);
+  AngularParticleFilter() : AngularParticleFilter(Options()) {}
+
+  // Moves the particles through the motion model.
+  void Predict();
+  // Weighs the particles by the likelihood of the measured point, relative
+  // to the center of the circle, and resamples if needed.
+  void Correct(const cv::Point2f& measurement);
+
+  // Weighted circular mean of the angles, in (-pi, pi].
+  float angle() const { return angle_; }
+  // Weighted mean of the angular velocities.
+  float angular_velocity() const { return angular_velocity_; }
+  double effective_sample_size() const { return effective_sample_size_; }
+  int32_t num_resamples() const { return num_resamples_; }
+
+ private:
+  int32_t num_chunks() const {
+    return (options_.num_particles + kChunk - 1) / kChunk;
+  }
+  void Resample();
+
+  const Options options_;
+  int64_t step_ = 0;
+  std::vector<float> angles_;
+  std::vector<float> velocities_;
+  // Unnormalized, summing to weight_sum_.
+  std::vector<float> weights_;
+  double weight_sum_;
+  // cos and sin of the angles during Correct().
+  std::vector<float> cos_;
+  std::vector<float> sin_;
+  // Per chunk largest log likelihood, and sums of the weight, the squared
+  // weight, and the weighted cos, sin and velocity.
+  std::vector<float> chunk_max_;
+  std::vector<std::array<double, 5>> chunk_sums_;
+  // Resampling double buffers.
+  std::vector<float> resampled_angles_;
+  std::vector<float> resampled_velocities_;
+  float angle_ = 0;
+  float angular_velocity_ = 0;
+  double effective_sample_size_;
+  int32_t num_resamples_ = 0;
+};
+
+}  // namespace hello::tracking
+
+#endif  // TRACKING_PARTICLE_FILTER_H_
@@ -0,0 +1,174 @@
+// Convergence and timing of AngularParticleFilter against the linear
+// cv::KalmanFilter of Kalman() on a seeded run of the angular motion
+// model. Measurements are points on the circle, the Kalman filter is given
+// their angle unwrapped next to its prediction. The particles start with
+// uniform angles, the Kalman filter at 0 with unit variance as in Kalman().
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "opencv2/core.hpp"
+#include "opencv2/video/tracking.hpp"
+#include "tracking/particle_filter.h"
+
+ABSL_FLAG(std::string, particles, "10000,100000,1000000",
+          "Comma separated numbers of particles");
+ABSL_FLAG(int32_t, steps, 200, "Steps of the run");
+ABSL_FLAG(uint64_t, seed, 0x5eed, "Seed of the run and the particles");
+ABSL_FLAG(double, converged_error, 0.05,
+          "Angle error in radians below which a filter counts as converged");
+
+namespace {
+
+double Milliseconds(int64 start) {
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+float AngleDifference(float a, float b) {
+  return static_cast<float>(std::remainder(a - b, 2 * CV_PI));
+}
+
+struct Trajectory {
+  std::vector<float> angles;
+  std::vector<cv::Point2f> measurements;
+};
+
+Trajectory Simulate(
+    const hello::tracking::AngularParticleFilter::Options& options,
+    int32_t steps) {
+  cv::RNG rng(options.seed);
+  Trajectory trajectory;
+  float angle = static_cast<float>(rng.uniform(-CV_PI, CV_PI));
+  float velocity = static_cast<float>(rng.gaussian(0.1));
+  const double process_sigma = std::sqrt(options.process_noise);
+  const double measurement_sigma = std::sqrt(options.measurement_noise);
+  for (int32_t step = 0; step < steps; ++step) {
+    angle += velocity + static_cast<float>(rng.gaussian(process_sigma));
+    velocity += static_cast<float>(rng.gaussian(process_sigma));
+    trajectory.angles.push_back(angle);
+    trajectory.measurements.emplace_back(
+        options.radius * std::cos(angle) +
+            static_cast<float>(rng.gaussian(measurement_sigma)),
+        options.radius * std::sin(angle) +
+            static_cast<float>(rng.gaussian(measurement_sigma)));
+  }
+  return trajectory;
+}
+
+// Logs the time per step, the first step from which the error stays
+// below --converged_error, and the RMS error from there on.
+void Report(const std::string& name, const std::vector<float>& errors,
+            double ms) {
+  const float converged_error =
+      static_cast<float>(absl::GetFlag(FLAGS_converged_error));
+  size_t converged = errors.size();
+  while (converged > 0 && std::abs(errors[converged - 1]) < converged_error) {
+    --converged;
+  }
+  double sum = 0;
+  for (size_t i = converged; i < errors.size(); ++i) {
+    sum += errors[i] * errors[i];
+  }
+  const size_t n = errors.size() - converged;
+  LOG(INFO) << absl::StreamFormat(
+      "%-16s %10.3f %10s %12s", name, ms / errors.size(),
+      n == 0 ? std::string("never") : absl::StrCat(converged),
+      n == 0 ? std::string("-")
+             : absl::StrFormat("%.5f", std::sqrt(sum / n)));
+}
+
+void RunKalmanFilter(
+    const hello::tracking::AngularParticleFilter::Options& options,
+    const Trajectory& trajectory) {
+  cv::KalmanFilter filter(2, 1, 0);
+  filter.transitionMatrix = (cv::Mat_<float>(2, 2) << 1, 1, 0, 1);
+  cv::setIdentity(filter.measurementMatrix, cv::Scalar(1));
+  cv::setIdentity(filter.processNoiseCov, cv::Scalar(options.process_noise));
+  // The angle noise of a point measured with the given pixel noise.
+  cv::setIdentity(filter.measurementNoiseCov,
+                  cv::Scalar(options.measurement_noise /
+                             (options.radius * options.radius)));
+  cv::setIdentity(filter.errorCovPost, cv::Scalar(1));
+  cv::Mat z(1, 1, CV_32F);
+  std::vector<float> errors;
+  double ms = 0;
+  for (size_t step = 0; step < trajectory.angles.size(); ++step) {
+    const int64 start = cv::getTickCount();
+    const float predicted = filter.predict().at<float>(0);
+    const cv::Point2f& m = trajectory.measurements[step];
+    const float measured = std::atan2(m.y, m.x);
+    z.at<float>(0) = predicted + AngleDifference(measured, predicted);
+    filter.correct(z);
+    ms += Milliseconds(start);
+    errors.push_back(AngleDifference(filter.statePost.at<float>(0),
+                                     trajectory.angles[step]));
+  }
+  Report("KalmanFilter", errors, ms);
+}
+
+void RunParticleFilter(
+    const hello::tracking::AngularParticleFilter::Options& options,
+    const Trajectory& trajectory) {
+  hello::tracking::AngularParticleFilter filter(options);
+  std::vector<float> errors;
+  double ms = 0;
+  for (size_t step = 0; step < trajectory.angles.size(); ++step) {
+    const int64 start = cv::getTickCount();
+    filter.Predict();
+    filter.Correct(trajectory.measurements[step]);
+    ms += Milliseconds(start);
+    errors.push_back(AngleDifference(filter.angle(), trajectory.angles[step]));
+  }
+  Report(absl::StrCat("particles ", options.num_particles), errors, ms);
+}
+
+}  // namespace
+
+absl::Status Run() {
+  std::vector<int32_t> particle_counts;
+  for (absl::string_view count : absl::StrSplit(
+           absl::GetFlag(FLAGS_particles), ',', absl::SkipEmpty())) {
+    int32_t value;
+    if (!absl::SimpleAtoi(count, &value) || value <= 0) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Bad number of particles - ", count));
+    }
+    particle_counts.push_back(value);
+  }
+  const int32_t steps = absl::GetFlag(FLAGS_steps);
+  if (steps <= 0) {
+    return absl::InvalidArgumentError("--steps must be positive");
+  }
+  hello::tracking::AngularParticleFilter::Options options;
+  options.seed = absl::GetFlag(FLAGS_seed);
+  const Trajectory trajectory = Simulate(options, steps);
+  LOG(INFO) << absl::StreamFormat("%-16s %10s %10s %12s", "filter",
+                                  "ms_per_step", "converged", "rms_error");
+  RunKalmanFilter(options, trajectory);
+  for (int32_t num_particles : particle_counts) {
+    options.num_particles = num_particles;
+    RunParticleFilter(options, trajectory);
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  FLAGS_alsologtostderr = true;
+  auto status = Run();
+  if (!status.ok()) {
+    LOG(ERROR) << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
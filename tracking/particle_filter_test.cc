@@ -0,0 +1,80 @@
+#include "tracking/particle_filter.h"
+#include <cmath>
+#include <cstdint>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+#include "opencv2/core.hpp"
+
+namespace hello::tracking {
+namespace {
+
+using ::testing::Eq;
+using ::testing::FloatNear;
+using ::testing::Gt;
+
+// Difference of two angles in [-pi, pi].
+float AngleDifference(float a, float b) {
+  return static_cast<float>(std::remainder(a - b, 2 * CV_PI));
+}
+
+cv::Point2f Project(float angle, float radius) {
+  return cv::Point2f(radius * std::cos(angle), radius * std::sin(angle));
+}
+
+TEST(AngularParticleFilter, ConvergesToTheTrajectory) {
+  AngularParticleFilter::Options options;
+  options.num_particles = 20000;
+  AngularParticleFilter filter(options);
+  // Wraps around the circle more than once.
+  float angle = 2;
+  const float velocity = 0.1f;
+  for (int32_t step = 0; step < 100; ++step) {
+    angle += velocity;
+    filter.Predict();
+    filter.Correct(Project(angle, options.radius));
+  }
+  EXPECT_THAT(AngleDifference(filter.angle(), angle), FloatNear(0, 0.02f));
+  EXPECT_THAT(filter.angular_velocity(), FloatNear(velocity, 0.01f));
+}
+
+TEST(AngularParticleFilter, IsRepeatable) {
+  AngularParticleFilter::Options options;
+  options.num_particles = 3 * AngularParticleFilter::kChunk + 17;
+  auto run = [&options]() {
+    AngularParticleFilter filter(options);
+    for (int32_t step = 0; step < 10; ++step) {
+      filter.Predict();
+      filter.Correct(Project(0.3f * step, options.radius));
+    }
+    return filter;
+  };
+  const int threads = cv::getNumThreads();
+  cv::setNumThreads(1);
+  const AngularParticleFilter single = run();
+  cv::setNumThreads(threads);
+  const AngularParticleFilter parallel = run();
+  EXPECT_THAT(single.angle(), Eq(parallel.angle()));
+  EXPECT_THAT(single.angular_velocity(), Eq(parallel.angular_velocity()));
+  EXPECT_THAT(single.num_resamples(), Eq(parallel.num_resamples()));
+}
+
+TEST(AngularParticleFilter, ResamplesDegenerateWeights) {
+  AngularParticleFilter::Options options;
+  options.num_particles = 10000;
+  options.measurement_noise = 1;
+  AngularParticleFilter filter(options);
+  filter.Predict();
+  // Few of the uniformly spread particles are within a few pixels.
+  filter.Correct(Project(1, options.radius));
+  EXPECT_THAT(filter.num_resamples(), Eq(1));
+  EXPECT_THAT(filter.angle(), FloatNear(1, 0.02f));
+  // The resampled particles are all near the measurement, so the same
+  // measurement again keeps the weight spread over many of them.
+  filter.Predict();
+  filter.Correct(Project(1, options.radius));
+  EXPECT_THAT(filter.effective_sample_size(),
+              Gt(0.01 * options.num_particles));
+}
+
+}  // namespace
+}  // namespace hello::tracking
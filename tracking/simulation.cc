@@ -0,0 +1,151 @@
+#include "tracking/simulation.h"
+#include <array>
+#include <cmath>
+#include <vector>
+#include "opencv2/core.hpp"
+#include "opencv2/video/tracking.hpp"
+#include "tracking/kalman_bank.h"
+
+namespace hello::tracking {
+namespace {
+
+double Seconds(int64 start) {
+  return (cv::getTickCount() - start) / cv::getTickFrequency();
+}
+
+// Targets and measurements, drawn from one generator in a fixed order so
+// that every filter sees the same run.
+class Scenario {
+ public:
+  explicit Scenario(const SimulationOptions& options)
+      : options_(options),
+        rng_(options.seed),
+        angles_(options.targets),
+        velocities_(options.targets),
+        initial_estimates_(options.targets),
+        measurements_(options.targets) {
+    for (int32_t t = 0; t < options.targets; ++t) {
+      angles_[t] = static_cast<float>(rng_.gaussian(0.1));
+      velocities_[t] = static_cast<float>(rng_.gaussian(0.1));
+      initial_estimates_[t] = {static_cast<float>(rng_.gaussian(0.1)),
+                               static_cast<float>(rng_.gaussian(0.1))};
+    }
+  }
+
+  const std::array<float, 2>& initial_estimate(int32_t t) const {
+    return initial_estimates_[t];
+  }
+  const std::vector<float>& measurements() const { return measurements_; }
+
+  // Measures the angles of the current step.
+  void Measure() {
+    const double sigma = std::sqrt(options_.measurement_noise);
+    for (int32_t t = 0; t < options_.targets; ++t) {
+      measurements_[t] = angles_[t] + static_cast<float>(rng_.gaussian(sigma));
+    }
+  }
+
+  // Moves on to the next step.
+  void Advance() {
+    const double sigma = std::sqrt(options_.process_noise);
+    for (int32_t t = 0; t < options_.targets; ++t) {
+      angles_[t] += velocities_[t] + static_cast<float>(rng_.gaussian(sigma));
+      velocities_[t] += static_cast<float>(rng_.gaussian(sigma));
+    }
+  }
+
+  float SquaredError(int32_t t, float angle) const {
+    return (angle - angles_[t]) * (angle - angles_[t]);
+  }
+
+ private:
+  const SimulationOptions options_;
+  cv::RNG rng_;
+  std::vector<float> angles_;
+  std::vector<float> velocities_;
+  std::vector<std::array<float, 2>> initial_estimates_;
+  std::vector<float> measurements_;
+};
+
+}  // namespace
+
+double SimulationTrace::RmsError() const {
+  if (squared_errors.empty()) return 0;
+  double sum = 0;
+  for (float e : squared_errors) sum += e;
+  return std::sqrt(sum / squared_errors.size());
+}
+
+SimulationTrace SimulateKalmanFilter(const SimulationOptions& options) {
+  Scenario scenario(options);
+  std::vector<cv::KalmanFilter> filters(options.targets);
+  for (int32_t t = 0; t < options.targets; ++t) {
+    cv::KalmanFilter& filter = filters[t];
+    filter.init(2, 1, 0);
+    filter.transitionMatrix = (cv::Mat_<float>(2, 2) << 1, 1, 0, 1);
+    cv::setIdentity(filter.measurementMatrix, cv::Scalar(1));
+    cv::setIdentity(filter.processNoiseCov, cv::Scalar(options.process_noise));
+    cv::setIdentity(filter.measurementNoiseCov,
+                    cv::Scalar(options.measurement_noise));
+    cv::setIdentity(filter.errorCovPost, cv::Scalar(1));
+    filter.statePost.at<float>(0) = scenario.initial_estimate(t)[0];
+    filter.statePost.at<float>(1) = scenario.initial_estimate(t)[1];
+  }
+
+  SimulationTrace trace;
+  trace.squared_errors.reserve(options.steps);
+  trace.seconds.reserve(options.steps);
+  cv::Mat z(1, 1, CV_32F);
+  for (int32_t step = 0; step < options.steps; ++step) {
+    scenario.Measure();
+    const int64 start = cv::getTickCount();
+    for (int32_t t = 0; t < options.targets; ++t) {
+      filters[t].predict();
+      z.at<float>(0) = scenario.measurements()[t];
+      filters[t].correct(z);
+    }
+    trace.seconds.push_back(Seconds(start));
+    double error = 0;
+    for (int32_t t = 0; t < options.targets; ++t) {
+      error += scenario.SquaredError(t, filters[t].statePost.at<float>(0));
+    }
+    trace.squared_errors.push_back(
+        static_cast<float>(error / options.targets));
+    scenario.Advance();
+  }
+  return trace;
+}
+
+SimulationTrace SimulateKalmanBank(const SimulationOptions& options) {
+  Scenario scenario(options);
+  KalmanBank<2, 1>::Model model;
+  model.transition = {1, 1, 0, 1};
+  model.measurement = {1, 0};
+  model.process_noise = {options.process_noise, 0, 0, options.process_noise};
+  model.measurement_noise = {options.measurement_noise};
+  KalmanBank<2, 1> bank(model, options.targets);
+  for (int32_t t = 0; t < options.targets; ++t) {
+    bank.Add(scenario.initial_estimate(t), 1);
+  }
+
+  SimulationTrace trace;
+  trace.squared_errors.reserve(options.steps);
+  trace.seconds.reserve(options.steps);
+  for (int32_t step = 0; step < options.steps; ++step) {
+    scenario.Measure();
+    const int64 start = cv::getTickCount();
+    bank.Predict();
+    bank.Correct(scenario.measurements().data());
+    trace.seconds.push_back(Seconds(start));
+    double error = 0;
+    for (int32_t t = 0; t < options.targets; ++t) {
+      error += scenario.SquaredError(t, bank.state(t, 0));
+    }
+    trace.squared_errors.push_back(
+        static_cast<float>(error / options.targets));
+    scenario.Advance();
+  }
+  return trace;
+}
+
+}  // namespace hello::tracking
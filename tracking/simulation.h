@@ -0,0 +1,41 @@
+#ifndef TRACKING_SIMULATION_H_
+#define TRACKING_SIMULATION_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace hello::tracking {
+
+// Headless, seeded version of the simulation in Kalman(): targets rotate
+// at a constant angular velocity disturbed by process noise, the state is
+// the angle and the angular velocity and only the angle is measured.
+struct SimulationOptions {
+  uint64_t seed = 0x5eed;
+  int32_t steps = 10000;
+  // Independent targets, each with its own filter.
+  int32_t targets = 1;
+  // Variances, as in Kalman().
+  float process_noise = 1e-5f;
+  float measurement_noise = 1e-1f;
+};
+
+// Per step records of a simulation run.
+struct SimulationTrace {
+  // Squared angle error of the corrected estimates, averaged over the
+  // targets.
+  std::vector<float> squared_errors;
+  // Time spent in the filters, the simulation itself excluded.
+  std::vector<double> seconds;
+
+  double RmsError() const;
+};
+
+// Every run with the same options sees the same targets and measurements.
+// With one cv::KalmanFilter per target.
+SimulationTrace SimulateKalmanFilter(const SimulationOptions& options);
+// With all targets in a KalmanBank<2, 1>.
+SimulationTrace SimulateKalmanBank(const SimulationOptions& options);
+
+}  // namespace hello::tracking
+
+#endif  // TRACKING_SIMULATION_H_
@@ -0,0 +1,42 @@
+#include "tracking/simulation.h"
+#include <cmath>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+
+namespace hello::tracking {
+namespace {
+
+using ::testing::DoubleNear;
+using ::testing::Eq;
+using ::testing::Lt;
+using ::testing::Ne;
+using ::testing::SizeIs;
+
+TEST(Simulation, IsDeterministic) {
+  SimulationOptions options;
+  options.steps = 200;
+  options.targets = 3;
+  const SimulationTrace first = SimulateKalmanBank(options);
+  const SimulationTrace second = SimulateKalmanBank(options);
+  ASSERT_THAT(first.squared_errors, SizeIs(200));
+  EXPECT_THAT(first.seconds, SizeIs(200));
+  EXPECT_THAT(first.squared_errors, Eq(second.squared_errors));
+
+  options.seed += 1;
+  EXPECT_THAT(SimulateKalmanBank(options).squared_errors,
+              Ne(first.squared_errors));
+}
+
+TEST(Simulation, FiltersAgreeAndBeatTheMeasurements) {
+  SimulationOptions options;
+  options.steps = 500;
+  options.targets = 10;
+  const SimulationTrace opencv = SimulateKalmanFilter(options);
+  const SimulationTrace bank = SimulateKalmanBank(options);
+  EXPECT_THAT(bank.RmsError(), DoubleNear(opencv.RmsError(), 1e-4));
+  EXPECT_THAT(bank.RmsError(),
+              Lt(0.5 * std::sqrt(options.measurement_noise)));
+}
+
+}  // namespace
+}  // namespace hello::tracking
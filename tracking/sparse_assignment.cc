@@ -0,0 +1,99 @@
+#include "tracking/sparse_assignment.h"
+#include <algorithm>
+#include <limits>
+
+namespace hello::tracking {
+
+std::vector<int32_t> AuctionAssignment(const SparseCostMatrix& costs,
+                                       float unassigned_cost, float epsilon) {
+  const int32_t num_rows = costs.num_rows();
+  const int32_t num_columns = costs.num_columns;
+  std::vector<int32_t> assignment(num_rows, -1);
+  if (num_rows == 0) return assignment;
+
+  // The auction needs as many bidders as objects for epsilon scaling to be
+  // sound, so the problem is made square and kept sparse: bidders are the
+  // rows and a stand-in for every column, objects the columns and a
+  // stand-in for every row. Row r may take column c at its cost or its own
+  // stand-in at unassigned_cost. The stand-in of column c may take c or,
+  // at no cost, the stand-in of any row that could take c, which is free
+  // whenever that row took c. Objects are numbered columns first.
+  const int32_t size = num_rows + num_columns;
+  std::vector<int32_t> offsets(size + 1, 0);
+  for (int32_t r = 0; r < num_rows; ++r) {
+    offsets[r + 1] = costs.row_offsets[r + 1] - costs.row_offsets[r] + 1;
+  }
+  for (int32_t c : costs.columns) ++offsets[num_rows + c + 1];
+  for (int32_t c = 0; c < num_columns; ++c) ++offsets[num_rows + c + 1];
+  for (int32_t b = 0; b < size; ++b) offsets[b + 1] += offsets[b];
+  std::vector<int32_t> objects(offsets[size]);
+  std::vector<float> benefits(offsets[size]);
+  std::vector<int32_t> fill(offsets.begin(), offsets.end() - 1);
+  auto add = [&](int32_t bidder, int32_t object, float benefit) {
+    objects[fill[bidder]] = object;
+    benefits[fill[bidder]++] = benefit;
+  };
+  for (int32_t r = 0; r < num_rows; ++r) {
+    for (int32_t e = costs.row_offsets[r]; e < costs.row_offsets[r + 1];
+         ++e) {
+      add(r, costs.columns[e], -costs.costs[e]);
+      add(num_rows + costs.columns[e], num_columns + r, 0);
+    }
+    add(r, num_columns + r, -unassigned_cost);
+  }
+  for (int32_t c = 0; c < num_columns; ++c) add(num_rows + c, c, 0);
+
+  float low = -unassigned_cost;
+  float high = 0;
+  for (float benefit : benefits) {
+    low = std::min(low, benefit);
+    high = std::max(high, benefit);
+  }
+  std::vector<double> prices(size, 0);
+  std::vector<int32_t> owners(size);
+  std::vector<int32_t> bidder_objects(size);
+  std::vector<int32_t> unassigned;
+  unassigned.reserve(size);
+  double scaled_epsilon = std::max<double>((high - low) / 4, epsilon);
+  for (;;) {
+    // Prices carry over from the previous phase, assignments are redone.
+    std::fill(owners.begin(), owners.end(), -1);
+    unassigned.clear();
+    for (int32_t b = size - 1; b >= 0; --b) unassigned.push_back(b);
+    while (!unassigned.empty()) {
+      const int32_t b = unassigned.back();
+      unassigned.pop_back();
+      // Bid for the object of the highest benefit minus price, raising its
+      // price by the margin over the second best plus epsilon.
+      int32_t best = -1;
+      double best_value = -std::numeric_limits<double>::infinity();
+      double second_value = -std::numeric_limits<double>::infinity();
+      for (int32_t e = offsets[b]; e < offsets[b + 1]; ++e) {
+        const double value = benefits[e] - prices[objects[e]];
+        if (value > best_value) {
+          second_value = best_value;
+          best_value = value;
+          best = objects[e];
+        } else if (value > second_value) {
+          second_value = value;
+        }
+      }
+      if (second_value == -std::numeric_limits<double>::infinity()) {
+        second_value = best_value;
+      }
+      prices[best] += best_value - second_value + scaled_epsilon;
+      const int32_t outbid = owners[best];
+      owners[best] = b;
+      bidder_objects[b] = best;
+      if (outbid >= 0) unassigned.push_back(outbid);
+    }
+    if (scaled_epsilon <= epsilon) break;
+    scaled_epsilon = std::max<double>(scaled_epsilon / 4, epsilon);
+  }
+  for (int32_t r = 0; r < num_rows; ++r) {
+    if (bidder_objects[r] < num_columns) assignment[r] = bidder_objects[r];
+  }
+  return assignment;
+}
+
+}  // namespace hello::tracking
@@ -0,0 +1,48 @@
+#ifndef TRACKING_SPARSE_ASSIGNMENT_H_
+#define TRACKING_SPARSE_ASSIGNMENT_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace hello::tracking {
+
+// Cost matrix in compressed rows: the entries of row r are
+// [row_offsets[r], row_offsets[r + 1]) of `columns` and `costs`. Missing
+// entries are pairs that may not be assigned.
+struct SparseCostMatrix {
+  int32_t num_columns = 0;
+  std::vector<int32_t> row_offsets = {0};
+  std::vector<int32_t> columns;
+  std::vector<float> costs;
+
+  int32_t num_rows() const {
+    return static_cast<int32_t>(row_offsets.size()) - 1;
+  }
+  void Add(int32_t column, float cost) {
+    columns.push_back(column);
+    costs.push_back(cost);
+  }
+  // Ends the current row.
+  void EndRow() { row_offsets.push_back(static_cast<int32_t>(costs.size())); }
+  void Clear() {
+    row_offsets.assign(1, 0);
+    columns.clear();
+    costs.clear();
+  }
+};
+
+// Assigns every row at most one column and every column at most one row,
+// minimizing the total cost where a row left unassigned costs
+// `unassigned_cost`. Solved with the auction algorithm with epsilon
+// scaling on a square problem built from the entries of the sparse matrix
+// alone, so the work follows the number of entries rather than
+// rows * columns. The total cost is within (num_rows() + num_columns) *
+// `epsilon` of the optimum. Returns the column of every row, -1 for
+// unassigned rows.
+std::vector<int32_t> AuctionAssignment(const SparseCostMatrix& costs,
+                                       float unassigned_cost,
+                                       float epsilon = 1e-3f);
+
+}  // namespace hello::tracking
+
+#endif  // TRACKING_SPARSE_ASSIGNMENT_H_
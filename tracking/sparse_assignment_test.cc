@@ -0,0 +1,107 @@
+#include "tracking/sparse_assignment.h"
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+
+namespace hello::tracking {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::FloatNear;
+using ::testing::SizeIs;
+
+// Dense matrix with kMissing for pairs that may not be assigned.
+constexpr float kMissing = -1;
+
+SparseCostMatrix ToSparse(const std::vector<std::vector<float>>& dense,
+                          int32_t num_columns) {
+  SparseCostMatrix costs;
+  costs.num_columns = num_columns;
+  for (const std::vector<float>& row : dense) {
+    for (int32_t c = 0; c < num_columns; ++c) {
+      if (row[c] != kMissing) costs.Add(c, row[c]);
+    }
+    costs.EndRow();
+  }
+  return costs;
+}
+
+float TotalCost(const std::vector<std::vector<float>>& dense,
+                const std::vector<int32_t>& assignment,
+                float unassigned_cost) {
+  float total = 0;
+  for (size_t r = 0; r < assignment.size(); ++r) {
+    total += assignment[r] < 0 ? unassigned_cost : dense[r][assignment[r]];
+  }
+  return total;
+}
+
+// Lowest total cost over all assignments of rows >= r.
+float BruteForce(const std::vector<std::vector<float>>& dense, size_t r,
+                 std::vector<bool>& used, float unassigned_cost) {
+  if (r == dense.size()) return 0;
+  float best = unassigned_cost + BruteForce(dense, r + 1, used,
+                                            unassigned_cost);
+  for (size_t c = 0; c < used.size(); ++c) {
+    if (used[c] || dense[r][c] == kMissing) continue;
+    used[c] = true;
+    best = std::min(best, dense[r][c] + BruteForce(dense, r + 1, used,
+                                                   unassigned_cost));
+    used[c] = false;
+  }
+  return best;
+}
+
+TEST(AuctionAssignment, Empty) {
+  EXPECT_THAT(AuctionAssignment(SparseCostMatrix(), 1), SizeIs(0));
+}
+
+TEST(AuctionAssignment, ResolvesConflicts) {
+  // Both rows prefer column 0, giving it to row 1 is cheaper overall.
+  const std::vector<std::vector<float>> dense = {{1, 2}, {1, 5}};
+  EXPECT_THAT(AuctionAssignment(ToSparse(dense, 2), 10), ElementsAre(1, 0));
+}
+
+TEST(AuctionAssignment, LeavesExpensiveRowsUnassigned) {
+  const std::vector<std::vector<float>> dense = {{1, kMissing},
+                                                 {2, kMissing},
+                                                 {kMissing, kMissing}};
+  EXPECT_THAT(AuctionAssignment(ToSparse(dense, 2), 3),
+              ElementsAre(0, -1, -1));
+}
+
+TEST(AuctionAssignment, MatchesBruteForce) {
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<float> cost(0, 10);
+  std::uniform_int_distribution<int32_t> size(1, 6);
+  for (int32_t trial = 0; trial < 200; ++trial) {
+    const int32_t num_rows = size(rng);
+    const int32_t num_columns = size(rng);
+    std::vector<std::vector<float>> dense(num_rows,
+                                          std::vector<float>(num_columns));
+    for (std::vector<float>& row : dense) {
+      for (float& c : row) c = cost(rng) < 4 ? kMissing : cost(rng);
+    }
+    const float unassigned_cost = 6;
+    const std::vector<int32_t> assignment =
+        AuctionAssignment(ToSparse(dense, num_columns), unassigned_cost);
+    std::vector<bool> used(num_columns, false);
+    for (size_t r = 0; r < assignment.size(); ++r) {
+      if (assignment[r] < 0) continue;
+      ASSERT_NE(dense[r][assignment[r]], kMissing);
+      ASSERT_FALSE(used[assignment[r]]);
+      used[assignment[r]] = true;
+    }
+    std::fill(used.begin(), used.end(), false);
+    EXPECT_THAT(TotalCost(dense, assignment, unassigned_cost),
+                FloatNear(BruteForce(dense, 0, used, unassigned_cost),
+                          (num_rows + num_columns) * 1e-3f))
+        << "trial " << trial;
+  }
+}
+
+}  // namespace
+}  // namespace hello::tracking
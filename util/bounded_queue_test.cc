@@ -0,0 +1,47 @@
+#include "util/bounded_queue.h"
+#include <thread>
+#include <vector>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+
+namespace hello::util {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Optional;
+
+TEST(BoundedQueue, TryPushFailsWhenFull) {
+  BoundedQueue<int> queue(2);
+  EXPECT_TRUE(queue.TryPush(1));
+  EXPECT_TRUE(queue.TryPush(2));
+  EXPECT_FALSE(queue.TryPush(3));
+  EXPECT_THAT(queue.size(), Eq(2));
+  EXPECT_THAT(queue.Pop(), Optional(1));
+  EXPECT_TRUE(queue.TryPush(3));
+}
+
+TEST(BoundedQueue, CloseDrainsThenStops) {
+  BoundedQueue<int> queue(4);
+  ASSERT_TRUE(queue.Push(1));
+  queue.Close();
+  EXPECT_FALSE(queue.Push(2));
+  EXPECT_THAT(queue.Pop(), Optional(1));
+  EXPECT_THAT(queue.Pop(), Eq(std::nullopt));
+}
+
+TEST(BoundedQueue, DeliversEverythingInOrderAcrossThreads) {
+  constexpr int kItems = 10000;
+  BoundedQueue<int> queue(8);
+  std::thread producer([&] {
+    for (int i = 0; i < kItems; ++i) ASSERT_TRUE(queue.Push(i));
+    queue.Close();
+  });
+  std::vector<int> received;
+  while (auto item = queue.Pop()) received.push_back(*item);
+  producer.join();
+  ASSERT_THAT(received.size(), Eq(kItems));
+  for (int i = 0; i < kItems; ++i) EXPECT_THAT(received[i], Eq(i));
+}
+
+}  // namespace
+}  // namespace hello::util
@@ -0,0 +1,202 @@
+#include "util/trace.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+
+namespace hello::util {
+namespace {
+
+constexpr double kNanosPerMs = 1e6;
+
+int FloorLog2(uint64_t value) {
+  int result = 0;
+  while (value >>= 1) ++result;
+  return result;
+}
+
+std::string JsonEscape(absl::string_view text) {
+  std::string result;
+  result.reserve(text.size());
+  for (const char c : text) {
+    if (c == '"' || c == '\\') result.push_back('\\');
+    result.push_back(c);
+  }
+  return result;
+}
+
+}  // namespace
+
+int LatencyHistogram::Bucket(int64_t nanos) {
+  if (nanos < kSubBuckets) return static_cast<int>(std::max<int64_t>(nanos, 0));
+  // Values in [2^e, 2^(e+1)) are split into kSubBuckets equal buckets.
+  const int exponent = FloorLog2(static_cast<uint64_t>(nanos));
+  const int sub_bucket = static_cast<int>(nanos >> (exponent - 4)) & 15;
+  return (exponent - 3) * kSubBuckets + sub_bucket;
+}
+
+int64_t LatencyHistogram::UpperBound(int bucket) {
+  if (bucket < kSubBuckets) return bucket;
+  const int exponent = bucket / kSubBuckets + 3;
+  const int64_t sub_bucket = bucket % kSubBuckets;
+  const int64_t lower = (kSubBuckets + sub_bucket) << (exponent - 4);
+  return lower + (int64_t{1} << (exponent - 4)) - 1;
+}
+
+void LatencyHistogram::Add(int64_t nanos) {
+  ++counts_[Bucket(nanos)];
+  ++count_;
+  total_ += nanos;
+  max_ = std::max(max_, nanos);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  for (int i = 0; i < kBuckets; ++i) counts_[i] += other.counts_[i];
+  count_ += other.count_;
+  total_ += other.total_;
+  max_ = std::max(max_, other.max_);
+}
+
+int64_t LatencyHistogram::Percentile(double quantile) const {
+  if (count_ == 0) return 0;
+  const int64_t rank = std::max<int64_t>(
+      1, static_cast<int64_t>(std::ceil(quantile * count_)));
+  int64_t seen = 0;
+  for (int i = 0; i < kBuckets; ++i) {
+    seen += counts_[i];
+    if (seen >= rank) return std::min(UpperBound(i), max_);
+  }
+  return max_;
+}
+
+Tracer& Tracer::Get() {
+  static Tracer* tracer = new Tracer();
+  return *tracer;
+}
+
+Tracer::Tracer() : origin_(std::chrono::steady_clock::now()) {}
+
+int64_t Tracer::Now() const {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - origin_)
+      .count();
+}
+
+Tracer::ThreadBuffer& Tracer::LocalBuffer() {
+  thread_local std::shared_ptr<ThreadBuffer> buffer;
+  if (buffer == nullptr) {
+    buffer = std::make_shared<ThreadBuffer>();
+    absl::MutexLock lock(&mutex_);
+    buffer->thread_id = static_cast<int32_t>(buffers_.size()) + 1;
+    buffers_.push_back(buffer);
+  }
+  return *buffer;
+}
+
+void Tracer::Record(const char* name, int64_t start_ns, int64_t end_ns) {
+  ThreadBuffer& buffer = LocalBuffer();
+  absl::MutexLock lock(&buffer.mutex);
+  if (buffer.events.size() < kMaxEventsPerThread) {
+    buffer.events.push_back({name, start_ns, end_ns});
+  }
+  auto stage = std::find_if(buffer.stages.begin(), buffer.stages.end(),
+                            [&](const Stage& s) { return s.name == name; });
+  if (stage == buffer.stages.end()) {
+    buffer.stages.push_back({name, LatencyHistogram()});
+    stage = std::prev(buffer.stages.end());
+  }
+  stage->histogram.Add(end_ns - start_ns);
+}
+
+std::vector<StageSummary> Tracer::Summary() const {
+  // The same literal may have different addresses in different translation
+  // units, so stages are merged by value.
+  std::map<std::string, LatencyHistogram> merged;
+  {
+    absl::MutexLock lock(&mutex_);
+    for (const auto& buffer : buffers_) {
+      absl::MutexLock buffer_lock(&buffer->mutex);
+      for (const Stage& stage : buffer->stages) {
+        merged[stage.name].Merge(stage.histogram);
+      }
+    }
+  }
+  std::vector<StageSummary> summary;
+  summary.reserve(merged.size());
+  for (const auto& [name, histogram] : merged) {
+    StageSummary stage;
+    stage.name = name;
+    stage.count = histogram.count();
+    stage.mean_ms = histogram.total() / kNanosPerMs /
+                    std::max<int64_t>(histogram.count(), 1);
+    stage.p50_ms = histogram.Percentile(0.50) / kNanosPerMs;
+    stage.p95_ms = histogram.Percentile(0.95) / kNanosPerMs;
+    stage.p99_ms = histogram.Percentile(0.99) / kNanosPerMs;
+    stage.max_ms = histogram.max() / kNanosPerMs;
+    summary.push_back(std::move(stage));
+  }
+  return summary;
+}
+
+std::string Tracer::SummaryTable() const {
+  const std::vector<StageSummary> summary = Summary();
+  size_t width = 5;
+  for (const auto& stage : summary) width = std::max(width, stage.name.size());
+  std::string table =
+      absl::StrFormat("%-*s %8s %10s %10s %10s %10s %10s\n", width, "stage",
+                      "count", "mean_ms", "p50_ms", "p95_ms", "p99_ms",
+                      "max_ms");
+  for (const auto& stage : summary) {
+    absl::StrAppendFormat(&table,
+                          "%-*s %8d %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+                          width, stage.name, stage.count, stage.mean_ms,
+                          stage.p50_ms, stage.p95_ms, stage.p99_ms,
+                          stage.max_ms);
+  }
+  return table;
+}
+
+absl::Status Tracer::WriteChromeTrace(absl::string_view file_path) const {
+  std::ofstream file{std::string(file_path)};
+  if (!file.is_open()) {
+    return absl::InternalError(
+        absl::StrFormat("Could not open file for writing: %s", file_path));
+  }
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  absl::MutexLock lock(&mutex_);
+  for (const auto& buffer : buffers_) {
+    absl::MutexLock buffer_lock(&buffer->mutex);
+    for (const Event& event : buffer->events) {
+      // Complete events, timestamps are in microseconds.
+      file << (first ? "\n" : ",\n")
+           << absl::StrFormat(
+                  "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                  "\"ts\":%.3f,\"dur\":%.3f}",
+                  JsonEscape(event.name), buffer->thread_id,
+                  event.start_ns / 1e3,
+                  (event.end_ns - event.start_ns) / 1e3);
+      first = false;
+    }
+  }
+  file << "\n]}\n";
+  file.close();
+  if (file.fail()) {
+    return absl::InternalError(
+        absl::StrFormat("Failed to write trace to %s", file_path));
+  }
+  return absl::OkStatus();
+}
+
+void Tracer::Clear() {
+  absl::MutexLock lock(&mutex_);
+  for (const auto& buffer : buffers_) {
+    absl::MutexLock buffer_lock(&buffer->mutex);
+    buffer->events.clear();
+    buffer->stages.clear();
+  }
+}
+
+}  // namespace hello::util
@@ -0,0 +1,141 @@
+#ifndef UTIL_TRACE_H_
+#define UTIL_TRACE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+namespace hello::util {
+
+// Latency distribution of one stage. Buckets are log-linear, 16 per power of
+// two, so percentiles are within ~6% of the recorded value.
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBuckets = 16;
+  static constexpr int kBuckets = 64 * kSubBuckets;
+
+  void Add(int64_t nanos);
+  void Merge(const LatencyHistogram& other);
+  // Returns the upper bound of the bucket holding the given quantile in [0, 1].
+  int64_t Percentile(double quantile) const;
+
+  int64_t count() const { return count_; }
+  int64_t total() const { return total_; }
+  int64_t max() const { return max_; }
+
+ private:
+  static int Bucket(int64_t nanos);
+  static int64_t UpperBound(int bucket);
+
+  std::vector<int64_t> counts_ = std::vector<int64_t>(kBuckets);
+  int64_t count_ = 0;
+  int64_t total_ = 0;
+  int64_t max_ = 0;
+};
+
+struct StageSummary {
+  std::string name;
+  int64_t count = 0;
+  double mean_ms = 0;
+  double p50_ms = 0;
+  double p95_ms = 0;
+  double p99_ms = 0;
+  double max_ms = 0;
+};
+
+// Process wide collector of spans. Every thread records into its own buffer,
+// the only lock taken on the hot path is the uncontended one of that buffer.
+class Tracer {
+ public:
+  // Spans kept per thread for the Chrome trace, histograms keep counting
+  // after that.
+  static constexpr size_t kMaxEventsPerThread = 1 << 20;
+
+  static Tracer& Get();
+
+  void SetEnabled(bool enabled) { enabled_.store(enabled); }
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // `name` must outlive the tracer, string literals are expected.
+  void Record(const char* name, int64_t start_ns, int64_t end_ns);
+
+  // Nanoseconds since the tracer was created.
+  int64_t Now() const;
+
+  // Per-stage statistics of all the threads sorted by name.
+  std::vector<StageSummary> Summary() const;
+  // Summary() as an aligned text table.
+  std::string SummaryTable() const;
+
+  // Writes all the recorded spans in Chrome trace_event JSON format, it can be
+  // opened with chrome://tracing or https://ui.perfetto.dev.
+  absl::Status WriteChromeTrace(absl::string_view file_path) const;
+
+  // Drops everything recorded so far.
+  void Clear();
+
+ private:
+  struct Event {
+    const char* name;
+    int64_t start_ns;
+    int64_t end_ns;
+  };
+  struct Stage {
+    const char* name;
+    LatencyHistogram histogram;
+  };
+  struct ThreadBuffer {
+    int32_t thread_id;
+    absl::Mutex mutex;
+    std::vector<Event> events ABSL_GUARDED_BY(mutex);
+    // Few stages per thread, linear search by pointer beats hashing.
+    std::vector<Stage> stages ABSL_GUARDED_BY(mutex);
+  };
+
+  Tracer();
+  ThreadBuffer& LocalBuffer();
+
+  const std::chrono::steady_clock::time_point origin_;
+  std::atomic<bool> enabled_{true};
+  mutable absl::Mutex mutex_;
+  // Buffers are shared so they outlive the threads that filled them.
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Records the time spent in the enclosing scope.
+class ScopedSpan {
+ public:
+  explicit ScopedSpan(const char* name)
+      : name_(Tracer::Get().enabled() ? name : nullptr),
+        start_ns_(name_ != nullptr ? Tracer::Get().Now() : 0) {}
+  ~ScopedSpan() {
+    if (name_ != nullptr) {
+      Tracer::Get().Record(name_, start_ns_, Tracer::Get().Now());
+    }
+  }
+  ScopedSpan(const ScopedSpan&) = delete;
+  ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+ private:
+  const char* const name_;
+  const int64_t start_ns_;
+};
+
+}  // namespace hello::util
+
+#define TRACE_INTERNAL_CONCAT2(a, b) a##b
+#define TRACE_INTERNAL_CONCAT(a, b) TRACE_INTERNAL_CONCAT2(a, b)
+
+// TRACE_SCOPE("module/stage"); times the rest of the enclosing scope.
+#define TRACE_SCOPE(name)                                    \
+  ::hello::util::ScopedSpan TRACE_INTERNAL_CONCAT(trace_span_, \
+                                                  __LINE__)(name)
+
+#endif  // UTIL_TRACE_H_
@@ -0,0 +1,84 @@
+#include "util/trace.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "gmock/gmock-matchers.h"
+#include "gtest/gtest.h"
+
+namespace hello::util {
+namespace {
+
+using ::testing::AllOf;
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::HasSubstr;
+using ::testing::Le;
+using ::testing::SizeIs;
+
+TEST(LatencyHistogram, PercentilesAreWithinBucketError) {
+  LatencyHistogram histogram;
+  for (int64_t i = 1; i <= 1000; ++i) histogram.Add(i * 1000);
+  EXPECT_THAT(histogram.count(), Eq(1000));
+  EXPECT_THAT(histogram.max(), Eq(1000000));
+  EXPECT_THAT(histogram.Percentile(0.5), AllOf(Ge(500000), Le(500000 * 1.07)));
+  EXPECT_THAT(histogram.Percentile(0.99),
+              AllOf(Ge(990000), Le(1000000)));
+  EXPECT_THAT(histogram.Percentile(1.0), Eq(1000000));
+}
+
+TEST(LatencyHistogram, SmallValuesAreExact) {
+  LatencyHistogram histogram;
+  for (int64_t i = 0; i < 16; ++i) histogram.Add(i);
+  EXPECT_THAT(histogram.Percentile(0.5), Eq(7));
+}
+
+TEST(Tracer, CollectsSpansFromAllThreads) {
+  Tracer::Get().Clear();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([] {
+      for (int i = 0; i < 100; ++i) {
+        TRACE_SCOPE("test/outer");
+        TRACE_SCOPE("test/inner");
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  const std::vector<StageSummary> summary = Tracer::Get().Summary();
+  ASSERT_THAT(summary, SizeIs(2));
+  EXPECT_THAT(summary[0].name, Eq("test/inner"));
+  EXPECT_THAT(summary[0].count, Eq(400));
+  EXPECT_THAT(summary[1].name, Eq("test/outer"));
+  EXPECT_THAT(summary[1].count, Eq(400));
+  EXPECT_THAT(summary[1].p99_ms, Ge(summary[1].p50_ms));
+  EXPECT_THAT(Tracer::Get().SummaryTable(), HasSubstr("test/outer"));
+}
+
+TEST(Tracer, DisabledTracerRecordsNothing) {
+  Tracer::Get().Clear();
+  Tracer::Get().SetEnabled(false);
+  { TRACE_SCOPE("test/disabled"); }
+  Tracer::Get().SetEnabled(true);
+  EXPECT_THAT(Tracer::Get().Summary(), SizeIs(0));
+}
+
+TEST(Tracer, WritesChromeTrace) {
+  Tracer::Get().Clear();
+  { TRACE_SCOPE("test/\"quoted\""); }
+  const std::string file_path =
+      ::testing::TempDir() + "/trace_test_chrome.json";
+  ASSERT_TRUE(Tracer::Get().WriteChromeTrace(file_path).ok());
+  std::ifstream file(file_path);
+  std::stringstream content;
+  content << file.rdbuf();
+  EXPECT_THAT(content.str(), HasSubstr("\"traceEvents\""));
+  EXPECT_THAT(content.str(), HasSubstr("\"ph\":\"X\""));
+  EXPECT_THAT(content.str(), HasSubstr("test/\\\"quoted\\\""));
+  std::remove(file_path.c_str());
+}
+
+}  // namespace
+}  // namespace hello::util